@@ -25,6 +25,7 @@
 // --- I2C шина (BMP280 x2, ADS1115) ---
 #define PIN_I2C_SDA         21
 #define PIN_I2C_SCL         9       // GPIO9 (GPIO22 не существует на S3!)
+#define I2C_FREQ_HZ         400000  // Fast mode
 
 // --- OneWire (DS18B20 x7) ---
 #define PIN_ONEWIRE         4
@@ -150,29 +151,87 @@
 #define SAFETY_VOLTAGE_MIN          190.0f  // V - низкое напряжение
 #define SAFETY_VOLTAGE_MAX          250.0f  // V - высокое напряжение
 #define SAFETY_SENSOR_TIMEOUT_MS    5000    // мс - таймаут датчика
+#define SAFETY_TSA_FORECAST_SEC     60      // Предупреждение: прогноз T_TSA по тренду
 
 // Давление (множители от P_захлёб)
 #define PRESSURE_WORK_MULT          0.75f   // Рабочее
 #define PRESSURE_WARN_MULT          0.90f   // Предупреждение
 #define PRESSURE_CRIT_MULT          1.05f   // Аварийное
+#define PRESSURE_TARGET_MULT        0.85f   // Уставка регулятора мощности (WattControl)
+
+// Регулятор мощности по давлению (модель + прогноз)
+#define WATT_CONTROL_PERIOD_MS      2000    // Шаг модели и пересчёта мощности
+#define WATT_FLOOD_HOLD_MS          30000   // Удержание сниженной мощности после захлёба
+#define WATT_FLOOD_BACKOFF          0.95f   // Снижение уставки на каждый захлёб
+#define WATT_TARGET_MIN_MULT        0.65f   // Уставка не ниже этой доли P_захлёб
+#define WATT_WARN_STEP_PERCENT      2       // Снижение за шаг выше порога предупреждения
+#define WATT_RISE_STEP_PERCENT      2       // Подъём мощности за шаг не больше
+#define WATT_FALL_STEP_PERCENT      5       // Снижение мощности за шаг не больше
+
+// Калибровка захлёба: ступенчатый подъём мощности при работе "на себя"
+#define FLOOD_CAL_START_PERCENT     50      // Мощность первой ступени, %
+#define FLOOD_CAL_STEP_PERCENT      5       // Шаг мощности, %
+#define FLOOD_CAL_STEP_SEC          120     // Длительность ступени (вторая половина - замер)
+#define FLOOD_CAL_STABILIZE_MIN     10      // Стабилизация перед первой ступенью, мин
+#define FLOOD_CAL_SLOPE_RATIO       2.5f    // Излом dP/dW относительно начальных ступеней
+#define FLOOD_CAL_STD_RATIO         3.0f    // Рост СКО давления относительно начальных ступеней
 
 // =============================================================================
 // ПАРАМЕТРЫ РЕЖИМОВ
 // =============================================================================
 
+// Разгон: прогноз кипения и снижение мощности заранее. T кипения - по
+// крепости загрузки из плана и давлению, без неё максимум до пара в колонне
+#define HEATUP_TAPER_MIN            10      // Снижение мощности за ~10 мин до кипения
+#define HEATUP_WORK_PERCENT         60      // Рабочая мощность без калибровки захлёба, %
+#define HEATUP_OVERSHOOT_MIN        10      // Окно оценки перерегулирования давления, мин
+
 // Авто-ректификация
 #define RECT_STABILIZATION_TIME_MIN 20      // Стабилизация "на себя", мин
 #define RECT_STABILIZATION_DELTA    0.1f    // °C за 5 мин
 #define RECT_HEADS_PERCENT_DEFAULT  8       // % голов от АС
 #define RECT_HEADS_SPEED_ML_H_KW    50      // мл/час на кВт
+#define RECT_HEADS_ABV_FALLBACK     40.0f   // % об. загрузки, если крепость в кубе не оценена
+#define RECT_HEADS_FLAT_SLOPE       0.05f   // °C/мин - тренд T верха царги выровнялся (~СКО оценки)
+#define RECT_HEADS_FLAT_SEC         120     // Ровный тренд перед концом голов, сек
+#define RECT_HEADS_EXTEND_MAX       0.5f    // Продление голов без выравнивания - до +50% объёма
 #define RECT_PURGE_TIME_MIN         10      // Продувка между фракциями
 
+// Дистилляция
+#define DIST_POWER_STEPS            4       // Ступеней мощности по T куба в плане
+#define DIST_HEADS_SPEED_MULT       0.5f    // Скорость отбора голов от скорости плана
+#define DIST_HEAT_LOSS_W            150     // Потери куба и царги при кипении, Вт
+#define DIST_FORECAST_INTERVAL_MS   10000   // Пересчёт прогноза окончания
+#define DIST_FINISH_COOL_MS         (5UL * 60 * 1000)
+
+// Прогноз окончания ректификации (баланс АС)
+#define RUN_ETA_INTERVAL_MS         10000   // Пересчёт прогноза
+#define RUN_ETA_WINDOW_SEC          600     // Окно оценки скорости отбора
+#define RUN_ETA_RATE_ALPHA          0.2f    // Вес нового окна в средней скорости
+#define RUN_ETA_ABV_SIGMA           3.0f    // % об. - погрешность крепости в кубе по T кипения
+#define RUN_ETA_TAILS_ABV           3.0f    // % об. в кубе на конце тела
+#define RUN_ETA_TAILS_DIST_ABV      80.0f   // % об. отбора хвостов
+#define RUN_ETA_MAX_SEC             (72UL * 3600)
+
+// Фильтр температур (Калман: температура + скорость, на каждый DS18B20)
+#define TEMP_KF_MEAS_STD            0.04f   // °C - шум и квантование DS18B20
+#define TEMP_KF_ACCEL_STD           0.0002f // °C/с² - изменение скорости нагрева
+#define TEMP_KF_SETTLE_SIGMA        0.03f   // °C - оценка готова при меньшем СКО
+#define TEMP_KF_OUTLIER_DELTA       1.0f    // °C - отскок от прогноза (одиночный сбой)
+#define TEMP_KF_OUTLIER_COUNT       3       // Отскоков подряд - реальный скачок, перезапуск
+#define TEMP_KF_TIMEOUT_MS          10000   // Без показаний - оценка недействительна
+
 // Smart Decrement
 #define DECREMENT_TRIGGER_DELTA     0.15f   // °C выше T_base → стоп
 #define DECREMENT_RESUME_DELTA      0.10f   // °C выше T_base → старт
+#define DECREMENT_FORECAST_SEC      120     // Рост по тренду: стоп, если прогноз выше порога
+#define DECREMENT_PRESSURE_LOG_STEP 0.05f   // °C изменения барометрической поправки для записи в лог
 #define DECREMENT_WAIT_MAX_SEC      300     // Макс. ожидание, сек
 #define DECREMENT_SPEED_MULT        0.85f   // Множитель снижения
 #define DECREMENT_MIN_SPEED_ML_H_KW 50      // Минимум → хвосты
+#define DECREMENT_STABLE_SEC        600     // Стабильная T царги до пробы увеличения, сек
+#define DECREMENT_INCREASE_ML_H_KW  10      // Шаг пробного увеличения
+#define DECREMENT_INCREASE_MAX_MULT 1.3f    // Потолок увеличения от скорости плана
 
 // УНО цикл
 #define UNO_ON_SEC_DEFAULT          3       // Клапан открыт, сек
@@ -205,7 +264,7 @@
 #define INTERVAL_FLOW_READ          1000    // Чтение потока воды
 #define INTERVAL_DISPLAY_UPDATE     250     // Обновление дисплея
 #define INTERVAL_WEB_BROADCAST      1000    // WebSocket broadcast
-#define INTERVAL_LOG_WRITE          5000    // Запись в лог
+#define INTERVAL_LOG_WRITE          1000    // Запись в лог (1 Гц, все каналы)
 #define INTERVAL_SAFETY_CHECK       100     // Проверка безопасности
 
 // =============================================================================
@@ -219,22 +278,55 @@
 #define WEB_SERVER_PORT             80
 #define WEBSOCKET_PORT              81
 
+// Команды управления (веб, MQTT, Telegram, кнопки -> задача loop)
+#define COMMAND_QUEUE_SIZE          8       // Степень двойки
+#define COMMAND_REPLY_TIMEOUT_MS    1000    // Ожидание результата в сетевом обработчике
+
 // =============================================================================
 // SPIFFS
 // =============================================================================
 
 #define LOG_FILE_PREFIX             "/logs/"
-#define LOG_FILE_EXT                ".csv"
-#define LOG_MAX_SIZE_BYTES          1048576 // 1 МБ на файл
-#define LOG_MAX_FILES               10
+#define LOG_FILE_EXT                ".bin"
+#define LOG_MAX_SIZE_BYTES          524288  // 512 КБ на сегмент (~2 ч при 1 Гц)
+#define LOG_BUDGET_BYTES            4194304 // 4 МБ на /logs из 8.4 МБ раздела (~17 ч)
+#define LOG_MIN_FREE_BYTES          1048576 // Свободно в разделе для /history, /profiles, UI
+#define LOG_BLOCK_SIZE              4096    // Блок записи = страница флеш
+#define LOG_RING_RECORDS            1024    // Кольцо записей (64 КБ в PSRAM)
+#define LOG_RING_RECORDS_FALLBACK   128     // Без PSRAM (8 КБ во внутренней RAM)
+#define LOG_FLUSH_TIMEOUT_MS        120000  // Сброс неполного блока (при 1 Гц блок полон за 64 с)
+#define LOG_TASK_STACK              4096
+#define LOG_TASK_PRIORITY           1       // Ниже сетевых задач ядра 0
+#define LOG_TASK_CORE               0
+#define LOG_EVENTS_KEEP             16      // Последние события в RAM
+
+// Фоновый импорт профилей (разбор JSON и запись во флеш)
+#define PROFILE_IMPORT_TASK_STACK   8192
+#define PROFILE_IMPORT_TASK_PRIORITY 1
+#define PROFILE_IMPORT_TASK_CORE    0
+
+// Бортовой самописец (RTC-память, переживает сброс)
+#define FLIGHT_SAMPLES              120     // 2 минуты при 1 Гц
+#define FLIGHT_EVENTS               12
+#define FLIGHT_SAMPLE_INTERVAL_MS   1000
+#define CRASH_DIR                   "/crash"
+#define CRASH_REPORT_FILE           "/crash/last.json"
+#define CRASH_REPORT_PREV           "/crash/prev.json"
 
 // =============================================================================
 // NVS NAMESPACE
 // =============================================================================
 
 #define NVS_NAMESPACE               "smartcol"
-
-// Ключи NVS
+#define NVS_KEY_SETTINGS            "settings"  // Блоб Settings с заголовком и CRC
+#define SETTINGS_SCHEMA_VERSION     2       // v2: floodCal
+#define NVS_WRITE_DELAY_MS          2000    // Пауза после последнего изменения до записи
+#define NVS_FLUSH_TIMEOUT_MS        1000    // Ожидание записи задачей при flush()
+#define NVS_TASK_STACK              4096
+#define NVS_TASK_PRIORITY           1
+#define NVS_TASK_CORE               0
+
+// Ключи NVS (до версии схемы 1, читаются только при миграции)
 #define NVS_KEY_WIFI_SSID           "wifi_ssid"
 #define NVS_KEY_WIFI_PASS           "wifi_pass"
 #define NVS_KEY_TG_TOKEN            "tg_token"
@@ -263,6 +355,32 @@
 #define PID_KD_DEFAULT              1.0f
 #define PID_OUTPUT_MIN              0
 #define PID_OUTPUT_MAX              100
+#define PID_D_FILTER_SEC            5.0f    // Постоянная фильтра производной, с
+
+// Автонастройка релейным методом (Острём-Хэгглунд)
+#define AUTOTUNE_HYSTERESIS         0.2f    // °C - гистерезис реле (> шума DS18B20)
+#define AUTOTUNE_CYCLES             3       // Согласованных циклов для расчёта
+#define AUTOTUNE_MAX_CYCLES         10      // Циклов до отказа
+#define AUTOTUNE_TOLERANCE          0.2f    // Допустимый разброс периода и амплитуды
+#define AUTOTUNE_MAX_MIN            240     // Ограничение длительности, мин
+#define AUTOTUNE_SETPOINT_MIN       30.0f   // °C куба
+#define AUTOTUNE_SETPOINT_MAX       95.0f
+
+// Затирка и Hold: ступени с рампой, прямая связь по потерям + ПИД
+#define MASH_MAX_STEPS              7       // Ступеней в профиле затирки
+#define MASH_PROFILE_COUNT          3       // Профилей затирки в настройках
+#define HOLD_SETPOINT_MIN           20.0f   // °C выдержки (старт Hold из API/MQTT)
+#define HOLD_SETPOINT_MAX           100.0f
+#define MASH_RAMP_RATE              1.0f    // °C/мин - подъём уставки между ступенями
+#define MASH_RAMP_LEAD              1.0f    // °C - уставка не уходит дальше от T куба
+#define MASH_HOLD_BAND              0.3f    // °C - допуск выдержки, вне его таймер стоит
+#define MASH_TRIM_PERCENT           25      // ±% - поправка ПИД к прямой связи
+#define MASH_LOSS_W_K_DEFAULT       8.0f    // Вт/°C - потери до первой оценки
+#define MASH_LOSS_LEARN             0.2f    // Вес нового окна в оценке потерь
+#define MASH_LEARN_MS               60000   // Окно оценки потерь на выдержке
+#define MASH_AMBIENT_TEMP           20.0f   // °C помещения (если куб на старте теплее)
+#define MASH_HEAT_J_L_K             4186.0f // Теплоёмкость затора (как вода), Дж/(л·°C)
+#define MASH_FINISH_MS              60000   // Пауза после последней ступени
 
 // =============================================================================
 // ШИМ
@@ -301,11 +419,13 @@
 #define DEBUG_LEVEL                 2       // 0=OFF, 1=ERROR, 2=INFO, 3=DEBUG
 
 #if DEBUG_SERIAL
-    #define LOG_E(fmt, ...) if(DEBUG_LEVEL >= 1) Serial.printf("[E] " fmt "\n", ##__VA_ARGS__)
-    #define LOG_WARN(fmt, ...) if(DEBUG_LEVEL >= 2) Serial.printf("[W] " fmt "\n", ##__VA_ARGS__)
+    // Отложенный вывод: форматирование и Serial в задаче логгера (deferred_log.h)
+    #include "deferred_log.h"
+    #define LOG_E(fmt, ...) do { if (DEBUG_LEVEL >= 1) DeferredLog::write(DLOG_LEVEL_E, "" fmt, ##__VA_ARGS__); } while (0)
+    #define LOG_WARN(fmt, ...) do { if (DEBUG_LEVEL >= 2) DeferredLog::write(DLOG_LEVEL_W, "" fmt, ##__VA_ARGS__); } while (0)
     #define LOG_W(fmt, ...) LOG_WARN(fmt, ##__VA_ARGS__)  // Алиас для совместимости
-    #define LOG_I(fmt, ...) if(DEBUG_LEVEL >= 2) Serial.printf("[I] " fmt "\n", ##__VA_ARGS__)
-    #define LOG_D(fmt, ...) if(DEBUG_LEVEL >= 3) Serial.printf("[D] " fmt "\n", ##__VA_ARGS__)
+    #define LOG_I(fmt, ...) do { if (DEBUG_LEVEL >= 2) DeferredLog::write(DLOG_LEVEL_I, "" fmt, ##__VA_ARGS__); } while (0)
+    #define LOG_D(fmt, ...) do { if (DEBUG_LEVEL >= 3) DeferredLog::write(DLOG_LEVEL_D, "" fmt, ##__VA_ARGS__); } while (0)
 #else
     #define LOG_E(fmt, ...)
     #define LOG_WARN(fmt, ...)
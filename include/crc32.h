@@ -0,0 +1,46 @@
+/**
+ * Smart-Column S3 - CRC32
+ *
+ * CRC-32 (IEEE 802.3, полином 0xEDB88320) для контроля целостности
+ * бинарных структур в NVS и LittleFS. Полубайтовая таблица - 64 байта.
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Продолжение расчёта CRC32
+ * @param crc Предыдущее значение (0 для начала)
+ * @param data Данные
+ * @param len Длина
+ * @return Новое значение CRC32
+ */
+inline uint32_t crc32Update(uint32_t crc, const void* data, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    while (len--) {
+        crc = table[(crc ^ *p) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (*p >> 4)) & 0x0F] ^ (crc >> 4);
+        p++;
+    }
+    return ~crc;
+}
+
+/**
+ * CRC32 блока данных
+ */
+inline uint32_t crc32(const void* data, size_t len) {
+    return crc32Update(0, data, len);
+}
+
+#endif // CRC32_H
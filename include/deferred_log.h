@@ -0,0 +1,202 @@
+/**
+ * Smart-Column S3 - Deferred Log
+ *
+ * Отложенное логирование для макросов LOG_*.
+ *
+ * На вызывающей задаче сохраняются только время, уровень, указатель
+ * на строку формата и сырые аргументы (строки копируются в запись).
+ * Форматирование и вывод в Serial / WebSocket / файл выполняет
+ * низкоприоритетная задача, поэтому заблокированный USB-CDC
+ * больше не останавливает FSM и проверки безопасности.
+ */
+
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DLOG_RING_SIZE      64          // Записей в очереди (степень двойки)
+#define DLOG_MAX_ARGS       8           // Аргументов в одной записи
+#define DLOG_POOL_SIZE      48          // Байт под копии строк
+#define DLOG_LINE_SIZE      192         // Максимальная длина строки
+#define DLOG_MAX_SINKS      4
+#define DLOG_TASK_STACK     4096
+#define DLOG_TASK_PRIORITY  1
+#define DLOG_TASK_CORE      0
+#define DLOG_FILE_PATH      "/logs/debug.txt"
+#define DLOG_FILE_MAX_BYTES 65536       // Затем debug.txt -> debug.old
+#define DLOG_FLUSH_TIMEOUT_MS 500       // Ожидание сброса задачей логгера
+
+// Уровни записи
+#define DLOG_LEVEL_E        1
+#define DLOG_LEVEL_W        2
+#define DLOG_LEVEL_I        3
+#define DLOG_LEVEL_D        4
+
+/**
+ * Тип сохранённого аргумента
+ */
+enum DLogArgType : uint8_t {
+    DLOG_ARG_I32 = 0,
+    DLOG_ARG_U32,
+    DLOG_ARG_I64,
+    DLOG_ARG_U64,
+    DLOG_ARG_F64,
+    DLOG_ARG_STR,           // Смещение в pool
+    DLOG_ARG_PTR
+};
+
+/**
+ * Запись очереди
+ */
+struct DLogRecord {
+    uint32_t timeMs;
+    const char* fmt;        // Строковый литерал (живёт всю программу)
+    uint8_t level;
+    uint8_t argc;
+    uint8_t poolUsed;
+    uint8_t truncated;      // Аргументы не поместились
+    uint8_t types[DLOG_MAX_ARGS];
+    union {
+        int32_t i32;
+        uint32_t u32;
+        int64_t i64;
+        uint64_t u64;
+        double f64;
+        const void* ptr;
+    } args[DLOG_MAX_ARGS];
+    char pool[DLOG_POOL_SIZE];
+};
+
+/**
+ * Приёмник готовых строк (вызывается из задачи логгера)
+ * @param level Уровень DLOG_LEVEL_*
+ * @param timeMs Время вызова LOG_* (millis)
+ * @param line Строка без перевода строки
+ * @param len Длина строки
+ */
+typedef void (*DLogSink)(uint8_t level, uint32_t timeMs, const char* line, size_t len);
+
+namespace DeferredLog {
+    /**
+     * Запуск задачи вывода (записи до вызова копятся в очереди)
+     */
+    void init();
+
+    /**
+     * Регистрация приёмника
+     * @return false если нет места
+     */
+    bool addSink(DLogSink sink);
+
+    /**
+     * Включение записи в файл DLOG_FILE_PATH (POST /api/log/file)
+     */
+    void setFileEnabled(bool enabled);
+
+    /**
+     * Запись в файл включена
+     */
+    bool isFileEnabled();
+
+    /**
+     * Вывод накопленных записей и закрытие файла (перед перезагрузкой).
+     * Задачу логгера не останавливает: просит её сбросить очередь и ждёт.
+     * До init() (и в симуляторе) выводит на вызывающей задаче
+     * @param timeoutMs Предел ожидания
+     * @return false если задача логгера не успела
+     */
+    bool flush(uint32_t timeoutMs = DLOG_FLUSH_TIMEOUT_MS);
+
+    /**
+     * Количество потерянных записей (очередь была полна)
+     */
+    uint32_t getDropped();
+
+    // ------------------------------------------------------------------------
+    // Захват аргументов (внутреннее)
+    // ------------------------------------------------------------------------
+
+    DLogRecord* begin(uint8_t level, const char* fmt, uint32_t& pos);
+    void commit(uint32_t pos);
+
+    inline void put(DLogRecord* r, uint8_t type) {
+        r->types[r->argc++] = type;
+    }
+
+    inline void capture(DLogRecord* r, int v)                { r->args[r->argc].i32 = v; put(r, DLOG_ARG_I32); }
+    inline void capture(DLogRecord* r, unsigned int v)       { r->args[r->argc].u32 = v; put(r, DLOG_ARG_U32); }
+    inline void capture(DLogRecord* r, long long v)          { r->args[r->argc].i64 = v; put(r, DLOG_ARG_I64); }
+    inline void capture(DLogRecord* r, unsigned long long v) { r->args[r->argc].u64 = v; put(r, DLOG_ARG_U64); }
+    inline void capture(DLogRecord* r, double v)             { r->args[r->argc].f64 = v; put(r, DLOG_ARG_F64); }
+
+    // long 32-битный на ESP32, 64-битный на хосте (env:native)
+    inline void capture(DLogRecord* r, long v) {
+        if (sizeof(long) == sizeof(int32_t)) {
+            r->args[r->argc].i32 = v;
+            put(r, DLOG_ARG_I32);
+        } else {
+            r->args[r->argc].i64 = v;
+            put(r, DLOG_ARG_I64);
+        }
+    }
+    inline void capture(DLogRecord* r, unsigned long v) {
+        if (sizeof(unsigned long) == sizeof(uint32_t)) {
+            r->args[r->argc].u32 = v;
+            put(r, DLOG_ARG_U32);
+        } else {
+            r->args[r->argc].u64 = v;
+            put(r, DLOG_ARG_U64);
+        }
+    }
+
+    inline void capture(DLogRecord* r, const char* s) {
+        // Строка может жить на стеке вызывающего - копируем
+        if (!s) s = "(null)";
+        size_t room = DLOG_POOL_SIZE - r->poolUsed;
+        size_t len = strnlen(s, room ? room - 1 : 0);
+        r->args[r->argc].u32 = r->poolUsed;
+        if (room) {
+            memcpy(r->pool + r->poolUsed, s, len);
+            r->pool[r->poolUsed + len] = '\0';
+            r->poolUsed += len + 1;
+        }
+        put(r, DLOG_ARG_STR);
+    }
+
+    inline void capture(DLogRecord* r, char* s) { capture(r, static_cast<const char*>(s)); }
+
+    template <typename T>
+    inline void capture(DLogRecord* r, T* p) {
+        r->args[r->argc].ptr = p;
+        put(r, DLOG_ARG_PTR);
+    }
+
+    inline void captureAll(DLogRecord* r) { (void)r; }
+
+    template <typename T, typename... Rest>
+    inline void captureAll(DLogRecord* r, T first, Rest... rest) {
+        if (r->argc >= DLOG_MAX_ARGS) {
+            r->truncated = 1;
+            return;
+        }
+        capture(r, first);
+        captureAll(r, rest...);
+    }
+
+    /**
+     * Запись в очередь (используется макросами LOG_*)
+     */
+    template <typename... Args>
+    inline void write(uint8_t level, const char* fmt, Args... args) {
+        uint32_t pos;
+        DLogRecord* r = begin(level, fmt, pos);
+        if (!r) return;
+        captureAll(r, args...);
+        commit(pos);
+    }
+}
+
+#endif // DEFERRED_LOG_H
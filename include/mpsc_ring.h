@@ -0,0 +1,121 @@
+/**
+ * Smart-Column S3 - MPSC Ring
+ *
+ * Lock-free кольцевая очередь: много производителей, один потребитель
+ * (ограниченная очередь Вьюкова с номером последовательности в ячейке).
+ * Запись не блокирует задачу и не выключает прерывания.
+ */
+
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint16_t N>
+class MpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscRing size must be a power of two");
+
+public:
+    MpscRing() : enqueuePos(0), dequeuePos(0) {
+        for (uint32_t i = 0; i < N; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Резервирование ячейки для записи на месте
+     * @param pos Позиция (передать в publish)
+     * @return Указатель на данные или nullptr если очередь полна
+     */
+    T* acquire(uint32_t& pos) {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & (N - 1)];
+            uint32_t seq = cell.seq.load(std::memory_order_acquire);
+            int32_t diff = static_cast<int32_t>(seq - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &cell.data;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Публикация заполненной ячейки
+     * @param pos Позиция из acquire
+     */
+    void publish(uint32_t pos) {
+        cells[pos & (N - 1)].seq.store(pos + 1, std::memory_order_release);
+    }
+
+    /**
+     * Запись копией
+     * @return false если очередь полна
+     */
+    bool push(const T& value) {
+        uint32_t pos;
+        T* slot = acquire(pos);
+        if (!slot) return false;
+        *slot = value;
+        publish(pos);
+        return true;
+    }
+
+    /**
+     * Доступ к голове очереди без извлечения (только потребитель)
+     * @return Указатель на данные или nullptr если пусто
+     */
+    T* peek() {
+        Cell& cell = cells[dequeuePos & (N - 1)];
+        uint32_t seq = cell.seq.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(seq - (dequeuePos + 1)) != 0) return nullptr;
+        return &cell.data;
+    }
+
+    /**
+     * Освобождение ячейки после peek (только потребитель)
+     */
+    void release() {
+        cells[dequeuePos & (N - 1)].seq.store(dequeuePos + N, std::memory_order_release);
+        dequeuePos++;
+    }
+
+    /**
+     * Извлечение копией (только потребитель)
+     * @return false если пусто
+     */
+    bool pop(T& out) {
+        T* slot = peek();
+        if (!slot) return false;
+        out = *slot;
+        release();
+        return true;
+    }
+
+    /**
+     * Приблизительное число элементов
+     */
+    uint16_t size() const {
+        return static_cast<uint16_t>(enqueuePos.load(std::memory_order_relaxed) - dequeuePos);
+    }
+
+    static constexpr uint16_t capacity() { return N; }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> seq;
+        T data;
+    };
+
+    Cell cells[N];
+    std::atomic<uint32_t> enqueuePos;
+    uint32_t dequeuePos;
+};
+
+#endif // MPSC_RING_H
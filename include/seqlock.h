@@ -0,0 +1,64 @@
+/**
+ * Smart-Column S3 - Seqlock
+ *
+ * Один писатель, много читателей. Писатель не ждёт никогда:
+ * нечётный номер последовательности означает запись в процессе,
+ * читатель копирует данные и повторяет, если номер изменился.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type");
+
+public:
+    Seqlock() : seq(0) {
+        memset(&data, 0, sizeof(T));
+    }
+
+    /**
+     * Публикация нового значения (только писатель)
+     */
+    void write(const T& value) {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&data, &value, sizeof(T));
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    /**
+     * Одна попытка согласованного чтения
+     * @param out Копия значения
+     * @return false если копия пересеклась с записью
+     */
+    bool tryRead(T& out) const {
+        uint32_t before = seq.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        memcpy(&out, &data, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return seq.load(std::memory_order_relaxed) == before;
+    }
+
+    /**
+     * Номер последней завершённой публикации
+     */
+    uint32_t version() const {
+        return seq.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    std::atomic<uint32_t> seq;
+    T data;
+};
+
+#endif // SEQLOCK_H
@@ -23,7 +23,9 @@ enum class Mode : uint8_t {
     MANUAL_RECT,        // Ручная ректификация
     DISTILLATION,       // Дистилляция
     MASHING,            // Затирка солода
-    HOLD                // Температурные ступени
+    HOLD,               // Температурные ступени
+    FLOOD_CALIBRATION,  // Калибровка порога захлёба
+    PID_AUTOTUNE        // Автонастройка ПИД по T куба
 };
 
 /**
@@ -105,6 +107,17 @@ enum class Fraction : uint8_t {
 // СТРУКТУРЫ ДАННЫХ
 // =============================================================================
 
+/**
+ * Оценка температуры фильтром Калмана (TempFilter)
+ */
+struct TempEstimate {
+    float value;            // Температура (°C)
+    float slope;            // Скорость изменения (°C/мин)
+    float sigma;            // СКО оценки температуры (°C)
+    float slopeSigma;       // СКО оценки скорости (°C/мин)
+    bool valid;             // Фильтр сошёлся, датчик отвечает
+};
+
 /**
  * Показания температур
  */
@@ -117,6 +130,7 @@ struct Temperatures {
     float waterIn;          // Вода вход
     float waterOut;         // Вода выход
     bool valid[TEMP_COUNT]; // Валидность каждого датчика
+    TempEstimate filtered[TEMP_COUNT];  // Отфильтрованные (индекс TEMP_*)
     uint32_t lastUpdate;    // Время последнего обновления
 };
 
@@ -158,6 +172,18 @@ struct Hydrometer {
     uint32_t lastUpdate;
 };
 
+/**
+ * Крепости по равновесию пар-жидкость (Vle), с поправкой на атм. давление
+ */
+struct VleState {
+    float cubeAbv;          // Крепость в кубе по T кипения (% об.)
+    float cubeVapourAbv;    // Пар над кубом - отбор при дистилляции (% об.)
+    float distillateAbv;    // Отбор по T верха царги (% об.)
+    float boilingWater;     // T кипения воды при текущем давлении (°C)
+    bool cubeValid;         // Куб кипит, T в диапазоне таблицы
+    bool distillateValid;   // Пар дошёл до верха царги
+};
+
 /**
  * Состояние насоса
  */
@@ -226,6 +252,17 @@ struct RunStats {
     float avgBodyAbv;               // Средняя крепость тела (%)
     float energyUsedKwh;            // Потрачено энергии (кВт·ч)
     uint8_t decrementCount;         // Число снижений скорости
+
+    // Прогноз по балансу абсолютного спирта (RunEta)
+    float chargeEthanolMl;          // АС загрузки (мл, по крепости в кубе до отбора)
+    float collectedEthanolMl;       // АС в отборе (мл)
+    bool etaValid;
+    uint32_t tailsEtaSec;           // До хвостов (с), 0 - уже в хвостах
+    uint32_t tailsEtaLowSec;        // Интервал: быстрая скорость, меньше спирта
+    uint32_t tailsEtaHighSec;       // Медленная скорость, больше спирта
+    uint32_t finishEtaSec;          // До конца погона (с)
+    uint32_t finishEtaLowSec;
+    uint32_t finishEtaHighSec;
 };
 
 /**
@@ -245,8 +282,41 @@ struct UnoParams {
 struct DecrementState {
     bool active;                    // Активен (ожидание)
     float baseTemp;                 // T_base (зафиксированная)
+    float basePressure;             // Атмосферное давление при фиксации T_base (гПа, 0 - нет)
+    float pressureCorrection;       // Поправка T царги к basePressure (°C)
     uint8_t decrementCount;         // Счётчик снижений
+    uint8_t incrementCount;         // Счётчик пробных увеличений
     uint32_t waitStart;             // Начало ожидания
+    uint32_t stableSince;           // Начало стабильного участка
+    float speed;                    // Скорость отбора тела (мл/ч)
+    float tripSpeed;                // Скорость последней остановки (0 - нет)
+};
+
+/**
+ * Прогноз окончания дистилляции
+ */
+struct DistForecast {
+    bool valid;                     // Куб кипит, крепость в кубе оценена
+    float remainingMin;             // До конца отбора, мин
+    float finalVolumeMl;            // Отбор к концу, мл
+    float takeoffMlH;               // Скорость отбора по насосу и тепловому балансу (мл/ч)
+    float endAbv;                   // Крепость в кубе на конце (% об.)
+};
+
+/**
+ * Ступени затирки / Hold
+ */
+struct MashState {
+    uint8_t step;                   // Текущая ступень (с 0)
+    uint8_t stepCount;
+    bool holding;                   // false - подъём к ступени
+    bool inBand;                    // T в допуске MASH_HOLD_BAND
+    float target;                   // °C ступени
+    float setpoint;                 // °C уставка регулятора (рампа)
+    uint32_t heldSec;               // Выдержано в допуске
+    uint32_t holdSec;               // Длительность выдержки (0 - до остановки)
+    float lossWK;                   // Оценка теплопотерь, Вт/°C над T помещения
+    float feedForward;              // Прямая связь, %
 };
 
 /**
@@ -292,6 +362,7 @@ struct SystemState {
     Pressure pressure;
     Power power;
     Hydrometer hydrometer;
+    VleState vle;
     
     PumpState pump;
     ValvesState valves;
@@ -300,6 +371,8 @@ struct SystemState {
     
     UnoParams uno;
     DecrementState decrement;
+    DistForecast distForecast;
+    MashState mash;
     
     Alarm currentAlarm;
     RunStats stats;
@@ -387,6 +460,15 @@ struct HydrometerCalibration {
     float pressurePoints[5];            // Соотв. давления
 };
 
+/**
+ * Калибровка порога захлёба (измеряется прогоном FLOOD_CALIBRATION)
+ */
+struct FloodCalSettings {
+    float pressure;                     // Давление начала захлёба (мм рт.ст.), 0 - не калибровано
+    uint8_t powerPercent;               // Мощность ТЭНа на границе захлёба (%)
+    uint16_t heaterPowerW;              // Номинал ТЭНа во время калибровки
+};
+
 /**
  * Калибровка насоса
  */
@@ -431,7 +513,7 @@ struct TempStep {
 struct MashProfile {
     char name[24];
     uint8_t stepCount;
-    TempStep steps[7];
+    TempStep steps[MASH_MAX_STEPS];
 };
 
 /**
@@ -448,11 +530,13 @@ struct Settings {
     PumpCalibration pumpCal;
     FractionatorSettings fractionator;
     RectificationParams rectParams;
-    MashProfile mashProfiles[3];
+    MashProfile mashProfiles[MASH_PROFILE_COUNT];
 
     uint8_t language;                   // 0=RU, 1=EN
     uint8_t theme;                      // 0=light, 1=dark
     bool soundEnabled;
+
+    FloodCalSettings floodCal;          // Схема v2
 };
 
 // =============================================================================
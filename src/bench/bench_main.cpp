@@ -0,0 +1,428 @@
+/**
+ * Smart-Column S3 - Бенчмарк горячих путей на ПК
+ *
+ * Код прошивки без изменений на HAL хоста и файловой системе в памяти.
+ * Для каждого случая - нс на операцию, выделений памяти и байт на
+ * операцию. Отчёт JSON (stdout или --out) для сравнения между релизами,
+ * таблица - в stderr.
+ *
+ * Запуск: pio run -e bench && .pio/build/bench/program --out bench.json
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <chrono>
+#include "config.h"
+#include "types.h"
+#include "../hal/hal.h"
+#include "../drivers/pzem_filter.h"
+#include "../interface/state_json.h"
+#include "../history.h"
+#include "../profiles.h"
+
+#define BENCH_DEFAULT_MIN_MS    500     // Время замера одного случая
+#define BENCH_HISTORY_FILES     MAX_HISTORY_FILES
+#define BENCH_TIMESERIES        480     // 8 часов с шагом TIMESERIES_INTERVAL
+#define BENCH_PZEM_READINGS     256
+#define BENCH_REPORT_VERSION    1
+
+// Настройки прошивки (профили компилируют план по ним)
+Settings g_settings;
+
+// =============================================================================
+// СЧЁТЧИК ВЫДЕЛЕНИЙ ПАМЯТИ
+// =============================================================================
+
+static uint64_t allocCount = 0;
+static uint64_t allocBytes = 0;
+
+#if defined(__GLIBC__)
+// malloc перехватывается целиком: ArduinoJson берёт пул через malloc,
+// operator new libstdc++ - тоже
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocCount++;
+    allocBytes += size;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocCount++;
+    allocBytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    allocCount++;
+    allocBytes += size;
+    return __libc_realloc(ptr, size);
+}
+#else
+// Без glibc считаются только выделения через new
+void* operator new(size_t size) {
+    allocCount++;
+    allocBytes += size;
+    void* ptr = malloc(size);
+    if (!ptr) abort();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+#endif
+
+// =============================================================================
+// ЗАМЕР
+// =============================================================================
+
+struct BenchCase {
+    const char* name;
+    void (*setup)();
+    void (*op)();
+};
+
+struct BenchResult {
+    const char* name;
+    uint64_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+/**
+ * Число повторов удваивается, пока серия не займёт minMs
+ */
+static BenchResult measure(const BenchCase& bench, uint32_t minMs) {
+    typedef std::chrono::steady_clock Clock;
+
+    if (bench.setup) bench.setup();
+    bench.op();     // Прогрев: кэши, пулы, файлы
+
+    BenchResult result;
+    result.name = bench.name;
+    uint64_t iterations = 1;
+    while (true) {
+        uint64_t allocs = allocCount;
+        uint64_t bytes = allocBytes;
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            bench.op();
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        if (ns >= minMs * 1e6 || iterations >= (1ULL << 40)) {
+            result.iterations = iterations;
+            result.nsPerOp = ns / iterations;
+            result.allocsPerOp = (double)(allocCount - allocs) / iterations;
+            result.bytesPerOp = (double)(allocBytes - bytes) / iterations;
+            return result;
+        }
+        iterations *= 2;
+    }
+}
+
+// =============================================================================
+// ДАННЫЕ
+// =============================================================================
+
+static SystemState state;
+static MemoryStats memory;
+static PzemReading pzemReadings[BENCH_PZEM_READINGS];
+static uint16_t pzemIndex = 0;
+static ProcessHistory history;
+static Profile profile;
+static String json;
+static volatile size_t sink;    // Результаты не выбрасываются оптимизатором
+
+static void fillState() {
+    memset(&state, 0, sizeof(state));
+    state.mode = Mode::RECTIFICATION;
+    state.rectPhase = RectPhase::BODY;
+    state.temps.cube = 92.37f;
+    state.temps.columnBottom = 81.12f;
+    state.temps.columnTop = 78.41f;
+    state.temps.reflux = 77.95f;
+    state.temps.tsa = 31.2f;
+    state.power.voltage = 229.4f;
+    state.power.current = 8.71f;
+    state.power.power = 1998.0f;
+    state.power.energy = 14.237f;
+    state.pump.speedMlPerHour = 1450.0f;
+    state.pump.totalVolumeMl = 8731.0f;
+    state.health.overallHealth = 95;
+    state.health.tempSensorsOk = 7;
+    state.health.tempSensorsTotal = 7;
+    state.health.bmp280Ok = true;
+    state.health.ads1115Ok = true;
+    state.health.pzemOk = true;
+    state.health.wifiRSSI = -61;
+    state.health.cpuTemp = 48;
+
+    memory.heapFree = 171234;
+    memory.heapTotal = 327680;
+    memory.psramFree = 8012345;
+    memory.psramTotal = 8388608;
+    memory.flashUsed = 1543210;
+    memory.flashTotal = 16777216;
+}
+
+/**
+ * Показания PZEM: шум сети, редкие NaN (нет ответа)
+ */
+static void fillPzem() {
+    srand(1);
+    for (uint16_t i = 0; i < BENCH_PZEM_READINGS; i++) {
+        float noise = (rand() % 2001 - 1000) / 1000.0f;
+        PzemReading& r = pzemReadings[i];
+        r.voltage = 230.0f + 4.0f * noise;
+        r.current = 8.7f + 0.3f * noise;
+        r.power = r.voltage * r.current;
+        r.energy = 10.0f + i * 0.001f;
+        r.frequency = 50.0f + 0.05f * noise;
+        r.powerFactor = 0.99f;
+        if (i % 64 == 63) r.voltage = NAN;
+    }
+}
+
+/**
+ * История ректификации на 8 часов
+ */
+static void fillHistory(uint32_t id) {
+    history = ProcessHistory();
+    history.id = String((unsigned long)id);
+    history.version = FW_VERSION;
+    history.metadata.startTime = id;
+    history.metadata.endTime = id + BENCH_TIMESERIES * TIMESERIES_INTERVAL;
+    history.metadata.duration = BENCH_TIMESERIES * TIMESERIES_INTERVAL;
+    history.metadata.completedSuccessfully = true;
+    history.metadata.deviceId = "bench";
+    history.process.type = "rectification";
+    history.process.mode = "auto";
+    history.process.profile = "builtin_sugar_40";
+    history.parameters.targetPower = 3000;
+    history.parameters.headVolume = 1300;
+    history.parameters.bodyVolume = 15000;
+    history.parameters.pumpSpeedHead = 150;
+    history.parameters.pumpSpeedBody = 1500;
+    history.parameters.wattControlEnabled = true;
+    history.parameters.smartDecrementEnabled = true;
+
+    const char* phases[] = {"heating", "stabilization", "heads", "purge", "body", "tails"};
+    for (uint8_t i = 0; i < 6; i++) {
+        ProcessPhase phase;
+        phase.name = phases[i];
+        phase.startTime = id + i * 3600;
+        phase.endTime = phase.startTime + 3600;
+        phase.duration = 3600;
+        phase.startTemp = 20.0f + i * 10;
+        phase.endTemp = 30.0f + i * 10;
+        phase.volume = i * 1000;
+        phase.avgSpeed = 1000;
+        history.phases.push_back(phase);
+    }
+
+    for (uint8_t i = 0; i < 8; i++) {
+        SpeedChange change;
+        change.time = id + 20000 + i * 600;
+        change.fromSpeed = 1500 - i * 50;
+        change.toSpeed = change.fromSpeed * 0.85f;
+        change.columnTop = 78.6f;
+        change.reason = "decrement";
+        history.speedChanges.push_back(change);
+    }
+
+    for (uint16_t i = 0; i < BENCH_TIMESERIES; i++) {
+        TimeseriesPoint point;
+        point.time = id + i * TIMESERIES_INTERVAL;
+        point.cube = 85.0f + i * 0.02f;
+        point.columnTop = 78.4f;
+        point.columnBottom = 81.0f;
+        point.deflegmator = 77.9f;
+        point.power = 2000;
+        point.voltage = 229.5f;
+        point.current = 8.7f;
+        point.pumpSpeed = 1450;
+        point.cubeAbv = 40.0f - i * 0.05f;
+        point.distillateAbv = 96.4f;
+        point.phase = static_cast<uint8_t>(RectPhase::BODY);
+        point.volume = 1300.0f + i * 24.0f;
+        history.timeseries.push_back(point);
+    }
+
+    history.results.headsCollected = 1300;
+    history.results.bodyCollected = 15000;
+    history.results.totalCollected = 16300;
+    history.results.status = "completed";
+}
+
+// =============================================================================
+// СЛУЧАИ
+// =============================================================================
+
+static void pzemSetup() {
+    fillPzem();
+    PzemFilter::reset();
+}
+
+static void pzemOp() {
+    PzemFilter::apply(pzemReadings[pzemIndex++ % BENCH_PZEM_READINGS], state.power);
+}
+
+static void wsStateOp() {
+    json = String();
+    StateJson::serializeWeb(state, memory, json);
+    sink = json.length();
+}
+
+// Как MQTT::publishState без PubSubClient: топик и JSON
+static void mqttStateOp() {
+    String topic = String("smartcolumn") + "/" + "bench" + "/state";
+    json = String();
+    StateJson::serializeMqtt(state, json);
+    sink = topic.length() + json.length();
+}
+
+static void historySaveSetup() {
+    fillHistory(1700000000);
+}
+
+static void historySaveOp() {
+    sink = saveProcessHistory(history);
+}
+
+static void historyListSetup() {
+    for (uint32_t i = 0; i < BENCH_HISTORY_FILES; i++) {
+        fillHistory(1700000000 + i * 86400);
+        saveProcessHistory(history);
+    }
+}
+
+static void historyListOp() {
+    sink = getProcessList().size();
+}
+
+#define BENCH_PROFILE_PATH  PROFILES_DIR "/profile_bench.json"
+
+static void profileParseSetup() {
+    loadProfile("builtin_sugar_40", profile);
+    profile.id = "bench";
+    profile.metadata.isBuiltin = false;
+    saveProfile(profile);
+}
+
+// Как загрузка профиля мимо кэша: чтение файла и разбор JSON
+static void profileParseOp() {
+    File file = LittleFS.open(BENCH_PROFILE_PATH, FILE_READ);
+    sink = parseProfile(file, profile);
+    file.close();
+}
+
+static const BenchCase CASES[] = {
+    {"pzem_filter", pzemSetup, pzemOp},
+    {"ws_broadcast_state", nullptr, wsStateOp},
+    {"mqtt_publish_state", nullptr, mqttStateOp},
+    {"history_save", historySaveSetup, historySaveOp},
+    {"history_list", historyListSetup, historyListOp},
+    {"profile_parse", profileParseSetup, profileParseOp},
+};
+
+static constexpr size_t CASE_COUNT = sizeof(CASES) / sizeof(CASES[0]);
+
+// =============================================================================
+// ОТЧЁТ
+// =============================================================================
+
+static void writeReport(FILE* out, const BenchResult* results, size_t count, uint32_t minMs) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": %d,\n", BENCH_REPORT_VERSION);
+    fprintf(out, "  \"firmware\": \"%s\",\n", FW_VERSION);
+#ifdef __VERSION__
+    fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+    fprintf(out, "  \"min_ms\": %lu,\n", (unsigned long)minMs);
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult& r = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, "
+                     "\"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f}%s\n",
+                r.name, (unsigned long long)r.iterations, r.nsPerOp, r.allocsPerOp,
+                r.bytesPerOp, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void printUsage() {
+    fprintf(stderr,
+            "Usage: program [options]\n"
+            "  --filter NAME   Only cases containing NAME\n"
+            "  --min-ms MS     Time per case (default %d)\n"
+            "  --out FILE      JSON report (default stdout)\n"
+            "  --list          Case names\n",
+            BENCH_DEFAULT_MIN_MS);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    const char* outPath = nullptr;
+    uint32_t minMs = BENCH_DEFAULT_MIN_MS;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (strcmp(arg, "--min-ms") == 0 && hasValue) {
+            minMs = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--out") == 0 && hasValue) {
+            outPath = argv[++i];
+        } else if (strcmp(arg, "--list") == 0) {
+            for (size_t c = 0; c < CASE_COUNT; c++) printf("%s\n", CASES[c].name);
+            return 0;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    // Журнал прошивки (история, профили) не мешает замеру
+    Serial.mute(true);
+    LittleFS.begin(true);
+    initProfiles();
+    fillState();
+
+    BenchResult results[CASE_COUNT];
+    size_t count = 0;
+
+    fprintf(stderr, "%-20s %12s %12s %12s\n", "case", "ns/op", "allocs/op", "B/op");
+    for (size_t c = 0; c < CASE_COUNT; c++) {
+        if (filter && !strstr(CASES[c].name, filter)) continue;
+        results[count] = measure(CASES[c], minMs);
+        const BenchResult& r = results[count++];
+        fprintf(stderr, "%-20s %12.1f %12.2f %12.1f\n", r.name, r.nsPerOp, r.allocsPerOp,
+                r.bytesPerOp);
+    }
+
+    FILE* out = stdout;
+    if (outPath) {
+        out = fopen(outPath, "w");
+        if (!out) {
+            fprintf(stderr, "Cannot create %s\n", outPath);
+            return 1;
+        }
+    }
+    writeReport(out, results, count, minMs);
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,223 @@
+/**
+ * Smart-Column S3 - Шина команд
+ *
+ * MPSC очередь команд: производители - задачи AsyncTCP, MQTT, Telegram,
+ * потребитель - loop(). Результат возвращается уведомлением задачи
+ * (token в старших 24 битах, CommandResult в младших 8).
+ */
+
+#include "command_bus.h"
+#include "../hal/hal.h"
+#include "fsm.h"
+#include "../profiles.h"
+#include "mpsc_ring.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+static MpscRing<ControlCommand, COMMAND_QUEUE_SIZE> queue;
+static TaskHandle_t controlTask = nullptr;
+static std::atomic<uint32_t> nextToken(1);
+static std::atomic<uint32_t> dropped(0);
+
+static const char* commandName(CommandType type) {
+    switch (type) {
+        case CommandType::START:  return "start";
+        case CommandType::STOP:   return "stop";
+        case CommandType::PAUSE:  return "pause";
+        case CommandType::RESUME: return "resume";
+        case CommandType::APPLY_PROFILE: return "apply";
+        default:                  return "unknown";
+    }
+}
+
+static const char* sourceName(CommandSource source) {
+    switch (source) {
+        case CommandSource::WEB:      return "web";
+        case CommandSource::MQTT:     return "mqtt";
+        case CommandSource::TELEGRAM: return "telegram";
+        case CommandSource::BUTTON:   return "button";
+        default:                      return "unknown";
+    }
+}
+
+/**
+ * Выполнение одной команды (только задача loop)
+ */
+static CommandResult apply(const ControlCommand& cmd, SystemState& state, const Settings& settings) {
+    CommandResult result = CommandResult::OK;
+
+    switch (cmd.type) {
+        case CommandType::START:
+            if (state.mode != Mode::IDLE) {
+                result = CommandResult::BUSY;
+            } else if (!state.safetyOk) {
+                result = CommandResult::UNSAFE;
+            } else if ((cmd.mode == Mode::FLOOD_CALIBRATION && !state.health.ads1115Ok) ||
+                       ((cmd.mode == Mode::PID_AUTOTUNE || cmd.mode == Mode::MASHING ||
+                         cmd.mode == Mode::HOLD || cmd.mode == Mode::DISTILLATION) &&
+                        !state.temps.valid[TEMP_CUBE])) {
+                result = CommandResult::NO_SENSOR;
+            } else {
+                FSM::startMode(state, settings, cmd.mode, cmd.value);
+            }
+            break;
+
+        case CommandType::STOP:
+            FSM::stopMode(state);
+            break;
+
+        case CommandType::PAUSE:
+            // Пауза замораживает выход регулятора, а таймеры идут: реле
+            // автонастройки, мощность затирки и ступень калибровки
+            // исказили бы измерение - эти режимы только останавливаются
+            if (state.mode == Mode::IDLE) {
+                result = CommandResult::NOT_RUNNING;
+            } else if (state.mode == Mode::PID_AUTOTUNE || state.mode == Mode::MASHING ||
+                       state.mode == Mode::HOLD || state.mode == Mode::FLOOD_CALIBRATION) {
+                result = CommandResult::NOT_PAUSABLE;
+            } else {
+                FSM::pause(state);
+            }
+            break;
+
+        case CommandType::RESUME:
+            if (state.mode == Mode::IDLE) {
+                result = CommandResult::NOT_RUNNING;
+            } else {
+                FSM::resume(state);
+            }
+            break;
+
+        case CommandType::APPLY_PROFILE:
+            // Во время процесса план сменился бы на границе фаз, в т.ч. на
+            // план другого режима - применение только перед стартом
+            if (state.mode != Mode::IDLE) {
+                result = CommandResult::BUSY;
+            } else if (!::applyProfile(String(cmd.profileId))) {
+                result = CommandResult::NO_PROFILE;
+            }
+            break;
+    }
+
+    LOG_I("Command: %s from %s -> %s", commandName(cmd.type), sourceName(cmd.source),
+          CommandBus::resultString(result));
+    return result;
+}
+
+static bool enqueue(CommandType type, CommandSource source, Mode mode, float value,
+                    const char* profileId, TaskHandle_t replyTo, uint32_t token) {
+    uint32_t pos;
+    ControlCommand* slot = queue.acquire(pos);
+    if (!slot) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        LOG_W("Command: Queue full, %s from %s dropped", commandName(type), sourceName(source));
+        return false;
+    }
+
+    slot->type = type;
+    slot->source = source;
+    slot->mode = mode;
+    slot->value = value;
+    snprintf(slot->profileId, sizeof(slot->profileId), "%s", profileId ? profileId : "");
+    slot->replyTo = replyTo;
+    slot->token = token;
+    queue.publish(pos);
+    return true;
+}
+
+/**
+ * Постановка и ожидание ответа задачи loop
+ */
+static CommandResult submit(CommandType type, CommandSource source, Mode mode, float value,
+                            const char* profileId, uint32_t timeoutMs) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    // Из задачи loop ждать некого - команда ставится в очередь
+    // и выполнится в начале следующего прохода
+    if (self == controlTask) {
+        return enqueue(type, source, mode, value, profileId, nullptr, 0) ? CommandResult::OK
+                                                                         : CommandResult::QUEUE_FULL;
+    }
+
+    uint32_t token = nextToken.fetch_add(1, std::memory_order_relaxed) & 0x00FFFFFF;
+    if (!enqueue(type, source, mode, value, profileId, self, token)) {
+        return CommandResult::QUEUE_FULL;
+    }
+
+    // Ответ на команду, по которой истёк таймаут, может прийти позже -
+    // такие уведомления отбрасываются по token
+    uint32_t start = Hal::millis();
+    while (true) {
+        uint32_t elapsed = Hal::millis() - start;
+        if (elapsed >= timeoutMs) break;
+
+        uint32_t value = 0;
+        if (xTaskNotifyWait(0, 0xFFFFFFFF, &value, pdMS_TO_TICKS(timeoutMs - elapsed)) != pdTRUE) {
+            break;
+        }
+        if ((value >> 8) == token) {
+            return static_cast<CommandResult>(value & 0xFF);
+        }
+    }
+
+    LOG_W("Command: %s from %s timed out", commandName(type), sourceName(source));
+    return CommandResult::TIMEOUT;
+}
+
+namespace CommandBus {
+
+void init() {
+    controlTask = xTaskGetCurrentTaskHandle();
+    LOG_I("Command: Ready");
+}
+
+bool post(CommandType type, CommandSource source, Mode mode, float value) {
+    return enqueue(type, source, mode, value, nullptr, nullptr, 0);
+}
+
+CommandResult execute(CommandType type, CommandSource source, Mode mode, float value,
+                      uint32_t timeoutMs) {
+    return submit(type, source, mode, value, nullptr, timeoutMs);
+}
+
+CommandResult applyProfile(CommandSource source, const char* profileId, uint32_t timeoutMs) {
+    return submit(CommandType::APPLY_PROFILE, source, Mode::IDLE, 0, profileId, timeoutMs);
+}
+
+void process(SystemState& state, const Settings& settings) {
+    // Только команды, поставленные до начала выборки: новые дождутся
+    // следующего прохода и не задержат контур управления
+    for (uint16_t n = queue.size(); n > 0; n--) {
+        ControlCommand* cmd = queue.peek();
+        if (!cmd) break;
+
+        CommandResult result = apply(*cmd, state, settings);
+        if (cmd->replyTo) {
+            xTaskNotify(cmd->replyTo, (cmd->token << 8) | static_cast<uint8_t>(result),
+                        eSetValueWithOverwrite);
+        }
+        queue.release();
+    }
+}
+
+const char* resultString(CommandResult result) {
+    switch (result) {
+        case CommandResult::OK:          return "ok";
+        case CommandResult::BUSY:        return "process already running";
+        case CommandResult::NOT_RUNNING: return "no process running";
+        case CommandResult::UNSAFE:      return "blocked by safety";
+        case CommandResult::NO_SENSOR:   return "required sensor not available";
+        case CommandResult::NO_PROFILE:  return "profile not found or invalid";
+        case CommandResult::NOT_PAUSABLE: return "mode cannot be paused";
+        case CommandResult::QUEUE_FULL:  return "command queue full";
+        case CommandResult::TIMEOUT:     return "control loop timeout";
+        default:                         return "unknown";
+    }
+}
+
+uint32_t getDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace CommandBus
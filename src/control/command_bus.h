@@ -0,0 +1,117 @@
+/**
+ * Smart-Column S3 - Command Bus
+ *
+ * Команды управления процессом от веб-сервера, MQTT, Telegram и кнопок.
+ * Источники только ставят команду в lock-free очередь, изменяет g_state
+ * и управляет Heater/Pump/Valves одна задача - loop(), которая
+ * выбирает очередь раз за проход. Блокировок в контуре управления нет.
+ */
+
+#ifndef COMMAND_BUS_H
+#define COMMAND_BUS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "run_plan.h"
+
+/**
+ * Тип команды
+ */
+enum class CommandType : uint8_t {
+    START = 0,          // Запуск режима (ControlCommand::mode)
+    STOP,
+    PAUSE,
+    RESUME,
+    APPLY_PROFILE       // Подготовка плана из профиля (ControlCommand::profileId)
+};
+
+/**
+ * Источник команды (для журнала)
+ */
+enum class CommandSource : uint8_t {
+    WEB = 0,
+    MQTT,
+    TELEGRAM,
+    BUTTON
+};
+
+/**
+ * Результат выполнения
+ */
+enum class CommandResult : uint8_t {
+    OK = 0,
+    BUSY,               // Процесс уже идёт
+    NOT_RUNNING,        // Нет процесса для паузы/продолжения
+    UNSAFE,             // Запуск запрещён защитой
+    NO_SENSOR,          // Нет датчика, нужного режиму
+    NO_PROFILE,         // Профиль не найден или не компилируется в план
+    NOT_PAUSABLE,       // Режим нельзя приостановить (только остановка)
+    QUEUE_FULL,
+    TIMEOUT             // Задача управления не ответила вовремя
+};
+
+/**
+ * Команда управления процессом
+ */
+struct ControlCommand {
+    CommandType type;
+    CommandSource source;
+    Mode mode;                      // Для START
+    float value;                    // Параметр режима (уставка PID_AUTOTUNE)
+    char profileId[RUN_PLAN_ID_LEN];  // Для APPLY_PROFILE
+    TaskHandle_t replyTo;           // nullptr - ответ не нужен
+    uint32_t token;                 // Сопоставление ответа с запросом
+};
+
+namespace CommandBus {
+    /**
+     * Инициализация (вызывать из задачи loop)
+     */
+    void init();
+
+    /**
+     * Постановка команды без ожидания результата
+     * @return false если очередь полна
+     */
+    bool post(CommandType type, CommandSource source, Mode mode = Mode::IDLE, float value = 0);
+
+    /**
+     * Постановка команды и ожидание результата.
+     * Из самой задачи loop команда выполняется сразу.
+     * @param value Параметр режима
+     * @param timeoutMs Время ожидания
+     * @return Результат или TIMEOUT
+     */
+    CommandResult execute(CommandType type, CommandSource source, Mode mode = Mode::IDLE,
+                          float value = 0, uint32_t timeoutMs = COMMAND_REPLY_TIMEOUT_MS);
+
+    /**
+     * Применение профиля задачей loop (только без процесса: план
+     * вступит в силу при следующем старте)
+     * @param profileId ID профиля
+     * @param timeoutMs Время ожидания (из задачи loop - без ожидания)
+     * @return Результат или TIMEOUT
+     */
+    CommandResult applyProfile(CommandSource source, const char* profileId,
+                               uint32_t timeoutMs = COMMAND_REPLY_TIMEOUT_MS);
+
+    /**
+     * Выполнение накопленных команд (вызывается в loop раз за проход)
+     * @param state Состояние
+     * @param settings Настройки
+     */
+    void process(SystemState& state, const Settings& settings);
+
+    /**
+     * Текст результата
+     */
+    const char* resultString(CommandResult result);
+
+    /**
+     * Количество отброшенных команд (очередь полна)
+     */
+    uint32_t getDropped();
+}
+
+#endif // COMMAND_BUS_H
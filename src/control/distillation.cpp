@@ -0,0 +1,272 @@
+/**
+ * Smart-Column S3 - Дистилляция
+ *
+ * Прогноз окончания:
+ *   спирт в кубе   L·a = L_end·a_end + V·d,  L_end = L - V
+ *   остаток отбора V = L·(a - a_end) / (d - a_end)
+ *   скорость       min(насос, (P - потери) / теплота испарения мл отбора)
+ * L - объём куба (загрузка минус отбор), a - крепость в кубе по T кипения,
+ * d - крепость отбора по T верха царги, a_end - крепость в кубе на конце
+ * (по T конца и/или крепости из плана).
+ */
+
+#include "distillation.h"
+#include "../hal/hal.h"
+#include "temp_filter.h"
+#include "vle.h"
+#include "watt_control.h"
+#include "heatup_planner.h"
+#include "../history.h"
+#include "../drivers/heater.h"
+#include "../drivers/pump.h"
+#include "../drivers/valves.h"
+
+// Теплота испарения на мл жидкости при 20 °C
+#define HVAP_WATER_J_ML         2257.0f
+#define HVAP_ETHANOL_J_ML       664.0f
+
+#define STANDARD_HPA            1013.25f
+#define HPA_PER_MMHG            1.33322f
+
+static uint32_t phaseStart = 0;
+static float startVolume = 0;           // Насос на старте (мл)
+static float phaseStartVolume = 0;
+static uint32_t lastForecast = 0;
+static uint8_t powerStep = 0;           // Пройдено ступеней мощности
+
+// =============================================================================
+// ВСПОМОГАТЕЛЬНЫЕ
+// =============================================================================
+
+static void enterPhase(SystemState& state, RectPhase phase) {
+    state.rectPhase = phase;
+    phaseStart = Hal::millis();
+    phaseStartVolume = Pump::getTotalVolume();
+}
+
+/**
+ * Крепость в кубе на конце: T конца отбора при давлении в кубе
+ * или крепость из плана, что наступит раньше
+ */
+static float endAbv(const RunPlan& plan, float cubeHpa) {
+    float abv = Vle::liquidAbv(plan.distEndTemp, cubeHpa);
+    return plan.distEndAbv > abv ? plan.distEndAbv : abv;
+}
+
+/**
+ * Скорость отбора: насос, если пара хватает, иначе весь конденсат
+ */
+static float takeoffRate(const SystemState& state, const RunPlan& plan, float pumpMlH, float distAbv) {
+    float watts = state.power.power > 0
+        ? state.power.power
+        : plan.heaterPowerW * Heater::getPower() / 100.0f;
+    watts -= DIST_HEAT_LOSS_W;
+    if (watts <= 0) return 0;
+
+    float jPerMl = distAbv / 100.0f * HVAP_ETHANOL_J_ML + (1.0f - distAbv / 100.0f) * HVAP_WATER_J_ML;
+    float boilMlH = watts * 3600.0f / jPerMl;
+    return pumpMlH < boilMlH ? pumpMlH : boilMlH;
+}
+
+static void updateForecast(SystemState& state, const RunPlan& plan) {
+    DistForecast& f = state.distForecast;
+    const VleState& vle = state.vle;
+
+    float collected = Distillation::getCollected();
+    float cubeMl = plan.chargeVolumeL * 1000.0f - collected;
+
+    f.valid = false;
+    if (!vle.cubeValid || cubeMl <= 0 ||
+        (state.rectPhase != RectPhase::HEADS && state.rectPhase != RectPhase::BODY)) {
+        return;
+    }
+
+    float atm = state.pressure.atmosphere > 0 ? state.pressure.atmosphere : STANDARD_HPA;
+    float cubeHpa = atm + (state.pressure.cube > 0 ? state.pressure.cube * HPA_PER_MMHG : 0);
+    float distAbv = vle.distillateValid ? vle.distillateAbv : vle.cubeVapourAbv;
+
+    f.endAbv = endAbv(plan, cubeHpa);
+
+    // Остаток по балансу спирта
+    float remainingMl = 0;
+    if (vle.cubeAbv > f.endAbv && distAbv > f.endAbv) {
+        remainingMl = cubeMl * (vle.cubeAbv - f.endAbv) / (distAbv - f.endAbv);
+    }
+
+    // Головы: остаток на своей скорости
+    float headsLeftMl = 0;
+    if (state.rectPhase == RectPhase::HEADS) {
+        headsLeftMl = plan.distHeadsMl - (Pump::getTotalVolume() - phaseStartVolume);
+        if (headsLeftMl < 0) headsLeftMl = 0;
+        if (headsLeftMl > remainingMl) headsLeftMl = remainingMl;
+    }
+    float bodyLeftMl = remainingMl - headsLeftMl;
+
+    // Целевой объём отбора ограничивает основную часть
+    if (plan.distTargetMl > 0) {
+        float bodyDone = state.rectPhase == RectPhase::BODY
+            ? Pump::getTotalVolume() - phaseStartVolume : 0;
+        float targetLeft = plan.distTargetMl - bodyDone;
+        if (targetLeft < 0) targetLeft = 0;
+        if (bodyLeftMl > targetLeft) bodyLeftMl = targetLeft;
+    }
+
+    // Скорость насоса - фактическая (план может быть выше предела насоса)
+    float pumpMlH = Pump::getSpeed();
+    float bodyPumpMlH = state.rectPhase == RectPhase::HEADS ? pumpMlH / DIST_HEADS_SPEED_MULT : pumpMlH;
+    f.takeoffMlH = takeoffRate(state, plan, bodyPumpMlH, distAbv);
+    float headsMlH = takeoffRate(state, plan, pumpMlH, distAbv);
+    if (f.takeoffMlH <= 0 || headsMlH <= 0) return;
+
+    f.remainingMin = (headsLeftMl / headsMlH + bodyLeftMl / f.takeoffMlH) * 60.0f;
+    f.finalVolumeMl = collected + headsLeftMl + bodyLeftMl;
+    f.valid = true;
+}
+
+/**
+ * Конец отбора: T куба, крепость в кубе или объём
+ */
+static bool bodyDone(const SystemState& state, const RunPlan& plan, float bodyVolume) {
+    if (TempFilter::value(state.temps, TEMP_CUBE) >= plan.distEndTemp) {
+        LOG_I("Distillation: End by cube temperature");
+        return true;
+    }
+    if (plan.distEndAbv > 0 && state.vle.cubeValid && state.vle.cubeAbv <= plan.distEndAbv) {
+        LOG_I("Distillation: End by cube ABV %.1f%%", state.vle.cubeAbv);
+        return true;
+    }
+    if (plan.distTargetMl > 0 && bodyVolume >= plan.distTargetMl) {
+        LOG_I("Distillation: End by volume");
+        return true;
+    }
+    return false;
+}
+
+namespace Distillation {
+
+// =============================================================================
+// API
+// =============================================================================
+
+void start(SystemState& state) {
+    LOG_I("Distillation: Starting");
+
+    startVolume = Pump::getTotalVolume();
+    lastForecast = 0;
+    powerStep = 0;
+    memset(&state.distForecast, 0, sizeof(state.distForecast));
+
+    Pump::stop();
+    Valves::setHeads(false);
+    enterPhase(state, RectPhase::HEATING);
+}
+
+bool update(SystemState& state, const RunPlan& plan) {
+    uint32_t now = Hal::millis();
+    float phaseVolume = Pump::getTotalVolume() - phaseStartVolume;
+    float cubeTemp = TempFilter::value(state.temps, TEMP_CUBE);
+
+    // Мощность: ступень по T куба - потолок для плана разгона, затем
+    // для регулятора давления (колонна на отборе легко уходит в захлёб)
+    if (state.rectPhase != RectPhase::FINISH) {
+        // T куба при отгоне только растёт - ступени не возвращаются назад
+        // от шума датчика на границе
+        while (powerStep < plan.distPowerSteps && cubeTemp >= plan.distPowerTemp[powerStep]) {
+            LOG_I("Distillation: Power step %u%% at T_cube=%.1f°C",
+                  plan.distPowerPercent[powerStep], cubeTemp);
+            powerStep++;
+        }
+        uint8_t scheduled = scheduledPower(plan, powerStep);
+
+        uint8_t power;
+        if (state.rectPhase == RectPhase::HEATING) {
+            power = HeatupPlanner::update(state, plan);
+            if (power > scheduled) power = scheduled;
+        } else {
+            HeatupPlanner::observe(state);
+            power = WattControl::update(state, scheduled);
+        }
+        if (Heater::getPower() != power) {
+            Heater::setPower(power);
+        }
+        if (state.temps.cube > plan.waterOnTemp) {
+            Valves::setWater(true);
+        }
+    }
+
+    switch (state.rectPhase) {
+        case RectPhase::HEATING:
+            // Пар дошёл до царги - начало отбора. Перегонный куб без
+            // датчика низа царги - по кипению, найденному планировщиком
+            if (state.temps.valid[TEMP_COLUMN_BOTTOM]
+                    ? TempFilter::value(state.temps, TEMP_COLUMN_BOTTOM) > plan.heatingEndTemp
+                    : HeatupPlanner::boiling()) {
+                Valves::setWater(true);
+                HeatupPlanner::finishHeating(state);
+                WattControl::resetModel(Heater::getPower());
+                if (plan.distHeadsMl > 0) {
+                    LOG_I("Distillation: HEATING → HEADS (%.0f ml)", plan.distHeadsMl);
+                    enterPhase(state, RectPhase::HEADS);
+                    Valves::setHeads(true);
+                    Pump::start(plan.distSpeedMlH * DIST_HEADS_SPEED_MULT);
+                } else {
+                    LOG_I("Distillation: HEATING → BODY");
+                    enterPhase(state, RectPhase::BODY);
+                    Pump::start(plan.distSpeedMlH);
+                }
+            }
+            break;
+
+        case RectPhase::HEADS:
+            if (phaseVolume >= plan.distHeadsMl) {
+                LOG_I("Distillation: HEADS → BODY (%.0f ml)", phaseVolume);
+                Valves::setHeads(false);
+                enterPhase(state, RectPhase::BODY);
+                Pump::start(plan.distSpeedMlH);
+            }
+            break;
+
+        case RectPhase::BODY:
+            if (bodyDone(state, plan, phaseVolume)) {
+                LOG_I("Distillation: BODY → FINISH (%.0f ml, total %.0f ml)",
+                      phaseVolume, getCollected());
+                Heater::setPower(0);
+                Pump::stop();
+                state.distForecast.valid = false;
+                enterPhase(state, RectPhase::FINISH);
+            }
+            break;
+
+        case RectPhase::FINISH:
+            // Охлаждение после выключения ТЭНа
+            Heater::setPower(0);
+            Pump::stop();
+            Valves::setWater(true);
+            if (now - phaseStart > DIST_FINISH_COOL_MS) {
+                return true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (now - lastForecast >= DIST_FORECAST_INTERVAL_MS) {
+        lastForecast = now;
+        updateForecast(state, plan);
+    }
+
+    return false;
+}
+
+uint8_t scheduledPower(const RunPlan& plan, uint8_t step) {
+    uint8_t power = step > 0 && step <= plan.distPowerSteps ? plan.distPowerPercent[step - 1]
+                                                            : plan.heaterMaxPercent;
+    return power < plan.heaterMaxPercent ? power : plan.heaterMaxPercent;
+}
+
+float getCollected() {
+    return Pump::getTotalVolume() - startVolume;
+}
+
+} // namespace Distillation
@@ -0,0 +1,49 @@
+/**
+ * Smart-Column S3 - Distillation
+ *
+ * Дистилляция (отгон): разгон, необязательный отбор голов, отбор до
+ * T куба или крепости в кубе из плана. Мощность - ступенями по T куба,
+ * скорость отбора - насосом. Остаток времени и итоговый объём
+ * прогнозируются по балансу спирта в кубе и тепловому балансу ТЭНа.
+ * Фазы - те же RectPhase (HEATING, HEADS, BODY, FINISH).
+ */
+
+#ifndef DISTILLATION_H
+#define DISTILLATION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "run_plan.h"
+
+namespace Distillation {
+    /**
+     * Начало дистилляции (из FSM::startMode)
+     * @param state Состояние системы
+     */
+    void start(SystemState& state);
+
+    /**
+     * Обновление (вызывать в loop в режиме DISTILLATION)
+     * @param state Состояние системы, прогноз пишется в state.distForecast
+     * @param plan Активный план
+     * @return true когда отбор завершён и куб охлаждён
+     */
+    bool update(SystemState& state, const RunPlan& plan);
+
+    /**
+     * Мощность ступени плана
+     * @param plan План
+     * @param step Пройдено ступеней (T куба выше их порогов)
+     * @return %, до первой ступени - heaterMaxPercent
+     */
+    uint8_t scheduledPower(const RunPlan& plan, uint8_t step);
+
+    /**
+     * Отобрано с начала дистилляции (головы и основной отбор)
+     * @return мл
+     */
+    float getCollected();
+}
+
+#endif // DISTILLATION_H
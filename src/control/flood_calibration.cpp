@@ -0,0 +1,295 @@
+/**
+ * Smart-Column S3 - Калибровка захлёба
+ *
+ * Ступенчатый подъём мощности при работе "на себя". На каждой ступени
+ * первая половина - переходный процесс, во второй набираются среднее
+ * и дисперсия давления (Welford). Первые ступени задают базовый наклон
+ * dP/dW и базовый разброс; захлёб - наклон или СКО заметно выше базы.
+ */
+
+#include "flood_calibration.h"
+#include "../hal/hal.h"
+#include "watt_control.h"
+#include "temp_filter.h"
+#include "../history.h"
+#include "../drivers/heater.h"
+#include "../drivers/pump.h"
+#include "../drivers/valves.h"
+#include "../storage/nvs_manager.h"
+
+#define CAL_BASELINE_STEPS      3       // Наклонов для базы (ступеней - на одну больше)
+#define CAL_STD_FLOOR           0.2f    // мм рт.ст. - нижняя граница базового СКО
+#define CAL_SLOPE_MIN           0.05f   // мм рт.ст. на % - давление не реагирует на мощность
+#define CAL_PRESSURE_LIMIT      72.0f   // мм рт.ст. - у верхней границы датчика (75)
+#define CAL_MIN_SAMPLES         10      // Замеров давления на ступень
+#define CAL_BACKOFF_MS          (60UL * 1000)
+#define CAL_COOLDOWN_MS         (5UL * 60 * 1000)
+
+extern Settings g_settings;
+
+static FloodCalStage stage = FloodCalStage::IDLE;
+static uint32_t stageStart = 0;
+static uint8_t power = 0;                   // Мощность текущей ступени, %
+static uint8_t stepIndex = 0;
+
+// Статистика давления текущей ступени
+static uint16_t sampleCount = 0;
+static float sampleMean = 0;
+static float sampleM2 = 0;
+static uint32_t lastSampleTime = 0;
+
+// Предыдущая ступень и база
+static float prevMean = 0;
+static uint8_t prevPower = 0;
+static float baseSlopeSum = 0;
+static uint8_t baseSlopeCount = 0;
+static float baseStd = 0;
+
+static float result = 0;
+
+static void enterStage(FloodCalStage next) {
+    stage = next;
+    stageStart = Hal::millis();
+}
+
+static void beginStep(uint8_t percent) {
+    power = percent;
+    Heater::setPower(power);
+    sampleCount = 0;
+    sampleMean = 0;
+    sampleM2 = 0;
+    enterStage(FloodCalStage::RAMP);
+}
+
+/**
+ * Прерывание без результата: ТЭН выкл, охлаждение
+ */
+static void abortCalibration(const char* reason) {
+    LOG_W("FloodCal: Aborted - %s", reason);
+    processRecorder.addWarning(reason, "error");
+    result = 0;
+    Heater::setPower(0);
+    enterStage(FloodCalStage::COOLDOWN);
+}
+
+/**
+ * Применение результата: регулятор мощности, пороги защиты и настройки
+ */
+static void applyResult(SystemState& state, float pressure, uint8_t percent) {
+    result = pressure;
+
+    WattControl::setFloodPressure(pressure);
+    state.pressure.floodThreshold = pressure;
+    WattControl::getThresholds(state.pressure.workThreshold, state.pressure.warnThreshold,
+                               state.pressure.critThreshold);
+
+    g_settings.floodCal.pressure = pressure;
+    g_settings.floodCal.powerPercent = percent;
+    g_settings.floodCal.heaterPowerW = g_settings.equipment.heaterPowerW;
+    NVSManager::markDirty();
+
+    char notes[96];
+    snprintf(notes, sizeof(notes), "P_захлёб=%.1f мм рт.ст. при %u%% (оценка по насадке %.1f)",
+             pressure, percent,
+             WattControl::calculateFloodPressure(g_settings.equipment.columnHeightMm,
+                                                 g_settings.equipment.packingCoeff));
+    processRecorder.setNotes(notes);
+}
+
+/**
+ * Конец ступени: запись точки и проверка излома
+ */
+static void finishStep(SystemState& state, const RunPlan& plan) {
+    if (sampleCount < CAL_MIN_SAMPLES) {
+        abortCalibration("Нет показаний датчика давления");
+        return;
+    }
+
+    float stdDev = sqrtf(sampleM2 / (sampleCount - 1));
+    bool flood = false;
+
+    if (stepIndex == 0) {
+        baseStd = stdDev;
+    } else {
+        float slope = (sampleMean - prevMean) / (float)(power - prevPower);
+
+        if (baseSlopeCount < CAL_BASELINE_STEPS) {
+            baseSlopeSum += slope;
+            baseSlopeCount++;
+            if (stdDev < baseStd) baseStd = stdDev;
+
+            if (baseSlopeCount == CAL_BASELINE_STEPS &&
+                baseSlopeSum / baseSlopeCount < CAL_SLOPE_MIN) {
+                processRecorder.recordRampStep(power, sampleMean, stdDev, false);
+                abortCalibration("Давление не растёт с мощностью");
+                return;
+            }
+        } else {
+            float baseSlope = baseSlopeSum / baseSlopeCount;
+            float stdLimit = FLOOD_CAL_STD_RATIO * (baseStd > CAL_STD_FLOOR ? baseStd : CAL_STD_FLOOR);
+            flood = slope > FLOOD_CAL_SLOPE_RATIO * baseSlope || stdDev > stdLimit;
+
+            LOG_I("FloodCal: slope=%.2f (base %.2f), std=%.2f (limit %.2f)",
+                  slope, baseSlope, stdDev, stdLimit);
+        }
+    }
+
+    LOG_I("FloodCal: Step %u: %u%% -> P=%.1f±%.2f%s",
+          stepIndex, power, sampleMean, stdDev, flood ? " FLOOD" : "");
+    processRecorder.recordRampStep(power, sampleMean, stdDev, flood);
+
+    if (flood) {
+        // Граница - последняя ступень без захлёба
+        applyResult(state, prevMean, prevPower);
+        LOG_I("FloodCal: P_flood=%.1f mmHg at %u%%", prevMean, prevPower);
+
+        uint8_t backoff = prevPower > 2 * FLOOD_CAL_STEP_PERCENT
+                              ? prevPower - 2 * FLOOD_CAL_STEP_PERCENT : 0;
+        Heater::setPower(backoff);
+        enterStage(FloodCalStage::BACKOFF);
+        return;
+    }
+
+    if (sampleMean > CAL_PRESSURE_LIMIT) {
+        abortCalibration("Давление у предела датчика, захлёб не определён");
+        return;
+    }
+
+    if (power >= plan.heaterMaxPercent) {
+        LOG_W("FloodCal: No flood up to %u%%", power);
+        processRecorder.addWarning("Захлёб не достигнут на максимальной мощности", "warning");
+        result = 0;
+        Heater::setPower(0);
+        enterStage(FloodCalStage::COOLDOWN);
+        return;
+    }
+
+    prevMean = sampleMean;
+    prevPower = power;
+    stepIndex++;
+
+    uint16_t next = power + FLOOD_CAL_STEP_PERCENT;
+    beginStep(next > plan.heaterMaxPercent ? plan.heaterMaxPercent : next);
+}
+
+namespace FloodCalibration {
+
+void start(SystemState& state) {
+    LOG_I("FloodCal: Starting");
+
+    stepIndex = 0;
+    prevMean = 0;
+    prevPower = 0;
+    baseSlopeSum = 0;
+    baseSlopeCount = 0;
+    baseStd = 0;
+    result = 0;
+    lastSampleTime = state.pressure.lastUpdate;
+
+    // Работа "на себя": отбор закрыт весь прогон
+    Pump::stop();
+    Valves::setHeads(false);
+
+    // Колонну намеренно подводят к захлёбу - защита срабатывает
+    // только у верхней границы датчика
+    state.pressure.workThreshold = CAL_PRESSURE_LIMIT;
+    state.pressure.warnThreshold = CAL_PRESSURE_LIMIT;
+    state.pressure.critThreshold = CAL_PRESSURE_LIMIT;
+
+    enterStage(FloodCalStage::HEATING);
+}
+
+bool update(SystemState& state, const RunPlan& plan) {
+    uint32_t elapsed = Hal::millis() - stageStart;
+
+    switch (stage) {
+        case FloodCalStage::HEATING:
+            Heater::setPower(plan.heaterMaxPercent);
+
+            if (state.temps.cube > plan.waterOnTemp) {
+                Valves::setWater(true);
+            }
+
+            if (state.temps.valid[TEMP_COLUMN_BOTTOM] &&
+                TempFilter::value(state.temps, TEMP_COLUMN_BOTTOM) > plan.heatingEndTemp) {
+                Valves::setWater(true);
+                power = FLOOD_CAL_START_PERCENT < plan.heaterMaxPercent
+                            ? FLOOD_CAL_START_PERCENT : plan.heaterMaxPercent;
+                Heater::setPower(power);
+                LOG_I("FloodCal: HEATING → STABILIZATION (%u%%)", power);
+                enterStage(FloodCalStage::STABILIZATION);
+            }
+            break;
+
+        case FloodCalStage::STABILIZATION:
+            if (elapsed > FLOOD_CAL_STABILIZE_MIN * 60000UL) {
+                LOG_I("FloodCal: STABILIZATION → RAMP");
+                beginStep(power);
+            }
+            break;
+
+        case FloodCalStage::RAMP:
+            // Замер во второй половине ступени, по одному на чтение датчика
+            if (elapsed >= FLOOD_CAL_STEP_SEC * 500UL &&
+                state.pressure.lastUpdate != lastSampleTime) {
+                lastSampleTime = state.pressure.lastUpdate;
+                sampleCount++;
+                float delta = state.pressure.cube - sampleMean;
+                sampleMean += delta / sampleCount;
+                sampleM2 += delta * (state.pressure.cube - sampleMean);
+            }
+
+            if (elapsed >= FLOOD_CAL_STEP_SEC * 1000UL) {
+                finishStep(state, plan);
+            }
+            break;
+
+        case FloodCalStage::BACKOFF:
+            if (elapsed > CAL_BACKOFF_MS) {
+                LOG_I("FloodCal: Backoff done, P=%.1f mmHg", state.pressure.cube);
+                Heater::setPower(0);
+                enterStage(FloodCalStage::COOLDOWN);
+            }
+            break;
+
+        case FloodCalStage::COOLDOWN:
+            Heater::setPower(0);
+            Valves::setWater(true);
+            if (elapsed > CAL_COOLDOWN_MS) {
+                enterStage(FloodCalStage::DONE);
+                return true;
+            }
+            break;
+
+        case FloodCalStage::DONE:
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+FloodCalStage getStage() {
+    return stage;
+}
+
+float getResult() {
+    return result;
+}
+
+const char* getStageName(FloodCalStage s) {
+    switch (s) {
+        case FloodCalStage::IDLE:          return "idle";
+        case FloodCalStage::HEATING:       return "heating";
+        case FloodCalStage::STABILIZATION: return "stabilization";
+        case FloodCalStage::RAMP:          return "ramp";
+        case FloodCalStage::BACKOFF:       return "backoff";
+        case FloodCalStage::COOLDOWN:      return "cooldown";
+        case FloodCalStage::DONE:          return "done";
+        default:                           return "unknown";
+    }
+}
+
+} // namespace FloodCalibration
@@ -0,0 +1,64 @@
+/**
+ * Smart-Column S3 - Flood Calibration
+ *
+ * Измерение давления захлёба на конкретной колонне. После разгона колонна
+ * работает "на себя" (насос стоит, узел отбора закрыт), мощность ТЭНа
+ * поднимается ступенями. Начало захлёба - излом зависимости давления от
+ * мощности или рост разброса давления относительно первых ступеней.
+ * Результат заменяет оценку по высоте колонны и коэффициенту насадки.
+ */
+
+#ifndef FLOOD_CALIBRATION_H
+#define FLOOD_CALIBRATION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "run_plan.h"
+
+/**
+ * Этап калибровки
+ */
+enum class FloodCalStage : uint8_t {
+    IDLE = 0,
+    HEATING,            // Разгон до T низа царги из плана
+    STABILIZATION,      // Работа "на себя" на мощности первой ступени
+    RAMP,               // Ступени мощности с замером давления
+    BACKOFF,            // Мощность ниже границы захлёба, пена оседает
+    COOLDOWN,           // ТЭН выключен, охлаждение
+    DONE
+};
+
+namespace FloodCalibration {
+    /**
+     * Начало калибровки (из FSM::startMode)
+     * @param state Состояние системы
+     */
+    void start(SystemState& state);
+
+    /**
+     * Обновление (вызывать в loop в режиме FLOOD_CALIBRATION)
+     * @param state Состояние системы
+     * @param plan Активный план (мощность, T включения воды и конца разгона)
+     * @return true когда калибровка завершена и колонна охлаждена
+     */
+    bool update(SystemState& state, const RunPlan& plan);
+
+    /**
+     * Текущий этап
+     */
+    FloodCalStage getStage();
+
+    /**
+     * Измеренное давление захлёба последнего прогона
+     * @return мм рт.ст., 0 если захлёб не найден
+     */
+    float getResult();
+
+    /**
+     * Название этапа
+     */
+    const char* getStageName(FloodCalStage stage);
+}
+
+#endif // FLOOD_CALIBRATION_H
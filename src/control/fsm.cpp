@@ -5,44 +5,278 @@
  */
 
 #include "fsm.h"
+#include "../hal/hal.h"
+#include "run_plan.h"
+#include "watt_control.h"
+#include "flood_calibration.h"
+#include "pid_autotune.h"
+#include "distillation.h"
+#include "mash_sequencer.h"
+#include "run_eta.h"
+#include "heatup_planner.h"
+#include "temp_filter.h"
+#include "../history.h"
 #include "../drivers/heater.h"
 #include "../drivers/pump.h"
 #include "../drivers/valves.h"
 #include "../drivers/sensors.h"
 #include "../interface/mqtt.h"
+#include "../storage/logger.h"
 
 namespace FSM {
 
 static uint32_t phaseStartTime = 0;
+static uint32_t runStartTime = 0;
+static float phaseStartVolume = 0;
+
+// Головы: целевой объём на входе в фазу, ровный тренд T верха царги
+static float headsTargetMl = 0;
+static uint32_t headsFlatSince = 0;
+static bool headsExtended = false;
+
+/**
+ * Объём голов: из плана или % от абсолютного спирта загрузки.
+ * Крепость загрузки - по T кипения куба после стабилизации "на себя"
+ */
+static float computeHeadsTarget(const SystemState& state, const RunPlan& plan) {
+    if (plan.headsVolumeMl > 0) {
+        LOG_I("FSM: Heads target %.0f ml (plan)", plan.headsVolumeMl);
+        return plan.headsVolumeMl;
+    }
+    if (plan.chargeVolumeL <= 0 || plan.headsPercent <= 0) {
+        return 0;
+    }
+
+    float abv = state.vle.cubeAbv;
+    if (!state.vle.cubeValid) {
+        abv = RECT_HEADS_ABV_FALLBACK;
+        LOG_W("FSM: Cube ABV unknown, assuming %.0f%%", abv);
+    }
+
+    float target = plan.chargeVolumeL * 1000.0f * abv / 100.0f * plan.headsPercent / 100.0f;
+    LOG_I("FSM: Heads target %.0f ml (%.0f l × %.1f%% × %.0f%%)",
+          target, plan.chargeVolumeL, abv, plan.headsPercent);
+    return target;
+}
+
+/**
+ * Переход в фазу. Граница фаз - единственное место, где
+ * подготовленный план погона сменяет активный.
+ */
+static void enterPhase(SystemState& state, RectPhase phase) {
+    state.rectPhase = phase;
+    phaseStartTime = Hal::millis();
+    phaseStartVolume = Pump::getTotalVolume();
+
+    if (RunPlanner::swapIfPending()) {
+        const RunPlan& plan = RunPlanner::active();
+        processRecorder.recordPlan(plan.checksum, plan.profileId, getPhaseName(phase));
+    }
+
+    if (phase == RectPhase::HEADS) {
+        headsTargetMl = computeHeadsTarget(state, RunPlanner::active());
+        headsFlatSince = 0;
+        headsExtended = false;
+    }
+
+    // Начало тела: T_base фиксируется по стабилизированной после продувки колонне
+    if (phase == RectPhase::BODY) {
+        const RunPlan& plan = RunPlanner::active();
+        SmartDecrement::init(TempFilter::value(state.temps, TEMP_COLUMN_TOP), plan.bodySpeedMlH,
+                             plan.heaterPowerW / 1000.0f, state.pressure.atmosphere);
+    }
+}
+
+/**
+ * Мощность ТЭНа по давлению в кубе (после разгона)
+ */
+static void applyWattControl(SystemState& state, const RunPlan& plan) {
+    uint8_t power = WattControl::update(state, plan.heaterMaxPercent);
+    if (Heater::getPower() != power) {
+        Heater::setPower(power);
+    }
+}
+
+/**
+ * Калибровка захлёба: этапами управляет FloodCalibration,
+ * здесь - только завершение прогона
+ */
+static void updateFloodCalibration(SystemState& state) {
+    if (!FloodCalibration::update(state, RunPlanner::active())) {
+        return;
+    }
+
+    float pressure = FloodCalibration::getResult();
+
+    Valves::closeAll();
+    state.rectPhase = RectPhase::IDLE;
+    state.mode = Mode::IDLE;
+    LOG_I("FSM: Flood calibration complete");
+    Logger::closeLog();
+    processRecorder.stopRecording(pressure > 0);
+
+    char msg[128];
+    if (pressure > 0) {
+        snprintf(msg, sizeof(msg), "Давление захлёба: %.1f мм рт.ст.", pressure);
+    } else {
+        snprintf(msg, sizeof(msg), "Захлёб не определён, порог по насадке сохранён");
+    }
+    MQTT::publishNotification("Калибровка захлёба", msg, pressure > 0 ? "success" : "warning");
+}
+
+/**
+ * Автонастройка ПИД: реле ведёт PidAutotune, здесь - завершение
+ */
+static void updatePidAutotune(SystemState& state) {
+    if (!PidAutotune::update(state, RunPlanner::active())) {
+        return;
+    }
+
+    AutotuneResult result;
+    PidAutotune::getResult(result);
+    bool success = result.status == AutotuneStatus::DONE;
+
+    Heater::setPower(0);
+    Valves::closeAll();
+    state.mode = Mode::IDLE;
+    LOG_I("FSM: PID autotune complete");
+    Logger::closeLog();
+    processRecorder.stopRecording(success);
+
+    char msg[128];
+    if (success) {
+        snprintf(msg, sizeof(msg), "Kp=%.3f Ki=%.5f Kd=%.2f%s", result.kp, result.ki, result.kd,
+                 result.saved ? " (записано в профиль)" : "");
+    } else {
+        snprintf(msg, sizeof(msg), "Автонастройка не удалась");
+    }
+    MQTT::publishNotification("Автонастройка ПИД", msg, success ? "success" : "warning");
+}
+
+/**
+ * Дистилляция: фазами ведёт Distillation, здесь - завершение
+ */
+static void updateDistillation(SystemState& state) {
+    if (!Distillation::update(state, RunPlanner::active())) {
+        return;
+    }
+
+    float collected = Distillation::getCollected();
+
+    Valves::closeAll();
+    state.rectPhase = RectPhase::IDLE;
+    state.mode = Mode::IDLE;
+    LOG_I("FSM: Distillation complete");
+    Logger::closeLog();
+    processRecorder.stopRecording(true);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Дистилляция завершена! Собрано: %.0f мл", collected);
+    MQTT::publishNotification("Процесс завершён", msg, "success");
+}
+
+/**
+ * Затирка и Hold: ступенями ведёт MashSequencer, здесь - завершение
+ */
+static void updateMashing(SystemState& state) {
+    if (!MashSequencer::update(state, RunPlanner::active())) {
+        return;
+    }
+
+    bool success = MashSequencer::completed();
+    bool mashing = state.mode == Mode::MASHING;
+
+    Heater::setPower(0);
+    Valves::closeAll();
+    state.mode = Mode::IDLE;
+    state.mashPhase = MashPhase::IDLE;
+    LOG_I("FSM: %s complete", mashing ? "Mashing" : "Hold");
+    Logger::closeLog();
+    processRecorder.stopRecording(success);
+
+    if (success) {
+        MQTT::publishNotification("Процесс завершён",
+                                  mashing ? "Затирка завершена, все паузы выдержаны"
+                                          : "Выдержка завершена",
+                                  "success");
+    } else {
+        MQTT::publishNotification("Процесс остановлен",
+                                  mashing ? "Затирка прервана" : "Выдержка прервана", "warning");
+    }
+}
 
 void update(SystemState& state, const Settings& settings) {
+    (void)settings;
+
+    if (state.mode == Mode::FLOOD_CALIBRATION) {
+        updateFloodCalibration(state);
+        return;
+    }
+    if (state.mode == Mode::PID_AUTOTUNE) {
+        updatePidAutotune(state);
+        return;
+    }
+    if (state.mode == Mode::DISTILLATION) {
+        updateDistillation(state);
+        return;
+    }
+    if (state.mode == Mode::MASHING || state.mode == Mode::HOLD) {
+        updateMashing(state);
+        return;
+    }
+
     // Обрабатываем только режим авто-ректификации
     if (state.mode != Mode::RECTIFICATION) {
         return;
     }
 
-    uint32_t now = millis();
+    const RunPlan& plan = RunPlanner::active();
+    uint32_t now = Hal::millis();
     uint32_t elapsed = now - phaseStartTime;
+    float phaseVolume = Pump::getTotalVolume() - phaseStartVolume;
+
+    // Ограничение длительности процесса из плана
+    if (plan.maxRuntimeMs > 0 && state.rectPhase != RectPhase::FINISH &&
+        state.rectPhase != RectPhase::IDLE && now - runStartTime > plan.maxRuntimeMs) {
+        LOG_W("FSM: Max runtime reached → FINISH");
+        processRecorder.addWarning("Превышено время процесса", "warning");
+        enterPhase(state, RectPhase::FINISH);
+        return;
+    }
+
+    // Перерегулирование давления после разгона - в отчёт разгона
+    if (state.rectPhase != RectPhase::HEATING) {
+        HeatupPlanner::observe(state);
+    }
+
+    // Прогноз хвостов и конца погона по балансу спирта
+    RunEta::update(state);
 
     switch (state.rectPhase) {
         case RectPhase::IDLE:
             // Ожидание старта
             break;
 
-        case RectPhase::HEATING:
-            // Разгон: ТЭН 100%, вода вкл при T_cube > 45°C
-            Heater::setPower(100);
+        case RectPhase::HEATING: {
+            // Разгон: максимум плана со снижением до рабочей мощности перед кипением
+            uint8_t power = HeatupPlanner::update(state, plan);
+            if (Heater::getPower() != power) {
+                Heater::setPower(power);
+            }
 
-            if (state.temps.cube > 45.0f) {
+            if (state.temps.cube > plan.waterOnTemp) {
                 Valves::setWater(true);
             }
 
             // Переход к стабилизации когда T стабильна
             if (state.temps.valid[TEMP_COLUMN_BOTTOM] &&
-                state.temps.columnBottom > 78.0f) {
+                TempFilter::value(state.temps, TEMP_COLUMN_BOTTOM) > plan.heatingEndTemp) {
                 LOG_I("FSM: HEATING → STABILIZATION");
-                state.rectPhase = RectPhase::STABILIZATION;
-                phaseStartTime = now;
+                HeatupPlanner::finishHeating(state);
+                enterPhase(state, RectPhase::STABILIZATION);
+
+                // Регулятор давления продолжает с мощности конца разгона
+                WattControl::resetModel(Heater::getPower());
 
                 // Отправка уведомления
                 MQTT::publishNotification(
@@ -52,13 +286,14 @@ void update(SystemState& state, const Settings& settings) {
                 );
             }
             break;
+        }
 
         case RectPhase::STABILIZATION:
-            // Работа "на себя" 20 минут
-            if (elapsed > settings.rectParams.stabilizationMin * 60 * 1000UL) {
+            // Работа "на себя"
+            applyWattControl(state, plan);
+            if (elapsed > plan.stabilizationMs) {
                 LOG_I("FSM: STABILIZATION → HEADS");
-                state.rectPhase = RectPhase::HEADS;
-                phaseStartTime = now;
+                enterPhase(state, RectPhase::HEADS);
 
                 // Отправка уведомления
                 MQTT::publishNotification(
@@ -71,24 +306,55 @@ void update(SystemState& state, const Settings& settings) {
 
         case RectPhase::HEADS: {
             // Отбор голов
-            float headsSpeed = settings.rectParams.headsSpeedMlHKw *
-                               (settings.equipment.heaterPowerW / 1000.0f);
-            Pump::start(headsSpeed);
+            applyWattControl(state, plan);
+            if (Pump::getSpeed() != plan.headsSpeedMlH) {
+                Pump::setSpeed(plan.headsSpeedMlH);
+            }
             Valves::setHeads(true);
 
-            // TODO: Проверка завершения по объёму или T_column
+            // Тренд T верха царги: головы вышли, когда он выровнялся
+            const TempEstimate& top = state.temps.filtered[TEMP_COLUMN_TOP];
+            if (top.valid && fabsf(top.slope) < RECT_HEADS_FLAT_SLOPE) {
+                if (headsFlatSince == 0) headsFlatSince = now;
+            } else {
+                headsFlatSince = 0;
+            }
+            bool flat = headsFlatSince != 0 && now - headsFlatSince >= RECT_HEADS_FLAT_SEC * 1000UL;
+
+            // Завершение по объёму с выровненным трендом или по T верха царги (0 - не задано).
+            // Тренд не выровнялся - головы продлеваются, но не дольше +RECT_HEADS_EXTEND_MAX
+            bool volumeDone = false;
+            if (headsTargetMl > 0 && phaseVolume >= headsTargetMl) {
+                if (flat) {
+                    volumeDone = true;
+                } else if (phaseVolume >= headsTargetMl * (1.0f + RECT_HEADS_EXTEND_MAX)) {
+                    LOG_W("FSM: Column top not settled (%+.3f°C/min), heads limit reached",
+                          top.slope);
+                    processRecorder.addWarning("T верха царги не стабилизировалась за головы", "warning");
+                    volumeDone = true;
+                } else if (!headsExtended) {
+                    LOG_I("FSM: Heads extended, column top %+.3f°C/min", top.slope);
+                    headsExtended = true;
+                }
+            }
+            bool tempDone = plan.headsEndTemp > 0 && state.temps.valid[TEMP_COLUMN_TOP] &&
+                            TempFilter::value(state.temps, TEMP_COLUMN_TOP) >= plan.headsEndTemp;
+            if (volumeDone || tempDone) {
+                LOG_I("FSM: HEADS → PURGE (%.0f ml of %.0f)", phaseVolume, headsTargetMl);
+                enterPhase(state, RectPhase::PURGE);
+            }
             break;
         }
 
         case RectPhase::PURGE:
             // Продувка
+            applyWattControl(state, plan);
             Pump::stop();
-            Valves::closeAll();
+            Valves::setHeads(false);
 
-            if (elapsed > settings.rectParams.purgeMin * 60 * 1000UL) {
+            if (elapsed > plan.purgeMs) {
                 LOG_I("FSM: PURGE → BODY");
-                state.rectPhase = RectPhase::BODY;
-                phaseStartTime = now;
+                enterPhase(state, RectPhase::BODY);
 
                 // Отправка уведомления
                 MQTT::publishNotification(
@@ -100,13 +366,31 @@ void update(SystemState& state, const Settings& settings) {
             break;
 
         case RectPhase::BODY:
-            // Отбор тела с Smart Decrement
-            // TODO: Реализовать логику Smart Decrement
+            // Отбор тела: скоростью и остановками насоса управляет Smart Decrement
+            applyWattControl(state, plan);
+            if (SmartDecrement::update(state)) {
+                LOG_I("FSM: BODY → TAILS (Smart Decrement, %.0f ml)", phaseVolume);
+                enterPhase(state, RectPhase::TAILS);
+            } else if (plan.bodyVolumeMl > 0 && phaseVolume >= plan.bodyVolumeMl) {
+                LOG_I("FSM: BODY → TAILS (%.0f ml)", phaseVolume);
+                enterPhase(state, RectPhase::TAILS);
+            }
             break;
 
-        case RectPhase::TAILS:
-            // Отбор хвостов
+        case RectPhase::TAILS: {
+            // Отбор хвостов до T куба из плана или объёма хвостов
+            applyWattControl(state, plan);
+            if (Pump::getSpeed() != plan.tailsSpeedMlH) {
+                Pump::setSpeed(plan.tailsSpeedMlH);
+            }
+
+            bool volumeDone = plan.tailsVolumeMl > 0 && phaseVolume >= plan.tailsVolumeMl;
+            if (volumeDone || TempFilter::value(state.temps, TEMP_CUBE) >= plan.maxCubeTemp) {
+                LOG_I("FSM: TAILS → FINISH");
+                enterPhase(state, RectPhase::FINISH);
+            }
             break;
+        }
 
         case RectPhase::FINISH:
             // Завершение
@@ -119,6 +403,8 @@ void update(SystemState& state, const Settings& settings) {
                 state.rectPhase = RectPhase::IDLE;
                 state.mode = Mode::IDLE;
                 LOG_I("FSM: Process complete!");
+                Logger::closeLog();
+                processRecorder.stopRecording(true);
 
                 // Отправка уведомления о завершении
                 char msg[128];
@@ -138,15 +424,77 @@ void update(SystemState& state, const Settings& settings) {
     }
 }
 
-void startMode(SystemState& state, const Settings& settings, Mode mode) {
+void startMode(SystemState& state, const Settings& settings, Mode mode, float value) {
     LOG_I("FSM: Starting mode %d", static_cast<int>(mode));
 
     state.mode = mode;
     state.paused = false;
 
+    Logger::startNewLog(mode);
+    processRecorder.startRecording(getModeName(mode),
+                                   mode == Mode::MANUAL_RECT ? "manual" : "auto");
+
+    // Профиль, применённый до старта (автонастройка пишет в него коэффициенты).
+    // Ожидающий план сначала вступает в силу, активный может быть заменён ниже
+    char appliedProfileId[RUN_PLAN_ID_LEN] = "";
+    bool hadPending = RunPlanner::hasPending();
+    if (!hadPending && RunPlanner::active().source != RunPlanSource::SETTINGS) {
+        snprintf(appliedProfileId, sizeof(appliedProfileId), "%s", RunPlanner::active().profileId);
+    }
+
+    // Без применённого профиля - план из настроек (пересобирается
+    // при каждом старте, чтобы учесть изменённые настройки)
+    if (!hadPending &&
+        (RunPlanner::active().source == RunPlanSource::SETTINGS ||
+         RunPlanner::active().mode != mode)) {
+        RunPlan plan;
+        RunPlanner::fromSettings(settings, mode, plan);
+        RunPlanner::stage(plan);
+    }
+
+    // Старт - тоже граница фаз
+    RunPlanner::swapIfPending();
+    if (hadPending && RunPlanner::active().source != RunPlanSource::SETTINGS) {
+        snprintf(appliedProfileId, sizeof(appliedProfileId), "%s", RunPlanner::active().profileId);
+    }
+
+    if (RunPlanner::active().mode != mode) {
+        LOG_W("FSM: Plan is for mode %d, using settings",
+              static_cast<int>(RunPlanner::active().mode));
+        RunPlan plan;
+        RunPlanner::fromSettings(settings, mode, plan);
+        RunPlanner::stage(plan);
+        RunPlanner::swapIfPending();
+    }
+
+    const RunPlan& plan = RunPlanner::active();
+    processRecorder.recordPlan(plan.checksum, plan.profileId, "start");
+
+    runStartTime = Hal::millis();
+
+    // Регулятор мощности: пороги от высоты колонны и насадки либо
+    // измеренные калибровкой, модель давления идентифицируется заново
+    WattControl::init(settings.equipment);
+    state.pressure.floodThreshold = WattControl::calculateFloodPressure(
+        settings.equipment.columnHeightMm, settings.equipment.packingCoeff);
+    if (settings.floodCal.pressure > 0) {
+        WattControl::setFloodPressure(settings.floodCal.pressure);
+        state.pressure.floodThreshold = settings.floodCal.pressure;
+    }
+    WattControl::resetModel(plan.heaterMaxPercent);
+    WattControl::getThresholds(state.pressure.workThreshold, state.pressure.warnThreshold,
+                               state.pressure.critThreshold);
+
+    // Рабочая мощность после разгона: по калибровке захлёба - на уставке давления
+    uint8_t workPercent = HEATUP_WORK_PERCENT;
+    if (settings.floodCal.powerPercent > 0) {
+        workPercent = (uint8_t)(settings.floodCal.powerPercent * PRESSURE_TARGET_MULT);
+    }
+
     if (mode == Mode::RECTIFICATION) {
-        state.rectPhase = RectPhase::HEATING;
-        phaseStartTime = millis();
+        HeatupPlanner::start(state, plan, workPercent);
+        RunEta::start(state, plan);
+        enterPhase(state, RectPhase::HEATING);
 
         // Отправка уведомления о старте
         MQTT::publishNotification(
@@ -155,25 +503,69 @@ void startMode(SystemState& state, const Settings& settings, Mode mode) {
             "info"
         );
     } else if (mode == Mode::DISTILLATION) {
-        // TODO: Инициализация дистилляции
-        LOG_I("FSM: Distillation mode started");
+        HeatupPlanner::start(state, plan, workPercent);
+        Distillation::start(state);
+
+        MQTT::publishNotification(
+            "Процесс запущен",
+            "Начат процесс дистилляции - фаза разогрева",
+            "info"
+        );
+    } else if (mode == Mode::MASHING) {
+        // value - номер профиля затирки из настроек
+        uint8_t index = value > 0 && value < MASH_PROFILE_COUNT ? (uint8_t)value : 0;
+        const MashProfile& profile = settings.mashProfiles[index];
+        LOG_I("FSM: Mash profile %u \"%s\"", index, profile.name);
+        MashSequencer::start(state, profile.steps, profile.stepCount);
+
+        MQTT::publishNotification(
+            "Процесс запущен",
+            "Начата затирка - подъём к первой паузе",
+            "info"
+        );
+    } else if (mode == Mode::HOLD) {
+        // value - T выдержки, до остановки
+        TempStep step;
+        memset(&step, 0, sizeof(step));
+        step.temperature = value;
+        strncpy(step.name, "hold", sizeof(step.name) - 1);
+        MashSequencer::start(state, &step, 1);
     } else if (mode == Mode::MANUAL_RECT) {
         // TODO: Инициализация ручной ректификации
         LOG_I("FSM: Manual rectification mode started");
+    } else if (mode == Mode::PID_AUTOTUNE) {
+        PidAutotune::start(state, value, appliedProfileId);
+    } else if (mode == Mode::FLOOD_CALIBRATION) {
+        FloodCalibration::start(state);
+
+        MQTT::publishNotification(
+            "Калибровка захлёба",
+            "Разгон, затем ступенчатый подъём мощности при работе на себя",
+            "info"
+        );
     }
 }
 
 void stopMode(SystemState& state) {
     LOG_I("FSM: Stopping");
 
+    if (state.mode == Mode::PID_AUTOTUNE) {
+        PidAutotune::cancel();
+    }
+
     Heater::setPower(0);
     Pump::stop();
     Valves::closeAll();
 
     state.mode = Mode::IDLE;
     state.rectPhase = RectPhase::IDLE;
+    state.mashPhase = MashPhase::IDLE;
+    state.stats.etaValid = false;
     state.paused = false;
 
+    Logger::closeLog();
+    processRecorder.stopRecording(false);
+
     // Отправка уведомления об остановке
     MQTT::publishNotification(
         "Процесс остановлен",
@@ -192,4 +584,33 @@ void resume(SystemState& state) {
     LOG_I("FSM: Resumed");
 }
 
+const char* getPhaseName(RectPhase phase) {
+    switch (phase) {
+        case RectPhase::IDLE:          return "idle";
+        case RectPhase::HEATING:       return "heating";
+        case RectPhase::STABILIZATION: return "stabilization";
+        case RectPhase::HEADS:         return "heads";
+        case RectPhase::PURGE:         return "purge";
+        case RectPhase::BODY:          return "body";
+        case RectPhase::TAILS:         return "tails";
+        case RectPhase::FINISH:        return "finish";
+        case RectPhase::ERROR:         return "error";
+        default:                       return "unknown";
+    }
+}
+
+const char* getModeName(Mode mode) {
+    switch (mode) {
+        case Mode::IDLE:          return "idle";
+        case Mode::RECTIFICATION: return "rectification";
+        case Mode::MANUAL_RECT:   return "manual_rect";
+        case Mode::DISTILLATION:  return "distillation";
+        case Mode::MASHING:       return "mashing";
+        case Mode::HOLD:          return "hold";
+        case Mode::FLOOD_CALIBRATION: return "flood_calibration";
+        case Mode::PID_AUTOTUNE:  return "pid_autotune";
+        default:                  return "unknown";
+    }
+}
+
 } // namespace FSM
@@ -24,8 +24,9 @@ namespace FSM {
      * @param state Состояние
      * @param settings Настройки
      * @param mode Режим
+     * @param value Параметр режима (уставка T куба для PID_AUTOTUNE)
      */
-    void startMode(SystemState& state, const Settings& settings, Mode mode);
+    void startMode(SystemState& state, const Settings& settings, Mode mode, float value = 0);
     
     /**
      * Остановка текущего режима
@@ -106,33 +107,6 @@ namespace FSM {
         void update(SystemState& state, const Settings& settings);
     }
     
-    // =========================================================================
-    // ДИСТИЛЛЯЦИЯ
-    // =========================================================================
-    
-    namespace Distillation {
-        void update(SystemState& state, const Settings& settings);
-    }
-    
-    // =========================================================================
-    // ЗАТИРКА
-    // =========================================================================
-    
-    namespace Mashing {
-        void update(SystemState& state, const Settings& settings);
-        void setProfile(uint8_t profileIndex);
-        void nextStep(SystemState& state);
-    }
-    
-    // =========================================================================
-    // HOLD
-    // =========================================================================
-    
-    namespace Hold {
-        void update(SystemState& state, const Settings& settings);
-        void setSteps(const TempStep* steps, uint8_t count);
-    }
-    
     /**
      * Получение имени текущей фазы
      * @param phase Фаза
@@ -0,0 +1,267 @@
+/**
+ * Smart-Column S3 - Планировщик разгона
+ *
+ * Раз в HEATUP_SAMPLE_MS: наклон T куба (°C/мин), средняя мощность за
+ * окно (кВт, по PZEM или по проценту ТЭНа) и превышение над начальной T.
+ * МНК с забыванием по двум параметрам: dT/dt = g·P - l·(T - T0).
+ * T кипения - по крепости загрузки при атмосферном давлении плюс рабочее
+ * давление колонны. Полоса снижения мощности - путь T за HEATUP_TAPER_MIN
+ * на максимуме, внутри полосы мощность линейно сходит к рабочей.
+ * Без датчика низа царги (перегонный куб) кипение - по T куба: T кипения
+ * загрузки или наклон, упавший ниже доли расчётного по модели.
+ */
+
+#include "heatup_planner.h"
+#include "../hal/hal.h"
+#include "watt_control.h"
+#include "vle.h"
+#include "../history.h"
+#include "../drivers/heater.h"
+
+#define HEATUP_SAMPLE_MS        30000   // Окно оценки наклона
+#define HEATUP_FORGET           0.98f   // Забывание МНК (на окно)
+#define HEATUP_MIN_SAMPLES      6       // Окон до готовности модели
+#define HEATUP_MIN_SLOPE_TEMP   5.0f    // °C над T0 для оценки потерь
+#define HEATUP_VAPOUR_RISE      10.0f   // °C роста низа царги - пар в колонне
+#define HEATUP_MIN_SURPLUS      15      // % сверх потерь на кипении
+#define HEATUP_BOIL_SLOPE       0.25f   // Доля расчётного наклона - куб кипит
+#define HEATUP_BOIL_WINDOWS     2       // Окон подряд с упавшим наклоном
+
+#define STANDARD_HPA            1013.25f
+#define HPA_PER_MMHG            1.33322f
+
+static HeatupModel model;
+static HeatupReport report;
+
+// Суммы МНК: x1 = P (кВт), x2 = T - T0, y = dT/dt (°C/мин)
+static float s11, s12, s22, s1y, s2y;
+
+static uint32_t startTime = 0;
+static uint32_t windowStart = 0;
+static float windowTemp = 0;
+static float powerSum = 0;
+static uint16_t powerCount = 0;
+
+static float columnStartTemp = 0;
+static uint8_t workPercent = HEATUP_WORK_PERCENT;
+static bool vapour = false;
+static float atmosphereHpa = STANDARD_HPA;
+static uint8_t stalledWindows = 0;
+
+// Наблюдение после разгона
+static bool observing = false;
+static uint32_t observeStart = 0;
+
+/**
+ * Прогноз времени до T кипения при постоянной мощности (аналитически для
+ * звена первого порядка)
+ */
+static float predictEta(float temp, float powerKw) {
+    if (model.boilTemp <= 0) return -1;
+
+    float rise = model.boilTemp - model.ambientTemp;
+    float now = temp - model.ambientTemp;
+    if (now >= rise) return 0;
+
+    float drive = model.heatGain * powerKw;
+    if (drive <= 0) return -1;
+
+    if (model.lossRate <= 1e-5f) {
+        return (rise - now) / drive * 60.0f;
+    }
+
+    // Установившийся перегрев drive/l должен быть выше кипения
+    float steady = drive / model.lossRate;
+    if (steady <= rise) return -1;
+    return logf((steady - now) / (steady - rise)) / model.lossRate * 60.0f;
+}
+
+static void addSample(float slope, float powerKw, float excess) {
+    s11 = s11 * HEATUP_FORGET + powerKw * powerKw;
+    s12 = s12 * HEATUP_FORGET + powerKw * excess;
+    s22 = s22 * HEATUP_FORGET + excess * excess;
+    s1y = s1y * HEATUP_FORGET + powerKw * slope;
+    s2y = s2y * HEATUP_FORGET + excess * slope;
+    model.samples++;
+
+    // Пока куб не отошёл от T0, потери неразличимы - только теплоёмкость
+    float det = s11 * s22 - s12 * s12;
+    if (excess > HEATUP_MIN_SLOPE_TEMP && det > 1e-3f * s11 * s22) {
+        float g = (s22 * s1y - s12 * s2y) / det;
+        float l = -(s11 * s2y - s12 * s1y) / det;
+        if (g > 0) {
+            model.heatGain = g;
+            model.lossRate = l > 0 ? l : 0;
+        }
+    } else if (s11 > 0) {
+        model.heatGain = s1y / s11;
+        model.lossRate = 0;
+    }
+
+    model.ready = model.samples >= HEATUP_MIN_SAMPLES && model.heatGain > 0;
+}
+
+namespace HeatupPlanner {
+
+void start(const SystemState& state, const RunPlan& plan, uint8_t percent) {
+    memset(&model, 0, sizeof(model));
+    memset(&report, 0, sizeof(report));
+    s11 = s12 = s22 = s1y = s2y = 0;
+
+    model.ambientTemp = state.temps.cube;
+    model.boilEtaSec = -1;
+
+    // Куб закипает под давлением атмосферы и рабочим перепадом колонны
+    atmosphereHpa = state.pressure.atmosphere > 0 ? state.pressure.atmosphere : STANDARD_HPA;
+    if (plan.chargeAbv > 0) {
+        float cubeHpa = atmosphereHpa + WattControl::getModel().target * HPA_PER_MMHG;
+        model.boilTemp = Vle::boilingTemp(plan.chargeAbv, cubeHpa);
+    }
+    columnStartTemp = state.temps.columnBottom;
+    workPercent = percent;
+    vapour = false;
+    stalledWindows = 0;
+    observing = false;
+
+    startTime = windowStart = Hal::millis();
+    windowTemp = state.temps.cube;
+    powerSum = 0;
+    powerCount = 0;
+
+    if (model.boilTemp > 0) {
+        LOG_I("Heatup: T0=%.1f, boil %.1f (%.0f%%), work power %u%%", model.ambientTemp,
+              model.boilTemp, plan.chargeAbv, workPercent);
+    } else {
+        LOG_I("Heatup: T0=%.1f, charge ABV unknown, work power %u%%", model.ambientTemp,
+              workPercent);
+    }
+}
+
+uint8_t update(const SystemState& state, const RunPlan& plan) {
+    uint32_t now = Hal::millis();
+    uint8_t maxPercent = plan.heaterMaxPercent;
+    float nominalKw = plan.heaterPowerW / 1000.0f;
+
+    // Средняя фактическая мощность окна
+    powerSum += state.health.pzemOk ? state.power.power / 1000.0f
+                                    : Heater::getPower() * nominalKw / 100.0f;
+    powerCount++;
+
+    if (now - windowStart >= HEATUP_SAMPLE_MS && state.temps.valid[TEMP_CUBE]) {
+        float minutes = (now - windowStart) / 60000.0f;
+        float slope = (state.temps.cube - windowTemp) / minutes;
+        float excess = (state.temps.cube + windowTemp) / 2.0f - model.ambientTemp;
+        float powerKw = powerSum / powerCount;
+
+        // Тепло уходит в испарение, а не в нагрев: наклон падает против
+        // модели. Такие окна в МНК не идут - они занизили бы теплоёмкость
+        bool stalled = false;
+        if (model.ready && state.temps.cube > Vle::azeotropeTemp(atmosphereHpa)) {
+            float expected = model.heatGain * powerKw - model.lossRate * excess;
+            stalled = expected > 0 && slope < expected * HEATUP_BOIL_SLOPE;
+        }
+        stalledWindows = stalled ? stalledWindows + 1 : 0;
+        if (!stalled) addSample(slope, powerKw, excess);
+
+        windowStart = now;
+        windowTemp = state.temps.cube;
+        powerSum = 0;
+        powerCount = 0;
+
+        if (model.ready) {
+            float eta = predictEta(state.temps.cube, nominalKw * maxPercent / 100.0f);
+            if (report.predictedSec == 0 && eta > 0) {
+                report.predictedSec = (now - startTime) / 1000 + (uint32_t)eta;
+                LOG_I("Heatup: C=%.0f kJ/K, loss=%.0f W/K, boil in %.0f min",
+                      60.0f / model.heatGain, 1000.0f * model.lossRate / model.heatGain,
+                      eta / 60.0f);
+            }
+            model.boilEtaSec = eta;
+        }
+    }
+
+    // Пар уже в колонне - только рабочая мощность
+    if (!vapour && state.temps.valid[TEMP_COLUMN_BOTTOM] &&
+        state.temps.columnBottom - columnStartTemp > HEATUP_VAPOUR_RISE) {
+        vapour = true;
+        report.boilTemp = state.temps.cube;
+        LOG_I("Heatup: Vapour at T_cube=%.1f (expected %.1f)", state.temps.cube, model.boilTemp);
+    }
+    if (!vapour && !state.temps.valid[TEMP_COLUMN_BOTTOM] && state.temps.valid[TEMP_CUBE] &&
+        ((model.boilTemp > 0 && state.temps.cube >= model.boilTemp) ||
+         stalledWindows >= HEATUP_BOIL_WINDOWS)) {
+        vapour = true;
+        report.boilTemp = state.temps.cube;
+        LOG_I("Heatup: Boiling by cube at T=%.1f (expected %.1f)", state.temps.cube, model.boilTemp);
+    }
+
+    // Без крепости загрузки T кипения известна только по факту пара
+    float boilTemp = model.boilTemp > 0 ? model.boilTemp : state.temps.cube;
+
+    uint8_t work = workPercent < maxPercent ? workPercent : maxPercent;
+    if (model.ready && model.heatGain > 0) {
+        // Рабочая мощность должна перекрывать потери на кипении с запасом
+        float lossKw = model.lossRate / model.heatGain * (boilTemp - model.ambientTemp);
+        float lossPercent = nominalKw > 0 ? lossKw / nominalKw * 100.0f : 0;
+        if (work < lossPercent + HEATUP_MIN_SURPLUS) {
+            work = (uint8_t)min(lossPercent + HEATUP_MIN_SURPLUS, (float)maxPercent);
+        }
+    }
+    report.workPercent = work;
+
+    if (vapour) return work;
+    if (!model.ready || model.boilTemp <= 0 || !state.temps.valid[TEMP_CUBE]) return maxPercent;
+
+    // Полоса снижения: путь T за HEATUP_TAPER_MIN у кипения на максимуме
+    float slopeAtBoil = model.heatGain * nominalKw * maxPercent / 100.0f -
+                        model.lossRate * (model.boilTemp - model.ambientTemp);
+    float band = slopeAtBoil * HEATUP_TAPER_MIN;
+    if (band <= 0) return maxPercent;
+
+    float left = (model.boilTemp - state.temps.cube) / band;
+    if (left >= 1.0f) return maxPercent;
+    if (left <= 0.0f) return work;
+    return (uint8_t)(work + (maxPercent - work) * left + 0.5f);
+}
+
+void finishHeating(const SystemState& state) {
+    report.durationSec = (Hal::millis() - startTime) / 1000;
+    if (report.boilTemp == 0) report.boilTemp = state.temps.cube;
+    if (model.heatGain > 0) {
+        report.thermalMass = 60.0f / model.heatGain;
+        report.lossWK = 1000.0f * model.lossRate / model.heatGain;
+    }
+    report.overshoot = 0;
+
+    observing = true;
+    observeStart = Hal::millis();
+    processRecorder.recordHeatup(report);
+
+    LOG_I("Heatup: Done in %lu s (predicted %lu s)",
+          (unsigned long)report.durationSec, (unsigned long)report.predictedSec);
+}
+
+void observe(const SystemState& state) {
+    if (!observing) return;
+
+    if (state.health.ads1115Ok) {
+        float over = state.pressure.cube - WattControl::getModel().target;
+        if (over > report.overshoot) report.overshoot = over;
+    }
+
+    if (Hal::millis() - observeStart >= HEATUP_OVERSHOOT_MIN * 60000UL) {
+        observing = false;
+        LOG_I("Heatup: Pressure overshoot %.1f mmHg", report.overshoot);
+        processRecorder.recordHeatup(report);
+    }
+}
+
+bool boiling() {
+    return vapour;
+}
+
+const HeatupModel& getModel() {
+    return model;
+}
+
+} // namespace HeatupPlanner
@@ -0,0 +1,73 @@
+/**
+ * Smart-Column S3 - Heat-up Planner
+ *
+ * Разгон куба без броска паров в колонну. По наклону T куба и мощности
+ * идентифицируется тепловая модель C·dT/dt = P - k·(T - T0), по ней
+ * прогнозируется выход на кипение, и мощность заранее снижается до
+ * рабочей, чтобы колонна вышла на рабочее давление без перерегулирования.
+ * T кипения - по крепости загрузки из плана (VLE); без неё прогноза нет,
+ * и мощность максимальная до появления пара в колонне.
+ * Без датчика низа царги кипение определяется по T куба.
+ */
+
+#ifndef HEATUP_PLANNER_H
+#define HEATUP_PLANNER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "run_plan.h"
+
+/**
+ * Тепловая модель куба
+ */
+struct HeatupModel {
+    float heatGain;                 // 1/C: °C/мин на кВт
+    float lossRate;                 // k/C: 1/мин
+    float ambientTemp;              // T0 - T куба на старте
+    float boilTemp;                 // Ожидаемая T кипения загрузки (0 - неизвестна)
+    uint16_t samples;
+    bool ready;
+    float boilEtaSec;               // Прогноз до кипения на максимуме, с (-1 - не достигнет)
+};
+
+namespace HeatupPlanner {
+    /**
+     * Начало разгона
+     * @param state Состояние системы
+     * @param plan Активный план (крепость загрузки)
+     * @param workPercent Рабочая мощность после выхода на кипение (%)
+     */
+    void start(const SystemState& state, const RunPlan& plan, uint8_t workPercent);
+
+    /**
+     * Мощность в фазе HEATING (вызывать в loop)
+     * @param state Состояние системы
+     * @param plan Активный план (предел и номинал ТЭНа)
+     * @return Мощность 0-100%
+     */
+    uint8_t update(const SystemState& state, const RunPlan& plan);
+
+    /**
+     * Конец разгона (переход в стабилизацию)
+     */
+    void finishHeating(const SystemState& state);
+
+    /**
+     * Наблюдение за давлением после разгона: пик над уставкой
+     * WattControl за HEATUP_OVERSHOOT_MIN, затем отчёт в историю
+     */
+    void observe(const SystemState& state);
+
+    /**
+     * Куб кипит: пар в колонне по низу царги, без датчика - по T куба
+     */
+    bool boiling();
+
+    /**
+     * Текущая модель
+     */
+    const HeatupModel& getModel();
+}
+
+#endif // HEATUP_PLANNER_H
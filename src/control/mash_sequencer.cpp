@@ -0,0 +1,381 @@
+/**
+ * Smart-Column S3 - Ступени затирки и Hold
+ *
+ * Прямая связь:
+ *   потери   k·(T_уст - T0),  k - Вт/°C, оценивается на выдержке
+ *   рампа    C·v,  C = объём куба × теплоёмкость воды, v - MASH_RAMP_RATE
+ * ПИД добавляет к ней не больше ±MASH_TRIM_PERCENT. Коэффициенты - из плана
+ * (автонастройка), без неё - SIMC для интегрирующего объекта по C и
+ * мощности ТЭНа: общие PID_*_DEFAULT для массы затора слишком "интегральны".
+ * Оценка потерь: средняя мощность за окно MASH_LEARN_MS в допуске,
+ * делённая на превышение над T0. Смена оценки переносится из интеграла
+ * ПИД в прямую связь без скачка мощности.
+ */
+
+#include "mash_sequencer.h"
+#include "../hal/hal.h"
+#include "pid.h"
+#include "temp_filter.h"
+#include "../history.h"
+#include "../drivers/heater.h"
+
+#define MASH_CONTROL_MS         1000    // Шаг регулятора
+#define MASH_TEMP_MIN           20.0f   // °C ступени
+#define MASH_TEMP_MAX           100.0f
+#define MASH_LEARN_MIN_EXCESS   10.0f   // °C над T0 для оценки потерь
+#define MASH_BAND_LOG_HYST      0.05f   // °C - гистерезис записи выхода из допуска
+#define MASH_TUNE_LAG_SEC       60.0f   // Запаздывание куб - DS18B20 - фильтр для расчёта ПИД
+
+// Встроенные профили (из Distiller Control v1.4.0)
+static const struct {
+    const char* name;
+    uint8_t count;
+    float temp[MASH_MAX_STEPS];
+    uint16_t minutes[MASH_MAX_STEPS];
+} DEFAULT_PROFILES[3] = {
+    { "Классика", 7, { 40, 52, 63, 67, 72, 75, 78 }, { 10, 10, 30, 15, 30, 5, 10 } },
+    { "Полный",   7, { 38, 45, 52, 63, 67, 72, 78 }, { 15, 15, 20, 40, 20, 50, 10 } },
+    { "Быстрый",  4, { 52, 63, 72, 78 },             { 10, 20, 30, 10 } }
+};
+
+static TempStep program[MASH_MAX_STEPS];
+static uint8_t programCount = 0;
+static PidController pid;
+static float ambientTemp = MASH_AMBIENT_TEMP;
+
+static uint32_t lastControl = 0;
+static uint32_t stepStart = 0;
+static uint32_t rampMs = 0;
+static uint32_t heldMs = 0;
+static uint32_t outMs = 0;
+static float stepEnergyWh = 0;
+static bool wasInBand = false;
+
+// Окно оценки потерь
+static uint32_t learnStart = 0;
+static float learnPowerSum = 0;
+static float learnExcessSum = 0;
+static uint16_t learnCount = 0;
+
+static bool finished = false;           // Все ступени выдержаны
+static bool done = false;               // update() вернул true
+static uint32_t finishStart = 0;
+
+// =============================================================================
+// ВСПОМОГАТЕЛЬНЫЕ
+// =============================================================================
+
+/**
+ * Пауза затирки по T ступени
+ */
+static MashPhase phaseFor(float temp) {
+    if (temp < 45.0f) return MashPhase::ACID_REST;
+    if (temp < 55.0f) return MashPhase::PROTEIN_REST;
+    if (temp < 66.0f) return MashPhase::BETA_AMYLASE;
+    if (temp < 76.0f) return MashPhase::ALPHA_AMYLASE;
+    return MashPhase::MASH_OUT;
+}
+
+static const char* phaseKey(MashPhase phase) {
+    switch (phase) {
+        case MashPhase::ACID_REST:     return "acid";
+        case MashPhase::PROTEIN_REST:  return "protein";
+        case MashPhase::BETA_AMYLASE:  return "beta";
+        case MashPhase::ALPHA_AMYLASE: return "alpha";
+        case MashPhase::MASH_OUT:      return "mashout";
+        default:                       return "step";
+    }
+}
+
+/**
+ * Фактическая мощность ТЭНа: PZEM или процент от номинала
+ */
+static float heaterWatts(const SystemState& state, const RunPlan& plan) {
+    return state.health.pzemOk ? state.power.power
+                               : plan.heaterPowerW * Heater::getPower() / 100.0f;
+}
+
+/**
+ * Коэффициенты ПИД: из плана, если они не по умолчанию
+ */
+static void applyTunings(const RunPlan& plan) {
+    bool defaults = plan.pidKp == PID_KP_DEFAULT && plan.pidKi == PID_KI_DEFAULT &&
+                    plan.pidKd == PID_KD_DEFAULT;
+    float capacity = plan.chargeVolumeL * MASH_HEAT_J_L_K;
+    if (!defaults || capacity <= 0) {
+        pid.setTunings(plan.pidKp, plan.pidKi, plan.pidKd);
+        return;
+    }
+
+    // dT/dt = g·u, g - °C/с на % мощности; SIMC: Kp = 1/(g·2θ), Ti = 8θ
+    float gain = plan.heaterPowerW / 100.0f / capacity;
+    float kp = 1.0f / (gain * 2.0f * MASH_TUNE_LAG_SEC);
+    pid.setTunings(kp, kp / (8.0f * MASH_TUNE_LAG_SEC), 0);
+}
+
+static void resetLearning(uint32_t now) {
+    learnStart = now;
+    learnPowerSum = 0;
+    learnExcessSum = 0;
+    learnCount = 0;
+}
+
+static void enterStep(SystemState& state, uint8_t index, uint32_t now) {
+    MashState& m = state.mash;
+    const TempStep& step = program[index];
+
+    m.step = index;
+    m.target = step.temperature;
+    m.holdSec = step.durationMin * 60UL;
+    m.holding = false;
+    m.inBand = false;
+    m.heldSec = 0;
+    state.mashPhase = phaseFor(step.temperature);
+
+    stepStart = now;
+    rampMs = heldMs = outMs = 0;
+    stepEnergyWh = 0;
+    wasInBand = false;
+    resetLearning(now);
+
+    LOG_I("Mash: Step %u/%u %s: %.1f°C × %u min", index + 1, programCount, step.name,
+          step.temperature, step.durationMin);
+}
+
+static void finishStep(SystemState& state, uint32_t now) {
+    MashState& m = state.mash;
+
+    TempStepRecord record;
+    record.name = program[m.step].name;
+    record.target = m.target;
+    record.startTime = stepStart / 1000;
+    record.rampSec = rampMs / 1000;
+    record.holdSec = heldMs / 1000;
+    record.outOfBandSec = outMs / 1000;
+    record.energyWh = stepEnergyWh;
+    record.lossWK = m.lossWK;
+    processRecorder.recordTempStep(record);
+
+    LOG_I("Mash: Step %u done: ramp %lu s, hold %lu s, out of band %lu s, %.0f Wh",
+          m.step + 1, (unsigned long)record.rampSec, (unsigned long)record.holdSec,
+          (unsigned long)record.outOfBandSec, stepEnergyWh);
+
+    if (m.step + 1 < programCount) {
+        enterStep(state, m.step + 1, now);
+        return;
+    }
+
+    LOG_I("Mash: All steps done, loss %.1f W/°C", m.lossWK);
+    Heater::setPower(0);
+    state.mashPhase = MashPhase::FINISH;
+    finished = true;
+    finishStart = now;
+}
+
+static void fail(const char* message) {
+    LOG_E("Mash: %s", message);
+    processRecorder.addWarning(message, "error");
+    Heater::setPower(0);
+    done = true;
+}
+
+/**
+ * Выдержка: таймер в допуске, оценка потерь по окну в допуске
+ */
+static void updateHold(SystemState& state, const RunPlan& plan, float temp, uint32_t dtMs,
+                       uint32_t now) {
+    MashState& m = state.mash;
+
+    m.inBand = fabsf(temp - m.target) <= MASH_HOLD_BAND;
+    if (m.inBand) {
+        heldMs += dtMs;
+    } else {
+        outMs += dtMs;
+    }
+    m.heldSec = heldMs / 1000;
+
+    // В журнал - с гистерезисом, таймер - строго по допуску
+    float error = fabsf(temp - m.target);
+    if (wasInBand ? error > MASH_HOLD_BAND + MASH_BAND_LOG_HYST
+                  : error <= MASH_HOLD_BAND - MASH_BAND_LOG_HYST) {
+        if (!wasInBand) {
+            LOG_I("Mash: In band at %.2f°C, timer running", temp);
+        } else {
+            LOG_W("Mash: Out of band at %.2f°C, timer paused", temp);
+        }
+        wasInBand = !wasInBand;
+    }
+
+    // Потери: в допуске средняя мощность уходит в окружение
+    if (!m.inBand) {
+        resetLearning(now);
+    } else {
+        learnPowerSum += heaterWatts(state, plan);
+        learnExcessSum += temp - ambientTemp;
+        learnCount++;
+
+        if (now - learnStart >= MASH_LEARN_MS && learnCount > 0) {
+            float excess = learnExcessSum / learnCount;
+            if (excess > MASH_LEARN_MIN_EXCESS) {
+                float observed = learnPowerSum / learnCount / excess;
+                float previous = m.lossWK;
+                m.lossWK += MASH_LOSS_LEARN * (observed - previous);
+
+                // Прирост прямой связи снимается с интеграла - мощность не скачет
+                float shift = (m.lossWK - previous) * (m.setpoint - ambientTemp) /
+                              plan.heaterPowerW * 100.0f;
+                pid.reset(m.setpoint, temp, pid.getOutput() - shift);
+            }
+            resetLearning(now);
+        }
+    }
+
+    if (m.holdSec > 0 && heldMs >= m.holdSec * 1000UL) {
+        finishStep(state, now);
+    }
+}
+
+namespace MashSequencer {
+
+// =============================================================================
+// API
+// =============================================================================
+
+void defaultProfiles(MashProfile* profiles) {
+    for (uint8_t p = 0; p < 3; p++) {
+        MashProfile& profile = profiles[p];
+        memset(&profile, 0, sizeof(profile));
+        strncpy(profile.name, DEFAULT_PROFILES[p].name, sizeof(profile.name) - 1);
+        profile.stepCount = DEFAULT_PROFILES[p].count;
+        for (uint8_t i = 0; i < profile.stepCount; i++) {
+            TempStep& step = profile.steps[i];
+            step.temperature = DEFAULT_PROFILES[p].temp[i];
+            step.durationMin = DEFAULT_PROFILES[p].minutes[i];
+            strncpy(step.name, phaseKey(phaseFor(step.temperature)), sizeof(step.name) - 1);
+        }
+    }
+}
+
+void start(SystemState& state, const TempStep* steps, uint8_t count) {
+    uint32_t now = Hal::millis();
+    MashState& m = state.mash;
+
+    memset(&m, 0, sizeof(m));
+    finished = false;
+    done = false;
+    programCount = 0;
+
+    if (!steps || count == 0 || count > MASH_MAX_STEPS) {
+        fail("Нет ступеней затирки");
+        return;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (steps[i].temperature < MASH_TEMP_MIN || steps[i].temperature > MASH_TEMP_MAX) {
+            fail("T ступени вне диапазона");
+            return;
+        }
+        program[i] = steps[i];
+        if (program[i].name[0] == '\0') {
+            strncpy(program[i].name, phaseKey(phaseFor(program[i].temperature)),
+                    sizeof(program[i].name) - 1);
+        }
+    }
+    programCount = count;
+
+    float temp = state.temps.cube;
+    ambientTemp = state.temps.valid[TEMP_CUBE] && temp < MASH_AMBIENT_TEMP ? temp
+                                                                            : MASH_AMBIENT_TEMP;
+
+    m.stepCount = count;
+    m.setpoint = temp;
+    m.lossWK = MASH_LOSS_W_K_DEFAULT;
+
+    pid.setOutputLimits(-MASH_TRIM_PERCENT, MASH_TRIM_PERCENT);
+    pid.reset(temp, temp, 0);
+    lastControl = now;
+
+    LOG_I("Mash: Starting, %u steps, T0=%.1f°C", count, ambientTemp);
+    enterStep(state, 0, now);
+}
+
+bool update(SystemState& state, const RunPlan& plan) {
+    if (done) return true;
+
+    uint32_t now = Hal::millis();
+    MashState& m = state.mash;
+
+    if (finished) {
+        Heater::setPower(0);
+        if (now - finishStart >= MASH_FINISH_MS) {
+            done = true;
+        }
+        return done;
+    }
+
+    if (!state.temps.valid[TEMP_CUBE]) {
+        fail("Нет показаний термометра куба");
+        return true;
+    }
+
+    uint32_t dtMs = now - lastControl;
+    if (dtMs < MASH_CONTROL_MS) return false;
+    lastControl = now;
+    float dt = dtMs / 1000.0f;
+
+    float temp = TempFilter::value(state.temps, TEMP_CUBE);
+    stepEnergyWh += heaterWatts(state, plan) * dt / 3600.0f;
+
+    // Рампа: уставка движется к ступени, но не уходит от T куба дальше
+    // MASH_RAMP_LEAD - на слабом ТЭНе подъём медленнее, без накопления ошибки
+    bool heating = false;
+    if (!m.holding) {
+        float step = MASH_RAMP_RATE * dt / 60.0f;
+        if (m.target > m.setpoint) {
+            heating = true;
+            if (m.setpoint < temp + MASH_RAMP_LEAD) {
+                m.setpoint = m.setpoint + step < m.target ? m.setpoint + step : m.target;
+            }
+        } else if (m.setpoint > temp - MASH_RAMP_LEAD) {
+            m.setpoint = m.setpoint - step > m.target ? m.setpoint - step : m.target;
+        }
+
+        if (m.setpoint == m.target) {
+            m.holding = true;
+            rampMs = now - stepStart;
+            resetLearning(now);
+            LOG_I("Mash: Setpoint at %.1f°C after %lu s, T_cube=%.2f°C",
+                  m.target, (unsigned long)(rampMs / 1000), temp);
+        }
+    }
+
+    if (m.holding) {
+        updateHold(state, plan, temp, dtMs, now);
+        if (finished) return false;
+    }
+
+    // Прямая связь: потери при уставке и нагрев массы затора на рампе.
+    // Нагрев снимается за запаздывание датчика до ступени - иначе куб
+    // проскакивает её на путь T за это время
+    float watts = m.lossWK * (m.setpoint > ambientTemp ? m.setpoint - ambientTemp : 0);
+    if (heating && !m.holding &&
+        m.target - m.setpoint > MASH_RAMP_RATE * MASH_TUNE_LAG_SEC / 60.0f) {
+        watts += plan.chargeVolumeL * MASH_HEAT_J_L_K * MASH_RAMP_RATE / 60.0f;
+    }
+    m.feedForward = watts / plan.heaterPowerW * 100.0f;
+
+    applyTunings(plan);
+    float power = m.feedForward + pid.compute(m.setpoint, temp, dt);
+    power = constrain(power, 0.0f, (float)plan.heaterMaxPercent);
+
+    uint8_t percent = (uint8_t)(power + 0.5f);
+    if (Heater::getPower() != percent) {
+        Heater::setPower(percent);
+    }
+    return false;
+}
+
+bool completed() {
+    return finished;
+}
+
+} // namespace MashSequencer
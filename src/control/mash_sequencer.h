@@ -0,0 +1,48 @@
+/**
+ * Smart-Column S3 - Mash Sequencer
+ *
+ * Температурные ступени затирки и Hold: уставка поднимается к ступени
+ * с заданной скоростью (°C/мин), затем выдержка в допуске ±MASH_HOLD_BAND.
+ * Мощность = прямая связь (теплопотери по оценке Вт/°C над T помещения
+ * плюс нагрев массы затора на рампе) + поправка ПИД. Таймер ступени
+ * стоит, пока T куба вне допуска.
+ */
+
+#ifndef MASH_SEQUENCER_H
+#define MASH_SEQUENCER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "run_plan.h"
+
+namespace MashSequencer {
+    /**
+     * Встроенные профили затирки (настройки по умолчанию)
+     * @param profiles Массив из 3 профилей Settings::mashProfiles
+     */
+    void defaultProfiles(MashProfile* profiles);
+
+    /**
+     * Начало последовательности ступеней (из FSM::startMode)
+     * @param state Состояние системы
+     * @param steps Ступени (копируются)
+     * @param count Число ступеней, durationMin = 0 - выдержка до остановки
+     */
+    void start(SystemState& state, const TempStep* steps, uint8_t count);
+
+    /**
+     * Обновление (вызывать в loop в режимах MASHING и HOLD)
+     * @param state Состояние системы, ход ступеней - в state.mash
+     * @param plan Активный план (мощность ТЭНа, коэффициенты ПИД, объём куба)
+     * @return true когда последовательность завершена или прервана
+     */
+    bool update(SystemState& state, const RunPlan& plan);
+
+    /**
+     * Все ступени выдержаны (иначе - ошибка при старте или датчике)
+     */
+    bool completed();
+}
+
+#endif // MASH_SEQUENCER_H
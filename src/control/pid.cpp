@@ -0,0 +1,68 @@
+/**
+ * Smart-Column S3 - ПИД-регулятор
+ *
+ * Защита от насыщения интеграла: интеграл не растёт, пока выход упёрт
+ * в предел в ту же сторону, и ограничен пределами выхода. Производная
+ * по измерению сглаживается звеном первого порядка (PID_D_FILTER_SEC) -
+ * шаг DS18B20 0.0625°C иначе даёт импульсы выхода.
+ */
+
+#include "pid.h"
+
+PidController::PidController()
+    : kp(PID_KP_DEFAULT), ki(PID_KI_DEFAULT), kd(PID_KD_DEFAULT),
+      outMin(PID_OUTPUT_MIN), outMax(PID_OUTPUT_MAX),
+      integral(0), lastMeasurement(0), derivative(0), output(0), initialized(false) {
+}
+
+void PidController::setTunings(float newKp, float newKi, float newKd) {
+    if (newKp < 0 || newKi < 0 || newKd < 0) return;
+    kp = newKp;
+    ki = newKi;
+    kd = newKd;
+}
+
+void PidController::setOutputLimits(float newMin, float newMax) {
+    if (newMin >= newMax) return;
+    outMin = newMin;
+    outMax = newMax;
+    integral = constrain(integral, outMin, outMax);
+    output = constrain(output, outMin, outMax);
+}
+
+void PidController::reset(float setpoint, float measurement, float currentOutput) {
+    lastMeasurement = measurement;
+    derivative = 0;
+    output = constrain(currentOutput, outMin, outMax);
+    // Интеграл принимает на себя разницу между текущей мощностью
+    // и пропорциональной частью - первый шаг продолжит с той же мощности
+    integral = constrain(output - kp * (setpoint - measurement), outMin, outMax);
+    initialized = true;
+}
+
+float PidController::compute(float setpoint, float measurement, float dtSec) {
+    if (!initialized) {
+        reset(setpoint, measurement, output);
+    }
+    if (dtSec <= 0) {
+        return output;
+    }
+
+    float error = setpoint - measurement;
+
+    // Производная по измерению с фильтром
+    float rawDerivative = (measurement - lastMeasurement) / dtSec;
+    float alpha = dtSec / (PID_D_FILTER_SEC + dtSec);
+    derivative += alpha * (rawDerivative - derivative);
+    lastMeasurement = measurement;
+
+    // Условное интегрирование: не копить в сторону упора
+    float step = ki * error * dtSec;
+    bool windsUp = (output >= outMax && step > 0) || (output <= outMin && step < 0);
+    if (!windsUp) {
+        integral = constrain(integral + step, outMin, outMax);
+    }
+
+    output = constrain(integral + kp * error - kd * derivative, outMin, outMax);
+    return output;
+}
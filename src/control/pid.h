@@ -0,0 +1,68 @@
+/**
+ * Smart-Column S3 - PID Controller
+ *
+ * ПИД-регулятор мощности ТЭНа для удержания температуры.
+ * Единицы: выход в % мощности, Kp - %/°C, Ki - %/(°C·с), Kd - %·с/°C.
+ * Интеграл хранится в единицах выхода: смена Ki не даёт скачка,
+ * производная берётся по измерению, а не по ошибке - смена уставки
+ * тоже не даёт скачка.
+ */
+
+#ifndef PID_H
+#define PID_H
+
+#include <Arduino.h>
+#include "config.h"
+
+class PidController {
+public:
+    PidController();
+
+    /**
+     * Коэффициенты (без скачка выхода)
+     */
+    void setTunings(float kp, float ki, float kd);
+
+    /**
+     * Пределы выхода (по умолчанию PID_OUTPUT_MIN..PID_OUTPUT_MAX)
+     */
+    void setOutputLimits(float outMin, float outMax);
+
+    /**
+     * Безударное включение: следующий compute() продолжит с текущей
+     * мощности, а не с нуля
+     * @param setpoint Уставка
+     * @param measurement Текущее измерение
+     * @param output Мощность, которая сейчас на ТЭНе
+     */
+    void reset(float setpoint, float measurement, float output);
+
+    /**
+     * Шаг регулятора
+     * @param setpoint Уставка (°C)
+     * @param measurement Измерение (°C)
+     * @param dtSec Время с прошлого шага (с)
+     * @return Выход в пределах setOutputLimits()
+     */
+    float compute(float setpoint, float measurement, float dtSec);
+
+    float getOutput() const { return output; }
+    float getKp() const { return kp; }
+    float getKi() const { return ki; }
+    float getKd() const { return kd; }
+
+private:
+    float kp;
+    float ki;
+    float kd;
+    float outMin;
+    float outMax;
+
+    float integral;                 // Интегральная составляющая (% выхода)
+    float lastMeasurement;
+    float derivative;               // Отфильтрованная dPV/dt (°C/с)
+    float output;
+    bool initialized;
+};
+
+#endif // PID_H
@@ -0,0 +1,275 @@
+/**
+ * Smart-Column S3 - Автонастройка ПИД
+ *
+ * Реле с гистерезисом AUTOTUNE_HYSTERESIS вокруг уставки. Цикл - от
+ * включения до следующего включения ТЭНа, в цикле фиксируются период,
+ * размах T и длительности полупериодов. Смещение реле подстраивается так,
+ * чтобы полупериоды нагрева и остывания сравнялись (иначе при малых
+ * потерях куба колебания несимметричны и Ku завышен).
+ */
+
+#include "pid_autotune.h"
+#include "../hal/hal.h"
+#include "seqlock.h"
+#include "../history.h"
+#include "../profiles.h"
+#include "../drivers/heater.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define AUTOTUNE_MIN_RELAY      5.0f    // % - минимальная амплитуда реле
+
+static AutotuneResult current;
+static Seqlock<AutotuneResult> published;
+
+static uint32_t runStart = 0;
+static uint32_t lastSwitch = 0;
+static uint32_t cycleStart = 0;         // 0 - первый цикл ещё не начат
+static uint32_t highDuration = 0;
+static bool relayHigh = false;
+static float relay = 0;                 // Амплитуда реле d (%)
+static float peakMax = 0;
+static float peakMin = 0;
+static uint8_t maxPercent = 100;
+static char profileId[RUN_PLAN_ID_LEN];
+
+// Последние циклы (кольцо)
+static float periods[AUTOTUNE_CYCLES];
+static float amplitudes[AUTOTUNE_CYCLES];
+static float relays[AUTOTUNE_CYCLES];
+
+static void publish() {
+    published.write(current);
+}
+
+static void setRelay(bool high) {
+    relayHigh = high;
+    float out = high ? current.bias + relay : current.bias - relay;
+    Heater::setPower((uint8_t)constrain(out + 0.5f, 0.0f, (float)maxPercent));
+}
+
+/**
+ * Разброс значений относительно среднего
+ */
+static bool consistent(const float* values, float& mean) {
+    float lo = values[0], hi = values[0], sum = 0;
+    for (uint8_t i = 0; i < AUTOTUNE_CYCLES; i++) {
+        if (values[i] < lo) lo = values[i];
+        if (values[i] > hi) hi = values[i];
+        sum += values[i];
+    }
+    mean = sum / AUTOTUNE_CYCLES;
+    return mean > 0 && (hi - lo) / mean <= AUTOTUNE_TOLERANCE;
+}
+
+/**
+ * Возврат плана профиля, заменённого на время автонастройки
+ */
+static void restorePlan() {
+    if (profileId[0] != '\0') {
+        applyProfile(String(profileId));
+    }
+}
+
+static void fail(const char* reason) {
+    LOG_W("Autotune: Failed - %s", reason);
+    processRecorder.addWarning(reason, "error");
+    Heater::setPower(0);
+    current.status = AutotuneStatus::FAILED;
+    publish();
+    restorePlan();
+}
+
+/**
+ * Запись коэффициентов в пользовательский профиль.
+ * Встроенный рецепт или план из настроек не меняются - коэффициенты
+ * остаются в результате и заметках процесса.
+ */
+static bool saveGains() {
+    if (profileId[0] == '\0') {
+        LOG_W("Autotune: No profile applied, gains not saved");
+        return false;
+    }
+
+    String id(profileId);
+    bool saved = false;
+    if (isBuiltinProfile(id)) {
+        LOG_W("Autotune: Builtin profile %s is read-only, gains not saved", profileId);
+    } else {
+        Profile profile;
+        if (loadProfile(id, profile)) {
+            profile.parameters.heater.pidKp = current.kp;
+            profile.parameters.heater.pidKi = current.ki;
+            profile.parameters.heater.pidKd = current.kd;
+            saved = saveProfile(profile);
+        }
+    }
+
+    restorePlan();
+    return saved;
+}
+
+/**
+ * Конец цикла: проверка сходимости и расчёт коэффициентов
+ */
+static bool finishCycle(uint32_t now, uint32_t lowDuration) {
+    uint8_t slot = current.cycles % AUTOTUNE_CYCLES;
+    periods[slot] = (now - cycleStart) / 1000.0f;
+    amplitudes[slot] = (peakMax - peakMin) / 2.0f;
+    relays[slot] = relay;
+    current.cycles++;
+
+    LOG_I("Autotune: Cycle %u: T=%.0fs, a=%.2f°C, bias=%.1f%%, d=%.1f%%",
+          current.cycles, periods[slot], amplitudes[slot], current.bias, relay);
+
+    // Смещение реле - к равным полупериодам
+    float total = (float)(highDuration + lowDuration);
+    if (total > 0) {
+        current.bias += relay * ((float)highDuration - (float)lowDuration) / total / 2.0f;
+        current.bias = constrain(current.bias, AUTOTUNE_MIN_RELAY, maxPercent - AUTOTUNE_MIN_RELAY);
+        relay = min(current.bias, maxPercent - current.bias);
+    }
+
+    if (current.cycles < AUTOTUNE_CYCLES) return false;
+
+    float tu, a, d;
+    if (!consistent(periods, tu) || !consistent(amplitudes, a)) return false;
+    consistent(relays, d);
+
+    // Описывающая функция реле с гистерезисом
+    float eps = AUTOTUNE_HYSTERESIS;
+    float aEff = a > eps ? sqrtf(a * a - eps * eps) : a;
+    current.amplitude = a;
+    current.tuSec = tu;
+    current.ku = 4.0f * d / (PI * aEff);
+
+    // Тиреус-Люйбен: Kp = Ku/2.2, Ti = 2.2·Tu, Td = Tu/6.3
+    current.kp = current.ku / 2.2f;
+    current.ki = current.kp / (2.2f * tu);
+    current.kd = current.kp * tu / 6.3f;
+    return true;
+}
+
+namespace PidAutotune {
+
+void start(SystemState& state, float setpoint, const char* appliedProfileId) {
+    (void)state;
+    LOG_I("Autotune: Starting at %.1f°C", setpoint);
+
+    memset(&current, 0, sizeof(current));
+    current.status = AutotuneStatus::HEATING;
+    current.setpoint = setpoint;
+    memset(profileId, 0, sizeof(profileId));
+    strncpy(profileId, appliedProfileId ? appliedProfileId : "", sizeof(profileId) - 1);
+
+    runStart = Hal::millis();
+    cycleStart = 0;
+    publish();
+}
+
+bool update(SystemState& state, const RunPlan& plan) {
+    if (current.status == AutotuneStatus::DONE || current.status == AutotuneStatus::FAILED) {
+        return true;
+    }
+
+    uint32_t now = Hal::millis();
+    maxPercent = plan.heaterMaxPercent;
+
+    if (!state.temps.valid[TEMP_CUBE]) {
+        fail("Нет показаний термометра куба");
+        return true;
+    }
+    if (now - runStart > AUTOTUNE_MAX_MIN * 60000UL) {
+        fail("Автонастройка не сошлась за отведённое время");
+        return true;
+    }
+
+    float t = state.temps.cube;
+    float sp = current.setpoint;
+
+    if (current.status == AutotuneStatus::HEATING) {
+        Heater::setPower(maxPercent);
+        if (t >= sp - AUTOTUNE_HYSTERESIS) {
+            LOG_I("Autotune: HEATING → RELAY");
+            current.status = AutotuneStatus::RELAY;
+            current.bias = maxPercent / 2.0f;
+            relay = current.bias;
+            lastSwitch = now;
+            peakMax = peakMin = t;
+            setRelay(false);
+            publish();
+        }
+        return false;
+    }
+
+    if (t > peakMax) peakMax = t;
+    if (t < peakMin) peakMin = t;
+
+    if (relayHigh && t > sp + AUTOTUNE_HYSTERESIS) {
+        highDuration = now - lastSwitch;
+        lastSwitch = now;
+        setRelay(false);
+    } else if (!relayHigh && t < sp - AUTOTUNE_HYSTERESIS) {
+        uint32_t lowDuration = now - lastSwitch;
+        lastSwitch = now;
+
+        // Первое включение начинает первый полный цикл
+        if (cycleStart != 0 && finishCycle(now, lowDuration)) {
+            LOG_I("Autotune: Ku=%.2f Tu=%.0fs -> Kp=%.3f Ki=%.5f Kd=%.2f",
+                  current.ku, current.tuSec, current.kp, current.ki, current.kd);
+            Heater::setPower(0);
+            current.saved = saveGains();
+            current.status = AutotuneStatus::DONE;
+
+            char notes[128];
+            snprintf(notes, sizeof(notes), "Ku=%.2f Tu=%.0f с: Kp=%.3f Ki=%.5f Kd=%.2f%s",
+                     current.ku, current.tuSec, current.kp, current.ki, current.kd,
+                     current.saved ? " (записано в профиль)" : "");
+            processRecorder.setNotes(notes);
+            publish();
+            return true;
+        }
+
+        if (current.cycles >= AUTOTUNE_MAX_CYCLES) {
+            fail("Колебания не установились");
+            return true;
+        }
+
+        cycleStart = now;
+        peakMax = peakMin = t;
+        setRelay(true);
+        publish();
+    }
+
+    return false;
+}
+
+void cancel() {
+    if (current.status != AutotuneStatus::HEATING && current.status != AutotuneStatus::RELAY) {
+        return;
+    }
+    LOG_I("Autotune: Cancelled");
+    current.status = AutotuneStatus::IDLE;
+    publish();
+    restorePlan();
+}
+
+void getResult(AutotuneResult& out) {
+    // Писатель - задача loop, запись короткая
+    while (!published.tryRead(out)) {
+        vTaskDelay(1);
+    }
+}
+
+const char* getStatusName(AutotuneStatus status) {
+    switch (status) {
+        case AutotuneStatus::IDLE:    return "idle";
+        case AutotuneStatus::HEATING: return "heating";
+        case AutotuneStatus::RELAY:   return "relay";
+        case AutotuneStatus::DONE:    return "done";
+        case AutotuneStatus::FAILED:  return "failed";
+        default:                      return "unknown";
+    }
+}
+
+} // namespace PidAutotune
@@ -0,0 +1,81 @@
+/**
+ * Smart-Column S3 - PID Autotune
+ *
+ * Релейная автонастройка ПИД по Острёму-Хэгглунду на реальном кубе.
+ * ТЭН переключается между bias+d и bias-d вокруг уставки, по установившимся
+ * автоколебаниям T куба находятся критический коэффициент Ku и период Tu,
+ * коэффициенты считаются по Тиреусу-Люйбену (меньше перерегулирования,
+ * чем Циглер-Никольс, для медленного теплового объекта).
+ */
+
+#ifndef PID_AUTOTUNE_H
+#define PID_AUTOTUNE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "run_plan.h"
+
+/**
+ * Состояние автонастройки
+ */
+enum class AutotuneStatus : uint8_t {
+    IDLE = 0,
+    HEATING,            // Нагрев до уставки на максимуме плана
+    RELAY,              // Релейные колебания
+    DONE,               // Коэффициенты найдены
+    FAILED
+};
+
+/**
+ * Результат автонастройки (копия для веб-сервера)
+ */
+struct AutotuneResult {
+    AutotuneStatus status;
+    float setpoint;                 // °C куба
+    uint8_t cycles;                 // Завершённых циклов реле
+    float bias;                     // Средняя мощность реле (%)
+    float amplitude;                // °C - полуразмах колебаний
+    float ku;                       // %/°C
+    float tuSec;                    // с
+    float kp;
+    float ki;
+    float kd;
+    bool saved;                     // Записано в пользовательский профиль
+};
+
+namespace PidAutotune {
+    /**
+     * Начало автонастройки (из FSM::startMode)
+     * @param state Состояние системы
+     * @param setpoint Уставка T куба (°C)
+     * @param appliedProfileId Профиль, применённый до старта (пусто - нет),
+     *        в него записываются коэффициенты
+     */
+    void start(SystemState& state, float setpoint, const char* appliedProfileId);
+
+    /**
+     * Обновление (вызывать в loop в режиме PID_AUTOTUNE)
+     * @param state Состояние системы
+     * @param plan Активный план (предел мощности)
+     * @return true когда автонастройка завершена (успешно или нет)
+     */
+    bool update(SystemState& state, const RunPlan& plan);
+
+    /**
+     * Прерывание (FSM::stopMode): возврат плана профиля
+     */
+    void cancel();
+
+    /**
+     * Последний результат (из любой задачи)
+     */
+    void getResult(AutotuneResult& out);
+
+    /**
+     * Название состояния
+     */
+    const char* getStatusName(AutotuneStatus status);
+}
+
+#endif // PID_AUTOTUNE_H
@@ -0,0 +1,437 @@
+/**
+ * Smart-Column S3 - Run ETA
+ *
+ * Баланс абсолютного спирта:
+ *   E = L0·a0 - Σ ΔV·d          спирт в кубе
+ *   C = L0 - V                  объём куба
+ *   B = (E - C·a_t) / (d - a_t) остаток тела до крепости хвостов a_t в кубе
+ * L0 - загрузка, a0 - крепость по T кипения куба до отбора, d - крепость
+ * отбора по T верха царги, V - отбор насосом.
+ *
+ * Ошибка a0 по T кипения (таблица VLE на 30-50 % пологая) переходит в E
+ * целиком. В теле E сводится с C·a - крепостью в кубе за окно: веса
+ * обратны дисперсиям (L0·σ)² и (C·σ)², ошибки считаются зависимыми,
+ * поэтому каждое окно заменяет, а не накапливает измерение. К концу
+ * тела C·a точнее баланса.
+ *
+ * Скорость тела r - текущая скорость насоса × доля времени работы (остановки
+ * Smart Decrement) по окнам: средняя по объёму окон отстаёт от повышений
+ * скорости на несколько окон. r спадает как r·e^(-λt),
+ * λ - по снижениям скорости насоса с начала тела. Время до хвостов -
+ * меньшее из: отбор B при спадающей скорости и спад скорости насоса
+ * до минимума Smart Decrement.
+ */
+
+#include "run_eta.h"
+#include "../hal/hal.h"
+#include "../history.h"
+#include "../drivers/pump.h"
+
+#define FINISH_COOL_SEC         300     // Охлаждение в FINISH (как в FSM)
+#define RATE_PRIOR_SIGMA        0.25f   // Разброс скорости до первого окна (доля плана)
+#define RATE_FLOOR              0.25f   // Нижняя граница скорости для интервала (доля средней)
+#define DIST_ABV_DEFAULT        96.0f   // Крепость отбора до оценки по T верха царги
+
+// =============================================================================
+// ОЦЕНЩИК
+// =============================================================================
+
+EtaEstimator::EtaEstimator() {
+    RunPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    reset(plan);
+}
+
+void EtaEstimator::reset(const RunPlan& plan, float abv) {
+    chargeMl = plan.chargeVolumeL * 1000.0f;
+    bodySpeedMlH = plan.bodySpeedMlH;
+    tailsSpeedMlH = plan.tailsSpeedMlH;
+    tailsVolumeMl = plan.tailsVolumeMl;
+    minSpeedMlH = DECREMENT_MIN_SPEED_ML_H_KW * plan.heaterPowerW / 1000.0f;
+    purgeSec = plan.purgeMs / 1000;
+    tailsAbv = abv;
+
+    chargeAbv = 0;
+    chargeFrozen = false;
+    collectedEthanol = 0;
+    lastVolume = -1;
+    distAbv = DIST_ABV_DEFAULT;
+
+    phase = RectPhase::IDLE;
+    now = 0;
+    phaseStart = 0;
+    tailsStartVolume = 0;
+
+    bodyStart = 0;
+    bodyStartSpeed = 0;
+    lastSpeed = 0;
+    windowStart = 0;
+    windowVolume = 0;
+    windowPlanned = 0;
+    windowAbvSum = 0;
+    windowAbvCount = 0;
+    cubeAbv = 0;
+    dutyMean = 0;
+    dutyVar = 0;
+    rateValid = false;
+}
+
+void EtaEstimator::add(const EtaSample& s) {
+    // Отбор без остановок - по скорости насоса до этого отсчёта
+    if (phase == RectPhase::BODY && s.timeSec > now) {
+        windowPlanned += lastSpeed * (s.timeSec - now) / 3600.0f;
+    }
+    now = s.timeSec;
+
+    if (s.distillateAbv > 0) {
+        distAbv = s.distillateAbv;
+    }
+
+    // Крепость загрузки - по кипящему кубу до начала отбора
+    if (!chargeFrozen) {
+        if (s.cubeAbv > 0) {
+            chargeAbv = s.cubeAbv;
+        }
+        if (s.phase >= RectPhase::HEADS) {
+            chargeFrozen = true;
+            if (chargeAbv <= 0) {
+                chargeAbv = RECT_HEADS_ABV_FALLBACK;
+            }
+        }
+    }
+
+    // Отобранный спирт
+    if (lastVolume >= 0 && s.volumeMl > lastVolume) {
+        collectedEthanol += (s.volumeMl - lastVolume) * distAbv / 100.0f;
+    }
+    lastVolume = s.volumeMl;
+
+    if (s.phase != phase) {
+        phase = s.phase;
+        phaseStart = s.timeSec;
+        if (phase == RectPhase::BODY) {
+            bodyStart = s.timeSec;
+            bodyStartSpeed = s.speedMlH > 0 ? s.speedMlH : bodySpeedMlH;
+            lastSpeed = bodyStartSpeed;
+            windowStart = s.timeSec;
+            windowVolume = s.volumeMl;
+            windowPlanned = 0;
+            windowAbvSum = 0;
+            windowAbvCount = 0;
+            rateValid = false;
+        } else if (phase == RectPhase::TAILS) {
+            tailsStartVolume = s.volumeMl;
+        }
+    }
+
+    if (phase != RectPhase::BODY) {
+        return;
+    }
+
+    // Скорость насоса после снижений (стоп - не снижение)
+    if (s.speedMlH > 0) {
+        lastSpeed = s.speedMlH;
+    }
+
+    if (s.cubeAbv > 0) {
+        windowAbvSum += s.cubeAbv;
+        windowAbvCount++;
+    }
+
+    // Доля работы насоса за окно - отбор к отбору без остановок
+    uint32_t dt = s.timeSec - windowStart;
+    if (dt >= RUN_ETA_WINDOW_SEC && windowPlanned > 0) {
+        float duty = (s.volumeMl - windowVolume) / windowPlanned;
+        if (duty > 1.0f) duty = 1.0f;
+        if (!rateValid) {
+            dutyMean = duty;
+            dutyVar = 0;
+            rateValid = true;
+        } else {
+            float diff = duty - dutyMean;
+            dutyMean += RUN_ETA_RATE_ALPHA * diff;
+            dutyVar = (1.0f - RUN_ETA_RATE_ALPHA) * (dutyVar + RUN_ETA_RATE_ALPHA * diff * diff);
+        }
+        windowStart = s.timeSec;
+        windowVolume = s.volumeMl;
+        windowPlanned = 0;
+
+        cubeAbv = windowAbvCount > 0 ? windowAbvSum / windowAbvCount : 0;
+        windowAbvSum = 0;
+        windowAbvCount = 0;
+    }
+}
+
+/**
+ * Спирт в кубе: баланс, сведённый с крепостью в кубе за окно
+ * @param sigmaMl Погрешность (мл)
+ */
+float EtaEstimator::cubeEthanol(float cubeVolumeMl, float& sigmaMl) const {
+    float balance = chargeMl * chargeAbv / 100.0f - collectedEthanol;
+    float balanceVar = chargeMl * RUN_ETA_ABV_SIGMA / 100.0f;
+    balanceVar *= balanceVar;
+
+    if (phase != RectPhase::BODY || cubeAbv <= 0) {
+        sigmaMl = sqrtf(balanceVar);
+        return balance;
+    }
+
+    float measured = cubeVolumeMl * cubeAbv / 100.0f;
+    float measuredVar = cubeVolumeMl * RUN_ETA_ABV_SIGMA / 100.0f;
+    measuredVar *= measuredVar;
+
+    sigmaMl = sqrtf(balanceVar * measuredVar / (balanceVar + measuredVar));
+    return (balance * measuredVar + measured * balanceVar) / (balanceVar + measuredVar);
+}
+
+/**
+ * Время до хвостов (ч) при спирте в кубе ethanolMl и скорости rateMlH
+ */
+float EtaEstimator::bodyHours(float ethanolMl, float rateMlH, float decay, float cubeVolumeMl) const {
+    float maxHours = RUN_ETA_MAX_SEC / 3600.0f;
+    if (rateMlH <= 0) return maxHours;
+
+    // Остаток тела до крепости хвостов в кубе
+    float hours = maxHours;
+    if (distAbv > tailsAbv) {
+        float bodyLeft = (ethanolMl - cubeVolumeMl * tailsAbv / 100.0f) * 100.0f /
+                         (distAbv - tailsAbv);
+        if (bodyLeft <= 0) {
+            hours = 0;
+        } else if (decay <= 0) {
+            hours = bodyLeft / rateMlH;
+        } else if (bodyLeft * decay < rateMlH) {
+            hours = -logf(1.0f - bodyLeft * decay / rateMlH) / decay;
+        }
+    }
+
+    // Скорость насоса дойдёт до минимума Smart Decrement раньше
+    if (decay > 0 && lastSpeed > minSpeedMlH && minSpeedMlH > 0) {
+        float floorHours = logf(lastSpeed / minSpeedMlH) / decay;
+        if (floorHours < hours) hours = floorHours;
+    }
+
+    return hours < maxHours ? hours : maxHours;
+}
+
+bool EtaEstimator::estimate(RunStats& stats) const {
+    float cubeVolume = chargeMl - (lastVolume > 0 ? lastVolume : 0);
+    float charge = chargeMl * chargeAbv / 100.0f;
+
+    stats.chargeEthanolMl = charge;
+    stats.collectedEthanolMl = collectedEthanol;
+    stats.etaValid = false;
+
+    if (!chargeFrozen || chargeMl <= 0 || cubeVolume <= 0 ||
+        (phase != RectPhase::PURGE && phase != RectPhase::BODY &&
+         phase != RectPhase::TAILS && phase != RectPhase::FINISH)) {
+        return false;
+    }
+
+    uint32_t elapsed = now - phaseStart;
+    float tailsEta = 0, tailsLow = 0, tailsHigh = 0;
+
+    if (phase == RectPhase::PURGE || phase == RectPhase::BODY) {
+        // Скорость: текущая скорость насоса × доля работы либо план до первого окна
+        float rate = rateValid ? dutyMean * lastSpeed : bodySpeedMlH;
+        float sigma = rateValid ? sqrtf(dutyVar) * lastSpeed : bodySpeedMlH * RATE_PRIOR_SIGMA;
+        float slow = rate - sigma;
+        if (slow < rate * RATE_FLOOR) slow = rate * RATE_FLOOR;
+
+        // Спад скорости по снижениям Smart Decrement
+        float decay = 0;
+        float bodyHoursDone = phase == RectPhase::BODY ? elapsed / 3600.0f : 0;
+        if (bodyHoursDone > 0 && lastSpeed < bodyStartSpeed && lastSpeed > 0) {
+            decay = logf(bodyStartSpeed / lastSpeed) / bodyHoursDone;
+        }
+
+        float delta;
+        float ethanol = cubeEthanol(cubeVolume, delta);
+        tailsEta = bodyHours(ethanol, rate, decay, cubeVolume) * 3600.0f;
+        tailsLow = bodyHours(ethanol - delta, rate + sigma, decay, cubeVolume) * 3600.0f;
+        tailsHigh = bodyHours(ethanol + delta, slow, decay, cubeVolume) * 3600.0f;
+
+        if (phase == RectPhase::PURGE) {
+            uint32_t purgeLeft = elapsed < purgeSec ? purgeSec - elapsed : 0;
+            tailsEta += purgeLeft;
+            tailsLow += purgeLeft;
+            tailsHigh += purgeLeft;
+        }
+    }
+
+    // Хвосты: объём из плана либо спирт в кубе на конце тела
+    float finishAdd = FINISH_COOL_SEC;
+    if (phase != RectPhase::FINISH) {
+        float tailsMl = tailsVolumeMl > 0
+            ? tailsVolumeMl
+            : cubeVolume * tailsAbv / RUN_ETA_TAILS_DIST_ABV;
+        if (phase == RectPhase::TAILS) {
+            tailsMl -= lastVolume - tailsStartVolume;
+            if (tailsMl < 0) tailsMl = 0;
+        }
+        if (tailsSpeedMlH > 0) {
+            finishAdd += tailsMl / tailsSpeedMlH * 3600.0f;
+        }
+    } else {
+        finishAdd = elapsed < FINISH_COOL_SEC ? FINISH_COOL_SEC - elapsed : 0;
+    }
+
+    float maxSec = RUN_ETA_MAX_SEC;
+    stats.tailsEtaSec = (uint32_t)tailsEta;
+    stats.tailsEtaLowSec = (uint32_t)tailsLow;
+    stats.tailsEtaHighSec = (uint32_t)(tailsHigh < maxSec ? tailsHigh : maxSec);
+    stats.finishEtaSec = (uint32_t)(tailsEta + finishAdd);
+    stats.finishEtaLowSec = (uint32_t)(tailsLow + finishAdd);
+    stats.finishEtaHighSec = (uint32_t)(stats.tailsEtaHighSec + finishAdd);
+    stats.etaValid = true;
+    return true;
+}
+
+namespace RunEta {
+
+static EtaEstimator estimator;
+static uint32_t lastUpdate = 0;
+
+// =============================================================================
+// API
+// =============================================================================
+
+void start(SystemState& state, const RunPlan& plan) {
+    estimator.reset(plan);
+    lastUpdate = 0;
+    state.stats.chargeEthanolMl = 0;
+    state.stats.collectedEthanolMl = 0;
+    state.stats.etaValid = false;
+}
+
+void update(SystemState& state) {
+    uint32_t now = Hal::millis();
+    if (lastUpdate != 0 && now - lastUpdate < RUN_ETA_INTERVAL_MS) {
+        return;
+    }
+    lastUpdate = now;
+
+    EtaSample sample;
+    sample.timeSec = now / 1000;
+    sample.phase = state.rectPhase;
+    sample.volumeMl = Pump::getTotalVolume();
+    sample.speedMlH = Pump::isRunning() ? Pump::getSpeed() : 0;
+    sample.cubeAbv = state.vle.cubeValid ? state.vle.cubeAbv : 0;
+    sample.distillateAbv = state.vle.distillateValid ? state.vle.distillateAbv : 0;
+    estimator.add(sample);
+
+    bool wasValid = state.stats.etaValid;
+    estimator.estimate(state.stats);
+    if (state.stats.etaValid && !wasValid) {
+        LOG_I("RunEta: Charge %.0f ml ethanol, tails in %lu min (%lu-%lu)",
+              state.stats.chargeEthanolMl, (unsigned long)(state.stats.tailsEtaSec / 60),
+              (unsigned long)(state.stats.tailsEtaLowSec / 60),
+              (unsigned long)(state.stats.tailsEtaHighSec / 60));
+    }
+}
+
+bool validate(const ProcessHistory& history, const RunPlan& plan, EtaValidation& result,
+              float tailsAbv) {
+    memset(&result, 0, sizeof(result));
+    result.tailsAbv = tailsAbv;
+
+    // Факт: первая точка хвостов
+    uint32_t tailsTime = 0;
+    for (const TimeseriesPoint& p : history.timeseries) {
+        if (p.phase >= static_cast<uint8_t>(RectPhase::TAILS) &&
+            p.phase <= static_cast<uint8_t>(RectPhase::FINISH)) {
+            tailsTime = p.time;
+            break;
+        }
+    }
+    if (tailsTime == 0) {
+        return false;
+    }
+
+    EtaEstimator replay;
+    replay.reset(plan, tailsAbv);
+    RunStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    float errorSum = 0, biasSum = 0;
+    uint16_t inside = 0;
+
+    for (const TimeseriesPoint& p : history.timeseries) {
+        EtaSample sample;
+        sample.timeSec = p.time;
+        sample.phase = static_cast<RectPhase>(p.phase);
+        sample.volumeMl = p.volume;
+        sample.speedMlH = p.pumpSpeed;
+        sample.cubeAbv = p.cubeAbv;
+        sample.distillateAbv = p.distillateAbv;
+        replay.add(sample);
+
+        if (p.time >= tailsTime) {
+            break;
+        }
+        // Последняя крепость в кубе до хвостов - конец тела этой колонны
+        if (p.cubeAbv > 0) {
+            result.tailsCubeAbv = p.cubeAbv;
+        }
+        if (sample.phase != RectPhase::BODY || !replay.estimate(stats)) {
+            continue;
+        }
+
+        float actual = (float)(tailsTime - p.time);
+        float error = (float)stats.tailsEtaSec - actual;
+        errorSum += fabsf(error);
+        biasSum += error;
+        if (actual >= stats.tailsEtaLowSec && actual <= stats.tailsEtaHighSec) {
+            inside++;
+        }
+        result.samples++;
+    }
+
+    if (result.samples == 0) {
+        return false;
+    }
+    result.tailsErrorMin = errorSum / result.samples / 60.0f;
+    result.tailsBiasMin = biasSum / result.samples / 60.0f;
+    result.coverage = (float)inside / result.samples;
+    return true;
+}
+
+uint16_t validateStored(const RunPlan& plan, EtaValidation& result, float tailsAbv) {
+    memset(&result, 0, sizeof(result));
+    result.tailsAbv = tailsAbv;
+
+    float errorSum = 0, biasSum = 0, insideSum = 0, cubeAbvSum = 0;
+    uint32_t samples = 0;
+    uint16_t runs = 0;
+
+    for (const ProcessListItem& item : getProcessList()) {
+        if (item.type != "rectification") continue;
+
+        ProcessHistory history;
+        EtaValidation run;
+        if (!loadProcessHistory(item.id, history) || !validate(history, plan, run, tailsAbv)) {
+            continue;
+        }
+
+        errorSum += run.tailsErrorMin * run.samples;
+        biasSum += run.tailsBiasMin * run.samples;
+        insideSum += run.coverage * run.samples;
+        cubeAbvSum += run.tailsCubeAbv;
+        samples += run.samples;
+        runs++;
+        LOG_I("RunEta: Run %s - tails error %.0f min (bias %+.0f), cube %.1f%% at tails",
+              item.id.c_str(), run.tailsErrorMin, run.tailsBiasMin, run.tailsCubeAbv);
+    }
+
+    if (runs == 0) {
+        return 0;
+    }
+    result.samples = samples < 0xFFFF ? samples : 0xFFFF;
+    result.tailsErrorMin = errorSum / samples;
+    result.tailsBiasMin = biasSum / samples;
+    result.coverage = insideSum / samples;
+    result.tailsCubeAbv = cubeAbvSum / runs;
+    return runs;
+}
+
+} // namespace RunEta
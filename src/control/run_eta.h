@@ -0,0 +1,149 @@
+/**
+ * Smart-Column S3 - Run ETA
+ *
+ * Прогноз конца тела (перехода в хвосты) и конца погона по балансу
+ * абсолютного спирта: АС загрузки (объём куба × крепость по T кипения
+ * куба до отбора) минус отобранное (объём × крепость отбора по VLE),
+ * уточняемому крепостью в кубе по ходу тела.
+ * Скорость - текущая скорость насоса × доля работы (остановки Smart
+ * Decrement), её спад - по истории снижений. Интервал - по разбросу скорости и погрешности
+ * крепости загрузки.
+ */
+
+#ifndef RUN_ETA_H
+#define RUN_ETA_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "run_plan.h"
+
+struct ProcessHistory;
+
+/**
+ * Отсчёт для оценки (живой процесс или точка истории)
+ */
+struct EtaSample {
+    uint32_t timeSec;
+    RectPhase phase;
+    float volumeMl;                 // Отбор насосом с начала процесса
+    float speedMlH;                 // Скорость насоса (0 - стоит)
+    float cubeAbv;                  // % об., 0 - нет оценки
+    float distillateAbv;            // % об., 0 - нет оценки
+};
+
+/**
+ * Проверка прогноза на записанном погоне
+ */
+struct EtaValidation {
+    uint16_t samples;               // Прогнозов в теле
+    float tailsErrorMin;            // Средняя |ошибка| прогноза хвостов, мин
+    float tailsBiasMin;             // Средняя ошибка со знаком (+ прогноз позже), мин
+    float coverage;                 // Доля прогнозов, где факт внутри интервала
+    float tailsCubeAbv;             // Крепость в кубе по T кипения на входе в хвосты, % об.
+    float tailsAbv;                 // Конец тела в прогнозе, % об. в кубе
+};
+
+/**
+ * Оценщик (экземпляр на процесс - живой и при проверке по истории)
+ */
+class EtaEstimator {
+public:
+    EtaEstimator();
+
+    /**
+     * Начало процесса
+     * @param plan План (объём куба, скорости, продувка, хвосты)
+     * @param tailsAbv Крепость в кубе на конце тела, % об.
+     */
+    void reset(const RunPlan& plan, float tailsAbv = RUN_ETA_TAILS_ABV);
+
+    /**
+     * Очередной отсчёт (время не убывает)
+     */
+    void add(const EtaSample& sample);
+
+    /**
+     * Прогноз в поля RunStats (chargeEthanolMl ... finishEtaHighSec)
+     * @return true если прогноз есть (продувка, тело, хвосты)
+     */
+    bool estimate(RunStats& stats) const;
+
+private:
+    float chargeMl;
+    float bodySpeedMlH;
+    float tailsSpeedMlH;
+    float tailsVolumeMl;
+    float minSpeedMlH;              // Скорость, на которой Smart Decrement уходит в хвосты
+    uint32_t purgeSec;
+    float tailsAbv;
+
+    float chargeAbv;                // 0 - не оценена
+    bool chargeFrozen;              // Отбор начат - крепость загрузки не меняется
+    float collectedEthanol;
+    float lastVolume;
+    float distAbv;
+
+    RectPhase phase;
+    uint32_t now;
+    uint32_t phaseStart;
+    float tailsStartVolume;
+
+    // Скорость тела
+    uint32_t bodyStart;
+    float bodyStartSpeed;
+    float lastSpeed;
+    uint32_t windowStart;
+    float windowVolume;
+    float windowPlanned;            // Отбор за окно без остановок (по скорости насоса)
+    float windowAbvSum;             // Крепость в кубе за окно
+    uint16_t windowAbvCount;
+    float cubeAbv;                  // Средняя за последнее окно, 0 - нет
+    float dutyMean;                 // Доля времени работы насоса
+    float dutyVar;
+    bool rateValid;
+
+    float bodyHours(float ethanolMl, float rateMlH, float decay, float cubeVolumeMl) const;
+    float cubeEthanol(float cubeVolumeMl, float& sigmaMl) const;
+};
+
+namespace RunEta {
+    /**
+     * Начало ректификации (из FSM::startMode)
+     */
+    void start(SystemState& state, const RunPlan& plan);
+
+    /**
+     * Обновление (вызывать в loop в режиме RECTIFICATION), прогноз - в state.stats
+     */
+    void update(SystemState& state);
+
+    /**
+     * Проверка прогноза на записанном погоне: точки временного ряда
+     * проходят через оценщик, прогноз хвостов сравнивается с фактом
+     * @param history История (timeseries с phase и volume)
+     * @param plan План, с которым шёл погон
+     * @param result Итог
+     * @param tailsAbv Крепость в кубе на конце тела - по умолчанию как
+     *        в прошивке, либо tailsCubeAbv прошлых погонов этой колонны
+     * @return false если в истории нет тела и хвостов
+     */
+    bool validate(const ProcessHistory& history, const RunPlan& plan, EtaValidation& result,
+                  float tailsAbv = RUN_ETA_TAILS_ABV);
+
+    /**
+     * Проверка прогноза на сохранённых погонах /history: каждая
+     * ректификация с телом и хвостами через validate(), итог - средние,
+     * взвешенные числом прогнозов; tailsCubeAbv - среднее по погонам.
+     * План в файле истории не хранится (только контрольная сумма) -
+     * погоны повторяются с одним планом, объём куба должен совпадать
+     * @param plan План (загрузка куба, скорости)
+     * @param result Итог
+     * @param tailsAbv Крепость в кубе на конце тела
+     * @return Проверено погонов
+     */
+    uint16_t validateStored(const RunPlan& plan, EtaValidation& result,
+                            float tailsAbv = RUN_ETA_TAILS_ABV);
+}
+
+#endif // RUN_ETA_H
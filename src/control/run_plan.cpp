@@ -0,0 +1,237 @@
+/**
+ * Smart-Column S3 - План погона
+ *
+ * Проверка, контрольная сумма и двойной буфер активного плана
+ */
+
+#include "run_plan.h"
+#include "crc32.h"
+
+// Допустимые диапазоны
+#define PLAN_SPEED_MAX_ML_H     5000.0f
+#define PLAN_VOLUME_MAX_ML      100000.0f
+#define PLAN_CHARGE_MAX_L       1000.0f
+#define PLAN_HEADS_PERCENT_MAX  30.0f
+#define PLAN_END_ABV_MAX        50.0f
+#define PLAN_CHARGE_ABV_MAX     96.0f
+#define PLAN_TEMP_MIN           20.0f
+#define PLAN_TEMP_MAX           105.0f
+#define PLAN_PHASE_MAX_MS       (180UL * 60 * 1000)
+#define PLAN_RUNTIME_MAX_MS     (48UL * 3600 * 1000)
+
+// Значения по умолчанию для плана из настроек
+#define PLAN_WATER_ON_TEMP      45.0f   // °C куба
+#define PLAN_HEATING_END_TEMP   78.0f   // °C низа царги
+#define PLAN_DIST_END_TEMP      96.0f   // °C куба
+#define PLAN_DIST_SPEED_ML_H    500.0f
+
+// Двойной буфер: FSM читает slots[activeSlot], stage() пишет в другой
+static RunPlan slots[2];
+static volatile uint8_t activeSlot = 0;
+static volatile bool pending = false;
+static portMUX_TYPE planMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool inRange(float value, float minValue, float maxValue) {
+    return !isnan(value) && value >= minValue && value <= maxValue;
+}
+
+namespace RunPlanner {
+
+void fromSettings(const Settings& settings, Mode mode, RunPlan& plan) {
+    memset(&plan, 0, sizeof(plan));
+
+    plan.version = RUN_PLAN_VERSION;
+    plan.mode = mode;
+    plan.source = RunPlanSource::SETTINGS;
+
+    plan.heaterPowerW = settings.equipment.heaterPowerW ? settings.equipment.heaterPowerW
+                                                        : DEFAULT_HEATER_POWER_W;
+    plan.heaterMaxPercent = 100;
+    plan.waterOnTemp = PLAN_WATER_ON_TEMP;
+    plan.heatingEndTemp = PLAN_HEATING_END_TEMP;
+
+    float kw = plan.heaterPowerW / 1000.0f;
+    plan.stabilizationMs = settings.rectParams.stabilizationMin * 60000UL;
+    plan.purgeMs = settings.rectParams.purgeMin * 60000UL;
+    plan.headsSpeedMlH = settings.rectParams.headsSpeedMlHKw * kw;
+    plan.bodySpeedMlH = settings.rectParams.bodySpeedMlHKw * kw;
+    plan.tailsSpeedMlH = plan.bodySpeedMlH;
+    plan.chargeVolumeL = settings.equipment.cubeVolumeL;
+    plan.headsPercent = settings.rectParams.headsPercent;
+
+    // Объёмы не заданы - головы по % от АС, остальные фазы по температуре
+    plan.maxCubeTemp = TAILS_TEMP_CUBE_MIN;
+
+    plan.distSpeedMlH = PLAN_DIST_SPEED_ML_H;
+    plan.distEndTemp = PLAN_DIST_END_TEMP;
+
+    plan.pidKp = PID_KP_DEFAULT;
+    plan.pidKi = PID_KI_DEFAULT;
+    plan.pidKd = PID_KD_DEFAULT;
+
+    seal(plan);
+}
+
+RunPlanError validate(const RunPlan& plan) {
+    switch (plan.mode) {
+        case Mode::RECTIFICATION:
+        case Mode::MANUAL_RECT:
+        case Mode::DISTILLATION:
+        case Mode::MASHING:
+        case Mode::HOLD:
+        case Mode::FLOOD_CALIBRATION:
+        case Mode::PID_AUTOTUNE:
+            break;
+        default:
+            return RunPlanError::MODE;
+    }
+
+    if (plan.version != RUN_PLAN_VERSION) return RunPlanError::VERSION;
+
+    if (plan.heaterPowerW == 0 || plan.heaterMaxPercent == 0 || plan.heaterMaxPercent > 100) {
+        return RunPlanError::HEATER;
+    }
+
+    if (plan.mode == Mode::RECTIFICATION) {
+        if (!inRange(plan.headsSpeedMlH, 1.0f, PLAN_SPEED_MAX_ML_H) ||
+            !inRange(plan.bodySpeedMlH, 1.0f, PLAN_SPEED_MAX_ML_H) ||
+            !inRange(plan.tailsSpeedMlH, 0.0f, PLAN_SPEED_MAX_ML_H)) {
+            return RunPlanError::SPEED;
+        }
+    }
+
+    if (plan.mode == Mode::DISTILLATION &&
+        !inRange(plan.distSpeedMlH, 0.0f, PLAN_SPEED_MAX_ML_H)) {
+        return RunPlanError::SPEED;
+    }
+
+    // Ступени мощности дистилляции: по возрастанию T куба
+    if (plan.distPowerSteps > DIST_POWER_STEPS) {
+        return RunPlanError::HEATER;
+    }
+    for (uint8_t i = 0; i < plan.distPowerSteps; i++) {
+        if (plan.distPowerPercent[i] == 0 || plan.distPowerPercent[i] > 100) {
+            return RunPlanError::HEATER;
+        }
+        if (!inRange(plan.distPowerTemp[i], PLAN_TEMP_MIN, PLAN_TEMP_MAX) ||
+            (i > 0 && plan.distPowerTemp[i] <= plan.distPowerTemp[i - 1])) {
+            return RunPlanError::TEMPERATURE;
+        }
+    }
+    if (!inRange(plan.distEndAbv, 0.0f, PLAN_END_ABV_MAX)) {
+        return RunPlanError::TEMPERATURE;
+    }
+
+    if (!inRange(plan.headsVolumeMl, 0.0f, PLAN_VOLUME_MAX_ML) ||
+        !inRange(plan.bodyVolumeMl, 0.0f, PLAN_VOLUME_MAX_ML) ||
+        !inRange(plan.tailsVolumeMl, 0.0f, PLAN_VOLUME_MAX_ML) ||
+        !inRange(plan.distHeadsMl, 0.0f, PLAN_VOLUME_MAX_ML) ||
+        !inRange(plan.distTargetMl, 0.0f, PLAN_VOLUME_MAX_ML) ||
+        !inRange(plan.chargeVolumeL, 0.0f, PLAN_CHARGE_MAX_L) ||
+        !inRange(plan.chargeAbv, 0.0f, PLAN_CHARGE_ABV_MAX) ||
+        !inRange(plan.headsPercent, 0.0f, PLAN_HEADS_PERCENT_MAX)) {
+        return RunPlanError::VOLUME;
+    }
+
+    if (!inRange(plan.waterOnTemp, PLAN_TEMP_MIN, PLAN_TEMP_MAX) ||
+        !inRange(plan.heatingEndTemp, PLAN_TEMP_MIN, PLAN_TEMP_MAX) ||
+        !inRange(plan.maxCubeTemp, PLAN_TEMP_MIN, PLAN_TEMP_MAX)) {
+        return RunPlanError::TEMPERATURE;
+    }
+
+    // Необязательные пороги: 0 = не используется
+    const float optional[] = { plan.headsEndTemp, plan.bodyStartTemp, plan.bodyEndTemp,
+                               plan.maxColumnTemp, plan.distEndTemp };
+    for (float t : optional) {
+        if (t != 0.0f && !inRange(t, PLAN_TEMP_MIN, PLAN_TEMP_MAX)) {
+            return RunPlanError::TEMPERATURE;
+        }
+    }
+    if (plan.bodyStartTemp > 0.0f && plan.bodyEndTemp > 0.0f &&
+        plan.bodyStartTemp >= plan.bodyEndTemp) {
+        return RunPlanError::TEMPERATURE;
+    }
+
+    if (plan.stabilizationMs > PLAN_PHASE_MAX_MS || plan.purgeMs > PLAN_PHASE_MAX_MS) {
+        return RunPlanError::TIMING;
+    }
+
+    if (plan.maxRuntimeMs > PLAN_RUNTIME_MAX_MS ||
+        !inRange(plan.waterFlowMinLMin, 0.0f, 50.0f) ||
+        !inRange(plan.pressureMaxMmHg, 0.0f, 1000.0f)) {
+        return RunPlanError::SAFETY;
+    }
+
+    return RunPlanError::OK;
+}
+
+const char* errorString(RunPlanError error) {
+    switch (error) {
+        case RunPlanError::OK:          return "ok";
+        case RunPlanError::MODE:        return "unsupported mode";
+        case RunPlanError::HEATER:      return "invalid heater power";
+        case RunPlanError::SPEED:       return "speed out of range";
+        case RunPlanError::VOLUME:      return "volume out of range";
+        case RunPlanError::TEMPERATURE: return "invalid temperature thresholds";
+        case RunPlanError::TIMING:      return "phase duration out of range";
+        case RunPlanError::SAFETY:      return "invalid safety limits";
+        case RunPlanError::VERSION:     return "plan version mismatch";
+        case RunPlanError::CHECKSUM:    return "checksum mismatch";
+        default:                        return "unknown";
+    }
+}
+
+void seal(RunPlan& plan) {
+    plan.checksum = crc32(&plan, offsetof(RunPlan, checksum));
+}
+
+RunPlanError stage(const RunPlan& plan) {
+    RunPlanError error = validate(plan);
+    if (error != RunPlanError::OK) {
+        LOG_E("RunPlan: Rejected (%s)", errorString(error));
+        return error;
+    }
+
+    if (plan.checksum != crc32(&plan, offsetof(RunPlan, checksum))) {
+        LOG_E("RunPlan: Rejected (%s)", errorString(RunPlanError::CHECKSUM));
+        return RunPlanError::CHECKSUM;
+    }
+
+    portENTER_CRITICAL(&planMux);
+    slots[activeSlot ^ 1] = plan;
+    pending = true;
+    portEXIT_CRITICAL(&planMux);
+
+    LOG_I("RunPlan: Staged %s (crc=%08lX)",
+          plan.profileId[0] ? plan.profileId : "settings", (unsigned long)plan.checksum);
+    return RunPlanError::OK;
+}
+
+bool swapIfPending() {
+    bool swapped = false;
+
+    portENTER_CRITICAL(&planMux);
+    if (pending) {
+        activeSlot ^= 1;
+        pending = false;
+        swapped = true;
+    }
+    portEXIT_CRITICAL(&planMux);
+
+    if (swapped) {
+        LOG_I("RunPlan: Active %s (crc=%08lX)",
+              slots[activeSlot].profileId[0] ? slots[activeSlot].profileId : "settings",
+              (unsigned long)slots[activeSlot].checksum);
+    }
+    return swapped;
+}
+
+bool hasPending() {
+    return pending;
+}
+
+const RunPlan& active() {
+    return slots[activeSlot];
+}
+
+} // namespace RunPlanner
@@ -0,0 +1,156 @@
+/**
+ * Smart-Column S3 - Run Plan
+ *
+ * План погона: плоская проверенная структура фиксированного размера
+ * с параметрами фаз в единицах, которые использует FSM (мл/ч, °C, мс).
+ * Профиль или настройки компилируются в план один раз при применении,
+ * FSM читает план без String и JSON.
+ */
+
+#ifndef RUN_PLAN_H
+#define RUN_PLAN_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+#define RUN_PLAN_VERSION        1
+#define RUN_PLAN_ID_LEN         24
+
+/**
+ * Источник плана
+ */
+enum class RunPlanSource : uint8_t {
+    SETTINGS = 0,       // Settings::rectParams
+    BUILTIN,            // Встроенный рецепт
+    PROFILE             // Пользовательский профиль
+};
+
+/**
+ * Результат проверки плана
+ */
+enum class RunPlanError : uint8_t {
+    OK = 0,
+    MODE,               // Режим не поддерживается
+    HEATER,             // Мощность ТЭНа
+    SPEED,              // Скорость отбора вне диапазона
+    VOLUME,             // Объёмы фракций
+    TEMPERATURE,        // Пороги температур / их порядок
+    TIMING,             // Длительности фаз
+    SAFETY,             // Пределы безопасности
+    VERSION,            // План другой версии структуры
+    CHECKSUM            // Контрольная сумма не совпадает
+};
+
+/**
+ * План погона
+ */
+struct RunPlan {
+    uint16_t version;                   // RUN_PLAN_VERSION
+    Mode mode;
+    RunPlanSource source;
+    char profileId[RUN_PLAN_ID_LEN];    // Пусто для SETTINGS
+
+    // Нагрев
+    uint16_t heaterPowerW;              // Номинальная мощность для пересчёта скоростей
+    uint8_t heaterMaxPercent;           // Ограничение мощности ТЭНа (%)
+    uint8_t reserved;
+    float waterOnTemp;                  // °C куба - включение охлаждения
+    float heatingEndTemp;               // °C низа царги - конец разгона
+
+    // Фазы ректификации
+    uint32_t stabilizationMs;
+    uint32_t purgeMs;
+    float headsSpeedMlH;                // мл/ч (уже умножено на кВт)
+    float bodySpeedMlH;
+    float tailsSpeedMlH;
+    float headsVolumeMl;                // 0 - по headsPercent от АС загрузки
+    float bodyVolumeMl;
+    float tailsVolumeMl;
+    float chargeVolumeL;                // Загрузка куба (л)
+    float chargeAbv;                    // Крепость загрузки (% об., 0 - неизвестна)
+    float headsPercent;                 // % голов от АС загрузки
+
+    // Пороги
+    float headsEndTemp;                 // °C верха царги
+    float bodyStartTemp;
+    float bodyEndTemp;
+    float maxCubeTemp;                  // °C куба - конец отбора
+    float maxColumnTemp;
+
+    // Дистилляция
+    float distHeadsMl;
+    float distTargetMl;
+    float distSpeedMlH;
+    float distEndTemp;
+    float distEndAbv;                   // % об. в кубе (0 - не задано)
+    float distPowerTemp[DIST_POWER_STEPS];      // °C куба - начало ступени
+    uint8_t distPowerPercent[DIST_POWER_STEPS]; // Мощность ступени, %
+    uint8_t distPowerSteps;             // 0 - всю дистилляцию heaterMaxPercent
+
+    // Регулятор
+    float pidKp;
+    float pidKi;
+    float pidKd;
+
+    // Безопасность
+    uint32_t maxRuntimeMs;              // 0 = без ограничения
+    float waterFlowMinLMin;
+    float pressureMaxMmHg;
+
+    uint32_t checksum;                  // CRC32 всех полей выше
+};
+
+namespace RunPlanner {
+    /**
+     * План из текущих настроек (когда профиль не применён)
+     * @param settings Настройки
+     * @param mode Режим
+     * @param plan Результат
+     */
+    void fromSettings(const Settings& settings, Mode mode, RunPlan& plan);
+
+    /**
+     * Проверка плана
+     * @param plan План
+     * @return RunPlanError::OK если план исполним
+     */
+    RunPlanError validate(const RunPlan& plan);
+
+    /**
+     * Текст ошибки проверки
+     */
+    const char* errorString(RunPlanError error);
+
+    /**
+     * Расчёт и запись контрольной суммы
+     * @param plan План
+     */
+    void seal(RunPlan& plan);
+
+    /**
+     * Подготовка плана: проверка и запись в неактивный слот.
+     * Вступает в силу на ближайшей границе фаз (swapIfPending).
+     * @param plan План (с контрольной суммой)
+     * @return RunPlanError::OK если принят
+     */
+    RunPlanError stage(const RunPlan& plan);
+
+    /**
+     * Переключение на подготовленный план (вызывается FSM на границе фаз)
+     * @return true если план сменился
+     */
+    bool swapIfPending();
+
+    /**
+     * Есть ли подготовленный, но не активный план
+     */
+    bool hasPending();
+
+    /**
+     * Активный план (читает FSM)
+     */
+    const RunPlan& active();
+}
+
+#endif // RUN_PLAN_H
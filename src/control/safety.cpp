@@ -5,13 +5,43 @@
  */
 
 #include "safety.h"
+#include "../hal/hal.h"
+#include "temp_filter.h"
 #include "../drivers/heater.h"
 #include "../drivers/pump.h"
 #include "../drivers/valves.h"
 #include "../interface/mqtt.h"
 
+// Снятие предупреждения о прорыве: прогноз ниже порога на столько
+#define TSA_WARN_HYSTERESIS     2.0f    // °C
+
 namespace Safety {
 
+static bool tsaWarned = false;
+
+/**
+ * Раннее предупреждение о прорыве паров: T_TSA ещё в норме, но растёт
+ * и по тренду фильтра выйдет за SAFETY_TEMP_TSA_MAX. Авария остаётся
+ * за сырым значением - фильтр не должен задерживать отключение.
+ */
+static void checkTsaTrend(const SystemState& state) {
+    const TempEstimate& est = state.temps.filtered[TEMP_TSA];
+    float forecast = TempFilter::forecast(state.temps, TEMP_TSA, SAFETY_TSA_FORECAST_SEC);
+
+    if (!tsaWarned && TempFilter::isRising(est) && forecast > SAFETY_TEMP_TSA_MAX) {
+        tsaWarned = true;
+        LOG_WARN("SAFETY: T_TSA rising %.2f°C/min, %.1f°C in %ds",
+                 est.slope, forecast, SAFETY_TSA_FORECAST_SEC);
+
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Рост температуры TSA: %.1f°C, %+.2f°C/мин. Возможен прорыв паров",
+                 est.value, est.slope);
+        MQTT::publishNotification("ПРЕДУПРЕЖДЕНИЕ", msg, "warning");
+    } else if (tsaWarned && forecast < SAFETY_TEMP_TSA_MAX - TSA_WARN_HYSTERESIS) {
+        tsaWarned = false;
+    }
+}
+
 void check(SystemState& state, const Settings& settings) {
     bool emergencyStop = false;
     AlarmType alarmType = AlarmType::NONE;
@@ -28,6 +58,8 @@ void check(SystemState& state, const Settings& settings) {
         char msg[128];
         snprintf(msg, sizeof(msg), "Прорыв паров! Температура TSA: %.1f°C", state.temps.tsa);
         MQTT::publishNotification("КРИТИЧЕСКАЯ ОШИБКА", msg, "error");
+    } else if (state.temps.valid[TEMP_TSA]) {
+        checkTsaTrend(state);
     }
 
     // Проверка перегрева воды (T_water_out > 70°C)
@@ -57,7 +89,7 @@ void check(SystemState& state, const Settings& settings) {
     }
 
     // Проверка сбоя датчиков
-    uint32_t now = millis();
+    uint32_t now = Hal::millis();
     if (now - state.temps.lastUpdate > SAFETY_SENSOR_TIMEOUT_MS) {
         LOG_E("SAFETY: Temperature sensor timeout!");
         emergencyStop = true;
@@ -0,0 +1,39 @@
+/**
+ * Smart-Column S3 - Снимок состояния
+ *
+ * Seqlock поверх SystemState: публикация - одно копирование структуры
+ * без блокировок, читатель повторяет копию, если попал на запись.
+ */
+
+#include "state_snapshot.h"
+#include "seqlock.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define SNAPSHOT_SPIN_RETRIES   8   // Попыток до уступки процессора
+
+static Seqlock<SystemState> snapshot;
+
+namespace StateSnapshot {
+
+void publish(const SystemState& state) {
+    snapshot.write(state);
+}
+
+void read(SystemState& out) {
+    uint8_t spins = 0;
+    while (!snapshot.tryRead(out)) {
+        // Писатель может быть вытеснен читателем на том же ядре -
+        // отдать ему тик, чтобы он закончил запись
+        if (++spins >= SNAPSHOT_SPIN_RETRIES) {
+            spins = 0;
+            vTaskDelay(1);
+        }
+    }
+}
+
+uint32_t getVersion() {
+    return snapshot.version();
+}
+
+} // namespace StateSnapshot
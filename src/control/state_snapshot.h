@@ -0,0 +1,37 @@
+/**
+ * Smart-Column S3 - State Snapshot
+ *
+ * Согласованная копия SystemState для задач, отличных от loop()
+ * (обработчики веб-сервера). loop() публикует снимок в конце каждого
+ * прохода, читатели получают состояние одного прохода целиком:
+ * температуры и мощность не перемешиваются между тиками.
+ */
+
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "types.h"
+
+namespace StateSnapshot {
+    /**
+     * Публикация снимка (только задача loop, не блокируется)
+     * @param state Текущее состояние
+     */
+    void publish(const SystemState& state);
+
+    /**
+     * Чтение последнего снимка.
+     * При пересечении с публикацией повторяет копирование,
+     * после нескольких попыток уступает процессор писателю.
+     * @param out Копия состояния
+     */
+    void read(SystemState& out);
+
+    /**
+     * Количество опубликованных снимков (0 - ещё ни одного)
+     */
+    uint32_t getVersion();
+}
+
+#endif // STATE_SNAPSHOT_H
@@ -0,0 +1,172 @@
+/**
+ * Smart-Column S3 - Фильтр температур
+ *
+ * Калман с моделью постоянной скорости, состояние [T (°C), dT/dt (°C/с)]:
+ *   F = [[1, dt], [0, 1]]
+ *   Q = σa²·[[dt³/3, dt²/2], [dt²/2, dt]]  (σa - TEMP_KF_ACCEL_STD)
+ *   R = σm²                                (σm - TEMP_KF_MEAS_STD)
+ * Наружу скорость и её СКО отдаются в °C/мин.
+ */
+
+#include "temp_filter.h"
+#include "../hal/hal.h"
+#include <math.h>
+
+// Начальная неопределённость скорости - 1 °C/мин
+#define SLOPE_INIT_STD      (1.0f / 60.0f)
+
+// Минимум показаний до готовности оценки
+#define MIN_SAMPLES         3
+
+namespace TempFilter {
+
+// =============================================================================
+// ПЕРЕМЕННЫЕ
+// =============================================================================
+
+struct Channel {
+    float temp;             // °C
+    float rate;             // °C/с
+    float p00, p01, p11;    // Ковариация
+    uint32_t lastStepMs;    // Время последнего шага
+    uint32_t lastMeasMs;    // Время последнего принятого показания
+    uint16_t samples;
+    uint8_t outliers;       // Выбросов подряд
+    bool initialized;
+};
+
+static Channel channels[TEMP_COUNT];
+static uint32_t lastUpdate = 0;
+
+// =============================================================================
+// ВСПОМОГАТЕЛЬНЫЕ
+// =============================================================================
+
+static float rawValue(const Temperatures& temps, uint8_t index) {
+    switch (index) {
+        case TEMP_CUBE:          return temps.cube;
+        case TEMP_COLUMN_BOTTOM: return temps.columnBottom;
+        case TEMP_COLUMN_TOP:    return temps.columnTop;
+        case TEMP_REFLUX:        return temps.reflux;
+        case TEMP_TSA:           return temps.tsa;
+        case TEMP_WATER_IN:      return temps.waterIn;
+        case TEMP_WATER_OUT:     return temps.waterOut;
+        default:                 return 0;
+    }
+}
+
+static void start(Channel& ch, float measured, uint32_t now) {
+    ch.temp = measured;
+    ch.rate = 0;
+    ch.p00 = TEMP_KF_MEAS_STD * TEMP_KF_MEAS_STD;
+    ch.p01 = 0;
+    ch.p11 = SLOPE_INIT_STD * SLOPE_INIT_STD;
+    ch.lastStepMs = now;
+    ch.lastMeasMs = now;
+    ch.samples = 1;
+    ch.outliers = 0;
+    ch.initialized = true;
+}
+
+static void predict(Channel& ch, float dt) {
+    const float q = TEMP_KF_ACCEL_STD * TEMP_KF_ACCEL_STD;
+
+    ch.temp += ch.rate * dt;
+
+    // P = F·P·Fᵀ + Q
+    ch.p00 += dt * (2.0f * ch.p01 + dt * ch.p11) + q * dt * dt * dt / 3.0f;
+    ch.p01 += dt * ch.p11 + q * dt * dt / 2.0f;
+    ch.p11 += q * dt;
+}
+
+static void correct(Channel& ch, float innovation) {
+    float s = ch.p00 + TEMP_KF_MEAS_STD * TEMP_KF_MEAS_STD;
+    float k0 = ch.p00 / s;
+    float k1 = ch.p01 / s;
+
+    ch.temp += k0 * innovation;
+    ch.rate += k1 * innovation;
+
+    // P = (I - K·H)·P
+    ch.p11 -= k1 * ch.p01;
+    ch.p01 *= (1.0f - k0);
+    ch.p00 *= (1.0f - k0);
+}
+
+static void step(Channel& ch, bool validReading, float measured, uint32_t now) {
+    if (!validReading) return;
+
+    if (!ch.initialized) {
+        start(ch, measured, now);
+        return;
+    }
+
+    float dt = (now - ch.lastStepMs) / 1000.0f;
+    ch.lastStepMs = now;
+    if (dt > 0) predict(ch, dt);
+
+    float innovation = measured - ch.temp;
+    if (fabsf(innovation) > TEMP_KF_OUTLIER_DELTA) {
+        // Одиночный сбой шины - пропускаем, серия подряд - реальный скачок
+        if (++ch.outliers >= TEMP_KF_OUTLIER_COUNT) {
+            start(ch, measured, now);
+        }
+        return;
+    }
+
+    correct(ch, innovation);
+    ch.lastMeasMs = now;
+    ch.outliers = 0;
+    if (ch.samples < 0xFFFF) ch.samples++;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+void reset() {
+    memset(channels, 0, sizeof(channels));
+    lastUpdate = 0;
+}
+
+void update(Temperatures& temps) {
+    if (temps.lastUpdate == lastUpdate) return;
+    lastUpdate = temps.lastUpdate;
+
+    uint32_t now = Hal::millis();
+
+    for (uint8_t i = 0; i < TEMP_COUNT; i++) {
+        Channel& ch = channels[i];
+        step(ch, temps.valid[i], rawValue(temps, i), now);
+
+        // Датчик молчит - оценка устарела, при возврате начнём заново
+        if (ch.initialized && now - ch.lastMeasMs > TEMP_KF_TIMEOUT_MS) {
+            ch.initialized = false;
+        }
+
+        TempEstimate& est = temps.filtered[i];
+        est.value = ch.temp;
+        est.slope = ch.rate * 60.0f;
+        est.sigma = sqrtf(ch.p00);
+        est.slopeSigma = sqrtf(ch.p11) * 60.0f;
+        est.valid = ch.initialized && ch.samples >= MIN_SAMPLES &&
+                    est.sigma < TEMP_KF_SETTLE_SIGMA;
+    }
+}
+
+float value(const Temperatures& temps, uint8_t index) {
+    const TempEstimate& est = temps.filtered[index];
+    return est.valid ? est.value : rawValue(temps, index);
+}
+
+float forecast(const Temperatures& temps, uint8_t index, float horizonSec) {
+    const TempEstimate& est = temps.filtered[index];
+    if (!est.valid) return rawValue(temps, index);
+    return est.value + est.slope * horizonSec / 60.0f;
+}
+
+bool isRising(const TempEstimate& est) {
+    return est.valid && est.slope > 2.0f * est.slopeSigma;
+}
+
+} // namespace TempFilter
@@ -0,0 +1,49 @@
+/**
+ * Smart-Column S3 - Temperature Filter
+ *
+ * Фильтр Калмана на каждый DS18B20: состояние - температура и скорость
+ * её изменения (модель постоянной скорости). Снимает квантование 0.0625 °C
+ * и шум, даёт тренд в °C/мин с оценкой достоверности. Одиночные выбросы
+ * отбрасываются, серия выбросов подряд считается реальным скачком.
+ */
+
+#ifndef TEMP_FILTER_H
+#define TEMP_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+namespace TempFilter {
+    /**
+     * Сброс всех каналов (оценки недействительны до новых показаний)
+     */
+    void reset();
+
+    /**
+     * Обновление по новым показаниям (вызывать после Sensors::readTemperatures).
+     * Шаг выполняется только при смене temps.lastUpdate.
+     * @param temps Показания, результат пишется в temps.filtered
+     */
+    void update(Temperatures& temps);
+
+    /**
+     * Температура для сравнения с порогами
+     * @return Отфильтрованная, если оценка готова, иначе сырая
+     */
+    float value(const Temperatures& temps, uint8_t index);
+
+    /**
+     * Прогноз температуры по тренду
+     * @param horizonSec Горизонт (с)
+     * @return Прогноз или сырая температура, если оценка не готова
+     */
+    float forecast(const Temperatures& temps, uint8_t index, float horizonSec);
+
+    /**
+     * Значимый рост: скорость выше двух СКО её оценки
+     */
+    bool isRising(const TempEstimate& est);
+}
+
+#endif // TEMP_FILTER_H
@@ -0,0 +1,286 @@
+/**
+ * Smart-Column S3 - Равновесие спирт-вода
+ *
+ * Опорные точки - мольные доли и T кипения при 760 мм рт.ст. (те же,
+ * что в модели колонны симулятора). При компиляции из них строятся
+ * таблицы в % об. и наклоны монотонного сплайна; на ESP32 таблицы
+ * лежат во flash. Поправка на давление - смещение T кипения чистых
+ * компонентов по уравнению Антуана, взвешенное по мольной доле спирта
+ * в жидкости.
+ */
+
+#include "vle.h"
+#include "temp_filter.h"
+#include <math.h>
+
+// Мольные объёмы при 20 °C (мл/моль) и избыточный объём смеси
+// (Редлих-Кистер, до -1 мл/моль около x = 0.35)
+#define VM_WATER            18.05
+#define VM_ETHANOL          58.4
+#define VE_A0               (-4.2)
+#define VE_A1               (-0.9)
+
+// Антуан, мм рт.ст. и °C: lg P = A - B / (C + T)
+#define ANTOINE_WATER_A     8.07131f
+#define ANTOINE_WATER_B     1730.63f
+#define ANTOINE_WATER_C     233.426f
+#define ANTOINE_ETHANOL_A   8.20417f
+#define ANTOINE_ETHANOL_B   1642.89f
+#define ANTOINE_ETHANOL_C   230.300f
+
+#define MMHG_PER_HPA        0.750062f
+#define STANDARD_MMHG       760.0f
+#define PRESSURE_EPS_HPA    0.05f   // Смещения пересчитываются при изменении давления
+
+#define VAPOUR_MARGIN       2.0f    // °C: низ царги ближе к T азеотропа - пар в колонне
+#define RANGE_MARGIN        0.5f    // °C: допуск на границы таблицы
+
+namespace Vle {
+
+// =============================================================================
+// ОПОРНЫЕ ТОЧКИ (760 мм рт.ст.)
+// =============================================================================
+
+struct VlePoint {
+    double x;               // Мольная доля спирта в жидкости
+    double y;               // ... в равновесном паре
+    double t;               // T кипения, °C
+};
+
+// До азеотропа включительно: дальше T снова растёт, и обратная задача
+// неоднозначна. Разбавленный участок - коэффициент распределения ~11
+static constexpr VlePoint POINTS[] = {
+    {0.0000, 0.0000, 100.00},
+    {0.0050, 0.0520,  98.70},
+    {0.0100, 0.1000,  97.60},
+    {0.0190, 0.1700,  95.50},
+    {0.0721, 0.3891,  89.00},
+    {0.0966, 0.4375,  86.70},
+    {0.1238, 0.4704,  85.30},
+    {0.1661, 0.5089,  84.10},
+    {0.2337, 0.5445,  82.70},
+    {0.2608, 0.5580,  82.30},
+    {0.3273, 0.5826,  81.50},
+    {0.3965, 0.6122,  80.70},
+    {0.5079, 0.6564,  79.80},
+    {0.5732, 0.6841,  79.30},
+    {0.6763, 0.7385,  78.74},
+    {0.7472, 0.7815,  78.41},
+    {0.8943, 0.8943,  78.15}
+};
+
+static constexpr int ROWS = sizeof(POINTS) / sizeof(POINTS[0]);
+
+// =============================================================================
+// ТАБЛИЦЫ (при компиляции)
+// =============================================================================
+
+enum Column : uint8_t {
+    COL_TEMP,
+    COL_MOLE,
+    COL_LIQUID_ABV,
+    COL_VAPOUR_ABV
+};
+
+/**
+ * Узлы монотонного сплайна: x по возрастанию, y и наклон dy/dx
+ */
+struct Knots {
+    float x[ROWS];
+    float y[ROWS];
+    float m[ROWS];
+};
+
+static constexpr double excessVolume(double x) {
+    return x * (1.0 - x) * (VE_A0 + VE_A1 * (1.0 - 2.0 * x));
+}
+
+static constexpr double abvFromMole(double x) {
+    return 100.0 * x * VM_ETHANOL /
+           (x * VM_ETHANOL + (1.0 - x) * VM_WATER + excessVolume(x));
+}
+
+static constexpr double column(Column c, int row) {
+    return c == COL_TEMP ? POINTS[row].t :
+           c == COL_MOLE ? POINTS[row].x :
+           c == COL_LIQUID_ABV ? abvFromMole(POINTS[row].x) :
+           abvFromMole(POINTS[row].y);
+}
+
+// Таблицы по температуре идут от азеотропа к воде - строки в обратном порядке
+static constexpr double knot(Column c, bool reversed, int i) {
+    return column(c, reversed ? ROWS - 1 - i : i);
+}
+
+static constexpr double secant(Column cx, Column cy, bool reversed, int i) {
+    return (knot(cy, reversed, i + 1) - knot(cy, reversed, i)) /
+           (knot(cx, reversed, i + 1) - knot(cx, reversed, i));
+}
+
+// Фрич-Бутланд: взвешенное гармоническое среднее соседних секущих,
+// ноль на смене знака - сплайн не выходит за значения узлов
+static constexpr double harmonic(double d0, double d1, double h0, double h1) {
+    return d0 * d1 <= 0 ? 0.0 : 3.0 * (h0 + h1) / ((2.0 * h1 + h0) / d0 + (h1 + 2.0 * h0) / d1);
+}
+
+static constexpr double slope(Column cx, Column cy, bool reversed, int i) {
+    return i == 0 ? secant(cx, cy, reversed, 0) :
+           i == ROWS - 1 ? secant(cx, cy, reversed, ROWS - 2) :
+           harmonic(secant(cx, cy, reversed, i - 1), secant(cx, cy, reversed, i),
+                    knot(cx, reversed, i) - knot(cx, reversed, i - 1),
+                    knot(cx, reversed, i + 1) - knot(cx, reversed, i));
+}
+
+template<int... I> struct Seq {};
+template<int N, int... I> struct MakeSeq : MakeSeq<N - 1, N - 1, I...> {};
+template<int... I> struct MakeSeq<0, I...> { typedef Seq<I...> type; };
+
+template<int... I>
+static constexpr Knots makeKnots(Column cx, Column cy, bool reversed, Seq<I...>) {
+    return Knots{
+        { static_cast<float>(knot(cx, reversed, I))... },
+        { static_cast<float>(knot(cy, reversed, I))... },
+        { static_cast<float>(slope(cx, cy, reversed, I))... }
+    };
+}
+
+static constexpr Knots build(Column cx, Column cy, bool reversed) {
+    return makeKnots(cx, cy, reversed, MakeSeq<ROWS>::type());
+}
+
+static constexpr Knots TEMP_TO_LIQUID = build(COL_TEMP, COL_LIQUID_ABV, true);
+static constexpr Knots TEMP_TO_VAPOUR = build(COL_TEMP, COL_VAPOUR_ABV, true);
+static constexpr Knots TEMP_TO_MOLE   = build(COL_TEMP, COL_MOLE, true);
+static constexpr Knots LIQUID_TO_TEMP = build(COL_LIQUID_ABV, COL_TEMP, false);
+
+static constexpr bool increasing(const Knots& k, int i) {
+    return i >= ROWS - 1 || (k.x[i] < k.x[i + 1] && increasing(k, i + 1));
+}
+
+static_assert(increasing(TEMP_TO_LIQUID, 0), "VLE: T must fall with ethanol up to azeotrope");
+static_assert(increasing(LIQUID_TO_TEMP, 0), "VLE: ABV must grow with mole fraction");
+
+// =============================================================================
+// ВСПОМОГАТЕЛЬНЫЕ
+// =============================================================================
+
+static float cachedHpa = -1;
+static float shiftWater = 0;            // Смещение T кипения воды от 760 мм рт.ст.
+static float shiftEthanol = 0;
+
+/**
+ * Эрмитов сплайн по узлам, вне таблицы - крайнее значение
+ */
+static float interpolate(const Knots& k, float x) {
+    if (x <= k.x[0]) return k.y[0];
+    if (x >= k.x[ROWS - 1]) return k.y[ROWS - 1];
+
+    uint8_t lo = 0, hi = ROWS - 1;
+    while (hi - lo > 1) {
+        uint8_t mid = (lo + hi) / 2;
+        if (k.x[mid] <= x) lo = mid; else hi = mid;
+    }
+
+    float h = k.x[hi] - k.x[lo];
+    float t = (x - k.x[lo]) / h;
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * k.y[lo] + (t3 - 2 * t2 + t) * h * k.m[lo] +
+           (-2 * t3 + 3 * t2) * k.y[hi] + (t3 - t2) * h * k.m[hi];
+}
+
+static float antoine(float a, float b, float c, float mmHg) {
+    return b / (a - log10f(mmHg)) - c;
+}
+
+static void setPressure(float pressureHpa) {
+    if (fabsf(pressureHpa - cachedHpa) < PRESSURE_EPS_HPA) return;
+    cachedHpa = pressureHpa;
+
+    float mmHg = pressureHpa * MMHG_PER_HPA;
+    shiftWater = antoine(ANTOINE_WATER_A, ANTOINE_WATER_B, ANTOINE_WATER_C, mmHg) -
+                 antoine(ANTOINE_WATER_A, ANTOINE_WATER_B, ANTOINE_WATER_C, STANDARD_MMHG);
+    shiftEthanol = antoine(ANTOINE_ETHANOL_A, ANTOINE_ETHANOL_B, ANTOINE_ETHANOL_C, mmHg) -
+                   antoine(ANTOINE_ETHANOL_A, ANTOINE_ETHANOL_B, ANTOINE_ETHANOL_C, STANDARD_MMHG);
+}
+
+static float shift(float mole) {
+    return (1.0f - mole) * shiftWater + mole * shiftEthanol;
+}
+
+/**
+ * T, приведённая к 760 мм рт.ст. Смещение зависит от состава, который
+ * ищется по этой же T: второе приближение отличается от первого
+ * на сотые градуса
+ */
+static float toStandard(float temp, float pressureHpa) {
+    setPressure(pressureHpa);
+    float t760 = temp - shiftWater;
+    float mole = interpolate(TEMP_TO_MOLE, t760);
+    return temp - shift(mole);
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+float boilingTemp(float liquidAbv, float pressureHpa) {
+    setPressure(pressureHpa);
+    float t760 = interpolate(LIQUID_TO_TEMP, liquidAbv);
+    return t760 + shift(interpolate(TEMP_TO_MOLE, t760));
+}
+
+float liquidAbv(float temp, float pressureHpa) {
+    return interpolate(TEMP_TO_LIQUID, toStandard(temp, pressureHpa));
+}
+
+float vapourAbv(float temp, float pressureHpa) {
+    return interpolate(TEMP_TO_VAPOUR, toStandard(temp, pressureHpa));
+}
+
+float normalizeTemp(float temp, float pressureHpa, float refHpa) {
+    float t760 = toStandard(temp, pressureHpa);
+    float mole = interpolate(TEMP_TO_MOLE, t760);
+    setPressure(refHpa);
+    return t760 + shift(mole);
+}
+
+float waterBoilingTemp(float pressureHpa) {
+    setPressure(pressureHpa);
+    return TEMP_TO_LIQUID.x[ROWS - 1] + shiftWater;
+}
+
+float azeotropeTemp(float pressureHpa) {
+    setPressure(pressureHpa);
+    return TEMP_TO_LIQUID.x[0] + shift(TEMP_TO_MOLE.y[0]);
+}
+
+void update(SystemState& state) {
+    const Temperatures& temps = state.temps;
+    VleState& vle = state.vle;
+
+    float hPa = state.pressure.atmosphere > 0 ? state.pressure.atmosphere
+                                              : STANDARD_MMHG / MMHG_PER_HPA;
+    float tAz = azeotropeTemp(hPa);
+    vle.boilingWater = waterBoilingTemp(hPa);
+
+    // Куб кипит, когда пар прогрел низ царги (без датчика - только по диапазону).
+    // Давление в кубе выше атмосферного на перепад царги
+    float cube = TempFilter::value(temps, TEMP_CUBE);
+    float cubeHpa = hPa + (state.pressure.cube > 0 ? state.pressure.cube / MMHG_PER_HPA : 0);
+    bool vapour = !temps.valid[TEMP_COLUMN_BOTTOM] ||
+                  TempFilter::value(temps, TEMP_COLUMN_BOTTOM) > tAz - VAPOUR_MARGIN;
+    vle.cubeValid = temps.valid[TEMP_CUBE] && vapour &&
+                    cube > azeotropeTemp(cubeHpa) - RANGE_MARGIN &&
+                    cube < waterBoilingTemp(cubeHpa) + RANGE_MARGIN;
+    vle.cubeAbv = vle.cubeValid ? liquidAbv(cube, cubeHpa) : 0;
+    vle.cubeVapourAbv = vle.cubeValid ? vapourAbv(cube, cubeHpa) : 0;
+
+    // Верх царги - при атмосферном
+    float top = TempFilter::value(temps, TEMP_COLUMN_TOP);
+    vle.distillateValid = temps.valid[TEMP_COLUMN_TOP] &&
+                          top > tAz - RANGE_MARGIN && top < vle.boilingWater + RANGE_MARGIN;
+    vle.distillateAbv = vle.distillateValid ? vapourAbv(top, hPa) : 0;
+}
+
+} // namespace Vle
@@ -0,0 +1,68 @@
+/**
+ * Smart-Column S3 - Ethanol-Water VLE
+ *
+ * Равновесие пар-жидкость спирт-вода: T кипения, крепость жидкости и
+ * равновесного пара. Таблицы строятся при компиляции из опорных точек
+ * при 760 мм рт.ст., на давление BMP280 пересчитываются по Антуану.
+ * Интерполяция монотонная кубическая (Фрич-Карлсон): между точками
+ * таблицы нет ложных экстремумов, обратная задача однозначна.
+ *
+ * Крепость - % об. при 20 °C с учётом контракции смеси.
+ */
+
+#ifndef VLE_H
+#define VLE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+namespace Vle {
+    /**
+     * T кипения жидкости
+     * @param liquidAbv Крепость жидкости (% об.)
+     * @param pressureHpa Атмосферное давление (гПа)
+     * @return °C
+     */
+    float boilingTemp(float liquidAbv, float pressureHpa);
+
+    /**
+     * Крепость кипящей жидкости по её температуре (куб)
+     * @param temp T кипения (°C)
+     * @param pressureHpa Атмосферное давление (гПа)
+     * @return % об., вне таблицы - крайнее значение (0 или азеотроп)
+     */
+    float liquidAbv(float temp, float pressureHpa);
+
+    /**
+     * Крепость равновесного пара по температуре (верх царги - отбор)
+     * @param temp T в точке равновесия (°C)
+     * @param pressureHpa Атмосферное давление (гПа)
+     * @return % об.
+     */
+    float vapourAbv(float temp, float pressureHpa);
+
+    /**
+     * Приведение T кипения к другому давлению при том же составе
+     * (T царги к давлению начала отбора)
+     * @param temp Измеренная T кипения (°C)
+     * @param pressureHpa Давление при измерении (гПа)
+     * @param refHpa Давление, к которому приводится T (гПа)
+     * @return °C
+     */
+    float normalizeTemp(float temp, float pressureHpa, float refHpa);
+
+    /**
+     * T кипения воды / азеотропа при давлении - границы таблицы
+     */
+    float waterBoilingTemp(float pressureHpa);
+    float azeotropeTemp(float pressureHpa);
+
+    /**
+     * Пересчёт крепостей в state.vle по отфильтрованным температурам
+     * (вызывать после TempFilter::update)
+     */
+    void update(SystemState& state);
+}
+
+#endif // VLE_H
@@ -3,28 +3,268 @@
  *
  * Алгоритмы управления:
  * - Watt Control: автоматическая регулировка мощности по давлению
- * - Smart Decrement: адаптивное снижение скорости отбора
+ * - Smart Decrement: адаптивная скорость отбора тела (AIMD)
  */
 
 #include "watt_control.h"
+#include "../hal/hal.h"
+#include "temp_filter.h"
+#include "vle.h"
 #include "../drivers/heater.h"
 #include "../drivers/pump.h"
+#include "../history.h"
 
 // =============================================================================
 // WATT CONTROL - Управление мощностью по давлению
 // =============================================================================
 
+// Идентификация модели (RLS с забыванием по каждому кандидату запаздывания)
+#define MODEL_MAX_DEAD_STEPS    8       // До 16 с при шаге 2 с
+#define MODEL_FORGET            0.995f  // Фактор забывания RLS
+#define MODEL_P_INIT            1000.0f // Начальная ковариация
+#define MODEL_P_TRACE_MAX       1e5f    // Ограничение роста ковариации без возбуждения
+#define MODEL_MIN_SAMPLES       30      // Шагов до использования модели
+#define MODEL_ERR_SMOOTH        0.05f   // Сглаживание ошибки прогноза
+#define MODEL_DITHER_PERCENT    3       // Пробный сигнал, пока модель не готова
+#define MODEL_DEAD_HYSTERESIS   0.8f    // Смена запаздывания при ошибке меньше на 20%
+#define MODEL_ERR_DEADZONE      0.3f    // мм рт.ст. - шум MPX5010DP
+#define MODEL_MIN_A             0.5f    // Постоянная времени не меньше ~3 с
+#define MODEL_MIN_GAIN          0.05f   // мм рт.ст./% - статическое усиление
+#define MODEL_DIST_ALPHA        0.1f    // Оценка возмущения по ошибке прогноза (~20 с)
+
+// Оптимизация (одно движение, мощность постоянна на горизонте)
+#define MPC_HORIZON             24      // Шагов после запаздывания
+#define MPC_POWER_STEP          1       // Перебор мощности, %
+#define MPC_MOVE_WEIGHT         0.002f  // Штраф за изменение мощности
+#define MPC_WARN_WEIGHT         100.0f  // Штраф за прогноз выше порога предупреждения
+
 namespace WattControl {
 
+/**
+ * Оценка ARX-модели для одного запаздывания
+ */
+struct RlsEstimator {
+    float theta[3];                     // a, b, c
+    float P[3][3];
+    float errEwma;                      // Средний квадрат ошибки прогноза на шаг
+};
+
 // Глобальные переменные
 static float floodPressure = 0;         // Порог захлёба (мм рт.ст.)
 static float workThreshold = 0;         // Рабочий порог
 static float warnThreshold = 0;         // Предупреждение
 static float critThreshold = 0;         // Критический порог
+static float targetPressure = 0;        // Уставка регулятора
+static float targetMult = PRESSURE_TARGET_MULT;  // Доля P_захлёб для уставки
 static int8_t overridePower = -1;       // Override мощности (-1 = выкл)
 static uint32_t lastFloodTime = 0;      // Время последнего захлёба
 static uint8_t floodCount = 0;          // Счётчик захлёбов
 static uint8_t powerReduction = 0;      // Накопленное снижение мощности
+static bool floodHold = false;          // Удержание сниженной мощности после захлёба
+
+static RlsEstimator estimators[MODEL_MAX_DEAD_STEPS + 1];
+static float powerHistory[MODEL_MAX_DEAD_STEPS + 1];   // [j] = u[k-1-j]
+static float lastPressure = 0;
+static uint32_t lastStep = 0;
+static uint8_t output = 100;            // Последняя выбранная мощность
+static uint16_t ditherLfsr = 0xACE1;
+static float disturbance = 0;           // Невязка модели на шаг (мм рт.ст.)
+static WattModel model;
+
+static void updateThresholds() {
+    workThreshold = floodPressure * PRESSURE_WORK_MULT;
+    warnThreshold = floodPressure * PRESSURE_WARN_MULT;
+    critThreshold = floodPressure * PRESSURE_CRIT_MULT;
+    targetPressure = floodPressure * targetMult;
+    model.target = targetPressure;
+}
+
+// ============================================================================
+// Идентификация
+// ============================================================================
+
+static void resetEstimator(RlsEstimator& est) {
+    memset(&est, 0, sizeof(est));
+    est.theta[0] = 0.9f;                // Нейтральное начальное приближение
+    for (uint8_t i = 0; i < 3; i++) {
+        est.P[i][i] = MODEL_P_INIT;
+    }
+}
+
+/**
+ * Шаг RLS: y = theta · phi
+ */
+static void rlsUpdate(RlsEstimator& est, const float phi[3], float y) {
+    float Pphi[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        Pphi[i] = est.P[i][0] * phi[0] + est.P[i][1] * phi[1] + est.P[i][2] * phi[2];
+    }
+
+    float denom = MODEL_FORGET + phi[0] * Pphi[0] + phi[1] * Pphi[1] + phi[2] * Pphi[2];
+    float err = y - (est.theta[0] * phi[0] + est.theta[1] * phi[1] + est.theta[2] * phi[2]);
+
+    // Ошибка априорного прогноза - критерий выбора запаздывания
+    est.errEwma += MODEL_ERR_SMOOTH * (err * err - est.errEwma);
+
+    // Зона нечувствительности: ошибка на уровне шума датчика не несёт
+    // информации, а в установившемся режиме без возбуждения уводит a и c
+    if (fabsf(err) < MODEL_ERR_DEADZONE) return;
+
+    float K[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        K[i] = Pphi[i] / denom;
+        est.theta[i] += K[i] * err;
+    }
+
+    // Без возбуждения ковариация растёт как 1/λ^k - забывание отключается
+    float trace = est.P[0][0] + est.P[1][1] + est.P[2][2];
+    float forget = trace > MODEL_P_TRACE_MAX ? 1.0f : MODEL_FORGET;
+
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+            est.P[i][j] = (est.P[i][j] - K[i] * Pphi[j]) / forget;
+        }
+    }
+}
+
+/**
+ * Шаг идентификации по новому отсчёту давления
+ * @param pressure P[k]
+ * @param applied Мощность, действовавшая на прошедшем шаге u[k-1]
+ */
+static void identify(float pressure, uint8_t applied) {
+    powerHistory[0] = applied;
+
+    // Невязка опубликованной модели - постоянное возмущение в прогнозе
+    // (без него неточная модель держит давление со статической ошибкой)
+    if (model.ready) {
+        float predicted = model.a * lastPressure + model.b * powerHistory[model.deadSteps] +
+                          model.c + disturbance;
+        disturbance += MODEL_DIST_ALPHA * (pressure - predicted);
+        disturbance = constrain(disturbance, -floodPressure, floodPressure);
+    }
+
+    if (model.samples > 0) {
+        for (uint8_t d = 0; d <= MODEL_MAX_DEAD_STEPS; d++) {
+            const float phi[3] = { lastPressure, powerHistory[d], 1.0f };
+            rlsUpdate(estimators[d], phi, pressure);
+        }
+    }
+    if (model.samples < 0xFFFF) model.samples++;
+    lastPressure = pressure;
+
+    // Запаздывание - кандидат с наименьшей ошибкой прогноза
+    // (с гистерезисом, чтобы близкие кандидаты не переключались на шуме)
+    uint8_t best = model.deadSteps;
+    for (uint8_t d = 0; d <= MODEL_MAX_DEAD_STEPS; d++) {
+        if (estimators[d].errEwma < estimators[best].errEwma * MODEL_DEAD_HYSTERESIS) best = d;
+    }
+
+    // Для прогноза берётся только устойчивая оценка с правдоподобной
+    // инерцией и усилением, иначе остаётся последняя годная модель.
+    // Без возбуждения RLS сползает к "среднему давлению" (a и b около
+    // нуля): по такой модели мощность ни на что не влияет
+    const RlsEstimator& est = estimators[best];
+    bool stable = est.theta[0] > MODEL_MIN_A && est.theta[0] < 0.999f && est.theta[1] > 1e-4f &&
+                  est.theta[1] / (1.0f - est.theta[0]) > MODEL_MIN_GAIN;
+    if (!stable || model.samples < MODEL_MIN_SAMPLES) return;
+
+    if (!model.ready || best != model.deadSteps) {
+        LOG_I("WattControl: Model a=%.3f b=%.4f c=%.2f dead=%u (K=%.2f mmHg/%%)",
+              est.theta[0], est.theta[1], est.theta[2], best,
+              est.theta[1] / (1.0f - est.theta[0]));
+    }
+
+    // Обновлённая оценка уже учла смещение в c - невязка копится заново
+    if (!model.ready || est.theta[2] != model.c) {
+        disturbance = 0;
+    }
+    model.a = est.theta[0];
+    model.b = est.theta[1];
+    model.c = est.theta[2];
+    model.deadSteps = best;
+    model.ready = true;
+}
+
+/**
+ * Сдвиг истории мощности на шаг (после выбора u[k])
+ */
+static void pushPower(uint8_t percent) {
+    for (uint8_t j = MODEL_MAX_DEAD_STEPS; j > 0; j--) {
+        powerHistory[j] = powerHistory[j - 1];
+    }
+    powerHistory[0] = percent;
+}
+
+// ============================================================================
+// Оптимизация на горизонте
+// ============================================================================
+
+/**
+ * Выбор мощности: перебор постоянной мощности на горизонте,
+ * минимум квадрата отклонения прогноза от уставки + штраф за
+ * превышение порога предупреждения + штраф за изменение мощности.
+ * Решается заново на каждом шаге (скользящий горизонт).
+ */
+static uint8_t optimize(float pressure, uint8_t maxPercent) {
+    const uint8_t dead = model.deadSteps;
+    float bestCost = 1e30f;
+    uint8_t best = output;
+
+    for (uint16_t u = 0; u <= maxPercent; u += MPC_POWER_STEP) {
+        float y = pressure;
+        float cost = 0;
+
+        for (uint8_t i = 0; i < dead + MPC_HORIZON; i++) {
+            // Первые dead шагов действует уже поданная мощность
+            float uin = i < dead ? powerHistory[dead - 1 - i] : (float)u;
+            y = model.a * y + model.b * uin + model.c + disturbance;
+
+            if (i >= dead) {
+                float e = y - targetPressure;
+                cost += e * e;
+                if (y > warnThreshold) {
+                    float over = y - warnThreshold;
+                    cost += MPC_WARN_WEIGHT * over * over;
+                }
+            }
+        }
+
+        float move = (float)u - output;
+        cost += MPC_MOVE_WEIGHT * move * move * MPC_HORIZON;
+
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = u;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Пока модели нет: удержание мощности с пробным сигналом
+ * и отступ при приближении к захлёбу
+ */
+static uint8_t identifyPower(float pressure, uint8_t maxPercent) {
+    int16_t base = output;
+    if (pressure > warnThreshold) {
+        base = base * 9 / 10;
+    }
+
+    // Псевдослучайная последовательность ±MODEL_DITHER_PERCENT (LFSR 16 бит)
+    uint16_t bit = ((ditherLfsr >> 0) ^ (ditherLfsr >> 2) ^ (ditherLfsr >> 3) ^ (ditherLfsr >> 5)) & 1;
+    ditherLfsr = (ditherLfsr >> 1) | (bit << 15);
+    int16_t value = base + (bit ? MODEL_DITHER_PERCENT : -MODEL_DITHER_PERCENT);
+
+    if (value > maxPercent) value = maxPercent;
+    if (value < 0) value = 0;
+    return value;
+}
+
+// ============================================================================
+// Публичный интерфейс
+// ============================================================================
 
 void init(const EquipmentSettings& settings) {
     LOG_I("WattControl: Initializing...");
@@ -35,13 +275,14 @@ void init(const EquipmentSettings& settings) {
         settings.packingCoeff
     );
 
+    // Уставка - от номинальной доли P_захлёб, захлёбы в процессе её снижают
+    targetMult = PRESSURE_TARGET_MULT;
+
     // Рассчитать рабочие пороги
-    workThreshold = floodPressure * PRESSURE_WORK_MULT;
-    warnThreshold = floodPressure * PRESSURE_WARN_MULT;
-    critThreshold = floodPressure * PRESSURE_CRIT_MULT;
+    updateThresholds();
 
-    LOG_I("WattControl: P_flood=%.1f, P_work=%.1f, P_warn=%.1f, P_crit=%.1f",
-          floodPressure, workThreshold, warnThreshold, critThreshold);
+    LOG_I("WattControl: P_flood=%.1f, P_work=%.1f, P_warn=%.1f, P_crit=%.1f, P_target=%.1f",
+          floodPressure, workThreshold, warnThreshold, critThreshold, targetPressure);
 }
 
 float calculateFloodPressure(uint16_t columnHeightMm, float packingCoeff) {
@@ -55,20 +296,46 @@ void setFloodPressure(float pressure) {
         floodPressure = pressure;
 
         // Пересчитать пороги
-        workThreshold = floodPressure * PRESSURE_WORK_MULT;
-        warnThreshold = floodPressure * PRESSURE_WARN_MULT;
-        critThreshold = floodPressure * PRESSURE_CRIT_MULT;
+        updateThresholds();
 
         LOG_I("WattControl: Calibrated P_flood=%.1f", pressure);
     }
 }
 
-uint8_t update(const SystemState& state, const Settings& settings) {
+void resetModel(uint8_t startPercent) {
+    for (uint8_t d = 0; d <= MODEL_MAX_DEAD_STEPS; d++) {
+        resetEstimator(estimators[d]);
+        powerHistory[d] = startPercent;
+    }
+
+    model.a = 0;
+    model.b = 0;
+    model.c = 0;
+    model.deadSteps = 0;
+    model.samples = 0;
+    model.ready = false;
+    model.target = targetPressure;
+    disturbance = 0;
+
+    output = startPercent;
+    lastStep = 0;
+    floodCount = 0;
+    powerReduction = 0;
+    floodHold = false;
+}
+
+uint8_t update(const SystemState& state, uint8_t maxPercent) {
     // Если override активен - использовать его
     if (overridePower >= 0) {
         return overridePower;
     }
 
+    // Без датчика давления регулировать нечем
+    if (!state.health.ads1115Ok || floodPressure <= 0) {
+        return maxPercent;
+    }
+
+    uint32_t now = Hal::millis();
     float pressure = state.pressure.cube;
 
     // Проверка захлёба
@@ -76,20 +343,24 @@ uint8_t update(const SystemState& state, const Settings& settings) {
         handleFlood();
     }
 
-    // Рассчитать рекомендуемую мощность
-    uint8_t recommended = getRecommendedPower(pressure);
-
-    // Применить снижение после захлёбов
-    if (powerReduction > 0) {
-        if (recommended > powerReduction) {
-            recommended -= powerReduction;
-        } else {
-            recommended = 0;
+    // Удержание сниженной мощности после захлёба
+    if (floodHold) {
+        if (now - lastFloodTime < WATT_FLOOD_HOLD_MS) {
+            return Heater::getPower();
+        }
+        floodHold = false;
+
+        // Если захлёбы частые - добавить больше снижения
+        if (floodCount > 3) {
+            powerReduction += 10;
+            if (powerReduction > 50) powerReduction = 50;
+            LOG_E("WattControl: Frequent floods (%d), extra reduction: %d%%",
+                  floodCount, powerReduction);
         }
     }
 
     // Постепенное восстановление мощности после захлёба
-    if (powerReduction > 0 && millis() - lastFloodTime > 60000) {
+    if (powerReduction > 0 && now - lastFloodTime > 60000) {
         // Каждую минуту восстанавливаем 5%
         if (powerReduction >= 5) {
             powerReduction -= 5;
@@ -98,10 +369,47 @@ uint8_t update(const SystemState& state, const Settings& settings) {
             powerReduction = 0;
             LOG_I("WattControl: Power fully restored");
         }
-        lastFloodTime = millis();
+        lastFloodTime = now;
+    }
+
+    if (lastStep != 0 && now - lastStep < WATT_CONTROL_PERIOD_MS) {
+        return output;
     }
+    lastStep = now;
+
+    // Ограничение после захлёбов
+    uint8_t limit = maxPercent > powerReduction ? maxPercent - powerReduction : 0;
 
-    return recommended;
+    identify(pressure, Heater::getPower());
+    uint8_t next = model.ready ? optimize(pressure, limit) : identifyPower(pressure, limit);
+
+    // Модель без возбуждения дрейфует к среднему давлению (усиление около
+    // нуля) и просит полную мощность. Обратная связь поверх прогноза:
+    // выше уставки мощность не растёт, выше предупреждения - снижается
+    if (pressure > targetPressure && next > output) {
+        next = output;
+    }
+    if (pressure > warnThreshold && next >= output) {
+        next = output > WATT_WARN_STEP_PERCENT ? output - WATT_WARN_STEP_PERCENT : 0;
+    }
+    // Подъём ограничен по скорости: у захлёба усиление растёт быстрее,
+    // чем его успевает отследить модель. Снижение тоже ограничено: модель
+    // с заниженным усилением просит сброс почти до нуля, и давление
+    // проваливается (захлёб снижает мощность сам, в handleFlood)
+    if (next > output + WATT_RISE_STEP_PERCENT) {
+        next = output + WATT_RISE_STEP_PERCENT;
+    }
+    if (next + WATT_FALL_STEP_PERCENT < output) {
+        next = output - WATT_FALL_STEP_PERCENT;
+    }
+    output = next;
+    pushPower(output);
+
+    return output;
+}
+
+const WattModel& getModel() {
+    return model;
 }
 
 uint8_t getRecommendedPower(float pressure) {
@@ -129,10 +437,10 @@ bool isOverrideActive() {
 }
 
 void handleFlood() {
-    uint32_t now = millis();
+    uint32_t now = Hal::millis();
 
     // Защита от повторных срабатываний
-    if (now - lastFloodTime < 5000) {
+    if (floodHold || now - lastFloodTime < 5000) {
         return;
     }
 
@@ -143,24 +451,29 @@ void handleFlood() {
     uint8_t currentPower = Heater::getPower();
     uint8_t newPower = currentPower * 0.85f;
 
-    // Минимум 30%
-    if (newPower < 30) newPower = 30;
+    // Минимум 30% (но не выше текущей)
+    if (newPower < 30) newPower = currentPower < 30 ? currentPower : 30;
 
     Heater::setPower(newPower);
     powerReduction += 15;
     if (powerReduction > 50) powerReduction = 50; // Максимум -50%
 
+    // Мощность удерживается в update(), loop не блокируется
+    floodHold = true;
+    output = newPower;
+
     LOG_E("WattControl: FLOOD detected! Power %d%% → %d%% (reduction: %d%%)",
           currentPower, newPower, powerReduction);
 
-    // Пауза 30 секунд
-    delay(30000);
-
-    // Если захлёбы частые - добавить больше снижения
-    if (floodCount > 3) {
-        powerReduction += 10;
-        LOG_E("WattControl: Frequent floods (%d), extra reduction: %d%%",
-              floodCount, powerReduction);
+    // Захлёб ниже расчётного порога: реальный P_захлёб ниже оценки, и без
+    // снижения уставки регулятор вернётся к тому же давлению. Пороги защиты
+    // остаются от P_захлёб - иначе срабатывания пойдут по нормальному давлению
+    float mult = targetMult * WATT_FLOOD_BACKOFF;
+    if (mult >= WATT_TARGET_MIN_MULT) {
+        targetMult = mult;
+        updateThresholds();
+        LOG_W("WattControl: Target lowered to %.1f mmHg (%.0f%% of P_flood)",
+              targetPressure, targetMult * 100.0f);
     }
 }
 
@@ -179,89 +492,169 @@ void getThresholds(float& work, float& warn, float& crit) {
 } // namespace WattControl
 
 // =============================================================================
-// SMART DECREMENT - Адаптивное снижение скорости отбора
+// SMART DECREMENT - Адаптивная скорость отбора тела
 // =============================================================================
 
 namespace SmartDecrement {
 
 // Глобальные переменные
 static DecrementState state;
+static float minSpeed = 0;              // Ниже - переход в хвосты (мл/ч)
+static float maxSpeed = 0;              // Потолок пробного увеличения (мл/ч)
+static float increaseStep = 0;          // Шаг увеличения (мл/ч)
+static float loggedCorrection = 0;      // Поправка на давление в последней записи лога (°C)
+
+/**
+ * T царги, приведённая к давлению фиксации T_base. За 8-12 ч тела
+ * давление уходит на единицы гПа, T кипения - на десятые градуса
+ */
+static float normalizeTemp(float measured, float pressureHpa) {
+    if (state.basePressure <= 0 || pressureHpa <= 0) return measured;
+
+    float normalized = Vle::normalizeTemp(measured, pressureHpa, state.basePressure);
+    state.pressureCorrection = normalized - measured;
+
+    if (fabsf(state.pressureCorrection - loggedCorrection) >= DECREMENT_PRESSURE_LOG_STEP) {
+        loggedCorrection = state.pressureCorrection;
+        LOG_I("SmartDecrement: Pressure %.1f hPa (base %.1f), T_column correction %+.2f°C",
+              pressureHpa, state.basePressure, state.pressureCorrection);
+    }
+    return normalized;
+}
 
-void init(float baseTemp) {
+/**
+ * Смена скорости отбора с записью в историю процесса
+ */
+static void changeSpeed(float newSpeed, float columnTop, const char* reason) {
+    processRecorder.recordSpeedChange(state.speed, newSpeed, columnTop, reason);
+    state.speed = newSpeed;
+}
+
+void init(float baseTemp, float speedMlH, float heaterKw, float pressureHpa) {
     state.active = false;
     state.baseTemp = baseTemp;
+    state.basePressure = pressureHpa > 0 ? pressureHpa : 0;
+    state.pressureCorrection = 0;
+    loggedCorrection = 0;
     state.decrementCount = 0;
+    state.incrementCount = 0;
     state.waitStart = 0;
+    state.stableSince = Hal::millis();
+    state.speed = speedMlH;
+    state.tripSpeed = 0;
+
+    minSpeed = DECREMENT_MIN_SPEED_ML_H_KW * heaterKw;
+    maxSpeed = speedMlH * DECREMENT_INCREASE_MAX_MULT;
+    increaseStep = DECREMENT_INCREASE_ML_H_KW * heaterKw;
+
+    Pump::start(speedMlH);
 
-    LOG_I("SmartDecrement: Init, T_base=%.2f°C", baseTemp);
+    LOG_I("SmartDecrement: Init, T_base=%.2f°C at %.1f hPa, speed=%.0f ml/h (min %.0f, max %.0f)",
+          baseTemp, state.basePressure, speedMlH, minSpeed, maxSpeed);
 }
 
-bool update(SystemState& sysState, const Settings& settings) {
-    float currentTemp = sysState.temps.columnTop;
+bool update(SystemState& sysState) {
+    uint32_t now = Hal::millis();
 
     // Проверка валидности температуры
     if (!sysState.temps.valid[TEMP_COLUMN_TOP]) {
         return false;
     }
 
-    // Проверка условия срабатывания
-    if (!state.active && shouldDecrement(currentTemp, state.baseTemp)) {
-        LOG_I("SmartDecrement: Triggered! T_column=%.2f°C > T_base+%.2f°C",
-              currentTemp, DECREMENT_TRIGGER_DELTA);
-
-        // Остановить насос
-        Pump::stop();
-        state.active = true;
-        state.waitStart = millis();
+    // Сравнение с T_base - при давлении её фиксации
+    float measured = TempFilter::value(sysState.temps, TEMP_COLUMN_TOP);
+    float currentTemp = normalizeTemp(measured, sysState.pressure.atmosphere);
+    TempEstimate est = sysState.temps.filtered[TEMP_COLUMN_TOP];
+    est.value += state.pressureCorrection;
+
+    bool toTails = false;
+
+    if (!state.active) {
+        bool byTrend = false;
+        if (shouldDecrement(currentTemp, state.baseTemp) ||
+            (byTrend = shouldDecrementByTrend(est, state.baseTemp))) {
+            // Колонна не держит скорость - стоп до возврата T к T_base
+            if (byTrend) {
+                LOG_I("SmartDecrement: Triggered by trend! T_column=%.2f°C (%+.2f°C pressure), %+.3f°C/min at %.0f ml/h",
+                      currentTemp, state.pressureCorrection, est.slope, state.speed);
+            } else {
+                LOG_I("SmartDecrement: Triggered! T_column=%.2f°C (%+.2f°C pressure) > T_base+%.2f°C at %.0f ml/h",
+                      currentTemp, state.pressureCorrection, DECREMENT_TRIGGER_DELTA, state.speed);
+            }
 
-        return false; // Продолжаем работу
-    }
+            Pump::stop();
+            state.active = true;
+            state.waitStart = now;
+            state.tripSpeed = state.speed;
+        } else if (!canResume(currentTemp, state.baseTemp)) {
+            // Между порогами возобновления и срабатывания - участок не стабилен
+            state.stableSince = now;
+        } else if (now - state.stableSince >= DECREMENT_STABLE_SEC * 1000UL) {
+            state.stableSince = now;
+
+            // Аддитивное увеличение: до скорости последней остановки,
+            // на ней - ещё один стабильный участок, затем выше
+            float ceiling = maxSpeed;
+            if (state.tripSpeed > 0) {
+                if (state.speed >= state.tripSpeed) {
+                    state.tripSpeed = 0;
+                } else if (state.tripSpeed < ceiling) {
+                    ceiling = state.tripSpeed;
+                }
+            }
 
-    // Если активен - ждём снижения температуры
-    if (state.active) {
-        uint32_t elapsed = millis() - state.waitStart;
+            float newSpeed = state.speed + increaseStep;
+            if (newSpeed > ceiling) newSpeed = ceiling;
 
-        // Проверка таймаута
-        if (elapsed > DECREMENT_WAIT_MAX_SEC * 1000UL) {
-            LOG_E("SmartDecrement: Timeout! Transition to TAILS");
-            return true; // Переход в хвосты
+            if (newSpeed > state.speed) {
+                LOG_I("SmartDecrement: Stable, speed %.0f → %.0f ml/h", state.speed, newSpeed);
+                changeSpeed(newSpeed, measured, "increment");
+                Pump::setSpeed(newSpeed);
+                state.incrementCount++;
+            }
         }
-
-        // Проверка условия возобновления
-        if (canResume(currentTemp, state.baseTemp)) {
-            LOG_I("SmartDecrement: Resume! T_column=%.2f°C", currentTemp);
-
-            // Снизить скорость
-            float currentSpeed = Pump::getSpeed();
-            float newSpeed = currentSpeed * DECREMENT_SPEED_MULT;
-
-            // Проверка минимума
-            if (newSpeed < DECREMENT_MIN_SPEED_ML_H_KW *
-                          (settings.equipment.heaterPowerW / 1000.0f)) {
-                LOG_I("SmartDecrement: Speed too low, transition to TAILS");
-                return true; // Переход в хвосты
+    } else {
+        // Ожидание снижения температуры
+        if (now - state.waitStart > DECREMENT_WAIT_MAX_SEC * 1000UL) {
+            LOG_E("SmartDecrement: Timeout! Transition to TAILS");
+            toTails = true;
+        } else if (canResume(currentTemp, state.baseTemp)) {
+            // Мультипликативное снижение от скорости, на которой сработал стоп
+            float newSpeed = state.speed * DECREMENT_SPEED_MULT;
+
+            if (newSpeed < minSpeed) {
+                LOG_I("SmartDecrement: Speed too low (%.0f ml/h), transition to TAILS", newSpeed);
+                toTails = true;
+            } else {
+                LOG_I("SmartDecrement: Resume! T_column=%.2f°C (%+.2f°C pressure), speed %.0f → %.0f ml/h (count: %d)",
+                      currentTemp, state.pressureCorrection, state.speed, newSpeed, state.decrementCount + 1);
+
+                changeSpeed(newSpeed, measured, "decrement");
+                Pump::start(newSpeed);
+                state.active = false;
+                state.decrementCount++;
+                state.stableSince = now;
             }
-
-            // Установить новую скорость
-            Pump::start(newSpeed);
-            state.active = false;
-            state.decrementCount++;
-
-            LOG_I("SmartDecrement: Speed %.0f → %.0f ml/h (count: %d)",
-                  currentSpeed, newSpeed, state.decrementCount);
-
-            // Обновить статистику
-            sysState.stats.decrementCount = state.decrementCount;
         }
     }
 
-    return false; // Продолжаем работу
+    sysState.decrement = state;
+    sysState.stats.decrementCount = state.decrementCount;
+    return toTails;
 }
 
 bool shouldDecrement(float currentTemp, float baseTemp) {
     return (currentTemp > baseTemp + DECREMENT_TRIGGER_DELTA);
 }
 
+bool shouldDecrementByTrend(const TempEstimate& est, float baseTemp) {
+    if (!TempFilter::isRising(est) || est.value < baseTemp + DECREMENT_RESUME_DELTA) {
+        return false;
+    }
+    float forecast = est.value + est.slope * DECREMENT_FORECAST_SEC / 60.0f;
+    return shouldDecrement(forecast, baseTemp);
+}
+
 bool canResume(float currentTemp, float baseTemp) {
     return (currentTemp < baseTemp + DECREMENT_RESUME_DELTA);
 }
@@ -273,7 +666,12 @@ const DecrementState& getState() {
 void reset() {
     state.active = false;
     state.decrementCount = 0;
+    state.incrementCount = 0;
     state.waitStart = 0;
+    state.speed = 0;
+    state.tripSpeed = 0;
+    state.basePressure = 0;
+    state.pressureCorrection = 0;
     LOG_I("SmartDecrement: Reset");
 }
 
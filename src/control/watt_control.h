@@ -1,7 +1,10 @@
 /**
  * Smart-Column S3 - Watt Control
  * 
- * Автоматическое управление мощностью по давлению в колонне
+ * Автоматическое управление мощностью по давлению в колонне.
+ * Отклик давления на мощность ТЭНа идентифицируется онлайн как звено
+ * первого порядка с запаздыванием, мощность выбирается по прогнозу
+ * модели на горизонте так, чтобы удерживать давление на уставке ниже захлёба.
  */
 
 #ifndef WATT_CONTROL_H
@@ -11,6 +14,20 @@
 #include "config.h"
 #include "types.h"
 
+/**
+ * Идентифицированная модель давления куба:
+ * P[k+1] = a·P[k] + b·u[k-deadSteps] + c  (шаг WATT_CONTROL_PERIOD_MS, u в %)
+ */
+struct WattModel {
+    float a;                        // exp(-Ts/T) - инерционность
+    float b;                        // Усиление (мм рт.ст. на % за шаг)
+    float c;                        // Смещение
+    uint8_t deadSteps;              // Запаздывание (шагов)
+    uint16_t samples;               // Шагов идентификации
+    bool ready;                     // Модель пригодна для прогноза
+    float target;                   // Уставка давления (мм рт.ст.)
+};
+
 namespace WattControl {
     /**
      * Инициализация контроллера
@@ -33,12 +50,26 @@ namespace WattControl {
     void setFloodPressure(float pressure);
     
     /**
-     * Обновление (вызывать в loop)
+     * Сброс модели (начало процесса)
+     * @param startPercent Текущая мощность ТЭНа
+     */
+    void resetModel(uint8_t startPercent);
+
+    /**
+     * Обновление (вызывать в loop во время работы колонны).
+     * Раз в WATT_CONTROL_PERIOD_MS: шаг идентификации и выбор мощности
+     * по прогнозу; между шагами возвращает последнее значение.
+     * Без датчика давления возвращает maxPercent.
      * @param state Состояние системы
-     * @param settings Настройки
+     * @param maxPercent Ограничение мощности (план погона)
      * @return Рекомендуемая мощность 0-100%
      */
-    uint8_t update(const SystemState& state, const Settings& settings);
+    uint8_t update(const SystemState& state, uint8_t maxPercent);
+
+    /**
+     * Текущая модель давления
+     */
+    const WattModel& getModel();
     
     /**
      * Получение рабочей мощности (без override)
@@ -61,7 +92,8 @@ namespace WattControl {
     
     /**
      * Обработка захлёба
-     * Снижает мощность и запускает таймер восстановления
+     * Снижает мощность и удерживает её WATT_FLOOD_HOLD_MS (без блокировки),
+     * уставка давления до конца процесса снижается на WATT_FLOOD_BACKOFF
      */
     void handleFlood();
     
@@ -83,18 +115,23 @@ namespace WattControl {
 
 namespace SmartDecrement {
     /**
-     * Инициализация
+     * Инициализация и запуск насоса (начало отбора тела)
      * @param baseTemp Базовая температура царги (T_base)
+     * @param speedMlH Начальная скорость отбора (мл/ч)
+     * @param heaterKw Мощность ТЭНа (кВт) для минимума и шага скорости
+     * @param pressureHpa Атмосферное давление при фиксации T_base (0 - без поправки)
      */
-    void init(float baseTemp);
+    void init(float baseTemp, float speedMlH, float heaterKw, float pressureHpa);
     
     /**
-     * Обновление (вызывать в loop во время отбора тела)
+     * Обновление (вызывать в loop во время отбора тела).
+     * Превышение T_base - стоп и снижение скорости (×DECREMENT_SPEED_MULT),
+     * стабильный участок DECREMENT_STABLE_SEC - пробное увеличение на шаг.
+     * T царги перед сравнением приводится к давлению начала тела.
      * @param state Состояние системы
-     * @param settings Настройки
      * @return true если нужно перейти в хвосты
      */
-    bool update(SystemState& state, const Settings& settings);
+    bool update(SystemState& state);
     
     /**
      * Проверка условия срабатывания
@@ -103,6 +140,16 @@ namespace SmartDecrement {
      * @return true если нужно снизить скорость
      */
     bool shouldDecrement(float currentTemp, float baseTemp);
+
+    /**
+     * Упреждающее срабатывание по тренду: T уже выше порога возобновления,
+     * значимо растёт и по прогнозу на DECREMENT_FORECAST_SEC превысит порог
+     * срабатывания
+     * @param est Оценка фильтра для верха царги
+     * @param baseTemp Базовая температура
+     * @return true если нужно снизить скорость
+     */
+    bool shouldDecrementByTrend(const TempEstimate& est, float baseTemp);
     
     /**
      * Проверка условия возобновления
@@ -0,0 +1,313 @@
+/**
+ * Smart-Column S3 - Отложенное логирование
+ *
+ * Очередь записей и задача форматирования для макросов LOG_*
+ */
+
+#include "deferred_log.h"
+#include <Arduino.h>
+#include "config.h"
+#include "fs_compat.h"
+#include "mpsc_ring.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Очередь статическая - LOG_* работают ещё до init()
+static MpscRing<DLogRecord, DLOG_RING_SIZE> ring;
+static std::atomic<uint32_t> dropped(0);
+
+static TaskHandle_t logTask = nullptr;
+static DLogSink sinks[DLOG_MAX_SINKS];
+static uint8_t sinkCount = 0;
+static volatile bool fileEnabled = false;
+static File logFile;
+static std::atomic<bool> flushRequested(false);   // flush() ждёт сброса задачей
+
+// ============================================================================
+// Форматирование
+// ============================================================================
+
+/**
+ * Вывод одного аргумента. Модификатор длины берётся из сохранённого
+ * типа, а не из fmt, поэтому несовпадение %d/%ld/%f не читает мусор.
+ */
+static int formatArg(char* out, size_t room, const char* flags, char conv,
+                     const DLogRecord& r, uint8_t index) {
+    char spec[24];
+    const auto& a = r.args[index];
+    uint8_t type = r.types[index];
+    bool isFloatConv = strchr("fFeEgGaA", conv) != nullptr;
+    bool isIntConv = strchr("diouxXc", conv) != nullptr;
+
+    if (conv == 's') {
+        if (type != DLOG_ARG_STR) return snprintf(out, room, "<?>");
+        if (a.u32 >= r.poolUsed) return snprintf(out, room, "...");
+        snprintf(spec, sizeof(spec), "%%%ss", flags);
+        return snprintf(out, room, spec, r.pool + a.u32);
+    }
+
+    if (conv == 'p' || type == DLOG_ARG_PTR) {
+        return snprintf(out, room, "%p", type == DLOG_ARG_PTR ? a.ptr : nullptr);
+    }
+
+    if (type == DLOG_ARG_STR) return snprintf(out, room, "<?>");
+
+    if (isFloatConv) {
+        double v;
+        switch (type) {
+            case DLOG_ARG_I32: v = a.i32; break;
+            case DLOG_ARG_U32: v = a.u32; break;
+            case DLOG_ARG_I64: v = static_cast<double>(a.i64); break;
+            case DLOG_ARG_U64: v = static_cast<double>(a.u64); break;
+            default:           v = a.f64; break;
+        }
+        snprintf(spec, sizeof(spec), "%%%s%c", flags, conv);
+        return snprintf(out, room, spec, v);
+    }
+
+    if (isIntConv) {
+        bool isSigned = (conv == 'd' || conv == 'i');
+        long long v;
+        switch (type) {
+            case DLOG_ARG_I32: v = a.i32; break;
+            case DLOG_ARG_U32: v = a.u32; break;
+            case DLOG_ARG_I64: v = a.i64; break;
+            case DLOG_ARG_U64: v = static_cast<long long>(a.u64); break;
+            default:           v = static_cast<long long>(a.f64); break;
+        }
+        if (conv == 'c') {
+            snprintf(spec, sizeof(spec), "%%%sc", flags);
+            return snprintf(out, room, spec, static_cast<int>(v));
+        }
+        snprintf(spec, sizeof(spec), "%%%sll%c", flags, conv);
+        if (isSigned) return snprintf(out, room, spec, v);
+        // Беззнаковый вывод 32-битного значения без расширения знака
+        unsigned long long u = (type == DLOG_ARG_I32) ? static_cast<uint32_t>(a.i32)
+                                                      : static_cast<unsigned long long>(v);
+        return snprintf(out, room, spec, u);
+    }
+
+    return snprintf(out, room, "<?>");
+}
+
+/**
+ * Форматирование записи: спецификаторы из fmt по очереди
+ * заменяются сохранёнными аргументами
+ */
+static size_t formatRecord(const DLogRecord& r, char* out, size_t size) {
+    static const char levelChar[] = { '?', 'E', 'W', 'I', 'D' };
+
+    size_t used = snprintf(out, size, "[%c] ", levelChar[r.level <= DLOG_LEVEL_D ? r.level : 0]);
+    const char* p = r.fmt;
+    uint8_t argIndex = 0;
+
+    while (*p && used < size - 1) {
+        if (*p != '%') {
+            out[used++] = *p++;
+            continue;
+        }
+
+        if (p[1] == '%') {
+            out[used++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // %[флаги][ширина][.точность][длина]тип - длина отбрасывается
+        char flags[12];
+        size_t flagsLen = 0;
+        p++;
+        while (*p && strchr("-+ #0123456789.hlLzjt", *p)) {
+            if (!strchr("hlLzjt", *p) && flagsLen < sizeof(flags) - 1) {
+                flags[flagsLen++] = *p;
+            }
+            p++;
+        }
+        flags[flagsLen] = '\0';
+        if (!*p) break;
+        char conv = *p++;
+
+        size_t room = size - used;
+        int n;
+        if (argIndex >= r.argc) {
+            n = snprintf(out + used, room, "<?>");
+        } else {
+            n = formatArg(out + used, room, flags, conv, r, argIndex++);
+        }
+
+        if (n > 0) {
+            used += (static_cast<size_t>(n) < room) ? n : room - 1;
+        }
+    }
+
+    if (r.truncated && used + 4 < size) {
+        memcpy(out + used, " ...", 4);
+        used += 4;
+    }
+
+    out[used] = '\0';
+    return used;
+}
+
+// ============================================================================
+// Приёмники
+// ============================================================================
+
+static void serialSink(uint8_t level, uint32_t timeMs, const char* line, size_t len) {
+    (void)level;
+    (void)timeMs;
+    Serial.write(reinterpret_cast<const uint8_t*>(line), len);
+    Serial.write('\n');
+}
+
+static void fileSink(uint8_t level, uint32_t timeMs, const char* line, size_t len) {
+    (void)level;
+    if (!fileEnabled) {
+        if (logFile) logFile.close();
+        return;
+    }
+
+    if (!logFile) {
+        logFile = SPIFFS.open(DLOG_FILE_PATH, FILE_APPEND);
+        if (!logFile) return;
+    }
+
+    if (logFile.size() > DLOG_FILE_MAX_BYTES) {
+        logFile.close();
+        SPIFFS.remove("/logs/debug.old");
+        SPIFFS.rename(DLOG_FILE_PATH, "/logs/debug.old");
+        logFile = SPIFFS.open(DLOG_FILE_PATH, FILE_APPEND);
+        if (!logFile) return;
+    }
+
+    logFile.printf("%lu ", (unsigned long)timeMs);
+    logFile.write(reinterpret_cast<const uint8_t*>(line), len);
+    logFile.write('\n');
+}
+
+static bool drain() {
+    char line[DLOG_LINE_SIZE];
+    bool any = false;
+
+    DLogRecord* r;
+    while ((r = ring.peek()) != nullptr) {
+        size_t len = formatRecord(*r, line, sizeof(line));
+        uint8_t level = r->level;
+        uint32_t timeMs = r->timeMs;
+        ring.release();
+
+        serialSink(level, timeMs, line, len);
+        for (uint8_t i = 0; i < sinkCount; i++) {
+            sinks[i](level, timeMs, line, len);
+        }
+        any = true;
+    }
+
+    return any;
+}
+
+/**
+ * Сброс приёмников: Serial до конца, файл закрыт
+ */
+static void flushSinks() {
+    Serial.flush();
+    if (logFile) logFile.close();
+}
+
+static void logLoop(void* param) {
+    (void)param;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        bool any = drain();
+
+        if (flushRequested.load(std::memory_order_acquire)) {
+            while (drain()) {
+            }
+            flushSinks();
+            flushRequested.store(false, std::memory_order_release);
+        } else if (!any && logFile) {
+            // Пауза в потоке - сбросить файл
+            logFile.flush();
+        }
+    }
+}
+
+// ============================================================================
+// Публичный интерфейс
+// ============================================================================
+
+namespace DeferredLog {
+
+void init() {
+    if (logTask) return;
+
+    addSink(fileSink);
+    xTaskCreatePinnedToCore(logLoop, "dlog", DLOG_TASK_STACK, nullptr,
+                            DLOG_TASK_PRIORITY, &logTask, DLOG_TASK_CORE);
+}
+
+bool addSink(DLogSink sink) {
+    if (sinkCount >= DLOG_MAX_SINKS) return false;
+    sinks[sinkCount++] = sink;
+    return true;
+}
+
+void setFileEnabled(bool enabled) {
+    fileEnabled = enabled;
+    LOG_I("DeferredLog: File %s %s", DLOG_FILE_PATH, enabled ? "enabled" : "disabled");
+}
+
+bool isFileEnabled() {
+    return fileEnabled;
+}
+
+bool flush(uint32_t timeoutMs) {
+    // Задачи нет - очередь разбирает вызывающая задача (единственный потребитель)
+    if (!logTask) {
+        drain();
+        flushSinks();
+        return true;
+    }
+
+    // Потребитель очереди и владелец Serial/файла - только задача логгера:
+    // остановка посреди записи дала бы повтор записи или взаимоблокировку
+    flushRequested.store(true, std::memory_order_release);
+    xTaskNotifyGive(logTask);
+
+    uint32_t start = millis();
+    while (flushRequested.load(std::memory_order_acquire)) {
+        if (millis() - start >= timeoutMs) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return true;
+}
+
+uint32_t getDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+DLogRecord* begin(uint8_t level, const char* fmt, uint32_t& pos) {
+    DLogRecord* r = ring.acquire(pos);
+    if (!r) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    r->timeMs = millis();
+    r->fmt = fmt;
+    r->level = level;
+    r->argc = 0;
+    r->poolUsed = 0;
+    r->truncated = 0;
+    return r;
+}
+
+void commit(uint32_t pos) {
+    ring.publish(pos);
+    if (logTask) xTaskNotifyGive(logTask);
+}
+
+} // namespace DeferredLog
@@ -6,6 +6,7 @@
  */
 
 #include "heater.h"
+#include "../hal/hal.h"
 
 // =============================================================================
 // ГЛОБАЛЬНЫЕ ПЕРЕМЕННЫЕ
@@ -27,11 +28,11 @@ void init() {
     LOG_I("Heater: Initializing...");
 
     // Настройка LEDC ШИМ
-    ledcSetup(LEDC_CHANNEL_HEATER, PWM_FREQ_HEATER, PWM_RESOLUTION);
-    ledcAttachPin(PIN_SSR_HEATER, LEDC_CHANNEL_HEATER);
+    Hal::pwmSetup(LEDC_CHANNEL_HEATER, PWM_FREQ_HEATER, PWM_RESOLUTION);
+    Hal::pwmAttach(PIN_SSR_HEATER, LEDC_CHANNEL_HEATER);
 
     // Начальное состояние - выключено
-    ledcWrite(LEDC_CHANNEL_HEATER, 0);
+    Hal::pwmWrite(LEDC_CHANNEL_HEATER, 0);
     currentPower = 0;
 
     LOG_I("Heater: Init complete (PWM %d Hz, %d-bit)",
@@ -47,7 +48,7 @@ void setPower(uint8_t percent) {
 
     // Преобразовать проценты в ШИМ (0-255)
     uint8_t duty = map(percent, 0, 100, 0, 255);
-    ledcWrite(LEDC_CHANNEL_HEATER, duty);
+    Hal::pwmWrite(LEDC_CHANNEL_HEATER, duty);
 
     LOG_D("Heater: Power set to %d%% (duty=%d)", percent, duty);
 }
@@ -58,7 +59,7 @@ uint8_t getPower() {
 
 void emergencyStop() {
     LOG_I("Heater: EMERGENCY STOP!");
-    ledcWrite(LEDC_CHANNEL_HEATER, 0);
+    Hal::pwmWrite(LEDC_CHANNEL_HEATER, 0);
     currentPower = 0;
     targetPower = 0;
     ramping = false;
@@ -71,7 +72,7 @@ void rampTo(uint8_t targetPercent, uint32_t rampTimeMs) {
           currentPower, targetPercent, rampTimeMs);
 
     targetPower = targetPercent;
-    rampStartTime = millis();
+    rampStartTime = Hal::millis();
     rampDuration = rampTimeMs;
     ramping = true;
 
@@ -104,7 +105,7 @@ bool checkHealth(float actualPower) {
 void update() {
     if (!ramping) return;
 
-    uint32_t elapsed = millis() - rampStartTime;
+    uint32_t elapsed = Hal::millis() - rampStartTime;
 
     if (elapsed >= rampDuration) {
         // Разгон завершён
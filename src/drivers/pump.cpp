@@ -6,6 +6,7 @@
  */
 
 #include "pump.h"
+#include "../hal/hal.h"
 #include <AccelStepper.h>
 
 // =============================================================================
@@ -71,8 +72,8 @@ void init() {
     LOG_I("Pump: Initializing...");
 
     // Пины управления
-    pinMode(PIN_PUMP_EN, OUTPUT);
-    digitalWrite(PIN_PUMP_EN, HIGH); // Отключено (TMC2209: EN активен LOW)
+    Hal::gpioMode(PIN_PUMP_EN, OUTPUT);
+    Hal::gpioWrite(PIN_PUMP_EN, HIGH); // Отключено (TMC2209: EN активен LOW)
 
     // Настройка AccelStepper
     stepper.setMaxSpeed(PUMP_MAX_SPEED);
@@ -94,7 +95,7 @@ void start(float mlPerHour) {
     }
 
     // Включить драйвер
-    digitalWrite(PIN_PUMP_EN, LOW);
+    Hal::gpioWrite(PIN_PUMP_EN, LOW);
 
     // Установить скорость
     float stepsPerSec = mlPerHourToStepsPerSec(mlPerHour);
@@ -116,7 +117,7 @@ void start(float mlPerHour) {
 void stop() {
     stepper.setSpeed(0);
     stepper.stop();
-    digitalWrite(PIN_PUMP_EN, HIGH); // Отключить драйвер
+    Hal::gpioWrite(PIN_PUMP_EN, HIGH); // Отключить драйвер
     running = false;
     currentSpeedMlH = 0;
 
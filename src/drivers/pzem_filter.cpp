@@ -0,0 +1,141 @@
+/**
+ * Smart-Column S3 - Фильтр показаний PZEM-004T
+ */
+
+#include "pzem_filter.h"
+
+// Пороги для определения выбросов (допустимое изменение за одно чтение)
+#define PZEM_VOLTAGE_MAX_DELTA    30.0f   // ±30V за раз
+#define PZEM_CURRENT_MAX_DELTA    5.0f    // ±5A за раз
+#define PZEM_POWER_MAX_DELTA      1000.0f // ±1000W за раз
+
+// Защита от переполнения energy (PZEM может сбросить счётчик)
+static float lastEnergyReading = 0.0f;
+static float energyOffset = 0.0f;        // Накопленная энергия от предыдущих сбросов
+static bool energyInitialized = false;
+
+// Фильтрация выбросов PZEM (spike rejection)
+static float lastValidVoltage = 0.0f;
+static float lastValidCurrent = 0.0f;
+static float lastValidPower = 0.0f;
+static bool pzemDataInitialized = false;
+
+// Счётчик для мониторинга здоровья
+static uint16_t pzemSpikeCounter = 0;
+
+/**
+ * Фильтрация выброса (spike rejection)
+ * Возвращает true если значение адекватное, false если выброс
+ */
+static bool validateReading(float newValue, float lastValue, float maxDelta, bool initialized) {
+    if (!initialized) {
+        return true; // Первое чтение - принимаем
+    }
+
+    float delta = fabs(newValue - lastValue);
+    return (delta <= maxDelta);
+}
+
+namespace PzemFilter {
+
+void reset() {
+    lastEnergyReading = 0.0f;
+    energyOffset = 0.0f;
+    energyInitialized = false;
+    lastValidVoltage = 0.0f;
+    lastValidCurrent = 0.0f;
+    lastValidPower = 0.0f;
+    pzemDataInitialized = false;
+    pzemSpikeCounter = 0;
+}
+
+void apply(const PzemReading& raw, Power& power) {
+    float rawVoltage = raw.voltage;
+    float rawCurrent = raw.current;
+    float rawPower = raw.power;
+    float rawEnergy = raw.energy;
+
+    // Проверка на NaN и базовые диапазоны
+    if (isnan(rawVoltage) || rawVoltage < 0 || rawVoltage > 300) {
+        rawVoltage = lastValidVoltage;
+    }
+    if (isnan(rawCurrent) || rawCurrent < 0 || rawCurrent > PZEM_CURRENT_MAX) {
+        rawCurrent = lastValidCurrent;
+    }
+    if (isnan(rawPower) || rawPower < 0 || rawPower > 10000) {
+        rawPower = lastValidPower;
+    }
+
+    // Фильтрация выбросов (spike rejection)
+    if (validateReading(rawVoltage, lastValidVoltage, PZEM_VOLTAGE_MAX_DELTA, pzemDataInitialized)) {
+        power.voltage = rawVoltage;
+        lastValidVoltage = rawVoltage;
+    } else {
+        power.voltage = lastValidVoltage; // Отбросить выброс
+        pzemSpikeCounter++;
+        LOG_WARN("PZEM: Voltage spike rejected (%.1fV -> %.1fV)", lastValidVoltage, rawVoltage);
+    }
+
+    if (validateReading(rawCurrent, lastValidCurrent, PZEM_CURRENT_MAX_DELTA, pzemDataInitialized)) {
+        power.current = rawCurrent;
+        lastValidCurrent = rawCurrent;
+    } else {
+        power.current = lastValidCurrent; // Отбросить выброс
+        pzemSpikeCounter++;
+        LOG_WARN("PZEM: Current spike rejected (%.2fA -> %.2fA)", lastValidCurrent, rawCurrent);
+    }
+
+    if (validateReading(rawPower, lastValidPower, PZEM_POWER_MAX_DELTA, pzemDataInitialized)) {
+        power.power = rawPower;
+        lastValidPower = rawPower;
+    } else {
+        power.power = lastValidPower; // Отбросить выброс
+        pzemSpikeCounter++;
+        LOG_WARN("PZEM: Power spike rejected (%.1fW -> %.1fW)", lastValidPower, rawPower);
+    }
+
+    // Частота и PF (без фильтрации, но с валидацией)
+    if (isnan(raw.frequency) || raw.frequency < 45 || raw.frequency > 65) {
+        power.frequency = 50; // По умолчанию 50 Гц
+    } else {
+        power.frequency = raw.frequency;
+    }
+
+    if (isnan(raw.powerFactor) || raw.powerFactor < 0 || raw.powerFactor > 1) {
+        power.powerFactor = 0;
+    } else {
+        power.powerFactor = raw.powerFactor;
+    }
+
+    // Отметить как инициализированные
+    pzemDataInitialized = true;
+
+    // Обработка energy с защитой от переполнения/сброса
+    if (isnan(rawEnergy) || rawEnergy < 0) {
+        rawEnergy = 0;
+    }
+
+    if (!energyInitialized) {
+        // Первое чтение - инициализация
+        lastEnergyReading = rawEnergy;
+        energyOffset = 0;
+        energyInitialized = true;
+    } else {
+        // Проверка на сброс счётчика (значение уменьшилось)
+        if (rawEnergy < lastEnergyReading - 0.01f) {  // -0.01 для защиты от флуктуаций
+            // Счётчик был сброшен - сохраняем предыдущее значение
+            energyOffset += lastEnergyReading;
+            LOG_WARN("Sensors: PZEM energy counter reset detected (was %.3f kWh)", lastEnergyReading);
+        }
+        lastEnergyReading = rawEnergy;
+    }
+
+    // Итоговая энергия = offset + текущее показание
+    power.energy = energyOffset + rawEnergy;
+}
+
+uint16_t getSpikeCount() {
+    return pzemSpikeCounter;
+}
+
+} // namespace PzemFilter
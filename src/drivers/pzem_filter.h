@@ -0,0 +1,47 @@
+/**
+ * Smart-Column S3 - PZEM Filter
+ *
+ * Проверка показаний PZEM-004T: диапазоны, выбросы между соседними
+ * чтениями, сброс счётчика энергии. Отдельно от драйвера - без UART
+ * и библиотеки PZEM, собирается в бенчмарке на ПК.
+ */
+
+#ifndef PZEM_FILTER_H
+#define PZEM_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+/**
+ * Сырые показания PZEM (NaN - нет ответа)
+ */
+struct PzemReading {
+    float voltage;                  // В
+    float current;                  // А
+    float power;                    // Вт
+    float energy;                   // кВт·ч (счётчик PZEM)
+    float frequency;                // Гц
+    float powerFactor;
+};
+
+namespace PzemFilter {
+    /**
+     * Сброс истории (следующее чтение принимается как есть)
+     */
+    void reset();
+
+    /**
+     * Фильтрация показаний
+     * @param raw Сырые показания
+     * @param power Результат (кроме lastUpdate)
+     */
+    void apply(const PzemReading& raw, Power& power);
+
+    /**
+     * Отброшено выбросов с запуска
+     */
+    uint16_t getSpikeCount();
+}
+
+#endif // PZEM_FILTER_H
@@ -10,6 +10,8 @@
  */
 
 #include "sensors.h"
+#include "pzem_filter.h"
+#include "../hal/hal.h"
 #include <OneWire.h>
 #include <DallasTemperature.h>
 #include <Adafruit_BMP280.h>
@@ -36,28 +38,10 @@ static Adafruit_ADS1115 ads1115;
 static bool ads_ok = false;
 
 // PZEM-004T v3.0 (измеритель мощности)
-static HardwareSerial pzemSerial(PZEM_UART_NUM);
-static PZEM004Tv30 pzem(pzemSerial, PIN_PZEM_RX, PIN_PZEM_TX);
+static PZEM004Tv30 pzem(Hal::uartSerial(PZEM_UART_NUM), PIN_PZEM_RX, PIN_PZEM_TX);
 static bool pzem_ok = false;
 
-// Защита от переполнения energy (PZEM может сбросить счётчик)
-static float lastEnergyReading = 0.0f;
-static float energyOffset = 0.0f;        // Накопленная энергия от предыдущих сбросов
-static bool energyInitialized = false;
-
-// Фильтрация выбросов PZEM (spike rejection)
-static float lastValidVoltage = 0.0f;
-static float lastValidCurrent = 0.0f;
-static float lastValidPower = 0.0f;
-static bool pzemDataInitialized = false;
-
-// Пороги для определения выбросов (допустимое изменение за одно чтение)
-#define PZEM_VOLTAGE_MAX_DELTA    30.0f   // ±30V за раз
-#define PZEM_CURRENT_MAX_DELTA    5.0f    // ±5A за раз
-#define PZEM_POWER_MAX_DELTA      1000.0f // ±1000W за раз
-
 // Счётчики для мониторинга здоровья
-static uint16_t pzemSpikeCounter = 0;
 static uint16_t tempReadErrorCounter = 0;
 
 // Калибровка
@@ -89,19 +73,6 @@ void IRAM_ATTR flowPulseISR() {
 // ВНУТРЕННИЕ ФУНКЦИИ
 // =============================================================================
 
-/**
- * Фильтрация выброса (spike rejection)
- * Возвращает true если значение адекватное, false если выброс
- */
-static bool validateReading(float newValue, float lastValue, float maxDelta, bool initialized) {
-    if (!initialized) {
-        return true; // Первое чтение - принимаем
-    }
-
-    float delta = fabs(newValue - lastValue);
-    return (delta <= maxDelta);
-}
-
 /**
  * Интерполяция крепости по таблице калибровки
  */
@@ -141,7 +112,7 @@ void init() {
     LOG_I("Sensors: Initializing...");
 
     // Инициализация I2C
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+    Hal::i2cBegin(PIN_I2C_SDA, PIN_I2C_SCL, I2C_FREQ_HZ);
 
     // DS18B20
     ds18b20.begin();
@@ -198,8 +169,8 @@ void init() {
     }
 
     // PZEM-004T v3.0
-    pzemSerial.begin(PZEM_BAUD_RATE, SERIAL_8N1, PIN_PZEM_RX, PIN_PZEM_TX);
-    delay(100); // Даём время на инициализацию
+    Hal::uartBegin(PZEM_UART_NUM, PZEM_BAUD_RATE, PIN_PZEM_RX, PIN_PZEM_TX);
+    Hal::delayMs(100); // Даём время на инициализацию
 
     // Проверка связи с PZEM (3 попытки для надёжности)
     pzem_ok = false;
@@ -225,7 +196,7 @@ void init() {
 
         // Пауза перед следующей попыткой
         if (attempt < 2) {
-            delay(200);
+            Hal::delayMs(200);
         }
     }
 
@@ -234,8 +205,8 @@ void init() {
     }
 
     // Датчик потока воды
-    pinMode(PIN_FLOW_SENSOR, INPUT_PULLUP);
-    attachInterrupt(digitalPinToInterrupt(PIN_FLOW_SENSOR), flowPulseISR, RISING);
+    Hal::gpioMode(PIN_FLOW_SENSOR, INPUT_PULLUP);
+    Hal::gpioInterrupt(PIN_FLOW_SENSOR, flowPulseISR, RISING);
 
     // Обнулить калибровку
     memset(&tempCal, 0, sizeof(tempCal));
@@ -244,7 +215,7 @@ void init() {
 }
 
 void readTemperatures(Temperatures& temps) {
-    uint32_t now = millis();
+    uint32_t now = Hal::millis();
 
     // Фаза 1: Запуск конвертации (неблокирующий)
     if (!conversionInProgress) {
@@ -322,7 +293,7 @@ void readPressure(Pressure& pressure) {
         pressure.cube = 0;
     }
 
-    pressure.lastUpdate = millis();
+    pressure.lastUpdate = Hal::millis();
 }
 
 void readHydrometer(Hydrometer& hydro, float temperature) {
@@ -354,7 +325,7 @@ void readHydrometer(Hydrometer& hydro, float temperature) {
 
     // Валидация
     hydro.valid = (hydro.density > 0.7f && hydro.density < 1.1f);
-    hydro.lastUpdate = millis();
+    hydro.lastUpdate = Hal::millis();
 }
 
 void readPower(Power& power) {
@@ -366,101 +337,27 @@ void readPower(Power& power) {
         power.energy = 0;
         power.frequency = 0;
         power.powerFactor = 0;
-        power.lastUpdate = millis();
+        power.lastUpdate = Hal::millis();
         return;
     }
 
     // Читаем все параметры с PZEM-004T
-    float rawVoltage = pzem.voltage();
-    float rawCurrent = pzem.current();
-    float rawPower = pzem.power();
-    float rawEnergy = pzem.energy();
-    float rawFrequency = pzem.frequency();
-    float rawPF = pzem.pf();
-
-    // Проверка на NaN и базовые диапазоны
-    if (isnan(rawVoltage) || rawVoltage < 0 || rawVoltage > 300) {
-        rawVoltage = lastValidVoltage;
-    }
-    if (isnan(rawCurrent) || rawCurrent < 0 || rawCurrent > PZEM_CURRENT_MAX) {
-        rawCurrent = lastValidCurrent;
-    }
-    if (isnan(rawPower) || rawPower < 0 || rawPower > 10000) {
-        rawPower = lastValidPower;
-    }
-
-    // Фильтрация выбросов (spike rejection)
-    if (validateReading(rawVoltage, lastValidVoltage, PZEM_VOLTAGE_MAX_DELTA, pzemDataInitialized)) {
-        power.voltage = rawVoltage;
-        lastValidVoltage = rawVoltage;
-    } else {
-        power.voltage = lastValidVoltage; // Отбросить выброс
-        pzemSpikeCounter++;
-        LOG_WARN("PZEM: Voltage spike rejected (%.1fV -> %.1fV)", lastValidVoltage, rawVoltage);
-    }
-
-    if (validateReading(rawCurrent, lastValidCurrent, PZEM_CURRENT_MAX_DELTA, pzemDataInitialized)) {
-        power.current = rawCurrent;
-        lastValidCurrent = rawCurrent;
-    } else {
-        power.current = lastValidCurrent; // Отбросить выброс
-        pzemSpikeCounter++;
-        LOG_WARN("PZEM: Current spike rejected (%.2fA -> %.2fA)", lastValidCurrent, rawCurrent);
-    }
-
-    if (validateReading(rawPower, lastValidPower, PZEM_POWER_MAX_DELTA, pzemDataInitialized)) {
-        power.power = rawPower;
-        lastValidPower = rawPower;
-    } else {
-        power.power = lastValidPower; // Отбросить выброс
-        pzemSpikeCounter++;
-        LOG_WARN("PZEM: Power spike rejected (%.1fW -> %.1fW)", lastValidPower, rawPower);
-    }
-
-    // Частота и PF (без фильтрации, но с валидацией)
-    if (isnan(rawFrequency) || rawFrequency < 45 || rawFrequency > 65) {
-        power.frequency = 50; // По умолчанию 50 Гц
-    } else {
-        power.frequency = rawFrequency;
-    }
-
-    if (isnan(rawPF) || rawPF < 0 || rawPF > 1) {
-        power.powerFactor = 0;
-    } else {
-        power.powerFactor = rawPF;
-    }
-
-    // Отметить как инициализированные
-    pzemDataInitialized = true;
-
-    // Обработка energy с защитой от переполнения/сброса
-    if (isnan(rawEnergy) || rawEnergy < 0) {
-        rawEnergy = 0;
-    }
-
-    if (!energyInitialized) {
-        // Первое чтение - инициализация
-        lastEnergyReading = rawEnergy;
-        energyOffset = 0;
-        energyInitialized = true;
-    } else {
-        // Проверка на сброс счётчика (значение уменьшилось)
-        if (rawEnergy < lastEnergyReading - 0.01f) {  // -0.01 для защиты от флуктуаций
-            // Счётчик был сброшен - сохраняем предыдущее значение
-            energyOffset += lastEnergyReading;
-            LOG_WARN("Sensors: PZEM energy counter reset detected (was %.3f kWh)", lastEnergyReading);
-        }
-        lastEnergyReading = rawEnergy;
-    }
-
-    // Итоговая энергия = offset + текущее показание
-    power.energy = energyOffset + rawEnergy;
-
-    power.lastUpdate = millis();
+    PzemReading raw;
+    raw.voltage = pzem.voltage();
+    raw.current = pzem.current();
+    raw.power = pzem.power();
+    raw.energy = pzem.energy();
+    raw.frequency = pzem.frequency();
+    raw.powerFactor = pzem.pf();
+
+    // Диапазоны, выбросы и сброс счётчика энергии
+    PzemFilter::apply(raw, power);
+
+    power.lastUpdate = Hal::millis();
 }
 
 void readWaterFlow(WaterFlow& flow) {
-    uint32_t now = millis();
+    uint32_t now = Hal::millis();
     uint32_t elapsed = now - lastFlowCheck;
 
     if (elapsed >= 1000) { // Обновляем раз в секунду
@@ -486,7 +383,7 @@ void readWaterFlow(WaterFlow& flow) {
         lastFlowCheck = now;
     }
 
-    flow.lastPulse = millis();
+    flow.lastPulse = Hal::millis();
 }
 
 void applyCalibration(const TempCalibration& cal) {
@@ -539,7 +436,7 @@ void updateHealth(SystemHealth& health) {
     health.pzemOk = pzem_ok;
 
     // Счётчики ошибок
-    health.pzemSpikeCount = pzemSpikeCounter;
+    health.pzemSpikeCount = PzemFilter::getSpikeCount();
     health.tempReadErrors = tempReadErrorCounter;
 
     // WiFi
@@ -547,7 +444,7 @@ void updateHealth(SystemHealth& health) {
     health.wifiRSSI = WiFi.RSSI();
 
     // Системная информация
-    health.uptime = millis() / 1000;
+    health.uptime = Hal::millis() / 1000;
     health.freeHeap = ESP.getFreeHeap();
     health.cpuTemp = (uint8_t)temperatureRead(); // ESP32-S3 internal temp sensor
 
@@ -577,7 +474,7 @@ void updateHealth(SystemHealth& health) {
     if (score < 0) score = 0;
     health.overallHealth = score;
 
-    health.lastUpdate = millis();
+    health.lastUpdate = Hal::millis();
 }
 
 } // namespace Sensors
@@ -7,6 +7,7 @@
  */
 
 #include "valves.h"
+#include "../hal/hal.h"
 #include <ESP32Servo.h>
 
 // =============================================================================
@@ -47,19 +48,19 @@ void init() {
     LOG_I("Valves: Initializing...");
 
     // Настройка пинов клапанов (активный HIGH для открытия)
-    pinMode(PIN_VALVE_WATER, OUTPUT);
-    pinMode(PIN_VALVE_HEADS, OUTPUT);
-    pinMode(PIN_VALVE_UNO, OUTPUT);
+    Hal::gpioMode(PIN_VALVE_WATER, OUTPUT);
+    Hal::gpioMode(PIN_VALVE_HEADS, OUTPUT);
+    Hal::gpioMode(PIN_VALVE_UNO, OUTPUT);
 
     // Начальное состояние - все закрыты
-    digitalWrite(PIN_VALVE_WATER, LOW);
-    digitalWrite(PIN_VALVE_HEADS, LOW);
-    digitalWrite(PIN_VALVE_UNO, LOW);
+    Hal::gpioWrite(PIN_VALVE_WATER, LOW);
+    Hal::gpioWrite(PIN_VALVE_HEADS, LOW);
+    Hal::gpioWrite(PIN_VALVE_UNO, LOW);
 
     // Настройка ШИМ для клапана старт-стоп
-    ledcSetup(LEDC_CHANNEL_VALVE, PWM_FREQ_VALVE, PWM_RESOLUTION);
-    ledcAttachPin(PIN_VALVE_STARTSTOP, LEDC_CHANNEL_VALVE);
-    ledcWrite(LEDC_CHANNEL_VALVE, 0);
+    Hal::pwmSetup(LEDC_CHANNEL_VALVE, PWM_FREQ_VALVE, PWM_RESOLUTION);
+    Hal::pwmAttach(PIN_VALVE_STARTSTOP, LEDC_CHANNEL_VALVE);
+    Hal::pwmWrite(LEDC_CHANNEL_VALVE, 0);
 
     LOG_I("Valves: Init complete");
 }
@@ -86,7 +87,7 @@ void initFractionator() {
     LOG_I("Valves: Fractionator ready (angle=%d)", currentAngle);
 
     // Пауза для установки серво
-    delay(SERVO_MOVE_DELAY_MS);
+    Hal::delayMs(SERVO_MOVE_DELAY_MS);
 }
 
 // =========================================================================
@@ -94,7 +95,7 @@ void initFractionator() {
 // =========================================================================
 
 void setWater(bool open) {
-    digitalWrite(PIN_VALVE_WATER, open ? HIGH : LOW);
+    Hal::gpioWrite(PIN_VALVE_WATER, open ? HIGH : LOW);
     valveWater = open;
     LOG_D("Valves: Water %s", open ? "OPEN" : "CLOSED");
 }
@@ -104,7 +105,7 @@ bool getWater() {
 }
 
 void setHeads(bool open) {
-    digitalWrite(PIN_VALVE_HEADS, open ? HIGH : LOW);
+    Hal::gpioWrite(PIN_VALVE_HEADS, open ? HIGH : LOW);
     valveHeads = open;
     LOG_D("Valves: Heads %s", open ? "OPEN" : "CLOSED");
 }
@@ -114,7 +115,7 @@ bool getHeads() {
 }
 
 void setUno(bool open) {
-    digitalWrite(PIN_VALVE_UNO, open ? HIGH : LOW);
+    Hal::gpioWrite(PIN_VALVE_UNO, open ? HIGH : LOW);
     valveUno = open;
     LOG_D("Valves: UNO %s", open ? "OPEN" : "CLOSED");
 }
@@ -124,7 +125,7 @@ bool getUno() {
 }
 
 void setStartStop(uint8_t duty) {
-    ledcWrite(LEDC_CHANNEL_VALVE, duty);
+    Hal::pwmWrite(LEDC_CHANNEL_VALVE, duty);
     valveStartStopDuty = duty;
     LOG_D("Valves: StartStop PWM=%d", duty);
 }
@@ -164,7 +165,7 @@ void setFraction(Fraction fraction, bool smooth) {
         int8_t step = (targetAngle > currentAngle) ? 1 : -1;
         for (int angle = currentAngle; angle != targetAngle; angle += step) {
             fractionatorServo.write(angle);
-            delay(15); // ~1 секунда на 60 градусов
+            Hal::delayMs(15); // ~1 секунда на 60 градусов
         }
     }
 
@@ -183,7 +184,7 @@ void setFraction(Fraction fraction, bool smooth) {
     LOG_I("Valves: Fractionator → %s (angle=%d)", names[idx], targetAngle);
 
     // Пауза для стабилизации
-    delay(SERVO_MOVE_DELAY_MS);
+    Hal::delayMs(SERVO_MOVE_DELAY_MS);
 }
 
 void setFractionAngle(uint8_t angle) {
@@ -235,7 +236,7 @@ void nextFraction(const FractionatorSettings& settings) {
 void updateUno(UnoParams& params) {
     if (!params.enabled) return;
 
-    uint32_t now = millis();
+    uint32_t now = Hal::millis();
     uint32_t elapsed = now - params.lastToggle;
 
     if (params.state) {
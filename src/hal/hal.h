@@ -0,0 +1,128 @@
+/**
+ * Smart-Column S3 - Hardware Abstraction Layer
+ *
+ * Тонкий слой между кодом управления/драйверами и железом: часы, GPIO,
+ * ШИМ (LEDC), UART и I2C. На ESP32 - обёртки над arduino-esp32
+ * (hal_esp32.cpp), на ПК - виртуальные часы и записанные состояния
+ * выводов (hal_host.cpp) для симулятора и бенчмарка.
+ *
+ * Режимы выводов и фронты прерываний - константы Arduino
+ * (OUTPUT, INPUT_PULLUP, RISING...).
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+
+namespace Hal {
+    // =========================================================================
+    // ЧАСЫ
+    // =========================================================================
+
+    /**
+     * Миллисекунды с запуска
+     */
+    uint32_t millis();
+
+    /**
+     * Микросекунды с запуска
+     */
+    uint32_t micros();
+
+    /**
+     * Блокирующая пауза (на ПК - сдвиг виртуальных часов)
+     */
+    void delayMs(uint32_t ms);
+
+    // =========================================================================
+    // GPIO
+    // =========================================================================
+
+    void gpioMode(uint8_t pin, uint8_t mode);
+    void gpioWrite(uint8_t pin, uint8_t level);
+    uint8_t gpioRead(uint8_t pin);
+
+    /**
+     * Обработчик прерывания по фронту
+     * @param mode RISING, FALLING или CHANGE
+     */
+    void gpioInterrupt(uint8_t pin, void (*isr)(), uint8_t mode);
+
+    // =========================================================================
+    // ШИМ (LEDC)
+    // =========================================================================
+
+    void pwmSetup(uint8_t channel, uint32_t freqHz, uint8_t resolutionBits);
+    void pwmAttach(uint8_t pin, uint8_t channel);
+    void pwmWrite(uint8_t channel, uint32_t duty);
+
+    // =========================================================================
+    // UART
+    // =========================================================================
+
+    /**
+     * Запуск порта 8N1
+     * @param port Номер UART
+     * @param rxPin, txPin Выводы (-1 - по умолчанию)
+     */
+    bool uartBegin(uint8_t port, uint32_t baud, int8_t rxPin, int8_t txPin);
+    size_t uartWrite(uint8_t port, const uint8_t* data, size_t len);
+    size_t uartRead(uint8_t port, uint8_t* buffer, size_t len);
+    int uartAvailable(uint8_t port);
+
+    // =========================================================================
+    // I2C
+    // =========================================================================
+
+    bool i2cBegin(uint8_t sdaPin, uint8_t sclPin, uint32_t freqHz);
+
+    /**
+     * Запись в устройство
+     * @return false если устройство не ответило (NACK)
+     */
+    bool i2cWrite(uint8_t address, const uint8_t* data, size_t len);
+
+    /**
+     * Чтение из устройства
+     * @return Прочитано байт
+     */
+    size_t i2cRead(uint8_t address, uint8_t* buffer, size_t len);
+
+#ifdef SIM_NATIVE
+    // =========================================================================
+    // ПК: управление и наблюдение
+    // =========================================================================
+
+    namespace Host {
+        /**
+         * Сдвиг виртуальных часов
+         */
+        void advance(uint32_t ms);
+
+        /**
+         * Последнее записанное состояние вывода / скважность канала
+         */
+        uint8_t pinLevel(uint8_t pin);
+        uint32_t pwmDuty(uint8_t channel);
+
+        /**
+         * Данные в приёмник UART (ответ устройства)
+         */
+        void uartFeed(uint8_t port, const uint8_t* data, size_t len);
+
+        /**
+         * Вызов обработчика прерывания вывода
+         */
+        void gpioPulse(uint8_t pin);
+    }
+#else
+    /**
+     * Объекты шин для библиотек датчиков (PZEM, Adafruit), которые
+     * принимают порт Arduino
+     */
+    HardwareSerial& uartSerial(uint8_t port);
+#endif
+}
+
+#endif // HAL_H
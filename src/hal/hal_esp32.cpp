@@ -0,0 +1,116 @@
+/**
+ * Smart-Column S3 - HAL для ESP32
+ *
+ * Обёртки над arduino-esp32: LEDC, HardwareSerial, Wire
+ */
+
+#include "hal.h"
+#include <Wire.h>
+
+namespace Hal {
+
+// =============================================================================
+// ЧАСЫ
+// =============================================================================
+
+uint32_t millis() {
+    return ::millis();
+}
+
+uint32_t micros() {
+    return ::micros();
+}
+
+void delayMs(uint32_t ms) {
+    ::delay(ms);
+}
+
+// =============================================================================
+// GPIO
+// =============================================================================
+
+void gpioMode(uint8_t pin, uint8_t mode) {
+    ::pinMode(pin, mode);
+}
+
+void gpioWrite(uint8_t pin, uint8_t level) {
+    ::digitalWrite(pin, level);
+}
+
+uint8_t gpioRead(uint8_t pin) {
+    return ::digitalRead(pin);
+}
+
+void gpioInterrupt(uint8_t pin, void (*isr)(), uint8_t mode) {
+    ::attachInterrupt(digitalPinToInterrupt(pin), isr, mode);
+}
+
+// =============================================================================
+// ШИМ
+// =============================================================================
+
+void pwmSetup(uint8_t channel, uint32_t freqHz, uint8_t resolutionBits) {
+    ::ledcSetup(channel, freqHz, resolutionBits);
+}
+
+void pwmAttach(uint8_t pin, uint8_t channel) {
+    ::ledcAttachPin(pin, channel);
+}
+
+void pwmWrite(uint8_t channel, uint32_t duty) {
+    ::ledcWrite(channel, duty);
+}
+
+// =============================================================================
+// UART
+// =============================================================================
+
+HardwareSerial& uartSerial(uint8_t port) {
+    static HardwareSerial uart0(0);
+    static HardwareSerial uart1(1);
+    static HardwareSerial uart2(2);
+
+    switch (port) {
+        case 1:  return uart1;
+        case 2:  return uart2;
+        default: return uart0;
+    }
+}
+
+bool uartBegin(uint8_t port, uint32_t baud, int8_t rxPin, int8_t txPin) {
+    uartSerial(port).begin(baud, SERIAL_8N1, rxPin, txPin);
+    return true;
+}
+
+size_t uartWrite(uint8_t port, const uint8_t* data, size_t len) {
+    return uartSerial(port).write(data, len);
+}
+
+size_t uartRead(uint8_t port, uint8_t* buffer, size_t len) {
+    return uartSerial(port).readBytes(buffer, len);
+}
+
+int uartAvailable(uint8_t port) {
+    return uartSerial(port).available();
+}
+
+// =============================================================================
+// I2C
+// =============================================================================
+
+bool i2cBegin(uint8_t sdaPin, uint8_t sclPin, uint32_t freqHz) {
+    return Wire.begin(sdaPin, sclPin, freqHz);
+}
+
+bool i2cWrite(uint8_t address, const uint8_t* data, size_t len) {
+    Wire.beginTransmission(address);
+    Wire.write(data, len);
+    return Wire.endTransmission() == 0;
+}
+
+size_t i2cRead(uint8_t address, uint8_t* buffer, size_t len) {
+    size_t received = Wire.requestFrom(address, (uint8_t)len);
+    return Wire.readBytes(buffer, received);
+}
+
+} // namespace Hal
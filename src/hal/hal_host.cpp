@@ -0,0 +1,175 @@
+/**
+ * Smart-Column S3 - HAL для ПК
+ *
+ * Виртуальные часы (двигает симулятор или бенчмарк), состояния выводов
+ * и каналов ШИМ записываются для проверки, UART - очереди в памяти,
+ * на шине I2C устройств нет. Здесь же ядро Arduino для shim:
+ * millis()/delay(), Serial и LittleFS.
+ */
+
+#include "hal.h"
+#include <LittleFS.h>
+#include <deque>
+
+#define HOST_PINS           49      // GPIO0..48 ESP32-S3
+#define HOST_PWM_CHANNELS   8
+#define HOST_UARTS          3
+
+static uint32_t nowMs = 0;
+
+static uint8_t pinLevels[HOST_PINS];
+static void (*pinIsr[HOST_PINS])();
+static uint32_t pwmDuties[HOST_PWM_CHANNELS];
+static std::deque<uint8_t> uartRx[HOST_UARTS];
+
+SimSerial Serial;
+LittleFSFS LittleFS;
+
+// =============================================================================
+// ЯДРО ARDUINO (shim)
+// =============================================================================
+
+uint32_t millis() {
+    return nowMs;
+}
+
+uint32_t micros() {
+    return nowMs * 1000UL;
+}
+
+void delay(uint32_t ms) {
+    nowMs += ms;
+}
+
+void yield() {
+}
+
+size_t SimSerial::write(uint8_t c) {
+    if (muted) return 1;
+
+    if (lineStart) {
+        uint32_t sec = nowMs / 1000;
+        fprintf(stderr, "[%02lu:%02lu:%02lu] ", (unsigned long)(sec / 3600),
+                (unsigned long)(sec / 60 % 60), (unsigned long)(sec % 60));
+        lineStart = false;
+    }
+    fputc(c, stderr);
+    if (c == '\n') lineStart = true;
+    return 1;
+}
+
+// =============================================================================
+// HAL
+// =============================================================================
+
+namespace Hal {
+
+uint32_t millis() {
+    return nowMs;
+}
+
+uint32_t micros() {
+    return nowMs * 1000UL;
+}
+
+void delayMs(uint32_t ms) {
+    nowMs += ms;
+}
+
+void gpioMode(uint8_t pin, uint8_t mode) {
+    if (pin < HOST_PINS && mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+
+void gpioWrite(uint8_t pin, uint8_t level) {
+    if (pin < HOST_PINS) pinLevels[pin] = level;
+}
+
+uint8_t gpioRead(uint8_t pin) {
+    return pin < HOST_PINS ? pinLevels[pin] : LOW;
+}
+
+void gpioInterrupt(uint8_t pin, void (*isr)(), uint8_t mode) {
+    (void)mode;
+    if (pin < HOST_PINS) pinIsr[pin] = isr;
+}
+
+void pwmSetup(uint8_t channel, uint32_t freqHz, uint8_t resolutionBits) {
+    (void)freqHz; (void)resolutionBits;
+    if (channel < HOST_PWM_CHANNELS) pwmDuties[channel] = 0;
+}
+
+void pwmAttach(uint8_t pin, uint8_t channel) {
+    (void)pin; (void)channel;
+}
+
+void pwmWrite(uint8_t channel, uint32_t duty) {
+    if (channel < HOST_PWM_CHANNELS) pwmDuties[channel] = duty;
+}
+
+bool uartBegin(uint8_t port, uint32_t baud, int8_t rxPin, int8_t txPin) {
+    (void)baud; (void)rxPin; (void)txPin;
+    if (port >= HOST_UARTS) return false;
+    uartRx[port].clear();
+    return true;
+}
+
+size_t uartWrite(uint8_t port, const uint8_t* data, size_t len) {
+    (void)data;
+    return port < HOST_UARTS ? len : 0;
+}
+
+size_t uartRead(uint8_t port, uint8_t* buffer, size_t len) {
+    if (port >= HOST_UARTS) return 0;
+    size_t n = 0;
+    while (n < len && !uartRx[port].empty()) {
+        buffer[n++] = uartRx[port].front();
+        uartRx[port].pop_front();
+    }
+    return n;
+}
+
+int uartAvailable(uint8_t port) {
+    return port < HOST_UARTS ? (int)uartRx[port].size() : 0;
+}
+
+bool i2cBegin(uint8_t sdaPin, uint8_t sclPin, uint32_t freqHz) {
+    (void)sdaPin; (void)sclPin; (void)freqHz;
+    return true;
+}
+
+bool i2cWrite(uint8_t address, const uint8_t* data, size_t len) {
+    (void)address; (void)data; (void)len;
+    return false;
+}
+
+size_t i2cRead(uint8_t address, uint8_t* buffer, size_t len) {
+    (void)address; (void)buffer; (void)len;
+    return 0;
+}
+
+namespace Host {
+
+void advance(uint32_t ms) {
+    nowMs += ms;
+}
+
+uint8_t pinLevel(uint8_t pin) {
+    return gpioRead(pin);
+}
+
+uint32_t pwmDuty(uint8_t channel) {
+    return channel < HOST_PWM_CHANNELS ? pwmDuties[channel] : 0;
+}
+
+void uartFeed(uint8_t port, const uint8_t* data, size_t len) {
+    if (port >= HOST_UARTS) return;
+    uartRx[port].insert(uartRx[port].end(), data, data + len);
+}
+
+void gpioPulse(uint8_t pin) {
+    if (pin < HOST_PINS && pinIsr[pin]) pinIsr[pin]();
+}
+
+} // namespace Host
+
+} // namespace Hal
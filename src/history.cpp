@@ -52,138 +52,7 @@ bool saveProcessHistory(const ProcessHistory& history) {
 
     // Создать JSON документ
     DynamicJsonDocument doc(32768);  // 32 КБ для полного процесса
-
-    // Метаданные
-    doc["id"] = history.id;
-    doc["version"] = history.version;
-
-    JsonObject metadata = doc.createNestedObject("metadata");
-    metadata["startTime"] = history.metadata.startTime;
-    metadata["endTime"] = history.metadata.endTime;
-    metadata["duration"] = history.metadata.duration;
-    metadata["completedSuccessfully"] = history.metadata.completedSuccessfully;
-    metadata["deviceId"] = history.metadata.deviceId;
-
-    // Информация о процессе
-    JsonObject process = doc.createNestedObject("process");
-    process["type"] = history.process.type;
-    process["mode"] = history.process.mode;
-    process["profile"] = history.process.profile;
-
-    // Параметры
-    JsonObject parameters = doc.createNestedObject("parameters");
-    parameters["targetPower"] = history.parameters.targetPower;
-    parameters["headVolume"] = history.parameters.headVolume;
-    parameters["bodyVolume"] = history.parameters.bodyVolume;
-    parameters["tailVolume"] = history.parameters.tailVolume;
-    parameters["pumpSpeedHead"] = history.parameters.pumpSpeedHead;
-    parameters["pumpSpeedBody"] = history.parameters.pumpSpeedBody;
-    parameters["stabilizationTime"] = history.parameters.stabilizationTime;
-    parameters["wattControlEnabled"] = history.parameters.wattControlEnabled;
-    parameters["smartDecrementEnabled"] = history.parameters.smartDecrementEnabled;
-
-    // Метрики
-    JsonObject metrics = doc.createNestedObject("metrics");
-
-    JsonObject temps = metrics.createNestedObject("temperatures");
-    JsonObject cube = temps.createNestedObject("cube");
-    cube["min"] = history.metrics.cube.min;
-    cube["max"] = history.metrics.cube.max;
-    cube["avg"] = history.metrics.cube.avg;
-    cube["final"] = history.metrics.cube.final;
-
-    JsonObject columnBottom = temps.createNestedObject("columnBottom");
-    columnBottom["min"] = history.metrics.columnBottom.min;
-    columnBottom["max"] = history.metrics.columnBottom.max;
-    columnBottom["avg"] = history.metrics.columnBottom.avg;
-    columnBottom["final"] = history.metrics.columnBottom.final;
-
-    JsonObject columnTop = temps.createNestedObject("columnTop");
-    columnTop["min"] = history.metrics.columnTop.min;
-    columnTop["max"] = history.metrics.columnTop.max;
-    columnTop["avg"] = history.metrics.columnTop.avg;
-    columnTop["final"] = history.metrics.columnTop.final;
-
-    JsonObject deflegmator = temps.createNestedObject("deflegmator");
-    deflegmator["min"] = history.metrics.deflegmator.min;
-    deflegmator["max"] = history.metrics.deflegmator.max;
-    deflegmator["avg"] = history.metrics.deflegmator.avg;
-    deflegmator["final"] = history.metrics.deflegmator.final;
-
-    JsonObject power = metrics.createNestedObject("power");
-    power["energyUsed"] = history.metrics.energyUsed;
-    power["avgPower"] = history.metrics.avgPower;
-    power["peakPower"] = history.metrics.peakPower;
-
-    JsonObject pump = metrics.createNestedObject("pump");
-    pump["totalVolume"] = history.metrics.totalVolume;
-    pump["avgSpeed"] = history.metrics.avgSpeed;
-
-    // Фазы
-    JsonArray phases = doc.createNestedArray("phases");
-    for (const auto& phase : history.phases) {
-        JsonObject p = phases.createNestedObject();
-        p["name"] = phase.name;
-        p["startTime"] = phase.startTime;
-        p["endTime"] = phase.endTime;
-        p["duration"] = phase.duration;
-        p["startTemp"] = phase.startTemp;
-        p["endTemp"] = phase.endTemp;
-        p["volume"] = phase.volume;
-        p["avgSpeed"] = phase.avgSpeed;
-    }
-
-    // Временные ряды
-    JsonObject timeseries = doc.createNestedObject("timeseries");
-    timeseries["interval"] = TIMESERIES_INTERVAL;
-    JsonArray data = timeseries.createNestedArray("data");
-
-    // Ограничить количество точек для экономии памяти
-    size_t step = 1;
-    if (history.timeseries.size() > MAX_TIMESERIES_POINTS) {
-        step = history.timeseries.size() / MAX_TIMESERIES_POINTS + 1;
-    }
-
-    for (size_t i = 0; i < history.timeseries.size(); i += step) {
-        const auto& point = history.timeseries[i];
-        JsonObject p = data.createNestedObject();
-        p["time"] = point.time;
-        p["cube"] = point.cube;
-        p["columnTop"] = point.columnTop;
-        p["columnBottom"] = point.columnBottom;
-        p["deflegmator"] = point.deflegmator;
-        p["power"] = point.power;
-        p["voltage"] = point.voltage;
-        p["current"] = point.current;
-        p["pumpSpeed"] = point.pumpSpeed;
-    }
-
-    // Результаты
-    JsonObject results = doc.createNestedObject("results");
-    results["headsCollected"] = history.results.headsCollected;
-    results["bodyCollected"] = history.results.bodyCollected;
-    results["tailsCollected"] = history.results.tailsCollected;
-    results["totalCollected"] = history.results.totalCollected;
-    results["status"] = history.results.status;
-
-    JsonArray errors = results.createNestedArray("errors");
-    for (const auto& error : history.results.errors) {
-        JsonObject e = errors.createNestedObject();
-        e["time"] = error.time;
-        e["message"] = error.message;
-        e["severity"] = error.severity;
-    }
-
-    JsonArray warnings = results.createNestedArray("warnings");
-    for (const auto& warning : history.results.warnings) {
-        JsonObject w = warnings.createNestedObject();
-        w["time"] = warning.time;
-        w["message"] = warning.message;
-        w["severity"] = warning.severity;
-    }
-
-    // Заметки
-    doc["notes"] = history.notes;
+    historyToJson(history, doc);
 
     // Сериализовать в файл
     if (serializeJson(doc, file) == 0) {
@@ -229,119 +98,7 @@ bool loadProcessHistory(const String& id, ProcessHistory& history) {
         return false;
     }
 
-    // Загрузить данные из JSON в структуру
-    history.id = doc["id"].as<String>();
-    history.version = doc["version"].as<String>();
-
-    history.metadata.startTime = doc["metadata"]["startTime"];
-    history.metadata.endTime = doc["metadata"]["endTime"];
-    history.metadata.duration = doc["metadata"]["duration"];
-    history.metadata.completedSuccessfully = doc["metadata"]["completedSuccessfully"];
-    history.metadata.deviceId = doc["metadata"]["deviceId"].as<String>();
-
-    history.process.type = doc["process"]["type"].as<String>();
-    history.process.mode = doc["process"]["mode"].as<String>();
-    history.process.profile = doc["process"]["profile"].as<String>();
-
-    history.parameters.targetPower = doc["parameters"]["targetPower"];
-    history.parameters.headVolume = doc["parameters"]["headVolume"];
-    history.parameters.bodyVolume = doc["parameters"]["bodyVolume"];
-    history.parameters.tailVolume = doc["parameters"]["tailVolume"];
-    history.parameters.pumpSpeedHead = doc["parameters"]["pumpSpeedHead"];
-    history.parameters.pumpSpeedBody = doc["parameters"]["pumpSpeedBody"];
-    history.parameters.stabilizationTime = doc["parameters"]["stabilizationTime"];
-    history.parameters.wattControlEnabled = doc["parameters"]["wattControlEnabled"];
-    history.parameters.smartDecrementEnabled = doc["parameters"]["smartDecrementEnabled"];
-
-    // Загрузить метрики
-    history.metrics.cube.min = doc["metrics"]["temperatures"]["cube"]["min"];
-    history.metrics.cube.max = doc["metrics"]["temperatures"]["cube"]["max"];
-    history.metrics.cube.avg = doc["metrics"]["temperatures"]["cube"]["avg"];
-    history.metrics.cube.final = doc["metrics"]["temperatures"]["cube"]["final"];
-
-    history.metrics.columnBottom.min = doc["metrics"]["temperatures"]["columnBottom"]["min"];
-    history.metrics.columnBottom.max = doc["metrics"]["temperatures"]["columnBottom"]["max"];
-    history.metrics.columnBottom.avg = doc["metrics"]["temperatures"]["columnBottom"]["avg"];
-    history.metrics.columnBottom.final = doc["metrics"]["temperatures"]["columnBottom"]["final"];
-
-    history.metrics.columnTop.min = doc["metrics"]["temperatures"]["columnTop"]["min"];
-    history.metrics.columnTop.max = doc["metrics"]["temperatures"]["columnTop"]["max"];
-    history.metrics.columnTop.avg = doc["metrics"]["temperatures"]["columnTop"]["avg"];
-    history.metrics.columnTop.final = doc["metrics"]["temperatures"]["columnTop"]["final"];
-
-    history.metrics.deflegmator.min = doc["metrics"]["temperatures"]["deflegmator"]["min"];
-    history.metrics.deflegmator.max = doc["metrics"]["temperatures"]["deflegmator"]["max"];
-    history.metrics.deflegmator.avg = doc["metrics"]["temperatures"]["deflegmator"]["avg"];
-    history.metrics.deflegmator.final = doc["metrics"]["temperatures"]["deflegmator"]["final"];
-
-    history.metrics.energyUsed = doc["metrics"]["power"]["energyUsed"];
-    history.metrics.avgPower = doc["metrics"]["power"]["avgPower"];
-    history.metrics.peakPower = doc["metrics"]["power"]["peakPower"];
-
-    history.metrics.totalVolume = doc["metrics"]["pump"]["totalVolume"];
-    history.metrics.avgSpeed = doc["metrics"]["pump"]["avgSpeed"];
-
-    // Загрузить фазы
-    history.phases.clear();
-    JsonArray phases = doc["phases"];
-    for (JsonObject phase : phases) {
-        ProcessPhase p;
-        p.name = phase["name"].as<String>();
-        p.startTime = phase["startTime"];
-        p.endTime = phase["endTime"];
-        p.duration = phase["duration"];
-        p.startTemp = phase["startTemp"];
-        p.endTemp = phase["endTemp"];
-        p.volume = phase["volume"];
-        p.avgSpeed = phase["avgSpeed"];
-        history.phases.push_back(p);
-    }
-
-    // Загрузить временные ряды
-    history.timeseries.clear();
-    JsonArray data = doc["timeseries"]["data"];
-    for (JsonObject point : data) {
-        TimeseriesPoint p;
-        p.time = point["time"];
-        p.cube = point["cube"];
-        p.columnTop = point["columnTop"];
-        p.columnBottom = point["columnBottom"];
-        p.deflegmator = point["deflegmator"];
-        p.power = point["power"];
-        p.voltage = point["voltage"];
-        p.current = point["current"];
-        p.pumpSpeed = point["pumpSpeed"];
-        history.timeseries.push_back(p);
-    }
-
-    // Загрузить результаты
-    history.results.headsCollected = doc["results"]["headsCollected"];
-    history.results.bodyCollected = doc["results"]["bodyCollected"];
-    history.results.tailsCollected = doc["results"]["tailsCollected"];
-    history.results.totalCollected = doc["results"]["totalCollected"];
-    history.results.status = doc["results"]["status"].as<String>();
-
-    history.results.errors.clear();
-    JsonArray errors = doc["results"]["errors"];
-    for (JsonObject error : errors) {
-        ProcessWarning w;
-        w.time = error["time"];
-        w.message = error["message"].as<String>();
-        w.severity = error["severity"].as<String>();
-        history.results.errors.push_back(w);
-    }
-
-    history.results.warnings.clear();
-    JsonArray warnings = doc["results"]["warnings"];
-    for (JsonObject warning : warnings) {
-        ProcessWarning w;
-        w.time = warning["time"];
-        w.message = warning["message"].as<String>();
-        w.severity = warning["severity"].as<String>();
-        history.results.warnings.push_back(w);
-    }
-
-    history.notes = doc["notes"].as<String>();
+    historyFromJson(doc, history);
 
     Serial.printf("Процесс загружен: %s\n", id.c_str());
     return true;
@@ -540,7 +297,7 @@ size_t getHistorySize() {
 // ============================================================================
 
 String exportProcessToCSV(const ProcessHistory& history) {
-    String csv = "Time,Cube Temp,Column Top,Column Bottom,Deflegmator,Power,Voltage,Current,Pump Speed\n";
+    String csv = "Time,Cube Temp,Column Top,Column Bottom,Deflegmator,Power,Voltage,Current,Pump Speed,Cube ABV,Distillate ABV\n";
 
     for (const auto& point : history.timeseries) {
         csv += String(point.time) + ",";
@@ -551,7 +308,9 @@ String exportProcessToCSV(const ProcessHistory& history) {
         csv += String(point.power) + ",";
         csv += String(point.voltage, 1) + ",";
         csv += String(point.current, 2) + ",";
-        csv += String(point.pumpSpeed) + "\n";
+        csv += String(point.pumpSpeed) + ",";
+        csv += String(point.cubeAbv, 1) + ",";
+        csv += String(point.distillateAbv, 1) + "\n";
     }
 
     return csv;
@@ -563,11 +322,7 @@ String exportProcessToCSV(const ProcessHistory& history) {
 
 String exportProcessToJSON(const ProcessHistory& history) {
     DynamicJsonDocument doc(32768);
-
-    // Используем ту же структуру, что и для сохранения
-    doc["id"] = history.id;
-    doc["version"] = history.version;
-    // ... (аналогично saveProcessHistory)
+    historyToJson(history, doc);
 
     String json;
     serializeJson(doc, json);
@@ -635,6 +390,57 @@ void ProcessRecorder::addPhase(const ProcessPhase& phase) {
     currentHistory.phases.push_back(phase);
 }
 
+void ProcessRecorder::recordPlan(uint32_t checksum, const String& profileId, const String& phase) {
+    if (!recording) return;
+
+    PlanSwap swap;
+    swap.time = millis() / 1000;
+    swap.checksum = checksum;
+    swap.profileId = profileId;
+    swap.phase = phase;
+    currentHistory.plans.push_back(swap);
+
+    // Профиль процесса - первый применённый
+    if (currentHistory.process.profile.length() == 0 && profileId.length() > 0) {
+        currentHistory.process.profile = profileId;
+    }
+}
+
+void ProcessRecorder::recordSpeedChange(float fromSpeed, float toSpeed, float columnTop,
+                                        const String& reason) {
+    if (!recording) return;
+
+    SpeedChange change;
+    change.time = millis() / 1000;
+    change.fromSpeed = fromSpeed;
+    change.toSpeed = toSpeed;
+    change.columnTop = columnTop;
+    change.reason = reason;
+    currentHistory.speedChanges.push_back(change);
+}
+
+void ProcessRecorder::recordHeatup(const HeatupReport& report) {
+    if (!recording) return;
+    currentHistory.heatup = report;
+}
+
+void ProcessRecorder::recordRampStep(uint8_t power, float pressure, float pressureStd, bool flood) {
+    if (!recording) return;
+
+    RampStep step;
+    step.time = millis() / 1000;
+    step.power = power;
+    step.pressure = pressure;
+    step.pressureStd = pressureStd;
+    step.flood = flood;
+    currentHistory.ramp.push_back(step);
+}
+
+void ProcessRecorder::recordTempStep(const TempStepRecord& step) {
+    if (!recording) return;
+    currentHistory.steps.push_back(step);
+}
+
 void ProcessRecorder::addWarning(const String& message, const String& severity) {
     ProcessWarning warning;
     warning.time = millis() / 1000;
@@ -90,6 +90,10 @@ struct TimeseriesPoint {
     float voltage;                   // Напряжение (V)
     float current;                   // Ток (A)
     uint16_t pumpSpeed;              // Скорость насоса (мл/час)
+    float cubeAbv;                   // Крепость в кубе по VLE (% об., 0 - куб не кипит)
+    float distillateAbv;             // Крепость отбора по VLE (% об.)
+    uint8_t phase;                   // RectPhase
+    float volume;                    // Отбор насосом с начала процесса (мл)
 };
 
 // Предупреждение или ошибка
@@ -99,6 +103,55 @@ struct ProcessWarning {
     String severity;                 // info, warning, error
 };
 
+// Смена плана погона (RunPlan)
+struct PlanSwap {
+    uint32_t time;                   // Unix timestamp
+    uint32_t checksum;               // CRC32 плана
+    String profileId;                // Пусто - план из настроек
+    String phase;                    // Фаза, на границе которой сменился план
+};
+
+// Изменение скорости отбора тела (Smart Decrement)
+struct SpeedChange {
+    uint32_t time;                   // Unix timestamp
+    float fromSpeed;                 // мл/час до изменения
+    float toSpeed;                   // мл/час после
+    float columnTop;                 // T верха царги в момент изменения (°C)
+    String reason;                   // decrement, increment
+};
+
+// Ступень калибровки захлёба (подъём мощности "на себя")
+struct RampStep {
+    uint32_t time;                   // Unix timestamp конца ступени
+    uint8_t power;                   // Мощность ТЭНа (%)
+    float pressure;                  // Среднее давление за окно замера (мм рт.ст.)
+    float pressureStd;               // СКО давления за окно замера
+    bool flood;                      // На ступени обнаружен захлёб
+};
+
+// Ступень затирки / Hold
+struct TempStepRecord {
+    String name;
+    float target;                    // T ступени (°C)
+    uint32_t startTime;              // Unix timestamp начала подъёма
+    uint32_t rampSec;                // Подъём до ступени (сек)
+    uint32_t holdSec;                // Выдержка в допуске (сек)
+    uint32_t outOfBandSec;           // Вне допуска во время выдержки (сек)
+    float energyWh;                  // Энергия на подъём и выдержку (Вт·ч)
+    float lossWK;                    // Оценка теплопотерь на конце ступени (Вт/°C)
+};
+
+// Разгон куба (HeatupPlanner)
+struct HeatupReport {
+    uint32_t durationSec;            // Длительность разгона (сек)
+    uint32_t predictedSec;           // Прогноз длительности по модели (0 - не было)
+    float boilTemp;                  // T куба при появлении пара в колонне (°C)
+    float overshoot;                 // Пик давления над уставкой после разгона (мм рт.ст.)
+    float thermalMass;               // Теплоёмкость куба (кДж/°C)
+    float lossWK;                    // Теплопотери (Вт/°C)
+    uint8_t workPercent;             // Мощность выхода на кипение (%)
+};
+
 // Результаты процесса
 struct ProcessResults {
     uint16_t headsCollected;         // Собрано голов (мл)
@@ -119,6 +172,11 @@ struct ProcessHistory {
     ProcessParameters parameters;
     ProcessMetrics metrics;
     std::vector<ProcessPhase> phases;
+    std::vector<PlanSwap> plans;
+    std::vector<SpeedChange> speedChanges;
+    std::vector<RampStep> ramp;
+    std::vector<TempStepRecord> steps;
+    HeatupReport heatup;
     std::vector<TimeseriesPoint> timeseries;
     ProcessResults results;
     String notes;                    // Заметки пользователя
@@ -171,6 +229,10 @@ String exportProcessToCSV(const ProcessHistory& history);
 // Экспорт процесса в JSON
 String exportProcessToJSON(const ProcessHistory& history);
 
+// Структура истории в JSON файла и обратно (src/history_format.cpp, без ФС)
+void historyToJson(const ProcessHistory& history, JsonDocument& doc);
+void historyFromJson(JsonDocument& doc, ProcessHistory& history);
+
 // ============================================================================
 // Вспомогательные функции для сбора метрик в реальном времени
 // ============================================================================
@@ -195,6 +257,21 @@ public:
     // Добавить фазу процесса
     void addPhase(const ProcessPhase& phase);
 
+    // Записать смену плана погона
+    void recordPlan(uint32_t checksum, const String& profileId, const String& phase);
+
+    // Записать изменение скорости отбора тела
+    void recordSpeedChange(float fromSpeed, float toSpeed, float columnTop, const String& reason);
+
+    // Записать итоги разгона
+    void recordHeatup(const HeatupReport& report);
+
+    // Записать ступень калибровки захлёба
+    void recordRampStep(uint8_t power, float pressure, float pressureStd, bool flood);
+
+    // Записать завершённую ступень затирки / Hold
+    void recordTempStep(const TempStepRecord& step);
+
     // Добавить предупреждение
     void addWarning(const String& message, const String& severity);
 
@@ -0,0 +1,396 @@
+/**
+ * Smart-Column S3 - Формат файла истории
+ *
+ * ProcessHistory <-> JSON файла /history/process_<id>.json
+ * (docs/HISTORY_SCHEMA.md). Без файловой системы - общий код для
+ * истории прошивки и симулятора (env:native).
+ */
+
+#include "history.h"
+
+// ============================================================================
+// Запись
+// ============================================================================
+
+void historyToJson(const ProcessHistory& history, JsonDocument& doc) {
+    // Метаданные
+    doc["id"] = history.id;
+    doc["version"] = history.version;
+
+    JsonObject metadata = doc.createNestedObject("metadata");
+    metadata["startTime"] = history.metadata.startTime;
+    metadata["endTime"] = history.metadata.endTime;
+    metadata["duration"] = history.metadata.duration;
+    metadata["completedSuccessfully"] = history.metadata.completedSuccessfully;
+    metadata["deviceId"] = history.metadata.deviceId;
+
+    // Информация о процессе
+    JsonObject process = doc.createNestedObject("process");
+    process["type"] = history.process.type;
+    process["mode"] = history.process.mode;
+    process["profile"] = history.process.profile;
+
+    // Параметры
+    JsonObject parameters = doc.createNestedObject("parameters");
+    parameters["targetPower"] = history.parameters.targetPower;
+    parameters["headVolume"] = history.parameters.headVolume;
+    parameters["bodyVolume"] = history.parameters.bodyVolume;
+    parameters["tailVolume"] = history.parameters.tailVolume;
+    parameters["pumpSpeedHead"] = history.parameters.pumpSpeedHead;
+    parameters["pumpSpeedBody"] = history.parameters.pumpSpeedBody;
+    parameters["stabilizationTime"] = history.parameters.stabilizationTime;
+    parameters["wattControlEnabled"] = history.parameters.wattControlEnabled;
+    parameters["smartDecrementEnabled"] = history.parameters.smartDecrementEnabled;
+
+    // Метрики
+    JsonObject metrics = doc.createNestedObject("metrics");
+
+    JsonObject temps = metrics.createNestedObject("temperatures");
+    JsonObject cube = temps.createNestedObject("cube");
+    cube["min"] = history.metrics.cube.min;
+    cube["max"] = history.metrics.cube.max;
+    cube["avg"] = history.metrics.cube.avg;
+    cube["final"] = history.metrics.cube.final;
+
+    JsonObject columnBottom = temps.createNestedObject("columnBottom");
+    columnBottom["min"] = history.metrics.columnBottom.min;
+    columnBottom["max"] = history.metrics.columnBottom.max;
+    columnBottom["avg"] = history.metrics.columnBottom.avg;
+    columnBottom["final"] = history.metrics.columnBottom.final;
+
+    JsonObject columnTop = temps.createNestedObject("columnTop");
+    columnTop["min"] = history.metrics.columnTop.min;
+    columnTop["max"] = history.metrics.columnTop.max;
+    columnTop["avg"] = history.metrics.columnTop.avg;
+    columnTop["final"] = history.metrics.columnTop.final;
+
+    JsonObject deflegmator = temps.createNestedObject("deflegmator");
+    deflegmator["min"] = history.metrics.deflegmator.min;
+    deflegmator["max"] = history.metrics.deflegmator.max;
+    deflegmator["avg"] = history.metrics.deflegmator.avg;
+    deflegmator["final"] = history.metrics.deflegmator.final;
+
+    JsonObject power = metrics.createNestedObject("power");
+    power["energyUsed"] = history.metrics.energyUsed;
+    power["avgPower"] = history.metrics.avgPower;
+    power["peakPower"] = history.metrics.peakPower;
+
+    JsonObject pump = metrics.createNestedObject("pump");
+    pump["totalVolume"] = history.metrics.totalVolume;
+    pump["avgSpeed"] = history.metrics.avgSpeed;
+
+    // Фазы
+    JsonArray phases = doc.createNestedArray("phases");
+    for (const auto& phase : history.phases) {
+        JsonObject p = phases.createNestedObject();
+        p["name"] = phase.name;
+        p["startTime"] = phase.startTime;
+        p["endTime"] = phase.endTime;
+        p["duration"] = phase.duration;
+        p["startTemp"] = phase.startTemp;
+        p["endTemp"] = phase.endTemp;
+        p["volume"] = phase.volume;
+        p["avgSpeed"] = phase.avgSpeed;
+    }
+
+    // Планы погона
+    JsonArray plans = doc.createNestedArray("plans");
+    for (const auto& plan : history.plans) {
+        JsonObject p = plans.createNestedObject();
+        p["time"] = plan.time;
+        p["checksum"] = plan.checksum;
+        p["profileId"] = plan.profileId;
+        p["phase"] = plan.phase;
+    }
+
+    // Изменения скорости отбора тела
+    JsonArray speedChanges = doc.createNestedArray("speedChanges");
+    for (const auto& change : history.speedChanges) {
+        JsonObject c = speedChanges.createNestedObject();
+        c["time"] = change.time;
+        c["from"] = change.fromSpeed;
+        c["to"] = change.toSpeed;
+        c["columnTop"] = change.columnTop;
+        c["reason"] = change.reason;
+    }
+
+    // Разгон
+    if (history.heatup.durationSec > 0) {
+        JsonObject heatup = doc.createNestedObject("heatup");
+        heatup["duration"] = history.heatup.durationSec;
+        heatup["predicted"] = history.heatup.predictedSec;
+        heatup["boilTemp"] = history.heatup.boilTemp;
+        heatup["overshoot"] = history.heatup.overshoot;
+        heatup["thermalMass"] = history.heatup.thermalMass;
+        heatup["lossWK"] = history.heatup.lossWK;
+        heatup["workPercent"] = history.heatup.workPercent;
+    }
+
+    // Ступени калибровки захлёба
+    JsonArray ramp = doc.createNestedArray("ramp");
+    for (const auto& step : history.ramp) {
+        JsonObject r = ramp.createNestedObject();
+        r["time"] = step.time;
+        r["power"] = step.power;
+        r["pressure"] = step.pressure;
+        r["pressureStd"] = step.pressureStd;
+        r["flood"] = step.flood;
+    }
+
+    // Ступени затирки / Hold
+    JsonArray steps = doc.createNestedArray("steps");
+    for (const auto& step : history.steps) {
+        JsonObject s = steps.createNestedObject();
+        s["name"] = step.name;
+        s["target"] = step.target;
+        s["startTime"] = step.startTime;
+        s["ramp"] = step.rampSec;
+        s["hold"] = step.holdSec;
+        s["outOfBand"] = step.outOfBandSec;
+        s["energyWh"] = step.energyWh;
+        s["lossWK"] = step.lossWK;
+    }
+
+    // Временные ряды
+    JsonObject timeseries = doc.createNestedObject("timeseries");
+    timeseries["interval"] = TIMESERIES_INTERVAL;
+    JsonArray data = timeseries.createNestedArray("data");
+
+    // Ограничить количество точек для экономии памяти
+    size_t step = 1;
+    if (history.timeseries.size() > MAX_TIMESERIES_POINTS) {
+        step = history.timeseries.size() / MAX_TIMESERIES_POINTS + 1;
+    }
+
+    for (size_t i = 0; i < history.timeseries.size(); i += step) {
+        const auto& point = history.timeseries[i];
+        JsonObject p = data.createNestedObject();
+        p["time"] = point.time;
+        p["cube"] = point.cube;
+        p["columnTop"] = point.columnTop;
+        p["columnBottom"] = point.columnBottom;
+        p["deflegmator"] = point.deflegmator;
+        p["power"] = point.power;
+        p["voltage"] = point.voltage;
+        p["current"] = point.current;
+        p["pumpSpeed"] = point.pumpSpeed;
+        p["cubeAbv"] = point.cubeAbv;
+        p["distillateAbv"] = point.distillateAbv;
+        p["phase"] = point.phase;
+        p["volume"] = point.volume;
+    }
+
+    // Результаты
+    JsonObject results = doc.createNestedObject("results");
+    results["headsCollected"] = history.results.headsCollected;
+    results["bodyCollected"] = history.results.bodyCollected;
+    results["tailsCollected"] = history.results.tailsCollected;
+    results["totalCollected"] = history.results.totalCollected;
+    results["status"] = history.results.status;
+
+    JsonArray errors = results.createNestedArray("errors");
+    for (const auto& error : history.results.errors) {
+        JsonObject e = errors.createNestedObject();
+        e["time"] = error.time;
+        e["message"] = error.message;
+        e["severity"] = error.severity;
+    }
+
+    JsonArray warnings = results.createNestedArray("warnings");
+    for (const auto& warning : history.results.warnings) {
+        JsonObject w = warnings.createNestedObject();
+        w["time"] = warning.time;
+        w["message"] = warning.message;
+        w["severity"] = warning.severity;
+    }
+
+    // Заметки
+    doc["notes"] = history.notes;
+}
+
+// ============================================================================
+// Чтение
+// ============================================================================
+
+void historyFromJson(JsonDocument& doc, ProcessHistory& history) {
+    history.id = doc["id"].as<String>();
+    history.version = doc["version"].as<String>();
+
+    history.metadata.startTime = doc["metadata"]["startTime"];
+    history.metadata.endTime = doc["metadata"]["endTime"];
+    history.metadata.duration = doc["metadata"]["duration"];
+    history.metadata.completedSuccessfully = doc["metadata"]["completedSuccessfully"];
+    history.metadata.deviceId = doc["metadata"]["deviceId"].as<String>();
+
+    history.process.type = doc["process"]["type"].as<String>();
+    history.process.mode = doc["process"]["mode"].as<String>();
+    history.process.profile = doc["process"]["profile"].as<String>();
+
+    history.parameters.targetPower = doc["parameters"]["targetPower"];
+    history.parameters.headVolume = doc["parameters"]["headVolume"];
+    history.parameters.bodyVolume = doc["parameters"]["bodyVolume"];
+    history.parameters.tailVolume = doc["parameters"]["tailVolume"];
+    history.parameters.pumpSpeedHead = doc["parameters"]["pumpSpeedHead"];
+    history.parameters.pumpSpeedBody = doc["parameters"]["pumpSpeedBody"];
+    history.parameters.stabilizationTime = doc["parameters"]["stabilizationTime"];
+    history.parameters.wattControlEnabled = doc["parameters"]["wattControlEnabled"];
+    history.parameters.smartDecrementEnabled = doc["parameters"]["smartDecrementEnabled"];
+
+    // Загрузить метрики
+    history.metrics.cube.min = doc["metrics"]["temperatures"]["cube"]["min"];
+    history.metrics.cube.max = doc["metrics"]["temperatures"]["cube"]["max"];
+    history.metrics.cube.avg = doc["metrics"]["temperatures"]["cube"]["avg"];
+    history.metrics.cube.final = doc["metrics"]["temperatures"]["cube"]["final"];
+
+    history.metrics.columnBottom.min = doc["metrics"]["temperatures"]["columnBottom"]["min"];
+    history.metrics.columnBottom.max = doc["metrics"]["temperatures"]["columnBottom"]["max"];
+    history.metrics.columnBottom.avg = doc["metrics"]["temperatures"]["columnBottom"]["avg"];
+    history.metrics.columnBottom.final = doc["metrics"]["temperatures"]["columnBottom"]["final"];
+
+    history.metrics.columnTop.min = doc["metrics"]["temperatures"]["columnTop"]["min"];
+    history.metrics.columnTop.max = doc["metrics"]["temperatures"]["columnTop"]["max"];
+    history.metrics.columnTop.avg = doc["metrics"]["temperatures"]["columnTop"]["avg"];
+    history.metrics.columnTop.final = doc["metrics"]["temperatures"]["columnTop"]["final"];
+
+    history.metrics.deflegmator.min = doc["metrics"]["temperatures"]["deflegmator"]["min"];
+    history.metrics.deflegmator.max = doc["metrics"]["temperatures"]["deflegmator"]["max"];
+    history.metrics.deflegmator.avg = doc["metrics"]["temperatures"]["deflegmator"]["avg"];
+    history.metrics.deflegmator.final = doc["metrics"]["temperatures"]["deflegmator"]["final"];
+
+    history.metrics.energyUsed = doc["metrics"]["power"]["energyUsed"];
+    history.metrics.avgPower = doc["metrics"]["power"]["avgPower"];
+    history.metrics.peakPower = doc["metrics"]["power"]["peakPower"];
+
+    history.metrics.totalVolume = doc["metrics"]["pump"]["totalVolume"];
+    history.metrics.avgSpeed = doc["metrics"]["pump"]["avgSpeed"];
+
+    // Загрузить фазы
+    history.phases.clear();
+    JsonArray phases = doc["phases"];
+    for (JsonObject phase : phases) {
+        ProcessPhase p;
+        p.name = phase["name"].as<String>();
+        p.startTime = phase["startTime"];
+        p.endTime = phase["endTime"];
+        p.duration = phase["duration"];
+        p.startTemp = phase["startTemp"];
+        p.endTemp = phase["endTemp"];
+        p.volume = phase["volume"];
+        p.avgSpeed = phase["avgSpeed"];
+        history.phases.push_back(p);
+    }
+
+    // Загрузить планы погона
+    history.plans.clear();
+    JsonArray plans = doc["plans"];
+    for (JsonObject plan : plans) {
+        PlanSwap p;
+        p.time = plan["time"];
+        p.checksum = plan["checksum"];
+        p.profileId = plan["profileId"].as<String>();
+        p.phase = plan["phase"].as<String>();
+        history.plans.push_back(p);
+    }
+
+    // Загрузить изменения скорости
+    history.speedChanges.clear();
+    JsonArray speedChanges = doc["speedChanges"];
+    for (JsonObject change : speedChanges) {
+        SpeedChange c;
+        c.time = change["time"];
+        c.fromSpeed = change["from"];
+        c.toSpeed = change["to"];
+        c.columnTop = change["columnTop"];
+        c.reason = change["reason"].as<String>();
+        history.speedChanges.push_back(c);
+    }
+
+    // Загрузить итоги разгона
+    JsonObject heatup = doc["heatup"];
+    history.heatup.durationSec = heatup["duration"] | 0;
+    history.heatup.predictedSec = heatup["predicted"] | 0;
+    history.heatup.boilTemp = heatup["boilTemp"] | 0.0f;
+    history.heatup.overshoot = heatup["overshoot"] | 0.0f;
+    history.heatup.thermalMass = heatup["thermalMass"] | 0.0f;
+    history.heatup.lossWK = heatup["lossWK"] | 0.0f;
+    history.heatup.workPercent = heatup["workPercent"] | 0;
+
+    // Загрузить ступени калибровки захлёба
+    history.ramp.clear();
+    JsonArray ramp = doc["ramp"];
+    for (JsonObject step : ramp) {
+        RampStep r;
+        r.time = step["time"];
+        r.power = step["power"];
+        r.pressure = step["pressure"];
+        r.pressureStd = step["pressureStd"];
+        r.flood = step["flood"];
+        history.ramp.push_back(r);
+    }
+
+    // Загрузить ступени затирки / Hold
+    history.steps.clear();
+    JsonArray steps = doc["steps"];
+    for (JsonObject step : steps) {
+        TempStepRecord s;
+        s.name = step["name"].as<String>();
+        s.target = step["target"];
+        s.startTime = step["startTime"];
+        s.rampSec = step["ramp"];
+        s.holdSec = step["hold"];
+        s.outOfBandSec = step["outOfBand"];
+        s.energyWh = step["energyWh"];
+        s.lossWK = step["lossWK"];
+        history.steps.push_back(s);
+    }
+
+    // Загрузить временные ряды
+    history.timeseries.clear();
+    JsonArray data = doc["timeseries"]["data"];
+    for (JsonObject point : data) {
+        TimeseriesPoint p;
+        p.time = point["time"];
+        p.cube = point["cube"];
+        p.columnTop = point["columnTop"];
+        p.columnBottom = point["columnBottom"];
+        p.deflegmator = point["deflegmator"];
+        p.power = point["power"];
+        p.voltage = point["voltage"];
+        p.current = point["current"];
+        p.pumpSpeed = point["pumpSpeed"];
+        p.cubeAbv = point["cubeAbv"] | 0.0f;
+        p.distillateAbv = point["distillateAbv"] | 0.0f;
+        p.phase = point["phase"] | 0;
+        p.volume = point["volume"] | 0.0f;
+        history.timeseries.push_back(p);
+    }
+
+    // Загрузить результаты
+    history.results.headsCollected = doc["results"]["headsCollected"];
+    history.results.bodyCollected = doc["results"]["bodyCollected"];
+    history.results.tailsCollected = doc["results"]["tailsCollected"];
+    history.results.totalCollected = doc["results"]["totalCollected"];
+    history.results.status = doc["results"]["status"].as<String>();
+
+    history.results.errors.clear();
+    JsonArray errors = doc["results"]["errors"];
+    for (JsonObject error : errors) {
+        ProcessWarning w;
+        w.time = error["time"];
+        w.message = error["message"].as<String>();
+        w.severity = error["severity"].as<String>();
+        history.results.errors.push_back(w);
+    }
+
+    history.results.warnings.clear();
+    JsonArray warnings = doc["results"]["warnings"];
+    for (JsonObject warning : warnings) {
+        ProcessWarning w;
+        w.time = warning["time"];
+        w.message = warning["message"].as<String>();
+        w.severity = warning["severity"].as<String>();
+        history.results.warnings.push_back(w);
+    }
+
+    history.notes = doc["notes"].as<String>();
+}
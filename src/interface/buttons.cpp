@@ -5,6 +5,7 @@
  */
 
 #include "buttons.h"
+#include "../hal/hal.h"
 
 static uint32_t lastPress[4] = {0};
 static bool lastState[4] = {false};
@@ -14,20 +15,20 @@ namespace Buttons {
 void init() {
     LOG_I("Buttons: Initializing...");
 
-    pinMode(PIN_BTN_1, INPUT_PULLUP);
-    pinMode(PIN_BTN_2, INPUT_PULLUP);
-    pinMode(PIN_BTN_3, INPUT_PULLUP);
-    pinMode(PIN_BTN_4, INPUT_PULLUP);
+    Hal::gpioMode(PIN_BTN_1, INPUT_PULLUP);
+    Hal::gpioMode(PIN_BTN_2, INPUT_PULLUP);
+    Hal::gpioMode(PIN_BTN_3, INPUT_PULLUP);
+    Hal::gpioMode(PIN_BTN_4, INPUT_PULLUP);
 
     LOG_I("Buttons: Ready");
 }
 
 void update() {
-    uint32_t now = millis();
+    uint32_t now = Hal::millis();
     uint8_t pins[] = {PIN_BTN_1, PIN_BTN_2, PIN_BTN_3, PIN_BTN_4};
 
     for (uint8_t i = 0; i < 4; i++) {
-        bool current = !digitalRead(pins[i]); // Инвертируем (pullup)
+        bool current = !Hal::gpioRead(pins[i]); // Инвертируем (pullup)
 
         // Debounce
         if (current != lastState[i] && now - lastPress[i] > BTN_DEBOUNCE_MS) {
@@ -45,7 +46,7 @@ void update() {
 bool isPressed(uint8_t button) {
     if (button > 4) return false;
     uint8_t pins[] = {PIN_BTN_1, PIN_BTN_2, PIN_BTN_3, PIN_BTN_4};
-    return !digitalRead(pins[button - 1]);
+    return !Hal::gpioRead(pins[button - 1]);
 }
 
 } // namespace Buttons
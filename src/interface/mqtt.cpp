@@ -9,6 +9,8 @@
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include "config.h"
+#include "control/command_bus.h"
+#include "state_json.h"
 
 static WiFiClient wifiClient;
 static PubSubClient mqttClient(wifiClient);
@@ -16,6 +18,73 @@ static String baseTopic = "smartcolumn";
 static String deviceId;
 static uint32_t lastReconnectAttempt = 0;
 
+/**
+ * Команды управления: <base>/<id>/cmd/{start,stop,pause,resume,apply}
+ * (для start - режим в теле: rectification, distillation, manual либо
+ * JSON {"mode":"mashing|hold","value":N} - номер профиля затирки или
+ * T выдержки, для apply - ID профиля).
+ * Вызывается из MQTT::handle() в задаче loop - команда ставится
+ * в очередь и выполняется в начале следующего прохода.
+ */
+static void handleCommand(const char* topic, const byte* payload, unsigned int length) {
+    const char* cmd = strstr(topic, "/cmd/");
+    if (!cmd) return;
+    cmd += 5;
+
+    char arg[RUN_PLAN_ID_LEN];
+    unsigned int n = length < sizeof(arg) - 1 ? length : sizeof(arg) - 1;
+    memcpy(arg, payload, n);
+    arg[n] = '\0';
+
+    if (strcmp(cmd, "start") == 0) {
+        // Тело - имя режима или JSON с параметром режима
+        const char* modeStr = arg;
+        float value = 0;
+        StaticJsonDocument<128> doc;
+        if (length > 0 && payload[0] == '{') {
+            if (deserializeJson(doc, payload, length)) {
+                LOG_W("MQTT: Invalid start payload");
+                return;
+            }
+            modeStr = doc["mode"] | "";
+            value = doc["value"] | 0.0f;
+        }
+
+        Mode mode = Mode::IDLE;
+        if (strcmp(modeStr, "rectification") == 0) {
+            mode = Mode::RECTIFICATION;
+        } else if (strcmp(modeStr, "distillation") == 0) {
+            mode = Mode::DISTILLATION;
+        } else if (strcmp(modeStr, "manual") == 0 || strcmp(modeStr, "manual_rect") == 0) {
+            mode = Mode::MANUAL_RECT;
+        } else if (strcmp(modeStr, "mashing") == 0) {
+            mode = Mode::MASHING;
+        } else if (strcmp(modeStr, "hold") == 0) {
+            mode = Mode::HOLD;
+        } else {
+            LOG_W("MQTT: Unknown mode '%s'", modeStr);
+            return;
+        }
+
+        if ((mode == Mode::MASHING && (value < 0 || value >= MASH_PROFILE_COUNT)) ||
+            (mode == Mode::HOLD && (value < HOLD_SETPOINT_MIN || value > HOLD_SETPOINT_MAX))) {
+            LOG_W("MQTT: Start value %.1f out of range for '%s'", value, modeStr);
+            return;
+        }
+        CommandBus::post(CommandType::START, CommandSource::MQTT, mode, value);
+    } else if (strcmp(cmd, "stop") == 0) {
+        CommandBus::post(CommandType::STOP, CommandSource::MQTT);
+    } else if (strcmp(cmd, "pause") == 0) {
+        CommandBus::post(CommandType::PAUSE, CommandSource::MQTT);
+    } else if (strcmp(cmd, "resume") == 0) {
+        CommandBus::post(CommandType::RESUME, CommandSource::MQTT);
+    } else if (strcmp(cmd, "apply") == 0) {
+        CommandBus::applyProfile(CommandSource::MQTT, arg);
+    } else {
+        LOG_W("MQTT: Unknown command '%s'", cmd);
+    }
+}
+
 namespace MQTT {
 
 void init(const char* server, uint16_t port, const char* username, const char* password) {
@@ -33,7 +102,7 @@ void init(const char* server, uint16_t port, const char* username, const char* p
     // Установка callback для входящих сообщений
     mqttClient.setCallback([](char* topic, byte* payload, unsigned int length) {
         LOG_D("MQTT: Message received [%s]", topic);
-        // TODO: Обработка команд управления
+        handleCommand(topic, payload, length);
     });
 
     LOG_I("MQTT: Device ID: %s", deviceId.c_str());
@@ -84,33 +153,8 @@ void publishState(const SystemState& state) {
     if (!mqttClient.connected()) return;
 
     String topic = baseTopic + "/" + deviceId + "/state";
-    StaticJsonDocument<512> doc;
-
-    // Основные параметры
-    doc["mode"] = static_cast<int>(state.mode);
-    doc["phase"] = static_cast<int>(state.rectPhase);
-
-    // Температуры
-    JsonObject temps = doc.createNestedObject("temperatures");
-    temps["cube"] = round(state.temps.cube * 10) / 10;
-    temps["column_top"] = round(state.temps.columnTop * 10) / 10;
-    temps["column_bottom"] = round(state.temps.columnBottom * 10) / 10;
-    temps["reflux"] = round(state.temps.reflux * 10) / 10;
-    temps["tsa"] = round(state.temps.tsa * 10) / 10;
-
-    // Мощность
-    JsonObject power = doc.createNestedObject("power");
-    power["voltage"] = round(state.power.voltage * 10) / 10;
-    power["current"] = round(state.power.current * 100) / 100;
-    power["power"] = round(state.power.power);
-    power["energy"] = round(state.power.energy * 1000) / 1000;
-
-    // Насос
-    doc["pump_speed"] = round(state.pump.speedMlPerHour);
-    doc["pump_volume"] = round(state.pump.totalVolumeMl);
-
     String json;
-    serializeJson(doc, json);
+    StateJson::serializeMqtt(state, json);
     mqttClient.publish(topic.c_str(), json.c_str(), true);
 }
 
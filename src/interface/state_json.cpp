@@ -0,0 +1,133 @@
+/**
+ * Smart-Column S3 - JSON состояния для WebSocket и MQTT
+ */
+
+#include "state_json.h"
+#include <ArduinoJson.h>
+
+namespace StateJson {
+
+void serializeWeb(const SystemState& state, const MemoryStats& memory, String& json) {
+    // Сформировать JSON со состоянием
+    StaticJsonDocument<1536> doc;
+
+    doc["mode"] = static_cast<int>(state.mode);
+    doc["phase"] = static_cast<int>(state.rectPhase);
+    doc["t_cube"] = state.temps.cube;
+    doc["t_column"] = state.temps.columnTop;
+    if (state.temps.filtered[TEMP_COLUMN_TOP].valid) {
+        doc["t_column_slope"] = state.temps.filtered[TEMP_COLUMN_TOP].slope;
+    }
+    if (state.vle.cubeValid) doc["abv_cube"] = round(state.vle.cubeAbv * 10) / 10;
+    if (state.vle.distillateValid) doc["abv_distillate"] = round(state.vle.distillateAbv * 10) / 10;
+    doc["power"] = state.power.power;
+    doc["speed"] = state.pump.speedMlPerHour;
+    doc["volume"] = state.pump.totalVolumeMl;
+    if (state.distForecast.valid) {
+        doc["dist_eta_min"] = round(state.distForecast.remainingMin);
+        doc["dist_final_ml"] = round(state.distForecast.finalVolumeMl);
+    }
+    if (state.mode == Mode::RECTIFICATION && state.stats.etaValid) {
+        doc["eta_tails_min"] = state.stats.tailsEtaSec / 60;
+        doc["eta_tails_low_min"] = state.stats.tailsEtaLowSec / 60;
+        doc["eta_tails_high_min"] = state.stats.tailsEtaHighSec / 60;
+        doc["eta_finish_min"] = state.stats.finishEtaSec / 60;
+        doc["eta_finish_low_min"] = state.stats.finishEtaLowSec / 60;
+        doc["eta_finish_high_min"] = state.stats.finishEtaHighSec / 60;
+    }
+    if (state.mode == Mode::MASHING || state.mode == Mode::HOLD) {
+        doc["mash_step"] = state.mash.step + 1;
+        doc["mash_steps"] = state.mash.stepCount;
+        doc["mash_target"] = state.mash.target;
+        doc["mash_setpoint"] = round(state.mash.setpoint * 10) / 10;
+        doc["mash_held_sec"] = state.mash.heldSec;
+        doc["mash_hold_sec"] = state.mash.holdSec;
+        doc["mash_in_band"] = state.mash.inBand;
+    }
+
+    // Статистика памяти
+    JsonObject mem = doc.createNestedObject("memory");
+    mem["heap_free"] = memory.heapFree;
+    mem["heap_total"] = memory.heapTotal;
+    mem["heap_used_pct"] = memory.heapTotal > 0 ?
+        (memory.heapTotal - memory.heapFree) * 100 / memory.heapTotal : 0;
+    mem["psram_free"] = memory.psramFree;
+    mem["psram_total"] = memory.psramTotal;
+    mem["flash_used"] = memory.flashUsed;
+    mem["flash_total"] = memory.flashTotal;
+    mem["flash_used_pct"] = memory.flashTotal > 0 ? memory.flashUsed * 100 / memory.flashTotal : 0;
+
+    // Здоровье системы
+    JsonObject health = doc.createNestedObject("health");
+    health["overall"] = state.health.overallHealth;
+    health["tempSensorsOk"] = state.health.tempSensorsOk;
+    health["tempSensorsTotal"] = state.health.tempSensorsTotal;
+    health["bmp280"] = state.health.bmp280Ok;
+    health["ads1115"] = state.health.ads1115Ok;
+    health["pzem"] = state.health.pzemOk;
+    health["wifiRSSI"] = state.health.wifiRSSI;
+    health["pzemSpikes"] = state.health.pzemSpikeCount;
+    health["tempErrors"] = state.health.tempReadErrors;
+    health["cpuTemp"] = state.health.cpuTemp;
+
+    serializeJson(doc, json);
+}
+
+void serializeMqtt(const SystemState& state, String& json) {
+    StaticJsonDocument<768> doc;
+
+    // Основные параметры
+    doc["mode"] = static_cast<int>(state.mode);
+    doc["phase"] = static_cast<int>(state.rectPhase);
+
+    // Температуры
+    JsonObject temps = doc.createNestedObject("temperatures");
+    temps["cube"] = round(state.temps.cube * 10) / 10;
+    temps["column_top"] = round(state.temps.columnTop * 10) / 10;
+    temps["column_bottom"] = round(state.temps.columnBottom * 10) / 10;
+    temps["reflux"] = round(state.temps.reflux * 10) / 10;
+    temps["tsa"] = round(state.temps.tsa * 10) / 10;
+
+    // Крепости по равновесию пар-жидкость
+    if (state.vle.cubeValid || state.vle.distillateValid) {
+        JsonObject abv = doc.createNestedObject("abv");
+        if (state.vle.cubeValid) abv["cube"] = round(state.vle.cubeAbv * 10) / 10;
+        if (state.vle.distillateValid) abv["distillate"] = round(state.vle.distillateAbv * 10) / 10;
+    }
+
+    // Мощность
+    JsonObject power = doc.createNestedObject("power");
+    power["voltage"] = round(state.power.voltage * 10) / 10;
+    power["current"] = round(state.power.current * 100) / 100;
+    power["power"] = round(state.power.power);
+    power["energy"] = round(state.power.energy * 1000) / 1000;
+
+    // Насос
+    doc["pump_speed"] = round(state.pump.speedMlPerHour);
+    doc["pump_volume"] = round(state.pump.totalVolumeMl);
+
+    // Прогноз окончания дистилляции
+    if (state.distForecast.valid) {
+        JsonObject forecast = doc.createNestedObject("forecast");
+        forecast["remaining_min"] = round(state.distForecast.remainingMin);
+        forecast["final_volume"] = round(state.distForecast.finalVolumeMl);
+        forecast["takeoff"] = round(state.distForecast.takeoffMlH);
+    }
+
+    // Прогноз ректификации по балансу спирта
+    if (state.mode == Mode::RECTIFICATION && state.stats.etaValid) {
+        JsonObject eta = doc.createNestedObject("eta");
+        eta["tails_min"] = state.stats.tailsEtaSec / 60;
+        eta["tails_low_min"] = state.stats.tailsEtaLowSec / 60;
+        eta["tails_high_min"] = state.stats.tailsEtaHighSec / 60;
+        eta["finish_min"] = state.stats.finishEtaSec / 60;
+        eta["finish_low_min"] = state.stats.finishEtaLowSec / 60;
+        eta["finish_high_min"] = state.stats.finishEtaHighSec / 60;
+        eta["charge_ethanol"] = round(state.stats.chargeEthanolMl);
+        eta["collected_ethanol"] = round(state.stats.collectedEthanolMl);
+    }
+
+    serializeJson(doc, json);
+}
+
+} // namespace StateJson
@@ -0,0 +1,41 @@
+/**
+ * Smart-Column S3 - State JSON
+ *
+ * Сериализация состояния для WebSocket (broadcastState) и MQTT
+ * (publishState) без сетевого стека - собирается в бенчмарке на ПК.
+ */
+
+#ifndef STATE_JSON_H
+#define STATE_JSON_H
+
+#include <Arduino.h>
+#include "types.h"
+
+/**
+ * Память контроллера для WebSocket (на ESP32 - ESP.getFreeHeap() и т.п.)
+ */
+struct MemoryStats {
+    uint32_t heapFree;
+    uint32_t heapTotal;
+    uint32_t psramFree;
+    uint32_t psramTotal;
+    uint32_t flashUsed;             // Размер прошивки
+    uint32_t flashTotal;
+};
+
+namespace StateJson {
+    /**
+     * Состояние для WebSocket /ws
+     * @param state Состояние системы
+     * @param mem Память контроллера
+     * @param json Результат
+     */
+    void serializeWeb(const SystemState& state, const MemoryStats& mem, String& json);
+
+    /**
+     * Состояние для MQTT (<base>/<id>/state)
+     */
+    void serializeMqtt(const SystemState& state, String& json);
+}
+
+#endif // STATE_JSON_H
@@ -7,6 +7,7 @@
 #include "telegram.h"
 #include <WiFiClientSecure.h>
 #include <UniversalTelegramBot.h>
+#include "control/command_bus.h"
 // TelegramCertificate.h уже включён в UniversalTelegramBot.h
 
 static WiFiClientSecure client;
@@ -48,10 +49,15 @@ void update() {
         // Обработка команд
         if (text == "/status") {
             sendMessage("System status: OK");
+        } else if ((text == "/start_rect" || text == "/stop") && from != chatId) {
+            // Управление процессом - только из настроенного чата
+            LOG_W("Telegram: Command from unknown chat %s ignored", from.c_str());
         } else if (text == "/start_rect") {
             sendMessage("Starting rectification...");
+            CommandBus::post(CommandType::START, CommandSource::TELEGRAM, Mode::RECTIFICATION);
         } else if (text == "/stop") {
             sendMessage("Stopping process...");
+            CommandBus::post(CommandType::STOP, CommandSource::TELEGRAM);
         } else {
             sendMessage("Unknown command. Try /status");
         }
@@ -30,14 +30,55 @@ typedef enum {
 #include "storage/nvs_manager.h"
 #include "drivers/sensors.h"
 #include "control/fsm.h"
+#include "control/command_bus.h"
+#include "control/state_snapshot.h"
+#include "control/watt_control.h"
+#include "control/pid_autotune.h"
+#include "storage/logger.h"
+#include "storage/flight_recorder.h"
+#include "../profiles.h"
+#include "state_json.h"
+#include <memory>
 
 // Внешние переменные из main.cpp
-extern SystemState g_state;
+// (g_state читается только через StateSnapshot - обработчики работают в задаче AsyncTCP)
 extern Settings g_settings;
 extern EnergyHistory g_energyHistory;
 
 static AsyncWebServer server(WEB_SERVER_PORT);
 static AsyncWebSocket ws("/ws");
+static AsyncWebSocket logWs("/api/log/stream");
+
+/**
+ * Ответ на команду управления процессом
+ */
+static void sendCommandResult(AsyncWebServerRequest *request, CommandResult result,
+                              const char* okMessage) {
+    int code = 200;
+    switch (result) {
+        case CommandResult::OK:         code = 200; break;
+        case CommandResult::NO_PROFILE: code = 404; break;
+        case CommandResult::QUEUE_FULL: code = 503; break;
+        case CommandResult::TIMEOUT:    code = 504; break;
+        default:                        code = 409; break;
+    }
+
+    char response[128];
+    snprintf(response, sizeof(response), "{\"success\":%s,\"message\":\"%s\"}",
+             result == CommandResult::OK ? "true" : "false",
+             result == CommandResult::OK ? okMessage : CommandBus::resultString(result));
+    request->send(code, "application/json", response);
+}
+
+/**
+ * Приёмник отложенного лога: строки в WebSocket /api/log/stream
+ */
+static void logStreamSink(uint8_t level, uint32_t timeMs, const char* line, size_t len) {
+    (void)level;
+    (void)timeMs;
+    if (logWs.count() == 0) return;
+    logWs.textAll(line, len);
+}
 
 namespace WebServer {
 
@@ -59,6 +100,28 @@ void init() {
 
     server.addHandler(&ws);
 
+    // Поток отладочного лога
+    server.addHandler(&logWs);
+    DeferredLog::addSink(logStreamSink);
+
+    // POST /api/log/file - запись отладочного лога в /logs/debug.txt
+    server.on("/api/log/file", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            if (index + len != total) {
+                return;
+            }
+
+            StaticJsonDocument<64> doc;
+            if (deserializeJson(doc, data, len) || !doc["enabled"].is<bool>()) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Invalid JSON\"}");
+                return;
+            }
+
+            DeferredLog::setFileEnabled(doc["enabled"].as<bool>());
+            request->send(200, "application/json", "{\"success\":true}");
+        }
+    );
+
     // Статические файлы (Web UI)
     server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
 
@@ -70,44 +133,75 @@ void init() {
 
     // GET /api/health - получить здоровье системы
     server.on("/api/health", HTTP_GET, [](AsyncWebServerRequest *request) {
-        StaticJsonDocument<512> doc;
+        StaticJsonDocument<768> doc;
+
+        // Согласованный снимок: все поля из одного прохода loop()
+        SystemState state;
+        StateSnapshot::read(state);
 
         // Датчики температуры
         JsonObject temps = doc.createNestedObject("temperatures");
-        temps["ok"] = g_state.health.tempSensorsOk;
-        temps["total"] = g_state.health.tempSensorsTotal;
+        temps["ok"] = state.health.tempSensorsOk;
+        temps["total"] = state.health.tempSensorsTotal;
 
         // Другие датчики
         JsonObject sensors = doc.createNestedObject("sensors");
-        sensors["bmp280"] = g_state.health.bmp280Ok;
-        sensors["ads1115"] = g_state.health.ads1115Ok;
-        sensors["pzem"] = g_state.health.pzemOk;
+        sensors["bmp280"] = state.health.bmp280Ok;
+        sensors["ads1115"] = state.health.ads1115Ok;
+        sensors["pzem"] = state.health.pzemOk;
 
         // WiFi
         JsonObject wifi = doc.createNestedObject("wifi");
-        wifi["connected"] = g_state.health.wifiConnected;
-        wifi["rssi"] = g_state.health.wifiRSSI;
+        wifi["connected"] = state.health.wifiConnected;
+        wifi["rssi"] = state.health.wifiRSSI;
 
         // Система
         JsonObject system = doc.createNestedObject("system");
-        system["uptime"] = g_state.health.uptime;
-        system["freeHeap"] = g_state.health.freeHeap;
-        system["cpuTemp"] = g_state.health.cpuTemp;
+        system["uptime"] = state.health.uptime;
+        system["freeHeap"] = state.health.freeHeap;
+        system["cpuTemp"] = state.health.cpuTemp;
+        system["resetReason"] = FlightRecorder::getResetReason();
+        system["nvsCommits"] = NVSManager::getCommitCount();
 
         // Ошибки
         JsonObject errors = doc.createNestedObject("errors");
-        errors["pzemSpikes"] = g_state.health.pzemSpikeCount;
-        errors["tempErrors"] = g_state.health.tempReadErrors;
+        errors["pzemSpikes"] = state.health.pzemSpikeCount;
+        errors["tempErrors"] = state.health.tempReadErrors;
+
+        // Логгер (износ флеш)
+        LoggerStats logStats;
+        Logger::getStats(logStats);
+        JsonObject logger = doc.createNestedObject("logger");
+        logger["bytesWritten"] = logStats.bytesWritten;
+        logger["bytesThisHour"] = logStats.bytesThisHour;
+        logger["bytesLastHour"] = logStats.bytesLastHour;
+        logger["blocks"] = logStats.blocksWritten;
+        logger["dropped"] = logStats.droppedRecords;
+        logger["segments"] = logStats.segmentsOpened;
+        logger["pending"] = logStats.ringPending;
+        logger["psram"] = logStats.ringInPsram;
+        logger["freeSpace"] = Logger::getFreeSpace();
+        logger["debugDropped"] = DeferredLog::getDropped();
+        logger["debugFile"] = DeferredLog::isFileEnabled();
 
         // Общая оценка
-        doc["overallHealth"] = g_state.health.overallHealth;
-        doc["lastUpdate"] = g_state.health.lastUpdate;
+        doc["overallHealth"] = state.health.overallHealth;
+        doc["lastUpdate"] = state.health.lastUpdate;
 
         String json;
         serializeJson(doc, json);
         request->send(200, "application/json", json);
     });
 
+    // GET /api/crash/last - отчёт бортового самописца о последней аварии
+    server.on("/api/crash/last", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (!SPIFFS.exists(CRASH_REPORT_FILE)) {
+            request->send(404, "application/json", "{\"error\":\"No crash report\"}");
+            return;
+        }
+        request->send(SPIFFS, CRASH_REPORT_FILE, "application/json");
+    });
+
     // GET /api/version - получить информацию о версиях прошивки и фронтенда
     server.on("/api/version", HTTP_GET, [](AsyncWebServerRequest *request) {
         StaticJsonDocument<512> doc;
@@ -182,20 +276,41 @@ void init() {
                 mode = Mode::DISTILLATION;
             } else if (strcmp(modeStr, "manual") == 0 || strcmp(modeStr, "manual_rect") == 0) {
                 mode = Mode::MANUAL_RECT;
+            } else if (strcmp(modeStr, "mashing") == 0) {
+                mode = Mode::MASHING;
+            } else if (strcmp(modeStr, "hold") == 0) {
+                mode = Mode::HOLD;
             } else {
                 request->send(400, "application/json", "{\"success\":false,\"message\":\"Unknown mode\"}");
                 return;
             }
 
+            // Параметр режима: номер профиля затирки или T выдержки
+            float value = doc["value"] | 0.0f;
+            if (mode == Mode::MASHING && (value < 0 || value >= MASH_PROFILE_COUNT)) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Mash profile out of range\"}");
+                return;
+            }
+            if (mode == Mode::HOLD && (value < HOLD_SETPOINT_MIN || value > HOLD_SETPOINT_MAX)) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Setpoint out of range\"}");
+                return;
+            }
+
             // Проверка термометров (только предупреждение, не блокируем запуск)
-            bool sensorsOk = g_state.health.tempSensorsTotal > 0 && g_state.health.tempSensorsOk;
+            SystemState state;
+            StateSnapshot::read(state);
+            bool sensorsOk = state.health.tempSensorsTotal > 0 && state.health.tempSensorsOk;
 
             if (!sensorsOk) {
                 LOG_W("Starting process without temperature sensors!");
             }
 
-            // Запуск через FSM
-            FSM::startMode(g_state, g_settings, mode);
+            // Запуск выполняет задача управления
+            CommandResult result = CommandBus::execute(CommandType::START, CommandSource::WEB, mode, value);
+            if (result != CommandResult::OK) {
+                sendCommandResult(request, result, nullptr);
+                return;
+            }
 
             LOG_I("Process started: mode=%s, sensors=%s", modeStr, sensorsOk ? "OK" : "WARNING");
 
@@ -212,23 +327,124 @@ void init() {
 
     // POST /api/process/stop - остановка процесса
     server.on("/api/process/stop", HTTP_POST, [](AsyncWebServerRequest *request) {
-        FSM::stopMode(g_state);
-        LOG_I("Process stopped via API");
-        request->send(200, "application/json", "{\"success\":true,\"message\":\"Process stopped\"}");
+        CommandResult result = CommandBus::execute(CommandType::STOP, CommandSource::WEB);
+        sendCommandResult(request, result, "Process stopped");
     });
 
     // POST /api/process/pause - пауза
     server.on("/api/process/pause", HTTP_POST, [](AsyncWebServerRequest *request) {
-        FSM::pause(g_state);
-        LOG_I("Process paused via API");
-        request->send(200, "application/json", "{\"success\":true,\"message\":\"Process paused\"}");
+        CommandResult result = CommandBus::execute(CommandType::PAUSE, CommandSource::WEB);
+        sendCommandResult(request, result, "Process paused");
     });
 
     // POST /api/process/resume - возобновление
     server.on("/api/process/resume", HTTP_POST, [](AsyncWebServerRequest *request) {
-        FSM::resume(g_state);
-        LOG_I("Process resumed via API");
-        request->send(200, "application/json", "{\"success\":true,\"message\":\"Process resumed\"}");
+        CommandResult result = CommandBus::execute(CommandType::RESUME, CommandSource::WEB);
+        sendCommandResult(request, result, "Process resumed");
+    });
+
+    // ==========================================================================
+    // ПРОФИЛИ
+    // ==========================================================================
+
+    // GET /api/profiles/export?builtin=1 - все профили JSON массивом.
+    // Ответ chunked: профили сериализуются по одному по мере отправки
+    server.on("/api/profiles/export", HTTP_GET, [](AsyncWebServerRequest *request) {
+        bool includeBuiltin = request->hasParam("builtin") &&
+                              request->getParam("builtin")->value() == "1";
+        std::shared_ptr<ProfileExporter> exporter = std::make_shared<ProfileExporter>(includeBuiltin);
+
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [exporter](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                (void)index;
+                return exporter->read(buffer, maxLen);
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=\"profiles.json\"");
+        request->send(response);
+    });
+
+    // POST /api/profiles/apply - применение профиля {"id": "..."}:
+    // план погона вступит в силу при следующем старте
+    server.on("/api/profiles/apply", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            if (index + len != total) {
+                return;
+            }
+
+            StaticJsonDocument<128> doc;
+            DeserializationError error = deserializeJson(doc, data, len);
+            const char* id = error ? nullptr : doc["id"].as<const char*>();
+            if (!id || !id[0] || strlen(id) >= RUN_PLAN_ID_LEN) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Profile id required\"}");
+                return;
+            }
+
+            // Загрузку и компиляцию выполняет задача управления
+            CommandResult result = CommandBus::applyProfile(CommandSource::WEB, id);
+            sendCommandResult(request, result, "Profile applied");
+        }
+    );
+
+    // POST /api/profiles/import - импорт массива профилей или одного профиля.
+    // Тело пишется во временный файл по мере поступления, разбор и запись
+    // профилей - в фоновой задаче (ответ 202, итог - GET /api/profiles/import)
+    server.on("/api/profiles/import", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            static File upload;
+            static bool busy = false;
+
+            if (index == 0) {
+                if (upload) upload.close();
+                // Файл предыдущей загрузки ещё читает задача импорта
+                ProfileImportStatus status;
+                getProfileImportStatus(status);
+                busy = status.running;
+                if (!busy) upload = SPIFFS.open(PROFILES_IMPORT_TMP, FILE_WRITE);
+            }
+
+            if (busy) {
+                if (index + len == total) {
+                    request->send(409, "application/json", "{\"success\":false,\"message\":\"Import already running\"}");
+                }
+                return;
+            }
+
+            if (!upload) {
+                if (index + len == total) {
+                    request->send(500, "application/json", "{\"success\":false,\"message\":\"Storage error\"}");
+                }
+                return;
+            }
+
+            upload.write(data, len);
+
+            // Ждем получения всех данных
+            if (index + len != total) {
+                return;
+            }
+            upload.close();
+
+            if (!startProfileImport()) {
+                SPIFFS.remove(PROFILES_IMPORT_TMP);
+                request->send(503, "application/json", "{\"success\":false,\"message\":\"Import not started\"}");
+                return;
+            }
+
+            LOG_I("Profiles import: %u bytes queued", (unsigned)total);
+            request->send(202, "application/json", "{\"success\":true,\"running\":true}");
+        }
+    );
+
+    // GET /api/profiles/import - ход и итог последнего импорта
+    server.on("/api/profiles/import", HTTP_GET, [](AsyncWebServerRequest *request) {
+        ProfileImportStatus status;
+        getProfileImportStatus(status);
+
+        char response[96];
+        snprintf(response, sizeof(response),
+                 "{\"running\":%s,\"imported\":%u,\"failed\":%u}",
+                 status.running ? "true" : "false", status.imported, status.failed);
+        request->send(200, "application/json", response);
     });
 
     // ==========================================================================
@@ -237,7 +453,9 @@ void init() {
 
     // GET /api/calibration - получить все данные калибровки
     server.on("/api/calibration", HTTP_GET, [](AsyncWebServerRequest *request) {
-        StaticJsonDocument<1024> doc;
+        StaticJsonDocument<1536> doc;
+        SystemState state;
+        StateSnapshot::read(state);
 
         // Насос
         JsonObject pump = doc.createNestedObject("pump");
@@ -264,16 +482,16 @@ void init() {
             // Текущие показания
             float currentTemp = 0;
             switch(i) {
-                case TEMP_CUBE: currentTemp = g_state.temps.cube; break;
-                case TEMP_COLUMN_BOTTOM: currentTemp = g_state.temps.columnBottom; break;
-                case TEMP_COLUMN_TOP: currentTemp = g_state.temps.columnTop; break;
-                case TEMP_REFLUX: currentTemp = g_state.temps.reflux; break;
-                case TEMP_TSA: currentTemp = g_state.temps.tsa; break;
-                case TEMP_WATER_IN: currentTemp = g_state.temps.waterIn; break;
-                case TEMP_WATER_OUT: currentTemp = g_state.temps.waterOut; break;
+                case TEMP_CUBE: currentTemp = state.temps.cube; break;
+                case TEMP_COLUMN_BOTTOM: currentTemp = state.temps.columnBottom; break;
+                case TEMP_COLUMN_TOP: currentTemp = state.temps.columnTop; break;
+                case TEMP_REFLUX: currentTemp = state.temps.reflux; break;
+                case TEMP_TSA: currentTemp = state.temps.tsa; break;
+                case TEMP_WATER_IN: currentTemp = state.temps.waterIn; break;
+                case TEMP_WATER_OUT: currentTemp = state.temps.waterOut; break;
             }
             t["current"] = currentTemp;
-            t["valid"] = g_state.temps.valid[i];
+            t["valid"] = state.temps.valid[i];
         }
 
         // Ареометр (гидрометр)
@@ -286,9 +504,19 @@ void init() {
             pressurePoints.add(g_settings.hydroCal.pressurePoints[i]);
         }
         // Текущие показания
-        hydro["currentPressure"] = g_state.hydrometer.density; // TODO: использовать реальное давление
-        hydro["currentABV"] = g_state.hydrometer.abv;
-        hydro["valid"] = g_state.hydrometer.valid;
+        hydro["currentPressure"] = state.hydrometer.density; // TODO: использовать реальное давление
+        hydro["currentABV"] = state.hydrometer.abv;
+        hydro["valid"] = state.hydrometer.valid;
+
+        // Порог захлёба
+        JsonObject flood = doc.createNestedObject("flood");
+        flood["pressure"] = g_settings.floodCal.pressure;
+        flood["powerPercent"] = g_settings.floodCal.powerPercent;
+        flood["heaterPowerW"] = g_settings.floodCal.heaterPowerW;
+        flood["estimated"] = WattControl::calculateFloodPressure(
+            g_settings.equipment.columnHeightMm, g_settings.equipment.packingCoeff);
+        flood["active"] = state.mode == Mode::FLOOD_CALIBRATION;
+        flood["currentPressure"] = state.pressure.cube;
 
         String json;
         serializeJson(doc, json);
@@ -316,7 +544,7 @@ void init() {
                     g_settings.pumpCal.stepsPerRevolution = doc["stepsPerRev"].as<uint16_t>();
                     LOG_I("Pump stepsPerRev: %u", g_settings.pumpCal.stepsPerRevolution);
                 }
-                NVSManager::saveSettings(g_settings);
+                NVSManager::markDirty();
                 request->send(200, "application/json", "{\"status\":\"ok\",\"method\":\"direct\"}");
                 return;
             }
@@ -331,7 +559,7 @@ void init() {
 
                 if (revolutions > 0) {
                     g_settings.pumpCal.mlPerRevolution = knownVolume / revolutions;
-                    NVSManager::saveSettings(g_settings);
+                    NVSManager::markDirty();
 
                     LOG_I("Pump calibrated: %.3f ml/rev (from %.1f ml in %u steps)",
                         g_settings.pumpCal.mlPerRevolution, knownVolume, steps);
@@ -378,7 +606,7 @@ void init() {
 
                 // Применить калибровку к драйверу
                 Sensors::applyCalibration(g_settings.tempCal);
-                NVSManager::saveSettings(g_settings);
+                NVSManager::markDirty();
 
                 LOG_I("Temp[%d] calibrated: offset = %.2f°C",
                     sensorIndex, g_settings.tempCal.offsets[sensorIndex]);
@@ -392,15 +620,17 @@ void init() {
                 float reference = doc["reference"].as<float>();  // Эталонная температура
 
                 // Прочитать текущее значение
+                SystemState state;
+                StateSnapshot::read(state);
                 float currentTemp = 0;
                 switch(sensorIndex) {
-                    case TEMP_CUBE: currentTemp = g_state.temps.cube; break;
-                    case TEMP_COLUMN_BOTTOM: currentTemp = g_state.temps.columnBottom; break;
-                    case TEMP_COLUMN_TOP: currentTemp = g_state.temps.columnTop; break;
-                    case TEMP_REFLUX: currentTemp = g_state.temps.reflux; break;
-                    case TEMP_TSA: currentTemp = g_state.temps.tsa; break;
-                    case TEMP_WATER_IN: currentTemp = g_state.temps.waterIn; break;
-                    case TEMP_WATER_OUT: currentTemp = g_state.temps.waterOut; break;
+                    case TEMP_CUBE: currentTemp = state.temps.cube; break;
+                    case TEMP_COLUMN_BOTTOM: currentTemp = state.temps.columnBottom; break;
+                    case TEMP_COLUMN_TOP: currentTemp = state.temps.columnTop; break;
+                    case TEMP_REFLUX: currentTemp = state.temps.reflux; break;
+                    case TEMP_TSA: currentTemp = state.temps.tsa; break;
+                    case TEMP_WATER_IN: currentTemp = state.temps.waterIn; break;
+                    case TEMP_WATER_OUT: currentTemp = state.temps.waterOut; break;
                 }
 
                 // Вычислить смещение (без учёта старого смещения)
@@ -408,7 +638,7 @@ void init() {
                 g_settings.tempCal.offsets[sensorIndex] = reference - rawTemp;
 
                 Sensors::applyCalibration(g_settings.tempCal);
-                NVSManager::saveSettings(g_settings);
+                NVSManager::markDirty();
 
                 LOG_I("Temp[%d] calibrated to %.2f°C: offset = %.2f°C",
                     sensorIndex, reference, g_settings.tempCal.offsets[sensorIndex]);
@@ -461,7 +691,7 @@ void init() {
             }
 
             // Сохранить в NVS
-            NVSManager::saveSettings(g_settings);
+            NVSManager::markDirty();
 
             StaticJsonDocument<128> resp;
             resp["status"] = "ok";
@@ -473,6 +703,61 @@ void init() {
         }
     );
 
+    // POST /api/calibration/flood - прогон калибровки захлёба
+    server.on("/api/calibration/flood", HTTP_POST, [](AsyncWebServerRequest *request) {
+        CommandResult result = CommandBus::execute(CommandType::START, CommandSource::WEB,
+                                                   Mode::FLOOD_CALIBRATION);
+        sendCommandResult(request, result, "Flood calibration started");
+    });
+
+    // POST /api/pid/autotune - релейная автонастройка ПИД по T куба
+    server.on("/api/pid/autotune", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            if (index + len != total) {
+                return;
+            }
+
+            StaticJsonDocument<128> doc;
+            if (deserializeJson(doc, data, len)) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Invalid JSON\"}");
+                return;
+            }
+
+            float setpoint = doc["setpoint"] | 0.0f;
+            if (setpoint < AUTOTUNE_SETPOINT_MIN || setpoint > AUTOTUNE_SETPOINT_MAX) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Setpoint out of range\"}");
+                return;
+            }
+
+            CommandResult result = CommandBus::execute(CommandType::START, CommandSource::WEB,
+                                                       Mode::PID_AUTOTUNE, setpoint);
+            sendCommandResult(request, result, "PID autotune started");
+        }
+    );
+
+    // GET /api/pid/autotune - ход и результат автонастройки
+    server.on("/api/pid/autotune", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AutotuneResult result;
+        PidAutotune::getResult(result);
+
+        StaticJsonDocument<384> doc;
+        doc["status"] = PidAutotune::getStatusName(result.status);
+        doc["setpoint"] = result.setpoint;
+        doc["cycles"] = result.cycles;
+        doc["bias"] = result.bias;
+        doc["amplitude"] = result.amplitude;
+        doc["ku"] = result.ku;
+        doc["tu"] = result.tuSec;
+        doc["kp"] = result.kp;
+        doc["ki"] = result.ki;
+        doc["kd"] = result.kd;
+        doc["saved"] = result.saved;
+
+        String json;
+        serializeJson(doc, json);
+        request->send(200, "application/json", json);
+    });
+
     // GET /api/calibration/scan - сканирование DS18B20
     server.on("/api/calibration/scan", HTTP_GET, [](AsyncWebServerRequest *request) {
         uint8_t addresses[TEMP_COUNT][8];
@@ -628,24 +913,20 @@ void init() {
 
             g_settings.wifi.apMode = false;
 
-            // Сохранить в NVS
-            if (NVSManager::saveSettings(g_settings)) {
-                LOG_I("WiFi: Settings saved, connecting to %s", ssid);
+            // Сохранить в NVS (запись выполнит фоновая задача)
+            NVSManager::markDirty();
+            LOG_I("WiFi: Settings updated, connecting to %s", ssid);
 
-                // Отправить ответ перед переподключением
-                request->send(200, "application/json", "{\"status\":\"connecting\",\"message\":\"Connecting to WiFi, please wait...\"}");
+            // Отправить ответ перед переподключением
+            request->send(200, "application/json", "{\"status\":\"connecting\",\"message\":\"Connecting to WiFi, please wait...\"}");
 
-                // Попытка подключения через небольшую задержку
-                // чтобы ответ успел уйти клиенту
-                delay(100);
+            // Попытка подключения через небольшую задержку
+            // чтобы ответ успел уйти клиенту
+            delay(100);
 
-                WiFi.disconnect();
-                WiFi.mode(WIFI_STA);
-                WiFi.begin(g_settings.wifi.ssid, g_settings.wifi.password);
-            } else {
-                LOG_E("WiFi: Failed to save settings to NVS");
-                request->send(500, "application/json", "{\"error\":\"Failed to save settings\"}");
-            }
+            WiFi.disconnect();
+            WiFi.mode(WIFI_STA);
+            WiFi.begin(g_settings.wifi.ssid, g_settings.wifi.password);
         }
     );
 
@@ -738,6 +1019,8 @@ void init() {
             if (shouldReboot) {
                 LOG_I("OTA: Update successful, rebooting...");
                 delay(1000);
+                NVSManager::flush();
+                DeferredLog::flush();
                 ESP.restart();
             } else {
                 LOG_E("OTA: Update failed!");
@@ -781,43 +1064,16 @@ void init() {
 void broadcastState(const SystemState& state) {
     if (ws.count() == 0) return;
 
-    // Сформировать JSON со состоянием
-    StaticJsonDocument<1536> doc;
-
-    doc["mode"] = static_cast<int>(state.mode);
-    doc["phase"] = static_cast<int>(state.rectPhase);
-    doc["t_cube"] = state.temps.cube;
-    doc["t_column"] = state.temps.columnTop;
-    doc["power"] = state.power.power;
-    doc["speed"] = state.pump.speedMlPerHour;
-    doc["volume"] = state.pump.totalVolumeMl;
-
-    // Статистика памяти
-    JsonObject mem = doc.createNestedObject("memory");
-    mem["heap_free"] = ESP.getFreeHeap();
-    mem["heap_total"] = ESP.getHeapSize();
-    mem["heap_used_pct"] = (ESP.getHeapSize() - ESP.getFreeHeap()) * 100 / ESP.getHeapSize();
-    mem["psram_free"] = ESP.getFreePsram();
-    mem["psram_total"] = ESP.getPsramSize();
-    mem["flash_used"] = ESP.getSketchSize();
-    mem["flash_total"] = ESP.getFlashChipSize();
-    mem["flash_used_pct"] = ESP.getSketchSize() * 100 / ESP.getFlashChipSize();
-
-    // Здоровье системы
-    JsonObject health = doc.createNestedObject("health");
-    health["overall"] = state.health.overallHealth;
-    health["tempSensorsOk"] = state.health.tempSensorsOk;
-    health["tempSensorsTotal"] = state.health.tempSensorsTotal;
-    health["bmp280"] = state.health.bmp280Ok;
-    health["ads1115"] = state.health.ads1115Ok;
-    health["pzem"] = state.health.pzemOk;
-    health["wifiRSSI"] = state.health.wifiRSSI;
-    health["pzemSpikes"] = state.health.pzemSpikeCount;
-    health["tempErrors"] = state.health.tempReadErrors;
-    health["cpuTemp"] = state.health.cpuTemp;
+    MemoryStats mem;
+    mem.heapFree = ESP.getFreeHeap();
+    mem.heapTotal = ESP.getHeapSize();
+    mem.psramFree = ESP.getFreePsram();
+    mem.psramTotal = ESP.getPsramSize();
+    mem.flashUsed = ESP.getSketchSize();
+    mem.flashTotal = ESP.getFlashChipSize();
 
     String json;
-    serializeJson(doc, json);
+    StateJson::serializeWeb(state, mem, json);
     ws.textAll(json);
 }
 
@@ -6,7 +6,6 @@
  */
 
 #include <Arduino.h>
-#include <Wire.h>
 #include <WiFi.h>
 #include "fs_compat.h"
 #include <esp_task_wdt.h>
@@ -14,6 +13,7 @@
 
 #include "config.h"
 #include "types.h"
+#include "hal/hal.h"
 
 // Драйверы
 #include "drivers/sensors.h"
@@ -25,7 +25,12 @@
 // Управление
 #include "control/safety.h"
 #include "control/fsm.h"
+#include "control/command_bus.h"
+#include "control/state_snapshot.h"
 #include "control/watt_control.h"
+#include "control/temp_filter.h"
+#include "control/vle.h"
+#include "control/mash_sequencer.h"
 
 // Интерфейсы
 #include "interface/webserver.h"
@@ -37,6 +42,9 @@
 // Хранение
 #include "storage/nvs_manager.h"
 #include "storage/logger.h"
+#include "storage/flight_recorder.h"
+#include "profiles.h"
+#include "history.h"
 
 // =============================================================================
 // ГЛОБАЛЬНЫЕ ОБЪЕКТЫ
@@ -71,10 +79,10 @@ void runTasks();
 namespace Buzzer {
     void beep(uint8_t count, uint16_t duration) {
         for (uint8_t i = 0; i < count; i++) {
-            digitalWrite(PIN_BUZZER, HIGH);
-            delay(duration);
-            digitalWrite(PIN_BUZZER, LOW);
-            if (i < count - 1) delay(duration);
+            Hal::gpioWrite(PIN_BUZZER, HIGH);
+            Hal::delayMs(duration);
+            Hal::gpioWrite(PIN_BUZZER, LOW);
+            if (i < count - 1) Hal::delayMs(duration);
         }
     }
 
@@ -92,6 +100,9 @@ void setup() {
     Serial.begin(115200);
     delay(100);
 
+    // Вывод LOG_* (записи до этого момента уже в очереди)
+    DeferredLog::init();
+
     // WatchDog Timer - защита от зависаний
     esp_task_wdt_init(30, true);  // 30 сек таймаут, паника при срабатывании
     esp_task_wdt_add(NULL);        // Регистрация главной задачи
@@ -118,6 +129,9 @@ void setup() {
               SPIFFS.usedBytes() / 1024, 
               SPIFFS.totalBytes() / 1024);
     }
+
+    // Бортовой самописец (отчёт об аварии, если сброс был аварийным)
+    FlightRecorder::init();
     
     // NVS - загрузка настроек
     LOG_I("Loading settings...");
@@ -132,6 +146,10 @@ void setup() {
     LOG_I("Initializing network...");
     initNetwork();
     
+    // Команды управления (до веб-сервера: обработчики сразу ставят их в очередь)
+    CommandBus::init();
+    StateSnapshot::publish(g_state);
+
     // Веб-сервер
     LOG_I("Starting web server...");
     WebServer::init();
@@ -164,6 +182,10 @@ void setup() {
     // Логгер
     Logger::init();
     Logger::log(LogEvent{millis(), 0, "System started"});
+
+    // Профили (применяются через план погона) и история процессов
+    initProfiles();
+    initHistory();
     
     // Готово
     LOG_I("=================================");
@@ -192,16 +214,24 @@ void loop() {
         return;
     }
 
+    // Шаги насоса (runSpeed нужно вызывать как можно чаще)
+    Pump::update();
+
     // Проверка безопасности (высший приоритет)
     if (now - g_lastSafetyCheck >= INTERVAL_SAFETY_CHECK) {
         g_lastSafetyCheck = now;
         Safety::check(g_state, g_settings);
     }
+
+    // Бортовой самописец (дёшево, срез раз в секунду)
+    FlightRecorder::record(g_state);
     
     // Чтение температур
     if (now - g_lastTempRead >= INTERVAL_TEMP_READ) {
         g_lastTempRead = now;
         Sensors::readTemperatures(g_state.temps);
+        TempFilter::update(g_state.temps);
+        Vle::update(g_state);
     }
     
     // Чтение давления
@@ -217,6 +247,10 @@ void loop() {
         Sensors::readPower(g_state.power);
     }
     
+    // Команды от веб-сервера, MQTT, Telegram (единственное место,
+    // где сеть меняет режим процесса)
+    CommandBus::process(g_state, g_settings);
+
     // FSM - конечный автомат режимов
     if (g_state.safetyOk && !g_state.paused) {
         FSM::update(g_state, g_settings);
@@ -238,6 +272,23 @@ void loop() {
     if (g_state.mode != Mode::IDLE && now - g_lastLogWrite >= INTERVAL_LOG_WRITE) {
         g_lastLogWrite = now;
         Logger::writeData(g_state);
+
+        // Временной ряд истории (ProcessRecorder прореживает до TIMESERIES_INTERVAL)
+        TimeseriesPoint point;
+        point.time = now / 1000;
+        point.cube = g_state.temps.cube;
+        point.columnTop = g_state.temps.columnTop;
+        point.columnBottom = g_state.temps.columnBottom;
+        point.deflegmator = g_state.temps.reflux;
+        point.power = g_state.power.power;
+        point.voltage = g_state.power.voltage;
+        point.current = g_state.power.current;
+        point.pumpSpeed = g_state.pump.speedMlPerHour;
+        point.cubeAbv = g_state.vle.cubeValid ? g_state.vle.cubeAbv : 0;
+        point.distillateAbv = g_state.vle.distillateValid ? g_state.vle.distillateAbv : 0;
+        point.phase = static_cast<uint8_t>(g_state.rectPhase);
+        point.volume = g_state.pump.totalVolumeMl;
+        processRecorder.addTimeseriesPoint(point);
     }
 
     // Запись истории энергопотребления (каждые 5 минут)
@@ -320,6 +371,9 @@ void loop() {
         }
     }
 
+    // Снимок состояния для задач веб-сервера (конец прохода)
+    StateSnapshot::publish(g_state);
+
     // Сброс WatchDog Timer (подтверждение работы)
     esp_task_wdt_reset();
 
@@ -333,8 +387,7 @@ void loop() {
 
 void initHardware() {
     // I2C
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
-    Wire.setClock(400000);
+    Hal::i2cBegin(PIN_I2C_SDA, PIN_I2C_SCL, I2C_FREQ_HZ);
     
     // Датчики
     Sensors::init();
@@ -360,8 +413,8 @@ void initHardware() {
     Buttons::init();
     
     // Зуммер
-    pinMode(PIN_BUZZER, OUTPUT);
-    digitalWrite(PIN_BUZZER, LOW);
+    Hal::gpioMode(PIN_BUZZER, OUTPUT);
+    Hal::gpioWrite(PIN_BUZZER, LOW);
 }
 
 // =============================================================================
@@ -444,6 +497,9 @@ void loadSettings() {
     g_settings.rectParams.bodySpeedMlHKw = RECT_HEADS_SPEED_ML_H_KW * 2;
     g_settings.rectParams.stabilizationMin = RECT_STABILIZATION_TIME_MIN;
     g_settings.rectParams.purgeMin = RECT_PURGE_TIME_MIN;
+
+    // Затирка - встроенные профили
+    MashSequencer::defaultProfiles(g_settings.mashProfiles);
     
     // Фракционник - все позиции по умолчанию
     g_settings.fractionator.enabled = false;
@@ -466,6 +522,9 @@ void loadSettings() {
     
     // Загрузка из NVS (перезапишет дефолты)
     NVSManager::loadSettings(g_settings);
+
+    // Отложенная запись: обработчики только помечают настройки изменёнными
+    NVSManager::startWriteBehind(g_settings);
     
     LOG_I("Settings loaded");
 }
@@ -5,68 +5,421 @@
 #include "profiles.h"
 #include <FS.h>
 #include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "crc32.h"
+
+extern Settings g_settings;
 
 // ============================================================================
-// Инициализация системы профилей
+// Встроенные рецепты (флеш, не копируются в файловую систему)
 // ============================================================================
 
-bool initProfiles() {
-    Serial.println("Инициализация системы профилей...");
+static constexpr BuiltinRecipe BUILTIN_RECIPES[] = {
+    // 1. Сахарная брага 40%
+    {
+        "builtin_sugar_40",
+        "Сахарная брага 40%",
+        "Классическая ректификация сахарной браги с крепостью 40%",
+        "rectification",
+        {"сахар", "классика", "40%"},
+        "rectification", "classic", 40.0f,
+        {3000, true, 2.0f, 0.5f, 1.0f},
+        {20, 50, 2000, 100, 150, 300, 400, 5},
+        {0, 0, 0, 0.0f, 0.0f, 0, {0.0f, 0.0f, 0.0f, 0.0f}, {0, 0, 0, 0}},
+        {98.0f, 82.0f, 78.5f, 78.0f, 85.0f},
+        {720, 2.0f, 150}
+    },
+    // 2. Зерновая брага 12%
+    {
+        "builtin_grain_12",
+        "Зерновая брага 12%",
+        "Бережная ректификация зерновой браги с сохранением органолептики",
+        "rectification",
+        {"зерно", "пшеница", "12%"},
+        "rectification", "classic", 12.0f,
+        {2500, true, 2.0f, 0.5f, 1.0f},
+        {30, 100, 2500, 150, 120, 250, 350, 5},
+        {0, 0, 0, 0.0f, 0.0f, 0, {0.0f, 0.0f, 0.0f, 0.0f}, {0, 0, 0, 0}},
+        {98.0f, 82.0f, 78.0f, 77.5f, 84.0f},
+        {720, 2.0f, 150}
+    },
+    // 3. Фруктовая дистилляция
+    {
+        "builtin_fruit_dist",
+        "Фруктовая дистилляция",
+        "Бережная дистилляция фруктовых браг с сохранением ароматики",
+        "distillation",
+        {"фрукты", "дистилляция", "аромат"},
+        "distillation", "classic", 8.0f,
+        {2000, false, 2.0f, 0.5f, 1.0f},
+        {0, 0, 0, 0, 0, 0, 0, 0},
+        // Полная мощность до кипения, мягкий отбор (пена, ароматика),
+        // к концу добор хвостовой части до 96°C
+        {30, 3000, 500, 96.0f, 0.0f, 2, {92.0f, 95.0f, 0.0f, 0.0f}, {70, 85, 0, 0}},
+        {98.0f, 90.0f, 82.0f, 78.0f, 96.0f},
+        {480, 1.5f, 100}
+    },
+};
+
+static constexpr size_t BUILTIN_COUNT = sizeof(BUILTIN_RECIPES) / sizeof(BUILTIN_RECIPES[0]);
+static_assert(BUILTIN_COUNT <= MAX_BUILTIN_PROFILES, "Too many builtin recipes");
 
-    // Проверить, смонтирована ли SPIFFS
-    if (!SPIFFS.begin(true)) {
-        Serial.println("Ошибка: не удалось инициализировать SPIFFS");
-        return false;
+// ============================================================================
+// Индекс и кэш
+// ============================================================================
+
+#define INDEX_MAGIC     0x58444950  // "PIDX"
+#define INDEX_VERSION   1
+
+// Категория в индексе - номер вместо строки
+static const char* const CATEGORY_NAMES[] = { "rectification", "distillation", "mashing" };
+
+/**
+ * Запись компактного индекса (профиль без параметров).
+ * Для встроенных рецептов хранит только статистику.
+ */
+struct ProfileIndexEntry {
+    char id[24];
+    char name[MAX_PROFILE_NAME_LEN + 1];
+    char tags[PROFILE_INDEX_TAGS_LEN];
+    uint8_t category;
+    uint8_t isBuiltin;
+    uint16_t useCount;
+    uint32_t lastUsed;
+    uint32_t created;
+    uint32_t avgDuration;
+    uint16_t avgYield;
+    float successRate;
+};
+
+struct ProfileIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+    uint16_t count;
+    uint16_t reserved;
+};
+
+/**
+ * Слот LRU-кэша разобранных профилей
+ */
+struct ProfileCacheSlot {
+    bool used;
+    uint32_t lastAccess;
+    Profile profile;
+};
+
+static std::vector<ProfileIndexEntry> profileIndex;
+static ProfileCacheSlot profileCache[PROFILE_CACHE_SIZE];
+static uint32_t cacheClock = 0;
+
+// Индекс и кэш меняются из loop (автонастройка, статистика, импорт) и из
+// AsyncTCP (список, экспорт, удаление). Мьютекс рекурсивный: saveProfile
+// вызывает rotateProfiles -> deleteProfile.
+static SemaphoreHandle_t profilesMutex = nullptr;
+
+/**
+ * Захват индекса и кэша на время вызова (до initProfiles - без блокировки)
+ */
+class ProfilesLock {
+public:
+    ProfilesLock() {
+        if (profilesMutex) xSemaphoreTakeRecursive(profilesMutex, portMAX_DELAY);
+    }
+    ~ProfilesLock() {
+        if (profilesMutex) xSemaphoreGiveRecursive(profilesMutex);
     }
+private:
+    ProfilesLock(const ProfilesLock&);
+    ProfilesLock& operator=(const ProfilesLock&);
+};
+
+// Пакет (импорт, ротация): index.bin пишется один раз в конце, а не на
+// каждый сохранённый или удалённый профиль
+static bool indexBatch = false;
+static bool indexDirty = false;
+
+static const BuiltinRecipe* findBuiltin(const String& id) {
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        if (id == BUILTIN_RECIPES[i].id) return &BUILTIN_RECIPES[i];
+    }
+    return nullptr;
+}
 
-    // Проверить существование директории /profiles
-    if (!SPIFFS.exists(PROFILES_DIR)) {
-        Serial.println("Создание директории /profiles");
-        // SPIFFS не требует явного создания директорий
+static uint8_t categoryToIndex(const String& category) {
+    for (uint8_t i = 0; i < 3; i++) {
+        if (category == CATEGORY_NAMES[i]) return i;
     }
+    return 0;
+}
 
-    // Загрузить встроенные рецепты если их нет
-    if (getProfileCount() == 0) {
-        Serial.println("Загрузка встроенных рецептов...");
-        loadBuiltinProfiles();
+static ProfileIndexEntry* findIndexEntry(const String& id) {
+    for (auto& entry : profileIndex) {
+        if (id == entry.id) return &entry;
     }
+    return nullptr;
+}
 
-    // Провести ротацию профилей
-    rotateProfiles();
+static void copyString(char* dst, size_t size, const char* src) {
+    snprintf(dst, size, "%s", src ? src : "");
+}
 
-    Serial.println("Система профилей инициализирована");
-    Serial.printf("Профилей: %d\n", getProfileCount());
+static void applyIndexStatistics(const ProfileIndexEntry* entry, ProfileStatistics& stats) {
+    if (!entry) {
+        memset(&stats, 0, sizeof(stats));
+        return;
+    }
+    stats.useCount = entry->useCount;
+    stats.lastUsed = entry->lastUsed;
+    stats.avgDuration = entry->avgDuration;
+    stats.avgYield = entry->avgYield;
+    stats.successRate = entry->successRate;
+}
+
+static void upsertIndex(const Profile& profile) {
+    ProfileIndexEntry* entry = findIndexEntry(profile.id);
+    if (!entry) {
+        profileIndex.push_back(ProfileIndexEntry());
+        entry = &profileIndex.back();
+        memset(entry, 0, sizeof(*entry));
+
+        // Статистика существующей записи ведётся журналом stats.bin
+        entry->useCount = profile.statistics.useCount;
+        entry->lastUsed = profile.statistics.lastUsed;
+        entry->avgDuration = profile.statistics.avgDuration;
+        entry->avgYield = profile.statistics.avgYield;
+        entry->successRate = profile.statistics.successRate;
+    }
+
+    copyString(entry->id, sizeof(entry->id), profile.id.c_str());
+    copyString(entry->name, sizeof(entry->name), profile.metadata.name.c_str());
+    entry->category = categoryToIndex(profile.metadata.category);
+    entry->isBuiltin = profile.metadata.isBuiltin ? 1 : 0;
+    entry->created = profile.metadata.created;
+
+    // Теги через '|', лишние отбрасываются
+    entry->tags[0] = '\0';
+    size_t used = 0;
+    for (const auto& tag : profile.metadata.tags) {
+        size_t len = tag.length();
+        if (used + len + 2 > sizeof(entry->tags)) break;
+        if (used) entry->tags[used++] = '|';
+        memcpy(entry->tags + used, tag.c_str(), len);
+        used += len;
+        entry->tags[used] = '\0';
+    }
+}
 
+static bool saveIndex() {
+    File file = SPIFFS.open(PROFILES_INDEX_FILE, FILE_WRITE);
+    if (!file) {
+        Serial.println("Ошибка: не удалось записать индекс профилей");
+        return false;
+    }
+
+    ProfileIndexHeader header = { INDEX_MAGIC, INDEX_VERSION, sizeof(ProfileIndexEntry),
+                                  static_cast<uint16_t>(profileIndex.size()), 0 };
+    file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    if (!profileIndex.empty()) {
+        file.write(reinterpret_cast<const uint8_t*>(profileIndex.data()),
+                   profileIndex.size() * sizeof(ProfileIndexEntry));
+    }
+    file.close();
     return true;
 }
 
-// ============================================================================
-// Сохранение профиля
-// ============================================================================
+/**
+ * Запись индекса после изменения (в пакете - отложенная)
+ */
+static void commitIndex() {
+    if (indexBatch) {
+        indexDirty = true;
+        return;
+    }
+    saveIndex();
+}
 
-bool saveProfile(const Profile& profile) {
-    // Валидация
-    if (!validateProfile(profile)) {
-        Serial.println("Ошибка: профиль не прошел валидацию");
-        return false;
+static bool loadIndex() {
+    profileIndex.clear();
+
+    File file = SPIFFS.open(PROFILES_INDEX_FILE, FILE_READ);
+    if (!file) return false;
+
+    ProfileIndexHeader header;
+    bool ok = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+              header.magic == INDEX_MAGIC &&
+              header.version == INDEX_VERSION &&
+              header.entrySize == sizeof(ProfileIndexEntry) &&
+              file.size() == sizeof(header) + header.count * sizeof(ProfileIndexEntry);
+
+    if (ok && header.count > 0) {
+        profileIndex.resize(header.count);
+        size_t bytes = header.count * sizeof(ProfileIndexEntry);
+        ok = file.read(reinterpret_cast<uint8_t*>(profileIndex.data()), bytes) == bytes;
     }
+    file.close();
 
-    String filename = String(PROFILES_DIR) + "/profile_" + profile.id + ".json";
-    Serial.printf("Сохранение профиля: %s\n", filename.c_str());
+    if (!ok) profileIndex.clear();
+    return ok;
+}
 
-    File file = SPIFFS.open(filename, FILE_WRITE);
-    if (!file) {
-        Serial.println("Ошибка: не удалось создать файл профиля");
-        return false;
+static bool loadProfileFile(const String& id, Profile& profile);
+
+/**
+ * Перестроение индекса обходом файлов (только если индекс отсутствует или повреждён)
+ */
+static void rebuildIndex() {
+    Serial.println("Перестроение индекса профилей...");
+    profileIndex.clear();
+
+    std::vector<String> ids;
+    File root = SPIFFS.open(PROFILES_DIR);
+    if (root && root.isDirectory()) {
+        File file = root.openNextFile();
+        while (file) {
+            String filename = file.name();
+            if (!file.isDirectory() && filename.startsWith("profile_") && filename.endsWith(".json")) {
+                ids.push_back(filename.substring(8, filename.length() - 5));
+            }
+            file = root.openNextFile();
+        }
     }
 
-    // Создать JSON документ
-    DynamicJsonDocument doc(8192);  // 8 КБ для профиля
+    for (const auto& id : ids) {
+        Profile profile;
+        if (isBuiltinProfile(id)) {
+            // Старые копии встроенных рецептов - сохранить только статистику
+            if (loadProfileFile(id, profile)) {
+                profile.metadata.isBuiltin = true;
+                upsertIndex(profile);
+            }
+        } else if (loadProfileFile(id, profile)) {
+            upsertIndex(profile);
+        }
+    }
+
+    saveIndex();
+    Serial.printf("Индекс профилей: %d записей\n", (int)profileIndex.size());
+}
+
+static Profile* cacheGet(const String& id) {
+    for (auto& slot : profileCache) {
+        if (slot.used && slot.profile.id == id) {
+            slot.lastAccess = ++cacheClock;
+            return &slot.profile;
+        }
+    }
+    return nullptr;
+}
 
-    doc["id"] = profile.id;
+static void cachePut(const Profile& profile) {
+    // Вытеснение наименее давно использованного
+    ProfileCacheSlot* victim = &profileCache[0];
+    for (auto& slot : profileCache) {
+        if (!slot.used) {
+            victim = &slot;
+            break;
+        }
+        if (slot.lastAccess < victim->lastAccess) victim = &slot;
+    }
+    victim->used = true;
+    victim->lastAccess = ++cacheClock;
+    victim->profile = profile;
+}
+
+static void cacheInvalidate(const String& id) {
+    for (auto& slot : profileCache) {
+        if (slot.used && slot.profile.id == id) {
+            slot.used = false;
+            slot.profile = Profile();
+        }
+    }
+}
+
+static void recipeToProfile(const BuiltinRecipe& recipe, Profile& profile) {
+    profile.id = recipe.id;
+
+    profile.metadata.name = recipe.name;
+    profile.metadata.description = recipe.description;
+    profile.metadata.category = recipe.category;
+    profile.metadata.tags.clear();
+    for (uint8_t i = 0; i < MAX_PROFILE_TAGS; i++) {
+        if (recipe.tags[i]) profile.metadata.tags.push_back(recipe.tags[i]);
+    }
+    profile.metadata.created = 0;
+    profile.metadata.updated = 0;
+    profile.metadata.author = "system";
+    profile.metadata.isBuiltin = true;
+
+    profile.parameters.mode = recipe.mode;
+    profile.parameters.model = recipe.model;
+    profile.parameters.chargeAbv = recipe.chargeAbv;
+    profile.parameters.heater = recipe.heater;
+    profile.parameters.rectification = recipe.rectification;
+    profile.parameters.distillation = recipe.distillation;
+    profile.parameters.temperatures = recipe.temperatures;
+    profile.parameters.safety = recipe.safety;
+
+    applyIndexStatistics(findIndexEntry(profile.id), profile.statistics);
+}
+
+static ProfileListItem builtinListItem(const BuiltinRecipe& recipe) {
+    ProfileListItem item;
+    item.id = recipe.id;
+    item.name = recipe.name;
+    item.category = recipe.category;
+    item.isBuiltin = true;
+
+    const ProfileIndexEntry* entry = findIndexEntry(item.id);
+    item.useCount = entry ? entry->useCount : 0;
+    item.lastUsed = entry ? entry->lastUsed : 0;
+    return item;
+}
+
+static ProfileListItem indexListItem(const ProfileIndexEntry& entry) {
+    ProfileListItem item;
+    item.id = entry.id;
+    item.name = entry.name;
+    item.category = CATEGORY_NAMES[entry.category < 3 ? entry.category : 0];
+    item.useCount = entry.useCount;
+    item.lastUsed = entry.lastUsed;
+    item.isBuiltin = false;
+    return item;
+}
+
+static bool tagMatches(const char* tags, const String& tag) {
+    const char* p = tags;
+    size_t len = tag.length();
+    while (*p) {
+        const char* end = strchr(p, '|');
+        size_t partLen = end ? static_cast<size_t>(end - p) : strlen(p);
+        if (partLen == len && strncmp(p, tag.c_str(), len) == 0) return true;
+        if (!end) break;
+        p = end + 1;
+    }
+    return false;
+}
+
+static void sortList(std::vector<ProfileListItem>& list) {
+    // Сортировать: встроенные первые, затем по частоте использования
+    std::sort(list.begin(), list.end(), [](const ProfileListItem& a, const ProfileListItem& b) {
+        if (a.isBuiltin != b.isBuiltin) return a.isBuiltin;
+        return a.useCount > b.useCount;
+    });
+}
+
+// ============================================================================
+// Сериализация профиля (общая для файлов, экспорта и импорта)
+// ============================================================================
+
+static void profileToJson(const Profile& profile, JsonObject obj) {
+    obj["id"] = profile.id;
 
     // Метаданные
-    JsonObject metadata = doc.createNestedObject("metadata");
+    JsonObject metadata = obj.createNestedObject("metadata");
     metadata["name"] = profile.metadata.name;
     metadata["description"] = profile.metadata.description;
     metadata["category"] = profile.metadata.category;
@@ -82,9 +435,10 @@ bool saveProfile(const Profile& profile) {
     metadata["isBuiltin"] = profile.metadata.isBuiltin;
 
     // Параметры
-    JsonObject parameters = doc.createNestedObject("parameters");
+    JsonObject parameters = obj.createNestedObject("parameters");
     parameters["mode"] = profile.parameters.mode;
     parameters["model"] = profile.parameters.model;
+    parameters["chargeAbv"] = profile.parameters.chargeAbv;
 
     // Нагреватель
     JsonObject heater = parameters.createNestedObject("heater");
@@ -111,6 +465,13 @@ bool saveProfile(const Profile& profile) {
     distillation["targetVolume"] = profile.parameters.distillation.targetVolume;
     distillation["speed"] = profile.parameters.distillation.speed;
     distillation["endTemp"] = profile.parameters.distillation.endTemp;
+    distillation["endAbv"] = profile.parameters.distillation.endAbv;
+    JsonArray schedule = distillation.createNestedArray("powerSchedule");
+    for (uint8_t i = 0; i < profile.parameters.distillation.powerSteps; i++) {
+        JsonObject step = schedule.createNestedObject();
+        step["temp"] = profile.parameters.distillation.powerTemp[i];
+        step["power"] = profile.parameters.distillation.powerPercent[i];
+    }
 
     // Температуры
     JsonObject temperatures = parameters.createNestedObject("temperatures");
@@ -127,12 +488,328 @@ bool saveProfile(const Profile& profile) {
     safety["pressureMax"] = profile.parameters.safety.pressureMax;
 
     // Статистика
-    JsonObject statistics = doc.createNestedObject("statistics");
+    JsonObject statistics = obj.createNestedObject("statistics");
     statistics["useCount"] = profile.statistics.useCount;
     statistics["lastUsed"] = profile.statistics.lastUsed;
     statistics["avgDuration"] = profile.statistics.avgDuration;
     statistics["avgYield"] = profile.statistics.avgYield;
     statistics["successRate"] = profile.statistics.successRate;
+}
+
+static void profileFromJson(JsonObject obj, Profile& profile) {
+    profile.id = obj["id"].as<String>();
+
+    // Метаданные
+    profile.metadata.name = obj["metadata"]["name"].as<String>();
+    profile.metadata.description = obj["metadata"]["description"].as<String>();
+    profile.metadata.category = obj["metadata"]["category"].as<String>();
+
+    profile.metadata.tags.clear();
+    JsonArray tags = obj["metadata"]["tags"];
+    for (JsonVariant tag : tags) {
+        profile.metadata.tags.push_back(tag.as<String>());
+    }
+
+    profile.metadata.created = obj["metadata"]["created"];
+    profile.metadata.updated = obj["metadata"]["updated"];
+    profile.metadata.author = obj["metadata"]["author"].as<String>();
+    profile.metadata.isBuiltin = obj["metadata"]["isBuiltin"];
+
+    // Параметры
+    profile.parameters.mode = obj["parameters"]["mode"].as<String>();
+    profile.parameters.model = obj["parameters"]["model"].as<String>();
+    profile.parameters.chargeAbv = obj["parameters"]["chargeAbv"] | 0.0f;
+
+    // Нагреватель
+    profile.parameters.heater.maxPower = obj["parameters"]["heater"]["maxPower"];
+    profile.parameters.heater.autoMode = obj["parameters"]["heater"]["autoMode"];
+    profile.parameters.heater.pidKp = obj["parameters"]["heater"]["pidKp"];
+    profile.parameters.heater.pidKi = obj["parameters"]["heater"]["pidKi"];
+    profile.parameters.heater.pidKd = obj["parameters"]["heater"]["pidKd"];
+
+    // Ректификация
+    profile.parameters.rectification.stabilizationMin = obj["parameters"]["rectification"]["stabilizationMin"];
+    profile.parameters.rectification.headsVolume = obj["parameters"]["rectification"]["headsVolume"];
+    profile.parameters.rectification.bodyVolume = obj["parameters"]["rectification"]["bodyVolume"];
+    profile.parameters.rectification.tailsVolume = obj["parameters"]["rectification"]["tailsVolume"];
+    profile.parameters.rectification.headsSpeed = obj["parameters"]["rectification"]["headsSpeed"];
+    profile.parameters.rectification.bodySpeed = obj["parameters"]["rectification"]["bodySpeed"];
+    profile.parameters.rectification.tailsSpeed = obj["parameters"]["rectification"]["tailsSpeed"];
+    profile.parameters.rectification.purgeMin = obj["parameters"]["rectification"]["purgeMin"];
+
+    // Дистилляция
+    profile.parameters.distillation.headsVolume = obj["parameters"]["distillation"]["headsVolume"];
+    profile.parameters.distillation.targetVolume = obj["parameters"]["distillation"]["targetVolume"];
+    profile.parameters.distillation.speed = obj["parameters"]["distillation"]["speed"];
+    profile.parameters.distillation.endTemp = obj["parameters"]["distillation"]["endTemp"];
+    profile.parameters.distillation.endAbv = obj["parameters"]["distillation"]["endAbv"];
+
+    uint8_t steps = 0;
+    JsonArray schedule = obj["parameters"]["distillation"]["powerSchedule"];
+    for (JsonObject step : schedule) {
+        if (steps >= DIST_POWER_STEPS) break;
+        profile.parameters.distillation.powerTemp[steps] = step["temp"];
+        profile.parameters.distillation.powerPercent[steps] = step["power"];
+        steps++;
+    }
+    profile.parameters.distillation.powerSteps = steps;
+
+    // Температуры
+    profile.parameters.temperatures.maxCube = obj["parameters"]["temperatures"]["maxCube"];
+    profile.parameters.temperatures.maxColumn = obj["parameters"]["temperatures"]["maxColumn"];
+    profile.parameters.temperatures.headsEnd = obj["parameters"]["temperatures"]["headsEnd"];
+    profile.parameters.temperatures.bodyStart = obj["parameters"]["temperatures"]["bodyStart"];
+    profile.parameters.temperatures.bodyEnd = obj["parameters"]["temperatures"]["bodyEnd"];
+
+    // Безопасность
+    profile.parameters.safety.maxRuntime = obj["parameters"]["safety"]["maxRuntime"];
+    profile.parameters.safety.waterFlowMin = obj["parameters"]["safety"]["waterFlowMin"];
+    profile.parameters.safety.pressureMax = obj["parameters"]["safety"]["pressureMax"];
+
+    // Статистика
+    profile.statistics.useCount = obj["statistics"]["useCount"];
+    profile.statistics.lastUsed = obj["statistics"]["lastUsed"];
+    profile.statistics.avgDuration = obj["statistics"]["avgDuration"];
+    profile.statistics.avgYield = obj["statistics"]["avgYield"];
+    profile.statistics.successRate = obj["statistics"]["successRate"];
+}
+
+// ============================================================================
+// Журнал статистики профилей
+// ============================================================================
+//
+// Тела профилей после сохранения не меняются. Каждое обновление статистики
+// дописывает в PROFILES_STATS_FILE одну запись с CRC, при загрузке для ID
+// действует последняя целая запись. Запись, оборванная пропаданием питания,
+// не проходит CRC и отбрасывается. Выросший журнал переписывается во
+// временный файл (по записи на профиль) и заменяет старый через rename.
+
+#define STATS_MAGIC     0x41545350  // "PSTA"
+#define STATS_VERSION   1
+
+struct ProfileStatsHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+};
+
+struct ProfileStatsRecord {
+    char id[24];
+    uint16_t useCount;
+    uint16_t avgYield;
+    uint32_t lastUsed;
+    uint32_t avgDuration;
+    float successRate;
+    uint32_t crc;                   // CRC32 полей выше
+};
+
+static uint16_t statsRecords = 0;
+
+/**
+ * Запись индекса для статистики (встроенным рецептам создаётся по требованию)
+ */
+static ProfileIndexEntry* statsEntry(const String& id) {
+    ProfileIndexEntry* entry = findIndexEntry(id);
+    if (entry) return entry;
+
+    const BuiltinRecipe* recipe = findBuiltin(id);
+    if (!recipe) return nullptr;
+
+    Profile profile;
+    recipeToProfile(*recipe, profile);
+    upsertIndex(profile);
+    return findIndexEntry(id);
+}
+
+static void fillStatsRecord(const ProfileIndexEntry& entry, ProfileStatsRecord& record) {
+    memset(&record, 0, sizeof(record));
+    copyString(record.id, sizeof(record.id), entry.id);
+    record.useCount = entry.useCount;
+    record.avgYield = entry.avgYield;
+    record.lastUsed = entry.lastUsed;
+    record.avgDuration = entry.avgDuration;
+    record.successRate = entry.successRate;
+    record.crc = crc32(&record, offsetof(ProfileStatsRecord, crc));
+}
+
+static bool writeStatsHeader(File& file) {
+    ProfileStatsHeader header = { STATS_MAGIC, STATS_VERSION, sizeof(ProfileStatsRecord) };
+    return file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+}
+
+static bool compactStats() {
+    File file = SPIFFS.open(PROFILES_STATS_TMP, FILE_WRITE);
+    if (!file) {
+        Serial.println("Ошибка: не удалось создать журнал статистики");
+        return false;
+    }
+
+    bool ok = writeStatsHeader(file);
+    uint16_t count = 0;
+    for (const auto& entry : profileIndex) {
+        if (!ok) break;
+        if (entry.useCount == 0) continue;
+
+        ProfileStatsRecord record;
+        fillStatsRecord(entry, record);
+        ok = file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+        count++;
+    }
+    file.close();
+
+    // rename в LittleFS атомарно заменяет старый журнал
+    if (!ok || !SPIFFS.rename(PROFILES_STATS_TMP, PROFILES_STATS_FILE)) {
+        Serial.println("Ошибка: не удалось переписать журнал статистики");
+        SPIFFS.remove(PROFILES_STATS_TMP);
+        return false;
+    }
+
+    statsRecords = count;
+    return true;
+}
+
+static bool appendStats(const ProfileIndexEntry& entry) {
+    if (statsRecords >= PROFILE_STATS_COMPACT_RECORDS) {
+        // Сжатие запишет и текущее значение
+        return compactStats();
+    }
+
+    bool fresh = !SPIFFS.exists(PROFILES_STATS_FILE);
+    File file = SPIFFS.open(PROFILES_STATS_FILE, FILE_APPEND);
+    if (!file) {
+        Serial.println("Ошибка: не удалось открыть журнал статистики");
+        return false;
+    }
+
+    ProfileStatsRecord record;
+    fillStatsRecord(entry, record);
+    bool ok = (!fresh || writeStatsHeader(file)) &&
+              file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+    file.close();
+
+    if (ok) statsRecords++;
+    return ok;
+}
+
+static void loadStats() {
+    statsRecords = 0;
+
+    File file = SPIFFS.open(PROFILES_STATS_FILE, FILE_READ);
+    if (!file) return;
+
+    ProfileStatsHeader header;
+    if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header) ||
+        header.magic != STATS_MAGIC || header.version != STATS_VERSION ||
+        header.recordSize != sizeof(ProfileStatsRecord)) {
+        file.close();
+        Serial.println("Журнал статистики повреждён - сброшен");
+        SPIFFS.remove(PROFILES_STATS_FILE);
+        return;
+    }
+
+    // Неполная последняя запись сдвинула бы все следующие
+    bool aligned = (file.size() - sizeof(header)) % sizeof(ProfileStatsRecord) == 0;
+    uint16_t broken = 0;
+
+    ProfileStatsRecord record;
+    while (file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record)) {
+        statsRecords++;
+        if (record.crc != crc32(&record, offsetof(ProfileStatsRecord, crc))) {
+            broken++;
+            continue;
+        }
+
+        record.id[sizeof(record.id) - 1] = '\0';
+        ProfileIndexEntry* entry = statsEntry(record.id);
+        if (!entry) continue;   // Профиль удалён
+
+        entry->useCount = record.useCount;
+        entry->avgYield = record.avgYield;
+        entry->lastUsed = record.lastUsed;
+        entry->avgDuration = record.avgDuration;
+        entry->successRate = record.successRate;
+    }
+    file.close();
+
+    if (broken > 0 || !aligned) {
+        Serial.printf("Журнал статистики: отброшено повреждённых записей: %d\n", broken + (aligned ? 0 : 1));
+        compactStats();
+    }
+}
+
+// ============================================================================
+// Инициализация системы профилей
+// ============================================================================
+
+bool initProfiles() {
+    Serial.println("Инициализация системы профилей...");
+
+    if (!profilesMutex) {
+        profilesMutex = xSemaphoreCreateRecursiveMutex();
+    }
+    ProfilesLock lock;
+
+    // Проверить, смонтирована ли SPIFFS
+    if (!SPIFFS.begin(true)) {
+        Serial.println("Ошибка: не удалось инициализировать SPIFFS");
+        return false;
+    }
+
+    if (!SPIFFS.exists(PROFILES_DIR)) {
+        Serial.println("Создание директории /profiles");
+        SPIFFS.mkdir(PROFILES_DIR);
+    }
+
+    // Индекс пользовательских профилей (обход файлов только если его нет)
+    if (!loadIndex()) {
+        rebuildIndex();
+    }
+
+    // Статистика из журнала свежее, чем в индексе и файлах профилей
+    loadStats();
+
+    // Убрать копии встроенных рецептов, записанные старыми версиями
+    loadBuiltinProfiles();
+
+    // Провести ротацию профилей
+    rotateProfiles();
+
+    Serial.println("Система профилей инициализирована");
+    Serial.printf("Профилей: %d\n", getProfileCount());
+
+    return true;
+}
+
+// ============================================================================
+// Сохранение профиля
+// ============================================================================
+
+bool saveProfile(const Profile& profile) {
+    // Встроенные рецепты неизменяемы
+    if (isBuiltinProfile(profile.id)) {
+        Serial.println("Ошибка: встроенный рецепт нельзя перезаписать");
+        return false;
+    }
+
+    // Валидация
+    if (!validateProfile(profile)) {
+        Serial.println("Ошибка: профиль не прошел валидацию");
+        return false;
+    }
+
+    String filename = String(PROFILES_DIR) + "/profile_" + profile.id + ".json";
+    Serial.printf("Сохранение профиля: %s\n", filename.c_str());
+
+    ProfilesLock lock;
+
+    File file = SPIFFS.open(filename, FILE_WRITE);
+    if (!file) {
+        Serial.println("Ошибка: не удалось создать файл профиля");
+        return false;
+    }
+
+    DynamicJsonDocument doc(PROFILE_JSON_DOC_SIZE);
+    profileToJson(profile, doc.to<JsonObject>());
 
     // Сериализовать в файл
     if (serializeJson(doc, file) == 0) {
@@ -141,11 +818,16 @@ bool saveProfile(const Profile& profile) {
         return false;
     }
 
-    file.close();
     Serial.printf("Профиль сохранён (%d байт)\n", file.size());
+    file.close();
 
-    // Провести ротацию
-    rotateProfiles();
+    // Индекс и кэш
+    upsertIndex(profile);
+    commitIndex();
+    cacheInvalidate(profile.id);
+
+    // Провести ротацию (пакет - один раз в конце)
+    if (!indexBatch) rotateProfiles();
 
     return true;
 }
@@ -154,7 +836,7 @@ bool saveProfile(const Profile& profile) {
 // Загрузка профиля
 // ============================================================================
 
-bool loadProfile(const String& id, Profile& profile) {
+static bool loadProfileFile(const String& id, Profile& profile) {
     String filename = String(PROFILES_DIR) + "/profile_" + id + ".json";
 
     if (!SPIFFS.exists(filename)) {
@@ -168,79 +850,45 @@ bool loadProfile(const String& id, Profile& profile) {
         return false;
     }
 
-    DynamicJsonDocument doc(8192);
-    DeserializationError error = deserializeJson(doc, file);
+    bool ok = parseProfile(file, profile);
     file.close();
+    return ok;
+}
+
+bool parseProfile(Stream& input, Profile& profile) {
+    DynamicJsonDocument doc(PROFILE_JSON_DOC_SIZE);
+    DeserializationError error = deserializeJson(doc, input);
 
     if (error) {
         Serial.printf("Ошибка парсинга JSON: %s\n", error.c_str());
         return false;
     }
 
-    // Загрузить данные из JSON
-    profile.id = doc["id"].as<String>();
-
-    // Метаданные
-    profile.metadata.name = doc["metadata"]["name"].as<String>();
-    profile.metadata.description = doc["metadata"]["description"].as<String>();
-    profile.metadata.category = doc["metadata"]["category"].as<String>();
+    profileFromJson(doc.as<JsonObject>(), profile);
+    return true;
+}
 
-    profile.metadata.tags.clear();
-    JsonArray tags = doc["metadata"]["tags"];
-    for (JsonVariant tag : tags) {
-        profile.metadata.tags.push_back(tag.as<String>());
+bool loadProfile(const String& id, Profile& profile) {
+    const BuiltinRecipe* recipe = findBuiltin(id);
+    if (recipe) {
+        recipeToProfile(*recipe, profile);
+        return true;
     }
 
-    profile.metadata.created = doc["metadata"]["created"];
-    profile.metadata.updated = doc["metadata"]["updated"];
-    profile.metadata.author = doc["metadata"]["author"].as<String>();
-    profile.metadata.isBuiltin = doc["metadata"]["isBuiltin"];
-
-    // Параметры
-    profile.parameters.mode = doc["parameters"]["mode"].as<String>();
-    profile.parameters.model = doc["parameters"]["model"].as<String>();
-
-    // Нагреватель
-    profile.parameters.heater.maxPower = doc["parameters"]["heater"]["maxPower"];
-    profile.parameters.heater.autoMode = doc["parameters"]["heater"]["autoMode"];
-    profile.parameters.heater.pidKp = doc["parameters"]["heater"]["pidKp"];
-    profile.parameters.heater.pidKi = doc["parameters"]["heater"]["pidKi"];
-    profile.parameters.heater.pidKd = doc["parameters"]["heater"]["pidKd"];
-
-    // Ректификация
-    profile.parameters.rectification.stabilizationMin = doc["parameters"]["rectification"]["stabilizationMin"];
-    profile.parameters.rectification.headsVolume = doc["parameters"]["rectification"]["headsVolume"];
-    profile.parameters.rectification.bodyVolume = doc["parameters"]["rectification"]["bodyVolume"];
-    profile.parameters.rectification.tailsVolume = doc["parameters"]["rectification"]["tailsVolume"];
-    profile.parameters.rectification.headsSpeed = doc["parameters"]["rectification"]["headsSpeed"];
-    profile.parameters.rectification.bodySpeed = doc["parameters"]["rectification"]["bodySpeed"];
-    profile.parameters.rectification.tailsSpeed = doc["parameters"]["rectification"]["tailsSpeed"];
-    profile.parameters.rectification.purgeMin = doc["parameters"]["rectification"]["purgeMin"];
-
-    // Дистилляция
-    profile.parameters.distillation.headsVolume = doc["parameters"]["distillation"]["headsVolume"];
-    profile.parameters.distillation.targetVolume = doc["parameters"]["distillation"]["targetVolume"];
-    profile.parameters.distillation.speed = doc["parameters"]["distillation"]["speed"];
-    profile.parameters.distillation.endTemp = doc["parameters"]["distillation"]["endTemp"];
-
-    // Температуры
-    profile.parameters.temperatures.maxCube = doc["parameters"]["temperatures"]["maxCube"];
-    profile.parameters.temperatures.maxColumn = doc["parameters"]["temperatures"]["maxColumn"];
-    profile.parameters.temperatures.headsEnd = doc["parameters"]["temperatures"]["headsEnd"];
-    profile.parameters.temperatures.bodyStart = doc["parameters"]["temperatures"]["bodyStart"];
-    profile.parameters.temperatures.bodyEnd = doc["parameters"]["temperatures"]["bodyEnd"];
+    ProfilesLock lock;
+    Profile* cached = cacheGet(id);
+    if (cached) {
+        profile = *cached;
+        return true;
+    }
 
-    // Безопасность
-    profile.parameters.safety.maxRuntime = doc["parameters"]["safety"]["maxRuntime"];
-    profile.parameters.safety.waterFlowMin = doc["parameters"]["safety"]["waterFlowMin"];
-    profile.parameters.safety.pressureMax = doc["parameters"]["safety"]["pressureMax"];
+    if (!loadProfileFile(id, profile)) {
+        return false;
+    }
 
-    // Статистика
-    profile.statistics.useCount = doc["statistics"]["useCount"];
-    profile.statistics.lastUsed = doc["statistics"]["lastUsed"];
-    profile.statistics.avgDuration = doc["statistics"]["avgDuration"];
-    profile.statistics.avgYield = doc["statistics"]["avgYield"];
-    profile.statistics.successRate = doc["statistics"]["successRate"];
+    // Статистика в индексе свежее, чем в файле профиля
+    applyIndexStatistics(findIndexEntry(id), profile.statistics);
+    cachePut(profile);
 
     Serial.printf("Профиль загружен: %s\n", profile.metadata.name.c_str());
     return true;
@@ -251,65 +899,67 @@ bool loadProfile(const String& id, Profile& profile) {
 // ============================================================================
 
 std::vector<ProfileListItem> getProfileList() {
-    std::vector<ProfileListItem> list;
-
-    File root = SPIFFS.open(PROFILES_DIR);
-    if (!root || !root.isDirectory()) {
-        return list;
-    }
-
-    File file = root.openNextFile();
-    while (file) {
-        if (!file.isDirectory()) {
-            String filename = file.name();
+    return searchProfiles("", "");
+}
 
-            // Проверить, что это файл профиля
-            if (filename.startsWith("profile_") && filename.endsWith(".json")) {
-                // Быстрая загрузка только необходимых полей
-                DynamicJsonDocument doc(512);
-                DeserializationError error = deserializeJson(doc, file);
-
-                if (!error) {
-                    ProfileListItem item;
-                    item.id = doc["id"].as<String>();
-                    item.name = doc["metadata"]["name"].as<String>();
-                    item.category = doc["metadata"]["category"].as<String>();
-                    item.useCount = doc["statistics"]["useCount"];
-                    item.lastUsed = doc["statistics"]["lastUsed"];
-                    item.isBuiltin = doc["metadata"]["isBuiltin"];
-
-                    list.push_back(item);
-                }
+std::vector<ProfileListItem> searchProfiles(const String& category, const String& tag) {
+    ProfilesLock lock;
+    std::vector<ProfileListItem> list;
+    list.reserve(BUILTIN_COUNT + profileIndex.size());
+
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        const BuiltinRecipe& recipe = BUILTIN_RECIPES[i];
+        if (category.length() && category != recipe.category) continue;
+        if (tag.length()) {
+            bool found = false;
+            for (uint8_t t = 0; t < MAX_PROFILE_TAGS && !found; t++) {
+                found = recipe.tags[t] && tag == recipe.tags[t];
             }
+            if (!found) continue;
         }
-        file = root.openNextFile();
+        list.push_back(builtinListItem(recipe));
     }
 
-    // Сортировать: встроенные первые, затем по частоте использования
-    std::sort(list.begin(), list.end(), [](const ProfileListItem& a, const ProfileListItem& b) {
-        if (a.isBuiltin != b.isBuiltin) return a.isBuiltin;
-        return a.useCount > b.useCount;
-    });
+    for (const auto& entry : profileIndex) {
+        if (entry.isBuiltin) continue;
+        if (category.length() && category != CATEGORY_NAMES[entry.category < 3 ? entry.category : 0]) continue;
+        if (tag.length() && !tagMatches(entry.tags, tag)) continue;
+        list.push_back(indexListItem(entry));
+    }
 
+    sortList(list);
     return list;
 }
 
+bool isBuiltinProfile(const String& id) {
+    return id.startsWith(BUILTIN_ID_PREFIX);
+}
+
 // ============================================================================
 // Удаление профиля
 // ============================================================================
 
 bool deleteProfile(const String& id) {
-    // Сначала загрузить профиль чтобы проверить isBuiltin
-    Profile profile;
-    if (loadProfile(id, profile)) {
-        if (profile.metadata.isBuiltin) {
-            Serial.println("Ошибка: нельзя удалить встроенный рецепт");
-            return false;
+    if (isBuiltinProfile(id)) {
+        Serial.println("Ошибка: нельзя удалить встроенный рецепт");
+        return false;
+    }
+
+    String filename = String(PROFILES_DIR) + "/profile_" + id + ".json";
+
+    ProfilesLock lock;
+    cacheInvalidate(id);
+    for (size_t i = 0; i < profileIndex.size(); i++) {
+        if (id == profileIndex[i].id) {
+            bool hadStats = profileIndex[i].useCount > 0;
+            profileIndex.erase(profileIndex.begin() + i);
+            commitIndex();
+            // ID может быть выдан снова - старая статистика не должна к нему вернуться
+            if (hadStats) compactStats();
+            break;
         }
     }
 
-    String filename = String(PROFILES_DIR) + "/profile_" + id + ".json";
-
     if (!SPIFFS.exists(filename)) {
         Serial.printf("Файл не найден: %s\n", filename.c_str());
         return false;
@@ -328,199 +978,45 @@ bool deleteProfile(const String& id) {
 // ============================================================================
 
 bool clearProfiles() {
-    File root = SPIFFS.open(PROFILES_DIR);
-    if (!root || !root.isDirectory()) {
-        return false;
-    }
-
+    ProfilesLock lock;
     int deleted = 0;
-    File file = root.openNextFile();
-    while (file) {
-        if (!file.isDirectory()) {
-            String filename = file.name();
-
-            // Проверить, что это профиль
-            if (filename.startsWith("profile_") && filename.endsWith(".json")) {
-                // Проверить, не встроенный ли
-                DynamicJsonDocument doc(512);
-                DeserializationError error = deserializeJson(doc, file);
 
-                if (!error && !doc["metadata"]["isBuiltin"].as<bool>()) {
-                    SPIFFS.remove(filename);
-                    deleted++;
-                }
-            }
+    for (size_t i = 0; i < profileIndex.size();) {
+        if (profileIndex[i].isBuiltin) {
+            i++;
+            continue;
         }
-        file = root.openNextFile();
+        String filename = String(PROFILES_DIR) + "/profile_" + profileIndex[i].id + ".json";
+        SPIFFS.remove(filename);
+        profileIndex.erase(profileIndex.begin() + i);
+        deleted++;
+    }
+
+    for (auto& slot : profileCache) {
+        slot.used = false;
+        slot.profile = Profile();
     }
 
+    commitIndex();
+    compactStats();
     Serial.printf("Удалено профилей: %d\n", deleted);
     return true;
 }
 
 // ============================================================================
-// Загрузка встроенных рецептов
+// Встроенные рецепты
 // ============================================================================
 
 bool loadBuiltinProfiles() {
-    uint32_t now = millis() / 1000;
-
-    // ========================================================================
-    // 1. Сахарная брага 40%
-    // ========================================================================
-    {
-        Profile profile;
-        profile.id = "builtin_sugar_40";
-
-        profile.metadata.name = "Сахарная брага 40%";
-        profile.metadata.description = "Классическая ректификация сахарной браги с крепостью 40%";
-        profile.metadata.category = "rectification";
-        profile.metadata.tags = {"сахар", "классика", "40%"};
-        profile.metadata.created = now;
-        profile.metadata.updated = now;
-        profile.metadata.author = "system";
-        profile.metadata.isBuiltin = true;
-
-        profile.parameters.mode = "rectification";
-        profile.parameters.model = "classic";
-
-        profile.parameters.heater.maxPower = 3000;
-        profile.parameters.heater.autoMode = true;
-        profile.parameters.heater.pidKp = 2.0;
-        profile.parameters.heater.pidKi = 0.5;
-        profile.parameters.heater.pidKd = 1.0;
-
-        profile.parameters.rectification.stabilizationMin = 20;
-        profile.parameters.rectification.headsVolume = 50;
-        profile.parameters.rectification.bodyVolume = 2000;
-        profile.parameters.rectification.tailsVolume = 100;
-        profile.parameters.rectification.headsSpeed = 150;
-        profile.parameters.rectification.bodySpeed = 300;
-        profile.parameters.rectification.tailsSpeed = 400;
-        profile.parameters.rectification.purgeMin = 5;
-
-        profile.parameters.temperatures.maxCube = 98.0;
-        profile.parameters.temperatures.maxColumn = 82.0;
-        profile.parameters.temperatures.headsEnd = 78.5;
-        profile.parameters.temperatures.bodyStart = 78.0;
-        profile.parameters.temperatures.bodyEnd = 85.0;
-
-        profile.parameters.safety.maxRuntime = 720;
-        profile.parameters.safety.waterFlowMin = 2.0;
-        profile.parameters.safety.pressureMax = 150;
-
-        profile.statistics.useCount = 0;
-        profile.statistics.lastUsed = 0;
-        profile.statistics.avgDuration = 0;
-        profile.statistics.avgYield = 0;
-        profile.statistics.successRate = 0;
-
-        saveProfile(profile);
-    }
-
-    // ========================================================================
-    // 2. Зерновая брага 12%
-    // ========================================================================
-    {
-        Profile profile;
-        profile.id = "builtin_grain_12";
-
-        profile.metadata.name = "Зерновая брага 12%";
-        profile.metadata.description = "Бережная ректификация зерновой браги с сохранением органолептики";
-        profile.metadata.category = "rectification";
-        profile.metadata.tags = {"зерно", "пшеница", "12%"};
-        profile.metadata.created = now;
-        profile.metadata.updated = now;
-        profile.metadata.author = "system";
-        profile.metadata.isBuiltin = true;
-
-        profile.parameters.mode = "rectification";
-        profile.parameters.model = "classic";
-
-        profile.parameters.heater.maxPower = 2500;
-        profile.parameters.heater.autoMode = true;
-        profile.parameters.heater.pidKp = 2.0;
-        profile.parameters.heater.pidKi = 0.5;
-        profile.parameters.heater.pidKd = 1.0;
-
-        profile.parameters.rectification.stabilizationMin = 30;
-        profile.parameters.rectification.headsVolume = 100;
-        profile.parameters.rectification.bodyVolume = 2500;
-        profile.parameters.rectification.tailsVolume = 150;
-        profile.parameters.rectification.headsSpeed = 120;
-        profile.parameters.rectification.bodySpeed = 250;
-        profile.parameters.rectification.tailsSpeed = 350;
-        profile.parameters.rectification.purgeMin = 5;
-
-        profile.parameters.temperatures.maxCube = 98.0;
-        profile.parameters.temperatures.maxColumn = 82.0;
-        profile.parameters.temperatures.headsEnd = 78.0;
-        profile.parameters.temperatures.bodyStart = 77.5;
-        profile.parameters.temperatures.bodyEnd = 84.0;
-
-        profile.parameters.safety.maxRuntime = 720;
-        profile.parameters.safety.waterFlowMin = 2.0;
-        profile.parameters.safety.pressureMax = 150;
-
-        profile.statistics.useCount = 0;
-        profile.statistics.lastUsed = 0;
-        profile.statistics.avgDuration = 0;
-        profile.statistics.avgYield = 0;
-        profile.statistics.successRate = 0;
-
-        saveProfile(profile);
-    }
-
-    // ========================================================================
-    // 3. Фруктовая дистилляция
-    // ========================================================================
-    {
-        Profile profile;
-        profile.id = "builtin_fruit_dist";
-
-        profile.metadata.name = "Фруктовая дистилляция";
-        profile.metadata.description = "Бережная дистилляция фруктовых браг с сохранением ароматики";
-        profile.metadata.category = "distillation";
-        profile.metadata.tags = {"фрукты", "дистилляция", "аромат"};
-        profile.metadata.created = now;
-        profile.metadata.updated = now;
-        profile.metadata.author = "system";
-        profile.metadata.isBuiltin = true;
-
-        profile.parameters.mode = "distillation";
-        profile.parameters.model = "classic";
-
-        profile.parameters.heater.maxPower = 2000;
-        profile.parameters.heater.autoMode = false;
-        profile.parameters.heater.pidKp = 2.0;
-        profile.parameters.heater.pidKi = 0.5;
-        profile.parameters.heater.pidKd = 1.0;
-
-        profile.parameters.distillation.headsVolume = 30;
-        profile.parameters.distillation.targetVolume = 3000;
-        profile.parameters.distillation.speed = 500;
-        profile.parameters.distillation.endTemp = 96.0;
-
-        profile.parameters.temperatures.maxCube = 98.0;
-        profile.parameters.temperatures.maxColumn = 90.0;
-        profile.parameters.temperatures.headsEnd = 82.0;
-        profile.parameters.temperatures.bodyStart = 78.0;
-        profile.parameters.temperatures.bodyEnd = 96.0;
-
-        profile.parameters.safety.maxRuntime = 480;
-        profile.parameters.safety.waterFlowMin = 1.5;
-        profile.parameters.safety.pressureMax = 100;
-
-        profile.statistics.useCount = 0;
-        profile.statistics.lastUsed = 0;
-        profile.statistics.avgDuration = 0;
-        profile.statistics.avgYield = 0;
-        profile.statistics.successRate = 0;
-
-        saveProfile(profile);
+    // Рецепты - таблица BUILTIN_RECIPES во флеш. Старые версии копировали
+    // их в /profiles как JSON - такие файлы удаляются (статистика уже в индексе).
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        String filename = String(PROFILES_DIR) + "/profile_" + BUILTIN_RECIPES[i].id + ".json";
+        if (SPIFFS.exists(filename)) {
+            SPIFFS.remove(filename);
+            Serial.printf("Удалена копия встроенного рецепта: %s\n", filename.c_str());
+        }
     }
-
-    Serial.println("Встроенные рецепты загружены");
     return true;
 }
 
@@ -529,55 +1025,35 @@ bool loadBuiltinProfiles() {
 // ============================================================================
 
 void rotateProfiles() {
-    std::vector<String> files;
-    std::vector<bool> builtinFlags;
+    ProfilesLock lock;
+    std::vector<size_t> userEntries;
+    for (size_t i = 0; i < profileIndex.size(); i++) {
+        if (!profileIndex[i].isBuiltin) userEntries.push_back(i);
+    }
 
-    // Собрать список файлов
-    File root = SPIFFS.open(PROFILES_DIR);
-    if (!root || !root.isDirectory()) {
+    if (userEntries.size() <= (MAX_PROFILES - MAX_BUILTIN_PROFILES)) {
         return;
     }
 
-    File file = root.openNextFile();
-    while (file) {
-        if (!file.isDirectory()) {
-            String filename = file.name();
-            if (filename.startsWith("profile_") && filename.endsWith(".json")) {
-                // Проверить, встроенный ли
-                DynamicJsonDocument doc(512);
-                DeserializationError error = deserializeJson(doc, file);
-                bool isBuiltin = false;
-                if (!error) {
-                    isBuiltin = doc["metadata"]["isBuiltin"].as<bool>();
-                }
-
-                files.push_back(filename);
-                builtinFlags.push_back(isBuiltin);
-            }
-        }
-        file = root.openNextFile();
-    }
+    // Удалить самые старые пользовательские профили
+    std::sort(userEntries.begin(), userEntries.end(), [](size_t a, size_t b) {
+        return profileIndex[a].created < profileIndex[b].created;
+    });
 
-    // Посчитать пользовательские профили
-    int userProfiles = 0;
-    for (bool isBuiltin : builtinFlags) {
-        if (!isBuiltin) userProfiles++;
+    size_t toDelete = userEntries.size() - (MAX_PROFILES - MAX_BUILTIN_PROFILES);
+    std::vector<String> ids;
+    for (size_t i = 0; i < toDelete; i++) {
+        ids.push_back(profileIndex[userEntries[i]].id);
     }
 
-    // Удалить старые пользовательские если превышен лимит
-    if (userProfiles > (MAX_PROFILES - MAX_BUILTIN_PROFILES)) {
-        // Сортировать по времени (старые первые)
-        std::sort(files.begin(), files.end());
-
-        int toDelete = userProfiles - (MAX_PROFILES - MAX_BUILTIN_PROFILES);
-        for (size_t i = 0; i < files.size() && toDelete > 0; i++) {
-            if (!builtinFlags[i]) {
-                Serial.printf("Удаление старого профиля: %s\n", files[i].c_str());
-                SPIFFS.remove(files[i]);
-                toDelete--;
-            }
-        }
+    bool nested = indexBatch;
+    indexBatch = true;
+    for (const auto& id : ids) {
+        Serial.printf("Удаление старого профиля: %s\n", id.c_str());
+        deleteProfile(id);
     }
+    indexBatch = nested;
+    commitIndex();
 }
 
 // ============================================================================
@@ -585,24 +1061,11 @@ void rotateProfiles() {
 // ============================================================================
 
 uint16_t getProfileCount() {
-    uint16_t count = 0;
-
-    File root = SPIFFS.open(PROFILES_DIR);
-    if (!root || !root.isDirectory()) {
-        return 0;
-    }
-
-    File file = root.openNextFile();
-    while (file) {
-        if (!file.isDirectory()) {
-            String filename = file.name();
-            if (filename.startsWith("profile_") && filename.endsWith(".json")) {
-                count++;
-            }
-        }
-        file = root.openNextFile();
+    ProfilesLock lock;
+    uint16_t count = BUILTIN_COUNT;
+    for (const auto& entry : profileIndex) {
+        if (!entry.isBuiltin) count++;
     }
-
     return count;
 }
 
@@ -637,6 +1100,12 @@ bool validateProfile(const Profile& profile) {
         }
     }
 
+    // Крепость загрузки (0 - неизвестна)
+    if (!(profile.parameters.chargeAbv >= 0 && profile.parameters.chargeAbv <= 96)) {
+        Serial.println("Валидация: неверная крепость загрузки");
+        return false;
+    }
+
     // Проверить температуры
     if (profile.parameters.temperatures.maxCube < 0 ||
         profile.parameters.temperatures.maxCube > 120) {
@@ -652,6 +1121,74 @@ bool validateProfile(const Profile& profile) {
 // Применение профиля
 // ============================================================================
 
+static Mode modeFromString(const String& mode) {
+    if (mode == "rectification") return Mode::RECTIFICATION;
+    if (mode == "distillation") return Mode::DISTILLATION;
+    if (mode == "mashing") return Mode::MASHING;
+    return Mode::IDLE;
+}
+
+RunPlanError compileRunPlan(const Profile& profile, const Settings& settings, RunPlan& plan) {
+    const ProfileParameters& p = profile.parameters;
+
+    // База - план из настроек, профиль переопределяет заданные поля
+    Mode mode = modeFromString(p.mode);
+    RunPlanner::fromSettings(settings, mode, plan);
+
+    plan.source = profile.metadata.isBuiltin ? RunPlanSource::BUILTIN : RunPlanSource::PROFILE;
+    copyString(plan.profileId, sizeof(plan.profileId), profile.id.c_str());
+
+    // Профиль может ограничить мощность ниже номинала ТЭНа;
+    // скорости пересчитываются на фактически используемые кВт
+    uint16_t equipmentW = plan.heaterPowerW;
+    if (p.heater.maxPower > 0 && p.heater.maxPower < equipmentW) {
+        plan.heaterPowerW = p.heater.maxPower;
+        plan.heaterMaxPercent = static_cast<uint8_t>((uint32_t)p.heater.maxPower * 100 / equipmentW);
+        if (plan.heaterMaxPercent == 0) plan.heaterMaxPercent = 1;
+    }
+    float kw = plan.heaterPowerW / 1000.0f;
+
+    if (p.heater.pidKp > 0.0f) {
+        plan.pidKp = p.heater.pidKp;
+        plan.pidKi = p.heater.pidKi;
+        plan.pidKd = p.heater.pidKd;
+    }
+
+    plan.stabilizationMs = p.rectification.stabilizationMin * 60000UL;
+    plan.purgeMs = p.rectification.purgeMin * 60000UL;
+    plan.headsSpeedMlH = p.rectification.headsSpeed * kw;
+    plan.bodySpeedMlH = p.rectification.bodySpeed * kw;
+    plan.tailsSpeedMlH = p.rectification.tailsSpeed * kw;
+    plan.headsVolumeMl = p.rectification.headsVolume;
+    plan.bodyVolumeMl = p.rectification.bodyVolume;
+    plan.tailsVolumeMl = p.rectification.tailsVolume;
+    plan.chargeAbv = p.chargeAbv;
+
+    plan.headsEndTemp = p.temperatures.headsEnd;
+    plan.bodyStartTemp = p.temperatures.bodyStart;
+    plan.bodyEndTemp = p.temperatures.bodyEnd;
+    if (p.temperatures.maxCube > 0.0f) plan.maxCubeTemp = p.temperatures.maxCube;
+    plan.maxColumnTemp = p.temperatures.maxColumn;
+
+    plan.distHeadsMl = p.distillation.headsVolume;
+    plan.distTargetMl = p.distillation.targetVolume;
+    if (p.distillation.speed > 0) plan.distSpeedMlH = p.distillation.speed;
+    if (p.distillation.endTemp > 0.0f) plan.distEndTemp = p.distillation.endTemp;
+    plan.distEndAbv = p.distillation.endAbv;
+    plan.distPowerSteps = p.distillation.powerSteps;
+    for (uint8_t i = 0; i < p.distillation.powerSteps && i < DIST_POWER_STEPS; i++) {
+        plan.distPowerTemp[i] = p.distillation.powerTemp[i];
+        plan.distPowerPercent[i] = p.distillation.powerPercent[i];
+    }
+
+    plan.maxRuntimeMs = p.safety.maxRuntime * 60000UL;
+    plan.waterFlowMinLMin = p.safety.waterFlowMin;
+    plan.pressureMaxMmHg = p.safety.pressureMax;
+
+    RunPlanner::seal(plan);
+    return RunPlanner::validate(plan);
+}
+
 bool applyProfile(const String& id) {
     Profile profile;
     if (!loadProfile(id, profile)) {
@@ -660,11 +1197,18 @@ bool applyProfile(const String& id) {
 
     Serial.printf("Применение профиля: %s\n", profile.metadata.name.c_str());
 
-    // TODO: Применить параметры к системе
-    // Эта функция будет интегрирована с основной системой управления
-    // Сейчас просто логируем что профиль применяется
+    RunPlan plan;
+    RunPlanError error = compileRunPlan(profile, g_settings, plan);
+    if (error != RunPlanError::OK) {
+        Serial.printf("Ошибка: профиль не применён (%s)\n", RunPlanner::errorString(error));
+        return false;
+    }
+
+    if (RunPlanner::stage(plan) != RunPlanError::OK) {
+        return false;
+    }
 
-    Serial.println("Профиль применён (TODO: интеграция с системой)");
+    Serial.printf("Профиль применён (план %08lX)\n", (unsigned long)plan.checksum);
     return true;
 }
 
@@ -673,45 +1217,49 @@ bool applyProfile(const String& id) {
 // ============================================================================
 
 void updateProfileStatistics(const String& id, bool success, uint32_t duration, uint16_t yield) {
-    Profile profile;
-    if (!loadProfile(id, profile)) {
+    // Файл профиля не трогается - только запись индекса и журнал
+    ProfilesLock lock;
+    ProfileIndexEntry* entry = statsEntry(id);
+    if (!entry) {
+        Serial.printf("Ошибка: профиль не найден: %s\n", id.c_str());
         return;
     }
 
     // Обновить статистику
-    profile.statistics.useCount++;
-    profile.statistics.lastUsed = millis() / 1000;
+    entry->useCount++;
+    entry->lastUsed = millis() / 1000;
 
     // Обновить среднюю длительность
-    if (profile.statistics.avgDuration == 0) {
-        profile.statistics.avgDuration = duration;
+    if (entry->avgDuration == 0) {
+        entry->avgDuration = duration;
     } else {
-        profile.statistics.avgDuration =
-            (profile.statistics.avgDuration * (profile.statistics.useCount - 1) + duration) /
-            profile.statistics.useCount;
+        entry->avgDuration =
+            (entry->avgDuration * (entry->useCount - 1) + duration) / entry->useCount;
     }
 
     // Обновить средний выход
-    if (profile.statistics.avgYield == 0) {
-        profile.statistics.avgYield = yield;
+    if (entry->avgYield == 0) {
+        entry->avgYield = yield;
     } else {
-        profile.statistics.avgYield =
-            (profile.statistics.avgYield * (profile.statistics.useCount - 1) + yield) /
-            profile.statistics.useCount;
+        entry->avgYield =
+            (entry->avgYield * (entry->useCount - 1) + yield) / entry->useCount;
     }
 
     // Обновить процент успеха
-    int successCount = (int)(profile.statistics.successRate * (profile.statistics.useCount - 1) / 100.0f);
+    int successCount = (int)lroundf(entry->successRate * (entry->useCount - 1) / 100.0f);
     if (success) successCount++;
-    profile.statistics.successRate = (float)successCount / profile.statistics.useCount * 100.0f;
+    entry->successRate = (float)successCount / entry->useCount * 100.0f;
 
-    // Обновить timestamp
-    profile.metadata.updated = millis() / 1000;
+    appendStats(*entry);
 
-    // Сохранить обратно
-    saveProfile(profile);
+    // Разобранная копия в кэше
+    for (auto& slot : profileCache) {
+        if (slot.used && slot.profile.id == id) {
+            applyIndexStatistics(entry, slot.profile.statistics);
+        }
+    }
 
-    Serial.printf("Статистика профиля обновлена: %s\n", profile.metadata.name.c_str());
+    Serial.printf("Статистика профиля обновлена: %s\n", entry->name);
 }
 
 // ============================================================================
@@ -736,6 +1284,7 @@ String createProfileFromSettings(const String& name, const String& description,
     // Пока заполняем значениями по умолчанию
     profile.parameters.mode = category;
     profile.parameters.model = "classic";
+    profile.parameters.chargeAbv = 0;
 
     // Нагреватель
     profile.parameters.heater.maxPower = 3000;
@@ -791,242 +1340,150 @@ String exportProfileToJSON(const String& id) {
         return "";
     }
 
-    DynamicJsonDocument doc(8192);
+    DynamicJsonDocument doc(PROFILE_JSON_DOC_SIZE);
+    profileToJson(profile, doc.to<JsonObject>());
 
-    // Используем ту же структуру, что и при сохранении
-    doc["id"] = profile.id;
+    String json;
+    serializeJson(doc, json);
 
-    JsonObject metadata = doc.createNestedObject("metadata");
-    metadata["name"] = profile.metadata.name;
-    metadata["description"] = profile.metadata.description;
-    metadata["category"] = profile.metadata.category;
+    Serial.printf("Профиль экспортирован: %s (%d байт)\n", profile.metadata.name.c_str(), json.length());
+    return json;
+}
 
-    JsonArray tags = metadata.createNestedArray("tags");
-    for (const auto& tag : profile.metadata.tags) {
-        tags.add(tag);
+ProfileExporter::ProfileExporter(bool includeBuiltin)
+    : next(0), offset(0), opened(false), closed(false), exported(0) {
+    // Только ID - сами профили загружаются по одному при отдаче
+    for (const auto& item : getProfileList()) {
+        if (!includeBuiltin && item.isBuiltin) continue;
+        ids.push_back(item.id);
     }
+}
 
-    metadata["created"] = profile.metadata.created;
-    metadata["updated"] = profile.metadata.updated;
-    metadata["author"] = profile.metadata.author;
-    metadata["isBuiltin"] = profile.metadata.isBuiltin;
+bool ProfileExporter::fillChunk() {
+    chunk = "";
+    offset = 0;
 
-    JsonObject parameters = doc.createNestedObject("parameters");
-    parameters["mode"] = profile.parameters.mode;
-    parameters["model"] = profile.parameters.model;
+    if (!opened) {
+        opened = true;
+        chunk = "[";
+        return true;
+    }
 
-    JsonObject heater = parameters.createNestedObject("heater");
-    heater["maxPower"] = profile.parameters.heater.maxPower;
-    heater["autoMode"] = profile.parameters.heater.autoMode;
-    heater["pidKp"] = profile.parameters.heater.pidKp;
-    heater["pidKi"] = profile.parameters.heater.pidKi;
-    heater["pidKd"] = profile.parameters.heater.pidKd;
+    while (next < ids.size()) {
+        Profile profile;
+        if (!loadProfile(ids[next++], profile)) continue;
 
-    JsonObject rectification = parameters.createNestedObject("rectification");
-    rectification["stabilizationMin"] = profile.parameters.rectification.stabilizationMin;
-    rectification["headsVolume"] = profile.parameters.rectification.headsVolume;
-    rectification["bodyVolume"] = profile.parameters.rectification.bodyVolume;
-    rectification["tailsVolume"] = profile.parameters.rectification.tailsVolume;
-    rectification["headsSpeed"] = profile.parameters.rectification.headsSpeed;
-    rectification["bodySpeed"] = profile.parameters.rectification.bodySpeed;
-    rectification["tailsSpeed"] = profile.parameters.rectification.tailsSpeed;
-    rectification["purgeMin"] = profile.parameters.rectification.purgeMin;
+        DynamicJsonDocument doc(PROFILE_JSON_DOC_SIZE);
+        profileToJson(profile, doc.to<JsonObject>());
 
-    JsonObject distillation = parameters.createNestedObject("distillation");
-    distillation["headsVolume"] = profile.parameters.distillation.headsVolume;
-    distillation["targetVolume"] = profile.parameters.distillation.targetVolume;
-    distillation["speed"] = profile.parameters.distillation.speed;
-    distillation["endTemp"] = profile.parameters.distillation.endTemp;
+        String json;
+        serializeJson(doc, json);
+        if (exported > 0) chunk = ",";
+        chunk += json;
+        exported++;
+        return true;
+    }
 
-    JsonObject temperatures = parameters.createNestedObject("temperatures");
-    temperatures["maxCube"] = profile.parameters.temperatures.maxCube;
-    temperatures["maxColumn"] = profile.parameters.temperatures.maxColumn;
-    temperatures["headsEnd"] = profile.parameters.temperatures.headsEnd;
-    temperatures["bodyStart"] = profile.parameters.temperatures.bodyStart;
-    temperatures["bodyEnd"] = profile.parameters.temperatures.bodyEnd;
+    if (!closed) {
+        closed = true;
+        chunk = "]";
+        Serial.printf("Экспортировано профилей: %d\n", exported);
+        return true;
+    }
 
-    JsonObject safety = parameters.createNestedObject("safety");
-    safety["maxRuntime"] = profile.parameters.safety.maxRuntime;
-    safety["waterFlowMin"] = profile.parameters.safety.waterFlowMin;
-    safety["pressureMax"] = profile.parameters.safety.pressureMax;
+    return false;
+}
 
-    JsonObject statistics = doc.createNestedObject("statistics");
-    statistics["useCount"] = profile.statistics.useCount;
-    statistics["lastUsed"] = profile.statistics.lastUsed;
-    statistics["avgDuration"] = profile.statistics.avgDuration;
-    statistics["avgYield"] = profile.statistics.avgYield;
-    statistics["successRate"] = profile.statistics.successRate;
+size_t ProfileExporter::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
 
-    String json;
-    serializeJson(doc, json);
+    while (written < maxLen) {
+        if (offset >= chunk.length() && !fillChunk()) break;
 
-    Serial.printf("Профиль экспортирован: %s (%d байт)\n", profile.metadata.name.c_str(), json.length());
-    return json;
+        size_t n = std::min(maxLen - written, (size_t)(chunk.length() - offset));
+        memcpy(buffer + written, chunk.c_str() + offset, n);
+        offset += n;
+        written += n;
+    }
+
+    return written;
 }
 
 String exportAllProfilesToJSON(bool includeBuiltin) {
-    std::vector<ProfileListItem> profiles = getProfileList();
-
-    DynamicJsonDocument doc(32768); // 32 КБ для массива профилей
-    JsonArray array = doc.to<JsonArray>();
-
-    int exported = 0;
-    for (const auto& item : profiles) {
-        // Пропустить встроенные если не требуется
-        if (!includeBuiltin && item.isBuiltin) {
-            continue;
-        }
-
-        // Загрузить полный профиль
-        Profile profile;
-        if (loadProfile(item.id, profile)) {
-            JsonObject obj = array.createNestedObject();
+    ProfileExporter exporter(includeBuiltin);
 
-            obj["id"] = profile.id;
+    String json;
+    uint8_t buffer[256];
+    size_t n;
+    while ((n = exporter.read(buffer, sizeof(buffer))) > 0) {
+        json.concat(reinterpret_cast<const char*>(buffer), n);
+    }
 
-            JsonObject metadata = obj.createNestedObject("metadata");
-            metadata["name"] = profile.metadata.name;
-            metadata["description"] = profile.metadata.description;
-            metadata["category"] = profile.metadata.category;
+    return json;
+}
 
-            JsonArray tags = metadata.createNestedArray("tags");
-            for (const auto& tag : profile.metadata.tags) {
-                tags.add(tag);
-            }
+// ----------------------------------------------------------------------------
+// Импорт: элементы массива разбираются по одному прямо из потока
+// ----------------------------------------------------------------------------
 
-            metadata["created"] = profile.metadata.created;
-            metadata["updated"] = profile.metadata.updated;
-            metadata["author"] = profile.metadata.author;
-            metadata["isBuiltin"] = profile.metadata.isBuiltin;
-
-            JsonObject parameters = obj.createNestedObject("parameters");
-            parameters["mode"] = profile.parameters.mode;
-            parameters["model"] = profile.parameters.model;
-
-            JsonObject heater = parameters.createNestedObject("heater");
-            heater["maxPower"] = profile.parameters.heater.maxPower;
-            heater["autoMode"] = profile.parameters.heater.autoMode;
-            heater["pidKp"] = profile.parameters.heater.pidKp;
-            heater["pidKi"] = profile.parameters.heater.pidKi;
-            heater["pidKd"] = profile.parameters.heater.pidKd;
-
-            JsonObject rectification = parameters.createNestedObject("rectification");
-            rectification["stabilizationMin"] = profile.parameters.rectification.stabilizationMin;
-            rectification["headsVolume"] = profile.parameters.rectification.headsVolume;
-            rectification["bodyVolume"] = profile.parameters.rectification.bodyVolume;
-            rectification["tailsVolume"] = profile.parameters.rectification.tailsVolume;
-            rectification["headsSpeed"] = profile.parameters.rectification.headsSpeed;
-            rectification["bodySpeed"] = profile.parameters.rectification.bodySpeed;
-            rectification["tailsSpeed"] = profile.parameters.rectification.tailsSpeed;
-            rectification["purgeMin"] = profile.parameters.rectification.purgeMin;
-
-            JsonObject distillation = parameters.createNestedObject("distillation");
-            distillation["headsVolume"] = profile.parameters.distillation.headsVolume;
-            distillation["targetVolume"] = profile.parameters.distillation.targetVolume;
-            distillation["speed"] = profile.parameters.distillation.speed;
-            distillation["endTemp"] = profile.parameters.distillation.endTemp;
-
-            JsonObject temperatures = parameters.createNestedObject("temperatures");
-            temperatures["maxCube"] = profile.parameters.temperatures.maxCube;
-            temperatures["maxColumn"] = profile.parameters.temperatures.maxColumn;
-            temperatures["headsEnd"] = profile.parameters.temperatures.headsEnd;
-            temperatures["bodyStart"] = profile.parameters.temperatures.bodyStart;
-            temperatures["bodyEnd"] = profile.parameters.temperatures.bodyEnd;
-
-            JsonObject safety = parameters.createNestedObject("safety");
-            safety["maxRuntime"] = profile.parameters.safety.maxRuntime;
-            safety["waterFlowMin"] = profile.parameters.safety.waterFlowMin;
-            safety["pressureMax"] = profile.parameters.safety.pressureMax;
-
-            JsonObject statistics = obj.createNestedObject("statistics");
-            statistics["useCount"] = profile.statistics.useCount;
-            statistics["lastUsed"] = profile.statistics.lastUsed;
-            statistics["avgDuration"] = profile.statistics.avgDuration;
-            statistics["avgYield"] = profile.statistics.avgYield;
-            statistics["successRate"] = profile.statistics.successRate;
-
-            exported++;
-        }
+/**
+ * Чтение JSON из строки для потокового разбора (read/peek/readBytes)
+ */
+struct JsonStringReader {
+    const char* p;
+    const char* end;
+
+    int read() { return p < end ? static_cast<uint8_t>(*p++) : -1; }
+    int peek() { return p < end ? static_cast<uint8_t>(*p) : -1; }
+
+    size_t readBytes(char* buffer, size_t length) {
+        size_t n = std::min(length, (size_t)(end - p));
+        memcpy(buffer, p, n);
+        p += n;
+        return n;
     }
+};
 
-    String json;
-    serializeJson(doc, json);
-
-    Serial.printf("Экспортировано профилей: %d (%d байт)\n", exported, json.length());
-    return json;
+template <typename TReader>
+static int skipSpaces(TReader& reader) {
+    int c;
+    while ((c = reader.peek()) == ' ' || c == '\n' || c == '\r' || c == '\t') {
+        reader.read();
+    }
+    return c;
 }
 
-String importProfileFromJSON(const String& jsonStr) {
-    DynamicJsonDocument doc(8192);
-    DeserializationError error = deserializeJson(doc, jsonStr);
-
-    if (error) {
-        Serial.printf("Ошибка парсинга JSON при импорте: %s\n", error.c_str());
-        return "";
+/**
+ * Уникальный ID: при пакетном импорте несколько профилей за одну секунду
+ */
+static String newProfileId() {
+    uint32_t id = millis() / 1000;
+    while (findIndexEntry(String(id)) ||
+           SPIFFS.exists(String(PROFILES_DIR) + "/profile_" + String(id) + ".json")) {
+        id++;
     }
+    return String(id);
+}
 
+static String importProfileObject(JsonObject obj) {
+    // Выбор свободного ID и запись - без чужих записей между ними
+    ProfilesLock lock;
     Profile profile;
+    profileFromJson(obj, profile);
 
-    // Генерируем новый ID на основе текущего времени
+    // Новый ID и время создания, статистика не переносится
     uint32_t now = millis() / 1000;
-    profile.id = String(now);
-
-    // Метаданные
-    profile.metadata.name = doc["metadata"]["name"].as<String>();
-    profile.metadata.description = doc["metadata"]["description"].as<String>();
-    profile.metadata.category = doc["metadata"]["category"].as<String>();
-
-    profile.metadata.tags.clear();
-    JsonArray tags = doc["metadata"]["tags"];
-    for (JsonVariant tag : tags) {
-        profile.metadata.tags.push_back(tag.as<String>());
-    }
-
-    profile.metadata.created = now; // Новое время создания
+    profile.id = newProfileId();
+    profile.metadata.created = now;
     profile.metadata.updated = now;
-    profile.metadata.author = doc["metadata"]["author"] | "imported";
+    if (profile.metadata.author.length() == 0 || profile.metadata.author == "null") {
+        profile.metadata.author = "imported";
+    }
+    if (profile.parameters.model.length() == 0 || profile.parameters.model == "null") {
+        profile.parameters.model = "classic";
+    }
     profile.metadata.isBuiltin = false; // Импортированные профили не встроенные
-
-    // Параметры
-    profile.parameters.mode = doc["parameters"]["mode"].as<String>();
-    profile.parameters.model = doc["parameters"]["model"] | "classic";
-
-    profile.parameters.heater.maxPower = doc["parameters"]["heater"]["maxPower"];
-    profile.parameters.heater.autoMode = doc["parameters"]["heater"]["autoMode"];
-    profile.parameters.heater.pidKp = doc["parameters"]["heater"]["pidKp"];
-    profile.parameters.heater.pidKi = doc["parameters"]["heater"]["pidKi"];
-    profile.parameters.heater.pidKd = doc["parameters"]["heater"]["pidKd"];
-
-    profile.parameters.rectification.stabilizationMin = doc["parameters"]["rectification"]["stabilizationMin"];
-    profile.parameters.rectification.headsVolume = doc["parameters"]["rectification"]["headsVolume"];
-    profile.parameters.rectification.bodyVolume = doc["parameters"]["rectification"]["bodyVolume"];
-    profile.parameters.rectification.tailsVolume = doc["parameters"]["rectification"]["tailsVolume"];
-    profile.parameters.rectification.headsSpeed = doc["parameters"]["rectification"]["headsSpeed"];
-    profile.parameters.rectification.bodySpeed = doc["parameters"]["rectification"]["bodySpeed"];
-    profile.parameters.rectification.tailsSpeed = doc["parameters"]["rectification"]["tailsSpeed"];
-    profile.parameters.rectification.purgeMin = doc["parameters"]["rectification"]["purgeMin"];
-
-    profile.parameters.distillation.headsVolume = doc["parameters"]["distillation"]["headsVolume"];
-    profile.parameters.distillation.targetVolume = doc["parameters"]["distillation"]["targetVolume"];
-    profile.parameters.distillation.speed = doc["parameters"]["distillation"]["speed"];
-    profile.parameters.distillation.endTemp = doc["parameters"]["distillation"]["endTemp"];
-
-    profile.parameters.temperatures.maxCube = doc["parameters"]["temperatures"]["maxCube"];
-    profile.parameters.temperatures.maxColumn = doc["parameters"]["temperatures"]["maxColumn"];
-    profile.parameters.temperatures.headsEnd = doc["parameters"]["temperatures"]["headsEnd"];
-    profile.parameters.temperatures.bodyStart = doc["parameters"]["temperatures"]["bodyStart"];
-    profile.parameters.temperatures.bodyEnd = doc["parameters"]["temperatures"]["bodyEnd"];
-
-    profile.parameters.safety.maxRuntime = doc["parameters"]["safety"]["maxRuntime"];
-    profile.parameters.safety.waterFlowMin = doc["parameters"]["safety"]["waterFlowMin"];
-    profile.parameters.safety.pressureMax = doc["parameters"]["safety"]["pressureMax"];
-
-    // Сбросить статистику для импортированного профиля
-    profile.statistics.useCount = 0;
-    profile.statistics.lastUsed = 0;
-    profile.statistics.avgDuration = 0;
-    profile.statistics.avgYield = 0;
-    profile.statistics.successRate = 0;
+    memset(&profile.statistics, 0, sizeof(profile.statistics));
 
     if (saveProfile(profile)) {
         Serial.printf("Профиль импортирован: %s (новый ID: %s)\n",
@@ -1037,33 +1494,160 @@ String importProfileFromJSON(const String& jsonStr) {
     return "";
 }
 
-uint16_t importProfilesFromJSON(const String& jsonStr) {
-    DynamicJsonDocument doc(32768);
-    DeserializationError error = deserializeJson(doc, jsonStr);
+/**
+ * Начало пакетного импорта. Файл индекса удаляется: при сбое питания
+ * посреди пакета индекс пересоберётся по файлам профилей при загрузке
+ */
+static void beginIndexBatch() {
+    ProfilesLock lock;
+    indexBatch = true;
+    indexDirty = false;
+    SPIFFS.remove(PROFILES_INDEX_FILE);
+}
 
-    if (error) {
-        Serial.printf("Ошибка парсинга JSON массива при импорте: %s\n", error.c_str());
+/**
+ * Конец пакета: одна запись индекса и одна ротация
+ */
+static void endIndexBatch() {
+    ProfilesLock lock;
+    indexBatch = false;
+    saveIndex();
+    rotateProfiles();
+}
+
+/**
+ * Разбор массива профилей (или одного объекта): в памяти только текущий элемент
+ */
+template <typename TReader>
+static uint16_t importProfileStream(TReader& reader, uint16_t& failed) {
+    // Поля, которые не переносятся (id, statistics), отбрасываются при разборе
+    StaticJsonDocument<64> filter;
+    filter["metadata"] = true;
+    filter["parameters"] = true;
+
+    uint16_t imported = 0;
+    failed = 0;
+
+    int first = skipSpaces(reader);
+    bool isArray = (first == '[');
+    if (!isArray && first != '{') {
+        Serial.println("Ошибка: ожидается JSON объект или массив профилей");
         return 0;
     }
 
-    if (!doc.is<JsonArray>()) {
-        Serial.println("Ошибка: JSON не является массивом");
-        return 0;
+    if (isArray) {
+        reader.read();
+        if (skipSpaces(reader) == ']') return 0;
     }
 
-    JsonArray array = doc.as<JsonArray>();
-    uint16_t imported = 0;
+    beginIndexBatch();
 
-    for (JsonObject obj : array) {
-        // Сериализуем каждый объект обратно в строку для передачи в importProfileFromJSON
-        String profileJson;
-        serializeJson(obj, profileJson);
+    while (true) {
+        DynamicJsonDocument doc(PROFILE_JSON_DOC_SIZE);
+        DeserializationError error = deserializeJson(doc, reader, DeserializationOption::Filter(filter));
+        if (error) {
+            // Позиция в потоке неизвестна - дальше разбирать нельзя
+            Serial.printf("Ошибка парсинга JSON при импорте: %s\n", error.c_str());
+            failed++;
+            break;
+        }
 
-        if (!importProfileFromJSON(profileJson).isEmpty()) {
+        if (importProfileObject(doc.as<JsonObject>()).isEmpty()) {
+            failed++;
+        } else {
             imported++;
         }
+
+        if (!isArray) break;
+
+        int separator = skipSpaces(reader);
+        reader.read();
+        if (separator == ',') continue;
+        if (separator != ']') {
+            Serial.println("Ошибка: неверный разделитель в массиве профилей");
+            failed++;
+        }
+        break;
+    }
+
+    endIndexBatch();
+
+    Serial.printf("Импортировано профилей: %d, ошибок: %d\n", imported, failed);
+    return imported;
+}
+
+String importProfileFromJSON(const String& jsonStr) {
+    DynamicJsonDocument doc(PROFILE_JSON_DOC_SIZE);
+    DeserializationError error = deserializeJson(doc, jsonStr);
+
+    if (error) {
+        Serial.printf("Ошибка парсинга JSON при импорте: %s\n", error.c_str());
+        return "";
     }
 
-    Serial.printf("Импортировано профилей: %d из %d\n", imported, array.size());
+    return importProfileObject(doc.as<JsonObject>());
+}
+
+uint16_t importProfilesFromJSON(const String& jsonStr) {
+    JsonStringReader reader = { jsonStr.c_str(), jsonStr.c_str() + jsonStr.length() };
+    uint16_t failed;
+    return importProfileStream(reader, failed);
+}
+
+uint16_t importProfilesFromStream(Stream& input, uint16_t* failed) {
+    uint16_t failedCount;
+    uint16_t imported = importProfileStream(input, failedCount);
+    if (failed) *failed = failedCount;
     return imported;
 }
+
+// ----------------------------------------------------------------------------
+// Фоновый импорт: разбор файла загрузки и запись профилей не в AsyncTCP
+// ----------------------------------------------------------------------------
+
+static std::atomic<bool> importRunning(false);
+static uint16_t importImported = 0;
+static uint16_t importFailed = 0;
+
+static void importTaskLoop(void* param) {
+    (void)param;
+
+    uint16_t failed = 0;
+    uint16_t imported = 0;
+    File input = SPIFFS.open(PROFILES_IMPORT_TMP, FILE_READ);
+    if (input) {
+        imported = importProfilesFromStream(input, &failed);
+        input.close();
+    } else {
+        failed = 1;
+    }
+    SPIFFS.remove(PROFILES_IMPORT_TMP);
+
+    importImported = imported;
+    importFailed = failed;
+    importRunning.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+bool startProfileImport() {
+    if (importRunning.exchange(true, std::memory_order_acq_rel)) {
+        return false;
+    }
+
+    importImported = 0;
+    importFailed = 0;
+    if (xTaskCreatePinnedToCore(importTaskLoop, "pimport", PROFILE_IMPORT_TASK_STACK, nullptr,
+                                PROFILE_IMPORT_TASK_PRIORITY, nullptr,
+                                PROFILE_IMPORT_TASK_CORE) != pdPASS) {
+        Serial.println("Ошибка: не удалось создать задачу импорта");
+        importRunning.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void getProfileImportStatus(ProfileImportStatus& status) {
+    status.running = importRunning.load(std::memory_order_acquire);
+    status.imported = importImported;
+    status.failed = importFailed;
+}
@@ -11,6 +11,7 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include "fs_compat.h"
+#include "control/run_plan.h"
 #include <vector>
 
 // Константы для профилей
@@ -19,6 +20,16 @@
 #define PROFILES_DIR "/profiles"      // Директория для хранения профилей
 #define MAX_PROFILE_NAME_LEN 50       // Максимальная длина имени
 #define MAX_PROFILE_DESC_LEN 200      // Максимальная длина описания
+#define MAX_PROFILE_TAGS 3            // Тегов во встроенном рецепте
+#define PROFILES_INDEX_FILE "/profiles/index.bin"  // Компактный индекс пользовательских профилей
+#define PROFILE_CACHE_SIZE 4          // LRU-кэш разобранных профилей
+#define PROFILE_INDEX_TAGS_LEN 64     // Теги в индексе (через '|')
+#define BUILTIN_ID_PREFIX "builtin_"
+#define PROFILE_JSON_DOC_SIZE 4096    // JSON документ одного профиля
+#define PROFILES_IMPORT_TMP "/profiles/import.tmp"  // Загружаемый файл импорта
+#define PROFILES_STATS_FILE "/profiles/stats.bin"   // Журнал статистики использования
+#define PROFILES_STATS_TMP "/profiles/stats.tmp"
+#define PROFILE_STATS_COMPACT_RECORDS 128  // Записей в журнале до сжатия
 
 // ============================================================================
 // Структуры данных для профилей
@@ -46,7 +57,7 @@ struct HeaterParams {
 };
 
 // Параметры ректификации
-struct RectificationParams {
+struct RectProfileParams {
     uint16_t stabilizationMin;        // Время стабилизации (минуты)
     uint16_t headsVolume;             // Объем голов (мл)
     uint16_t bodyVolume;              // Объем тела (мл)
@@ -63,6 +74,10 @@ struct DistillationParams {
     uint16_t targetVolume;            // Целевой объем (мл)
     uint16_t speed;                   // Скорость отбора (мл/ч)
     float endTemp;                    // Температура завершения (°C)
+    float endAbv;                     // Крепость в кубе для завершения (% об., 0 - нет)
+    uint8_t powerSteps;               // Ступеней мощности (0 - максимум всю перегонку)
+    float powerTemp[DIST_POWER_STEPS];      // T куба начала ступени (°C)
+    uint8_t powerPercent[DIST_POWER_STEPS]; // Мощность ступени (%)
 };
 
 // Температурные пороги
@@ -85,8 +100,9 @@ struct SafetyParams {
 struct ProfileParameters {
     String mode;                      // rectification, distillation, mashing
     String model;                     // classic, alternative
+    float chargeAbv;                  // Крепость загрузки куба (% об., 0 - неизвестна)
     HeaterParams heater;
-    RectificationParams rectification;
+    RectProfileParams rectification;
     DistillationParams distillation;
     TemperatureParams temperatures;
     SafetyParams safety;
@@ -109,6 +125,23 @@ struct Profile {
     ProfileStatistics statistics;
 };
 
+// Встроенный рецепт - POD во флеш (.rodata), в файловую систему не копируется
+struct BuiltinRecipe {
+    const char* id;
+    const char* name;
+    const char* description;
+    const char* category;
+    const char* tags[MAX_PROFILE_TAGS];
+    const char* mode;
+    const char* model;
+    float chargeAbv;
+    HeaterParams heater;
+    RectProfileParams rectification;
+    DistillationParams distillation;
+    TemperatureParams temperatures;
+    SafetyParams safety;
+};
+
 // Краткая информация о профиле для списка
 struct ProfileListItem {
     String id;
@@ -144,12 +177,35 @@ bool saveProfile(const Profile& profile);
  */
 bool loadProfile(const String& id, Profile& profile);
 
+/**
+ * Разбор JSON профиля (без кэша и индекса)
+ * @param input Поток с JSON (файл профиля)
+ * @param profile Структура для загрузки данных
+ * @return false при ошибке разбора
+ */
+bool parseProfile(Stream& input, Profile& profile);
+
 /**
  * Получение списка всех профилей
  * @return Вектор с кратким описанием профилей
  */
 std::vector<ProfileListItem> getProfileList();
 
+/**
+ * Поиск профилей по индексу (без чтения файлов)
+ * @param category Категория или пустая строка (любая)
+ * @param tag Тег или пустая строка (любой)
+ * @return Вектор с кратким описанием найденных профилей
+ */
+std::vector<ProfileListItem> searchProfiles(const String& category, const String& tag);
+
+/**
+ * Проверка, что ID относится к встроенному рецепту
+ * @param id ID профиля
+ * @return true если встроенный
+ */
+bool isBuiltinProfile(const String& id);
+
 /**
  * Удаление профиля
  * @param id ID профиля
@@ -164,7 +220,8 @@ bool deleteProfile(const String& id);
 bool clearProfiles();
 
 /**
- * Загрузка встроенных рецептов
+ * Удаление копий встроенных рецептов, записанных старыми версиями в /profiles
+ * (сами рецепты живут во флеш и не загружаются)
  * @return true если успешно
  */
 bool loadBuiltinProfiles();
@@ -188,7 +245,18 @@ uint16_t getProfileCount();
 bool validateProfile(const Profile& profile);
 
 /**
- * Применение профиля к текущим настройкам
+ * Компиляция профиля в план погона (RunPlan)
+ * Скорости мл/ч/кВт пересчитываются в мл/ч, минуты - в мс.
+ * @param profile Профиль
+ * @param settings Настройки (мощность ТЭНа по умолчанию)
+ * @param plan Результат (с контрольной суммой)
+ * @return RunPlanError::OK если план исполним
+ */
+RunPlanError compileRunPlan(const Profile& profile, const Settings& settings, RunPlan& plan);
+
+/**
+ * Применение профиля: компиляция и подготовка плана.
+ * План вступает в силу при старте процесса или на ближайшей границе фаз.
  * @param id ID профиля
  * @return true если успешно
  */
@@ -219,6 +287,38 @@ String createProfileFromSettings(const String& name, const String& description,
  */
 String exportProfileToJSON(const String& id);
 
+/**
+ * Потоковый экспорт профилей JSON массивом.
+ * Профили загружаются и сериализуются по одному - память не зависит
+ * от размера коллекции. Используется для chunked-ответа веб-сервера.
+ */
+class ProfileExporter {
+public:
+    explicit ProfileExporter(bool includeBuiltin);
+
+    /**
+     * Следующая порция JSON
+     * @param buffer Буфер
+     * @param maxLen Размер буфера
+     * @return Записано байт (0 - экспорт завершён)
+     */
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+    // Количество уже отданных профилей
+    uint16_t count() const { return exported; }
+
+private:
+    bool fillChunk();
+
+    std::vector<String> ids;
+    size_t next;
+    String chunk;                     // Текущий сериализованный профиль
+    size_t offset;
+    bool opened;
+    bool closed;
+    uint16_t exported;
+};
+
 /**
  * Экспорт всех профилей в JSON массив
  * @param includeBuiltin Включить встроенные рецепты
@@ -240,4 +340,34 @@ String importProfileFromJSON(const String& jsonStr);
  */
 uint16_t importProfilesFromJSON(const String& jsonStr);
 
+/**
+ * Потоковый импорт профилей (массив или один объект).
+ * Элементы разбираются и сохраняются по одному по мере чтения.
+ * @param input Поток (например, файл загрузки)
+ * @param failed Количество отклонённых профилей (может быть nullptr)
+ * @return Количество успешно импортированных профилей
+ */
+uint16_t importProfilesFromStream(Stream& input, uint16_t* failed = nullptr);
+
+/**
+ * Состояние фонового импорта
+ */
+struct ProfileImportStatus {
+    bool running;
+    uint16_t imported;              // Итог последнего импорта
+    uint16_t failed;
+};
+
+/**
+ * Импорт PROFILES_IMPORT_TMP в отдельной задаче (файл удаляется по окончании).
+ * Индекс записывается один раз на импорт.
+ * @return false если импорт уже идёт или задачу не создать
+ */
+bool startProfileImport();
+
+/**
+ * Ход и итог последнего фонового импорта
+ */
+void getProfileImportStatus(ProfileImportStatus& status);
+
 #endif // PROFILES_H
@@ -0,0 +1,480 @@
+/**
+ * Smart-Column S3 - Модель колонны
+ *
+ * Куб - одна ёмкость с идеальным перемешиванием. Пока T ниже кипения,
+ * тепло ТЭНа идёт на нагрев, выше - в пар. Царга - PLANT_STAGES
+ * теоретических тарелок с постоянным мольным потоком: холодная насадка
+ * конденсирует весь пар и греется, горячая держит удержание жидкости
+ * в равновесии с паром. Потери царги конденсируют часть пара (внутренняя
+ * флегма). Дефлегматор конденсирует не больше, чем позволяет вода, остаток
+ * пара уходит через ТСА. Перепад давления растёт со степенью 1.8 от
+ * нагрузки по пару, за границей захлёба - резко и с ростом пульсаций.
+ */
+
+#include "plant.h"
+
+#define PLANT_STAGES            40      // Теоретических тарелок в царге
+#define PLANT_STAGE_BOTTOM      4       // Тарелка датчика низа царги
+#define PLANT_STAGE_TOP         37      // Тарелка датчика верха царги
+#define PLANT_HVAP              40000.0 // Теплота испарения, Дж/моль (одна для спирта и воды)
+#define PLANT_CP_WATER          75.3    // Дж/(моль·К)
+#define PLANT_CP_ETHANOL        112.0
+#define PLANT_VM_WATER          18.05   // мл/моль
+#define PLANT_VM_ETHANOL        58.4
+#define PLANT_CUBE_STEEL_JK     6000.0  // Куб и ТЭН, Дж/К
+#define PLANT_CUBE_LOSS_WK      6.0     // Потери куба, Вт/К
+#define PLANT_COLUMN_JK         2000.0  // Царга с насадкой, Дж/К
+#define PLANT_COLUMN_LOSS_WK    1.0     // Потери царги, Вт/К
+#define PLANT_HOLDUP_ML_M       200.0   // Удержание насадки, мл на метр
+#define PLANT_HEATER_TAU        20.0    // Инерция ТЭНа, с
+#define PLANT_PRESSURE_TAU      8.0     // Инерция перепада давления, с
+#define PLANT_BOIL_PRESSURE_TAU 120.0   // Сглаживание перепада для T кипения куба, с
+#define PLANT_FLASH_TAU         30.0    // Выкипание перегрева куба сверх подвода ТЭНа, с
+#define PLANT_SENSOR_TAU        4.0     // Гильза DS18B20, с
+#define PLANT_TSA_TAU           20.0
+#define PLANT_WATER_TAU         30.0
+#define PLANT_DEPHL_EFFICIENCY  0.9     // Доля перепада T, снимаемая водой
+#define PLANT_FLOOD_EXPONENT    1.8     // Перепад ~ нагрузка^1.8 до захлёба
+#define PLANT_FLOOD_GAIN        6.0     // Рост перепада на долю перегрузки
+#define PLANT_MAINS_V           230.0
+#define PLANT_MMHG_PER_HPA      0.750062
+#define PLANT_MMHG_PER_KPA      7.50062
+#define PLANT_ADS_VOLTS         0.0001875   // ADS1115, GAIN_TWOTHIRDS: В на отсчёт
+#define PLANT_DS18B20_STEP      0.0625      // 12 бит
+
+/**
+ * Равновесие спирт-вода при 760 мм рт.ст. (мольные доли, °C).
+ * Разбавленный участок - по коэффициенту распределения ~11 при x→0.
+ */
+struct VlePoint {
+    double x;
+    double y;
+    double t;
+};
+
+static const VlePoint VLE[] = {
+    {0.0000, 0.0000, 100.00},
+    {0.0050, 0.0520,  98.70},
+    {0.0100, 0.1000,  97.60},
+    {0.0190, 0.1700,  95.50},
+    {0.0721, 0.3891,  89.00},
+    {0.0966, 0.4375,  86.70},
+    {0.1238, 0.4704,  85.30},
+    {0.1661, 0.5089,  84.10},
+    {0.2337, 0.5445,  82.70},
+    {0.2608, 0.5580,  82.30},
+    {0.3273, 0.5826,  81.50},
+    {0.3965, 0.6122,  80.70},
+    {0.5079, 0.6564,  79.80},
+    {0.5732, 0.6841,  79.30},
+    {0.6763, 0.7385,  78.74},
+    {0.7472, 0.7815,  78.41},
+    {0.8943, 0.8943,  78.15},
+    {1.0000, 1.0000,  78.30}
+};
+
+static const uint8_t VLE_POINTS = sizeof(VLE) / sizeof(VLE[0]);
+
+static PlantConfig cfg;
+static uint64_t rngState;
+
+// Куб
+static double cubeWater, cubeEthanol;   // моль
+static double cubeTemp;
+static double boilUp;                   // моль/с
+static double floodLoad;                // Нагрузка по пару относительно захлёба
+
+// Царга
+static double stageX[PLANT_STAGES];     // Мольная доля спирта в удержании
+static double stageT[PLANT_STAGES];
+static bool stageHot[PLANT_STAGES];
+static double stageHold;                // Удержание тарелки, моль
+static double stageJK;
+static double stageLossWK;
+
+// Исполнительные устройства
+static uint8_t heaterPercent;
+static double heaterW;                  // Мощность из сети
+static double heaterQ;                  // Тепло в жидкость (с инерцией)
+static bool waterOpen;
+static double drawMlH;
+static uint8_t receiver;
+
+// Окружение
+static double mainsV;
+static double atmHpa;
+static double pressureDrop;             // мм рт.ст. над атмосферным
+static double cubeOverpressure;         // Перепад над кубом для T кипения (сглаженный)
+static double refluxTemp, tsaTemp, waterOutTemp;
+static double sensorT[TEMP_COUNT];
+
+// Итоги
+static double energyWh;
+static double collectedMl[PLANT_RECEIVERS];
+static double collectedEthanolMl[PLANT_RECEIVERS];
+static double lostMl;
+
+// ============================================================================
+// Генератор (xorshift64*, нормальный шум - Бокс-Мюллер)
+// ============================================================================
+
+static double uniform() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    uint64_t r = rngState * 0x2545F4914F6CDD1DULL;
+    return ((r >> 11) + 1) * (1.0 / 9007199254740993.0);   // (0, 1]
+}
+
+static double gauss() {
+    double u1 = uniform();
+    double u2 = uniform();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+}
+
+// ============================================================================
+// Физика
+// ============================================================================
+
+static double molarVolume(double x) {
+    return x * PLANT_VM_ETHANOL + (1.0 - x) * PLANT_VM_WATER;
+}
+
+/**
+ * Равновесный пар и T кипения жидкости состава x при давлении p
+ */
+static void equilibrium(double x, double pMmHg, double& y, double& t) {
+    if (x <= 0) x = 0;
+    if (x >= 1) x = 1;
+
+    uint8_t lo = 0, hi = VLE_POINTS - 1;
+    while (hi - lo > 1) {
+        uint8_t mid = (lo + hi) / 2;
+        if (VLE[mid].x <= x) lo = mid; else hi = mid;
+    }
+    double k = (x - VLE[lo].x) / (VLE[hi].x - VLE[lo].x);
+    y = VLE[lo].y + k * (VLE[hi].y - VLE[lo].y);
+    t = VLE[lo].t + k * (VLE[hi].t - VLE[lo].t);
+
+    // Клапейрон-Клаузиус около 1 атм: вода 0.037, спирт 0.0334 °C/мм рт.ст.
+    t += (pMmHg - 760.0) * (0.0370 - 0.0036 * x);
+}
+
+static void addToCube(double moles, double x) {
+    cubeEthanol += moles * x;
+    cubeWater += moles * (1.0 - x);
+    if (cubeEthanol < 0) cubeEthanol = 0;
+    if (cubeWater < 0) cubeWater = 0;
+}
+
+static double relax(double value, double target, double dt, double tau) {
+    return value + (target - value) * dt / tau;
+}
+
+namespace Plant {
+
+void defaults(PlantConfig& config) {
+    config.chargeL = DEFAULT_CUBE_VOLUME_L * 0.8f;
+    config.chargeAbv = 40.0f;
+    config.ambientTemp = 20.0f;
+    config.heaterPowerW = DEFAULT_HEATER_POWER_W;
+    config.columnHeightMm = DEFAULT_COLUMN_HEIGHT_MM;
+    config.floodPressure = 21.0f;
+    config.floodPowerW = 2600.0f;
+    config.waterFlowLMin = 1.5f;
+    config.waterInTemp = 15.0f;
+    config.atmosphereHpa = 1013.25f;
+    config.columnSensor = true;
+    config.seed = 1;
+}
+
+void init(const PlantConfig& config) {
+    cfg = config;
+
+    // splitmix64: соседние seed дают независимые последовательности
+    uint64_t z = (uint64_t)config.seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    rngState = (z ^ (z >> 31)) | 1;
+
+    double ethanolMl = config.chargeL * 1000.0 * config.chargeAbv / 100.0;
+    double waterMl = config.chargeL * 1000.0 - ethanolMl;
+    cubeEthanol = ethanolMl / PLANT_VM_ETHANOL;
+    cubeWater = waterMl / PLANT_VM_WATER;
+    cubeTemp = config.ambientTemp;
+    boilUp = 0;
+    floodLoad = 0;
+
+    double heightM = config.columnHeightMm / 1000.0;
+    stageHold = PLANT_HOLDUP_ML_M * heightM / PLANT_STAGES / molarVolume(0.85);
+    stageJK = PLANT_COLUMN_JK * heightM / 1.5 / PLANT_STAGES;
+    stageLossWK = PLANT_COLUMN_LOSS_WK * heightM / 1.5 / PLANT_STAGES;
+    for (uint8_t j = 0; j < PLANT_STAGES; j++) {
+        stageX[j] = 0;
+        stageT[j] = config.ambientTemp;
+        stageHot[j] = false;
+    }
+
+    heaterPercent = 0;
+    heaterW = 0;
+    heaterQ = 0;
+    waterOpen = false;
+    drawMlH = 0;
+    receiver = 0;
+
+    mainsV = PLANT_MAINS_V;
+    atmHpa = config.atmosphereHpa;
+    pressureDrop = 0;
+    cubeOverpressure = 0;
+    refluxTemp = tsaTemp = config.ambientTemp;
+    waterOutTemp = config.waterInTemp;
+    for (uint8_t i = 0; i < TEMP_COUNT; i++) {
+        sensorT[i] = config.ambientTemp;
+    }
+    sensorT[TEMP_WATER_IN] = sensorT[TEMP_WATER_OUT] = config.waterInTemp;
+
+    energyWh = 0;
+    lostMl = 0;
+    for (uint8_t r = 0; r < PLANT_RECEIVERS; r++) {
+        collectedMl[r] = 0;
+        collectedEthanolMl[r] = 0;
+    }
+}
+
+void step(float dtSec) {
+    double dt = dtSec;
+
+    // Напряжение сети и погода - процессы Орнштейна-Уленбека
+    mainsV = relax(mainsV, PLANT_MAINS_V, dt, 600.0) + 0.3 * sqrt(dt) * gauss();
+    atmHpa = relax(atmHpa, cfg.atmosphereHpa, dt, 21600.0) + 0.03 * sqrt(dt) * gauss();
+
+    // ТЭН: мощность по квадрату напряжения, тепло в жидкость с инерцией
+    double scale = mainsV / PLANT_MAINS_V;
+    heaterW = cfg.heaterPowerW * scale * scale * heaterPercent / 100.0;
+    heaterQ = relax(heaterQ, heaterW, dt, PLANT_HEATER_TAU);
+    energyWh += heaterW * dt / 3600.0;
+
+    double atmMmHg = atmHpa * PLANT_MMHG_PER_HPA;
+
+    // ------------------------------------------------------------------------
+    // Куб
+    // ------------------------------------------------------------------------
+    double cubeMol = cubeWater + cubeEthanol;
+    double xCube = cubeMol > 0 ? cubeEthanol / cubeMol : 0;
+    double heatCap = cubeWater * PLANT_CP_WATER + cubeEthanol * PLANT_CP_ETHANOL + PLANT_CUBE_STEEL_JK;
+    cubeTemp += (heaterQ - PLANT_CUBE_LOSS_WK * (cubeTemp - cfg.ambientTemp)) * dt / heatCap;
+
+    // Кипение - под перепадом царги, как его учитывает прошивка (Vle по
+    // давлению куба). Перепад сглажен: с мгновенным перегретый куб вскипает
+    // при каждом спаде давления, и перепад держится без нагрева
+    cubeOverpressure = relax(cubeOverpressure, pressureDrop, dt, PLANT_BOIL_PRESSURE_TAU);
+    double yCube, boilTemp;
+    equilibrium(xCube, atmMmHg + cubeOverpressure, yCube, boilTemp);
+    // Тепло ТЭНа уходит в пар сразу, а перегрев сверх него (T кипения
+    // упала: стекло удержание, спал перепад) - за PLANT_FLASH_TAU. Иначе
+    // весь перегрев выкипает за шаг, и холодный куб после FINISH даёт
+    // всплеск перепада до захлёба
+    boilUp = 0;
+    if (cubeTemp > boilTemp && cubeMol > 0) {
+        double superheat = (cubeTemp - boilTemp) * heatCap / PLANT_HVAP;
+        double flash = (heaterQ > 0 ? heaterQ / PLANT_HVAP * dt : 0) + superheat * dt / PLANT_FLASH_TAU;
+        if (flash > superheat) flash = superheat;
+        boilUp = flash / dt;
+        cubeTemp -= flash * PLANT_HVAP / heatCap;
+    }
+
+    // ------------------------------------------------------------------------
+    // Пар снизу вверх
+    // ------------------------------------------------------------------------
+    double vapourIn[PLANT_STAGES], yIn[PLANT_STAGES];
+    double vapourOut[PLANT_STAGES], yOut[PLANT_STAGES];
+    double v = boilUp, y = yCube;
+
+    for (uint8_t j = 0; j < PLANT_STAGES; j++) {
+        double p = atmMmHg + pressureDrop * (1.0 - (j + 1.0) / PLANT_STAGES);
+        double loss = stageLossWK * (stageT[j] - cfg.ambientTemp);
+        vapourIn[j] = v;
+        yIn[j] = y;
+        vapourOut[j] = 0;
+        yOut[j] = y;
+
+        if (!stageHot[j]) {
+            // Холодная насадка: пар конденсируется целиком и греет её
+            stageT[j] += (v * PLANT_HVAP - loss) * dt / stageJK;
+            double yEq, t;
+            equilibrium(y, p, yEq, t);
+            if (v > 0 && stageT[j] >= t) {
+                // Удержание набирается из конденсата - убыль из куба
+                stageHot[j] = true;
+                stageX[j] = y;
+                stageT[j] = t;
+                addToCube(-stageHold, y);
+            }
+        } else {
+            double yEq, t;
+            equilibrium(stageX[j], p, yEq, t);
+            yOut[j] = yEq;
+            double condensed = loss / PLANT_HVAP;
+            if (v > condensed) {
+                stageT[j] = t;
+                vapourOut[j] = v - condensed;
+            } else {
+                // Пара не хватает на потери - насадка остывает, удержание стекает
+                stageT[j] += (v * PLANT_HVAP - loss) * dt / stageJK;
+                if (stageT[j] < t - 1.0) {
+                    stageHot[j] = false;
+                    addToCube(stageHold, stageX[j]);
+                }
+            }
+        }
+
+        v = vapourOut[j];
+        y = yOut[j];
+    }
+
+    // ------------------------------------------------------------------------
+    // Дефлегматор и отбор
+    // ------------------------------------------------------------------------
+    double yTopEq, topTemp;
+    equilibrium(y, atmMmHg, yTopEq, topTemp);
+
+    double waterJK = cfg.waterFlowLMin / 60.0 * 4186.0;    // Вт/К
+    double capacity = waterOpen ? waterJK * (topTemp - cfg.waterInTemp) * PLANT_DEPHL_EFFICIENCY / PLANT_HVAP : 0;
+    double condensed = v < capacity ? v : capacity;
+    double lost = v - condensed;
+
+    double drawMol = drawMlH / 3600.0 / molarVolume(y);
+    if (drawMol > condensed) drawMol = condensed;
+
+    collectedMl[receiver] += drawMol * dt * molarVolume(y);
+    collectedEthanolMl[receiver] += drawMol * dt * y * PLANT_VM_ETHANOL;
+    lostMl += lost * dt * molarVolume(y);
+
+    // ------------------------------------------------------------------------
+    // Флегма сверху вниз
+    // ------------------------------------------------------------------------
+    double liquid = condensed - drawMol;
+    double xLiquid = y;
+
+    for (int j = PLANT_STAGES - 1; j >= 0; j--) {
+        double liquidOut = liquid + vapourIn[j] - vapourOut[j];
+        double xOut;
+        if (!stageHot[j]) {
+            xOut = liquidOut > 0 ? (liquid * xLiquid + vapourIn[j] * yIn[j]) / liquidOut : xLiquid;
+        } else {
+            xOut = stageX[j];
+            double dx = (liquid * xLiquid + vapourIn[j] * yIn[j] - vapourOut[j] * yOut[j] -
+                         liquidOut * stageX[j]) / stageHold * dt;
+            stageX[j] = constrain(stageX[j] + dx, 0.0, 1.0);
+        }
+        liquid = liquidOut;
+        xLiquid = xOut;
+    }
+
+    addToCube(liquid * dt, xLiquid);
+    addToCube(-boilUp * dt, yCube);
+
+    // ------------------------------------------------------------------------
+    // Перепад давления и захлёб
+    // ------------------------------------------------------------------------
+    floodLoad = boilUp * PLANT_HVAP / cfg.floodPowerW;
+    double dropTarget = floodLoad <= 1.0
+        ? cfg.floodPressure * pow(floodLoad, PLANT_FLOOD_EXPONENT)
+        : cfg.floodPressure * (1.0 + PLANT_FLOOD_GAIN * (floodLoad - 1.0));
+    pressureDrop = relax(pressureDrop, dropTarget, dt, PLANT_PRESSURE_TAU);
+
+    // ------------------------------------------------------------------------
+    // Вода, флегма, ТСА, гильзы датчиков
+    // ------------------------------------------------------------------------
+    double waterTarget = waterOpen ? cfg.waterInTemp + condensed * PLANT_HVAP / waterJK
+                                   : (lost > 0 ? topTemp : cfg.ambientTemp);
+    waterOutTemp = relax(waterOutTemp, waterTarget, dt, PLANT_WATER_TAU);
+    refluxTemp = relax(refluxTemp, condensed > 0 ? topTemp - 3.0 : cfg.ambientTemp, dt, PLANT_WATER_TAU);
+    tsaTemp = relax(tsaTemp, lost > 1e-6 ? topTemp : cfg.ambientTemp, dt, PLANT_TSA_TAU);
+
+    double actual[TEMP_COUNT];
+    actual[TEMP_CUBE] = cubeTemp;
+    actual[TEMP_COLUMN_BOTTOM] = stageT[PLANT_STAGE_BOTTOM];
+    actual[TEMP_COLUMN_TOP] = stageT[PLANT_STAGE_TOP];
+    actual[TEMP_REFLUX] = refluxTemp;
+    actual[TEMP_TSA] = tsaTemp;
+    actual[TEMP_WATER_IN] = cfg.waterInTemp;
+    actual[TEMP_WATER_OUT] = waterOutTemp;
+    for (uint8_t i = 0; i < TEMP_COUNT; i++) {
+        sensorT[i] = relax(sensorT[i], actual[i], dt, PLANT_SENSOR_TAU);
+    }
+}
+
+// ============================================================================
+// Исполнительные устройства
+// ============================================================================
+
+void setHeater(uint8_t percent) {
+    heaterPercent = percent > 100 ? 100 : percent;
+}
+
+void setWater(bool open) {
+    waterOpen = open;
+}
+
+void setDraw(float mlPerHour, uint8_t target) {
+    drawMlH = mlPerHour > 0 ? mlPerHour : 0;
+    receiver = target < PLANT_RECEIVERS ? target : PLANT_RECEIVERS - 1;
+}
+
+// ============================================================================
+// Датчики
+// ============================================================================
+
+float readTemp(uint8_t index) {
+    if (index >= TEMP_COUNT) return 0;
+    double t = sensorT[index] + 0.02 * gauss();
+    return (float)(floor(t / PLANT_DS18B20_STEP + 0.5) * PLANT_DS18B20_STEP);
+}
+
+bool sensorPresent(uint8_t index) {
+    if (index >= TEMP_COUNT) return false;
+    return index != TEMP_COLUMN_BOTTOM || cfg.columnSensor;
+}
+
+float readPressure() {
+    // Пульсации растут у границы захлёба
+    double sigma = 0.05 + 0.6 * constrain((floodLoad - 0.97) / 0.08, 0.0, 1.0);
+    double p = pressureDrop + sigma * gauss();
+
+    // MPX5010DP -> ADS1115 -> обратный пересчёт как в Sensors::readPressure
+    double volts = MPX5010_OFFSET + p / PLANT_MMHG_PER_KPA * MPX5010_SENSITIVITY;
+    double counts = floor(volts / PLANT_ADS_VOLTS + 0.5);
+    double kPa = (counts * PLANT_ADS_VOLTS - MPX5010_OFFSET) / MPX5010_SENSITIVITY;
+    return (float)constrain(kPa * PLANT_MMHG_PER_KPA, 0.0, 75.0);
+}
+
+float readAtmosphere() {
+    return (float)(atmHpa + 0.012 * gauss());
+}
+
+void readPower(float& voltage, float& current, float& power, float& energyKwh) {
+    // PZEM-004T: 0.1 В, 0.1 Вт, 0.001 А, 1 Вт·ч
+    double v = floor((mainsV + 0.1 * gauss()) * 10.0 + 0.5) / 10.0;
+    double p = heaterW > 0 ? floor(heaterW * (1.0 + 0.005 * gauss()) * 10.0 + 0.5) / 10.0 : 0;
+    voltage = (float)v;
+    power = (float)p;
+    current = (float)(floor(p / v * 1000.0 + 0.5) / 1000.0);
+    energyKwh = (float)(floor(energyWh) / 1000.0);
+}
+
+void getStats(PlantStats& out) {
+    for (uint8_t r = 0; r < PLANT_RECEIVERS; r++) {
+        out.volumeMl[r] = (float)collectedMl[r];
+        out.ethanolMl[r] = (float)collectedEthanolMl[r];
+    }
+    out.vapourLostMl = (float)lostMl;
+    out.energyKwh = (float)(energyWh / 1000.0);
+
+    double ethanolMl = cubeEthanol * PLANT_VM_ETHANOL;
+    double totalMl = ethanolMl + cubeWater * PLANT_VM_WATER;
+    out.cubeVolumeL = (float)(totalMl / 1000.0);
+    out.cubeAbv = totalMl > 0 ? (float)(ethanolMl / totalMl * 100.0) : 0;
+}
+
+} // namespace Plant
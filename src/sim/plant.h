@@ -0,0 +1,118 @@
+/**
+ * Smart-Column S3 - Column Plant Model
+ *
+ * Цифровой двойник колонны для симулятора (env:native): тепловой баланс
+ * куба, равновесие пар-жидкость спирт-вода, тарелки насадки с удержанием,
+ * дефлегматор с ограниченной мощностью охлаждения, перепад давления с
+ * захлёбом и шумы датчиков (DS18B20, MPX5010 через ADS1115, PZEM-004T).
+ * Весь случайный шум - из одного генератора с заданным seed, прогон
+ * с тем же seed повторяется бит в бит.
+ */
+
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define PLANT_RECEIVERS     3       // Приёмники отбора: головы, тело, хвосты
+
+/**
+ * Параметры установки и загрузки
+ */
+struct PlantConfig {
+    float chargeL;                  // Загрузка куба, л
+    float chargeAbv;                // Крепость загрузки, % об.
+    float ambientTemp;              // °C
+    float heaterPowerW;             // Номинал ТЭНа при 230 В
+    float columnHeightMm;
+    float floodPressure;            // Перепад давления на границе захлёба (мм рт.ст.)
+    float floodPowerW;              // Мощность пара в царге при захлёбе (Вт)
+    float waterFlowLMin;            // Расход воды охлаждения
+    float waterInTemp;              // °C
+    float atmosphereHpa;            // Среднее атмосферное давление
+    bool columnSensor;              // Датчик низа царги (false - перегонный куб)
+    uint32_t seed;
+};
+
+/**
+ * Итоги прогона
+ */
+struct PlantStats {
+    float volumeMl[PLANT_RECEIVERS];    // Собрано по приёмникам
+    float ethanolMl[PLANT_RECEIVERS];   // Из них абсолютного спирта
+    float vapourLostMl;                 // Пар мимо дефлегматора (конденсат)
+    float energyKwh;
+    float cubeAbv;                      // Остаток в кубе, % об.
+    float cubeVolumeL;
+};
+
+namespace Plant {
+    /**
+     * Параметры по умолчанию (совпадают с настройками по умолчанию прошивки)
+     */
+    void defaults(PlantConfig& config);
+
+    /**
+     * Загрузка куба и сброс состояния
+     */
+    void init(const PlantConfig& config);
+
+    /**
+     * Шаг модели
+     * @param dtSec Шаг времени (с)
+     */
+    void step(float dtSec);
+
+    // =========================================================================
+    // ИСПОЛНИТЕЛЬНЫЕ УСТРОЙСТВА
+    // =========================================================================
+
+    void setHeater(uint8_t percent);
+    void setWater(bool open);
+
+    /**
+     * Отбор насосом
+     * @param mlPerHour Скорость (0 - стоп)
+     * @param receiver Приёмник 0..PLANT_RECEIVERS-1
+     */
+    void setDraw(float mlPerHour, uint8_t receiver);
+
+    // =========================================================================
+    // ДАТЧИКИ (с шумом и квантованием)
+    // =========================================================================
+
+    /**
+     * Показание DS18B20
+     * @param index Индекс TEMP_*
+     */
+    float readTemp(uint8_t index);
+
+    /**
+     * Датчик установлен
+     * @param index Индекс TEMP_*
+     */
+    bool sensorPresent(uint8_t index);
+
+    /**
+     * Давление в кубе (мм рт.ст. над атмосферным)
+     */
+    float readPressure();
+
+    /**
+     * Атмосферное давление (гПа)
+     */
+    float readAtmosphere();
+
+    /**
+     * Показания PZEM-004T
+     */
+    void readPower(float& voltage, float& current, float& power, float& energyKwh);
+
+    /**
+     * Итоги
+     */
+    void getStats(PlantStats& out);
+}
+
+#endif // PLANT_H
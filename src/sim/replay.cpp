@@ -0,0 +1,248 @@
+/**
+ * Smart-Column S3 - Повтор записанного погона
+ *
+ * Записи держатся в памяти целиком (сутки погона - около 6 МБ),
+ * датчики читают последнюю строку не позже виртуального времени.
+ * Бинарный сегмент узнаётся по заголовку сессии в первой записи.
+ */
+
+#include <vector>
+#include "replay.h"
+#include "../storage/logger.h"
+
+static std::vector<ReplayRow> rows;
+static size_t cursor = 0;
+static bool loaded = false;
+static Mode mode = Mode::IDLE;
+
+static FILE* diffFile = nullptr;
+static ReplayDiff diff;
+static double heaterAbsSum = 0;
+static double speedAbsSum = 0;
+static double energyDeltaWh = 0;
+static uint32_t lastCompareMs = 0;
+
+/**
+ * Разбор числа до запятой
+ * @return false если поле пустое
+ */
+static bool parseField(const char*& p, float& value) {
+    char* end;
+    value = strtof(p, &end);
+    bool ok = end != p;
+    p = end;
+    if (*p == ',') p++;
+    return ok;
+}
+
+static bool parseRow(const char* line, ReplayRow& row) {
+    // Время - целое: во float миллисекунды теряются после ~4.6 ч
+    char* end;
+    unsigned long timeMs = strtoul(line, &end, 10);
+    if (end == line || *end != ',') return false;
+
+    const char* p = end + 1;
+    float values[17];
+    for (uint8_t i = 1; i < 17; i++) {
+        if (!parseField(p, values[i])) return false;
+    }
+
+    row.timeMs = (uint32_t)timeMs;
+    row.temps[TEMP_CUBE] = values[1];
+    row.temps[TEMP_COLUMN_BOTTOM] = values[2];
+    row.temps[TEMP_COLUMN_TOP] = values[3];
+    row.temps[TEMP_REFLUX] = values[4];
+    row.temps[TEMP_TSA] = values[5];
+    row.temps[TEMP_WATER_IN] = values[6];
+    row.temps[TEMP_WATER_OUT] = values[7];
+    row.pressureCube = values[8];
+    row.pressureAtm = values[9];
+    row.abv = values[10];
+    row.power = values[11];
+    row.pumpSpeed = values[12];
+    row.pumpVolume = values[13];
+    row.phase = (uint8_t)values[14];
+    row.heater = (uint8_t)values[15];
+    row.valves = (uint8_t)values[16];
+    return true;
+}
+
+static void unpackRecord(const LogRecord& record, ReplayRow& row) {
+    row.timeMs = record.timeMs;
+    memcpy(row.temps, record.data.temps, sizeof(row.temps));
+    row.pressureCube = record.data.pressureCube;
+    row.pressureAtm = record.data.pressureAtm;
+    row.abv = record.data.abv;
+    row.power = record.data.power;
+    row.pumpSpeed = record.data.pumpSpeed;
+    row.pumpVolume = record.data.pumpVolume;
+    row.phase = record.phase;
+    row.heater = record.heaterPercent;
+    row.valves = record.data.valves;
+}
+
+static void loadBinary(FILE* file) {
+    LogRecord record;
+    ReplayRow row;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.kind == LogRecordKind::HEADER && mode == Mode::IDLE) {
+            mode = static_cast<Mode>(record.mode);
+        } else if (record.kind == LogRecordKind::DATA) {
+            unpackRecord(record, row);
+            rows.push_back(row);
+        }
+    }
+}
+
+static void loadCsv(FILE* file) {
+    char line[512];
+    ReplayRow row;
+    while (fgets(line, sizeof(line), file)) {
+        // Заголовок и строки событий (пустые поля датчиков) не разбираются
+        if (line[0] < '0' || line[0] > '9') continue;
+        if (parseRow(line, row)) {
+            rows.push_back(row);
+        }
+    }
+}
+
+/**
+ * Время входа в фазу по переходам
+ */
+static void trackPhase(int32_t* starts, uint8_t phase, uint8_t& last, uint32_t timeMs) {
+    if (phase != last && phase < REPLAY_PHASES && starts[phase] < 0) {
+        starts[phase] = timeMs / 1000;
+    }
+    last = phase;
+}
+
+namespace Replay {
+
+bool load(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        LOG_E("Replay: Cannot open %s", path);
+        return false;
+    }
+
+    rows.clear();
+    mode = Mode::IDLE;
+
+    LogRecord first;
+    bool binary = fread(&first, sizeof(first), 1, file) == 1 &&
+                  first.kind == LogRecordKind::HEADER && first.header.magic == LOG_RECORD_MAGIC;
+    rewind(file);
+    if (binary) {
+        loadBinary(file);
+    } else {
+        loadCsv(file);
+    }
+    fclose(file);
+
+    cursor = 0;
+    loaded = !rows.empty();
+    memset(&diff, 0, sizeof(diff));
+    for (uint8_t i = 0; i < REPLAY_PHASES; i++) {
+        diff.phaseStartOrig[i] = -1;
+        diff.phaseStartNew[i] = -1;
+    }
+
+    if (loaded) {
+        LOG_I("Replay: %u rows, %lu s", (unsigned)rows.size(),
+              (unsigned long)(rows.back().timeMs / 1000));
+    } else {
+        LOG_E("Replay: No data rows in %s", path);
+    }
+    return loaded;
+}
+
+Mode recordedMode() {
+    return mode;
+}
+
+bool active() {
+    return loaded;
+}
+
+bool advance(uint32_t timeMs) {
+    if (!loaded) return false;
+
+    while (cursor + 1 < rows.size() && rows[cursor + 1].timeMs <= timeMs) {
+        cursor++;
+    }
+    return timeMs <= rows.back().timeMs;
+}
+
+const ReplayRow& current() {
+    return rows[cursor];
+}
+
+void compare(const SystemState& state, uint32_t timeMs, uint8_t heaterPercent,
+             uint16_t heaterPowerW) {
+    const ReplayRow& row = rows[cursor];
+    float dtSec = diff.samples > 0 ? (timeMs - lastCompareMs) / 1000.0f : 0;
+    lastCompareMs = timeMs;
+
+    static uint8_t lastOrig = 0, lastNew = 0;
+    if (diff.samples == 0) {
+        lastOrig = 0;
+        lastNew = 0;
+    }
+    uint8_t phaseNew = static_cast<uint8_t>(state.rectPhase);
+    trackPhase(diff.phaseStartOrig, row.phase, lastOrig, row.timeMs);
+    trackPhase(diff.phaseStartNew, phaseNew, lastNew, timeMs);
+
+    uint8_t valvesNew = (state.valves.water ? 0x01 : 0) |
+                        (state.valves.heads ? 0x02 : 0) |
+                        (state.valves.uno ? 0x04 : 0);
+
+    float heaterDelta = (float)heaterPercent - row.heater;
+    float speedDelta = state.pump.speedMlPerHour - row.pumpSpeed;
+
+    diff.samples++;
+    heaterAbsSum += fabsf(heaterDelta);
+    speedAbsSum += fabsf(speedDelta);
+    if (fabsf(heaterDelta) > diff.heaterMaxAbs) diff.heaterMaxAbs = fabsf(heaterDelta);
+    energyDeltaWh += heaterDelta / 100.0f * heaterPowerW * dtSec / 3600.0f;
+    if (valvesNew != row.valves) diff.valveMismatchSec += (uint32_t)(dtSec + 0.5f);
+    if (phaseNew != row.phase) diff.phaseMismatchSec += (uint32_t)(dtSec + 0.5f);
+    diff.volumeOrig = row.pumpVolume;
+    diff.volumeNew = state.pump.totalVolumeMl;
+
+    if (diffFile) {
+        fprintf(diffFile, "%lu,%u,%u,%u,%u,%.1f,%.1f,%u,%u\n", (unsigned long)timeMs, row.phase,
+                phaseNew, row.heater, heaterPercent, row.pumpSpeed, state.pump.speedMlPerHour,
+                row.valves, valvesNew);
+    }
+}
+
+bool setDiffPath(const char* path) {
+    if (!path) return true;
+
+    diffFile = fopen(path, "w");
+    if (!diffFile) {
+        LOG_E("Replay: Cannot create %s", path);
+        return false;
+    }
+    fprintf(diffFile, "timestamp,phase_orig,phase_new,heater_orig,heater_new,"
+                      "speed_orig,speed_new,valves_orig,valves_new\n");
+    return true;
+}
+
+void getDiff(ReplayDiff& out) {
+    out = diff;
+    if (diff.samples > 0) {
+        out.heaterMeanAbs = heaterAbsSum / diff.samples;
+        out.speedMeanAbs = speedAbsSum / diff.samples;
+    }
+    out.energyDeltaKwh = energyDeltaWh / 1000.0;
+}
+
+void close() {
+    if (diffFile) {
+        fclose(diffFile);
+        diffFile = nullptr;
+    }
+}
+
+} // namespace Replay
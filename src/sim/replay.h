@@ -0,0 +1,111 @@
+/**
+ * Smart-Column S3 - Run Replay
+ *
+ * Повтор записанного погона через код управления: каналы датчиков из
+ * лога (сегменты .bin или экспорт CSV) подаются в Safety, FSM и WattControl по виртуальным
+ * часам, решения (мощность, скорость насоса, клапаны, фаза) сравниваются
+ * с решениями исходного прогона. Контур разомкнут - новые решения не
+ * меняют записанные показания.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+#define REPLAY_PHASES       8       // RectPhase::IDLE..FINISH
+
+/**
+ * Строка записи (DATA, 1 Гц)
+ */
+struct ReplayRow {
+    uint32_t timeMs;                // От начала сессии
+    float temps[TEMP_COUNT];
+    float pressureCube;             // мм рт.ст.
+    float pressureAtm;              // гПа
+    float abv;                      // %
+    float power;                    // Вт
+    float pumpSpeed;                // мл/час
+    float pumpVolume;               // мл
+    uint8_t phase;                  // RectPhase
+    uint8_t heater;                 // %
+    uint8_t valves;                 // Бит 0=вода, 1=головы, 2=УНО
+};
+
+/**
+ * Расхождение решений за прогон
+ */
+struct ReplayDiff {
+    uint32_t samples;               // Сравнено отсчётов
+    float heaterMeanAbs;            // Среднее |Δ мощности| (%)
+    float heaterMaxAbs;
+    float energyDeltaKwh;           // Новая - исходная (по номиналу ТЭНа)
+    float speedMeanAbs;             // Среднее |Δ скорости| (мл/час)
+    float volumeOrig;               // Отобрано в исходном прогоне (мл)
+    float volumeNew;
+    uint32_t valveMismatchSec;      // Секунд с другим состоянием клапанов
+    uint32_t phaseMismatchSec;      // Секунд в другой фазе
+    int32_t phaseStartOrig[REPLAY_PHASES];  // Начало фазы (с), -1 - не было
+    int32_t phaseStartNew[REPLAY_PHASES];
+};
+
+namespace Replay {
+    /**
+     * Загрузка лога: сегменты .bin (записи LogRecord, можно склеить cat)
+     * или CSV экспорта (Logger::formatCsv). События пропускаются.
+     * @param path Файл
+     * @return true если есть хотя бы одна строка данных
+     */
+    bool load(const char* path);
+
+    /**
+     * Режим из заголовка сессии (IDLE - в CSV режима нет)
+     */
+    Mode recordedMode();
+
+    /**
+     * Идёт повтор (датчики читаются из записи)
+     */
+    bool active();
+
+    /**
+     * Переход к последней строке не позже момента времени
+     * @param timeMs Время от начала сессии
+     * @return false после конца записи
+     */
+    bool advance(uint32_t timeMs);
+
+    /**
+     * Текущая строка
+     */
+    const ReplayRow& current();
+
+    /**
+     * Сравнение решений с текущей строкой (раз в секунду)
+     * @param state Состояние после прохода цикла
+     * @param timeMs Время от начала сессии
+     * @param heaterPercent Заданная мощность ТЭНа
+     * @param heaterPowerW Номинал ТЭНа для пересчёта в энергию
+     */
+    void compare(const SystemState& state, uint32_t timeMs, uint8_t heaterPercent,
+                 uint16_t heaterPowerW);
+
+    /**
+     * Файл построчного сравнения (nullptr - не писать)
+     */
+    bool setDiffPath(const char* path);
+
+    /**
+     * Итоги сравнения
+     */
+    void getDiff(ReplayDiff& out);
+
+    /**
+     * Закрытие файла сравнения
+     */
+    void close();
+}
+
+#endif // REPLAY_H
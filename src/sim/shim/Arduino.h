@@ -0,0 +1,192 @@
+/**
+ * Smart-Column S3 - Arduino Shim
+ *
+ * Минимум Arduino API для сборки src/control/ на ПК (env:native).
+ * millis() идёт по виртуальным часам HAL хоста, String - обёртка
+ * std::string, Serial пишет в stderr с виртуальным временем в начале строки.
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+// arduino-esp32 подключает FreeRTOS из Arduino.h
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Как в arduino-esp32: min/max - шаблоны std, а не макросы
+using std::min;
+using std::max;
+
+#define PI          3.1415926535897932384626433832795
+#define HIGH        1
+#define LOW         0
+
+// Режимы выводов и фронты прерываний (значения arduino-esp32)
+#define INPUT           0x01
+#define OUTPUT          0x03
+#define INPUT_PULLUP    0x05
+#define RISING          0x01
+#define FALLING         0x02
+#define CHANGE          0x03
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define IRAM_ATTR
+#define PROGMEM
+
+// Виртуальные часы (src/hal/hal_host.cpp)
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+
+class String {
+public:
+    String() {}
+    String(const char* s) : str(s ? s : "") {}
+    String(const std::string& s) : str(s) {}
+    explicit String(char c) : str(1, c) {}
+    explicit String(int value) : str(std::to_string(value)) {}
+    explicit String(unsigned int value) : str(std::to_string(value)) {}
+    explicit String(long value) : str(std::to_string(value)) {}
+    explicit String(unsigned long value) : str(std::to_string(value)) {}
+    explicit String(float value, unsigned int decimals = 2) { format(value, decimals); }
+    explicit String(double value, unsigned int decimals = 2) { format(value, decimals); }
+
+    const char* c_str() const { return str.c_str(); }
+    size_t length() const { return str.size(); }
+    bool isEmpty() const { return str.empty(); }
+    bool reserve(size_t size) { str.reserve(size); return true; }
+    bool startsWith(const char* prefix) const { return str.compare(0, strlen(prefix), prefix) == 0; }
+    bool endsWith(const char* suffix) const {
+        size_t n = strlen(suffix);
+        return str.size() >= n && str.compare(str.size() - n, n, suffix) == 0;
+    }
+    int indexOf(char c, size_t from = 0) const {
+        size_t pos = str.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    int indexOf(const char* s, size_t from = 0) const {
+        size_t pos = str.find(s, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(size_t from) const { return from < str.size() ? String(str.substr(from)) : String(); }
+    String substring(size_t from, size_t to) const {
+        return from < str.size() && to > from ? String(str.substr(from, to - from)) : String();
+    }
+    long toInt() const { return atol(str.c_str()); }
+    float toFloat() const { return (float)atof(str.c_str()); }
+    bool concat(const String& s) { str += s.str; return true; }
+    bool concat(const char* s) { if (s) str += s; return true; }
+    bool concat(const char* s, size_t length) { if (s) str.append(s, length); return true; }
+    bool concat(char c) { str += c; return true; }
+    char operator[](size_t index) const { return index < str.size() ? str[index] : 0; }
+
+    String& operator+=(const String& s) { str += s.str; return *this; }
+    String& operator+=(const char* s) { str += s; return *this; }
+    String& operator+=(char c) { str += c; return *this; }
+    bool operator==(const String& s) const { return str == s.str; }
+    bool operator==(const char* s) const { return str == s; }
+    bool operator!=(const String& s) const { return str != s.str; }
+    bool operator!=(const char* s) const { return str != s; }
+    bool operator<(const String& s) const { return str < s.str; }
+
+private:
+    void format(double value, unsigned int decimals) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+        str = buffer;
+    }
+
+    std::string str;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        for (size_t i = 0; i < size; i++) write(buffer[i]);
+        return size;
+    }
+    size_t write(char c) { return write(static_cast<uint8_t>(c)); }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { return write(c); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned int value) { return printf("%u", value); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t print(double value, int decimals = 2) { return printf("%.*f", decimals, value); }
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+    size_t println() { return write('\n'); }
+
+    int printf(const char* fmt, ...) {
+        char line[256];
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(line, sizeof(line), fmt, args);
+        va_end(args);
+        if (len < 0) return len;
+        size_t n = (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1;
+        return (int)write(reinterpret_cast<const uint8_t*>(line), n);
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+
+    size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        while (n < length && available() > 0) {
+            buffer[n++] = (char)read();
+        }
+        return n;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        return readBytes(reinterpret_cast<char*>(buffer), length);
+    }
+};
+
+/**
+ * Serial: stderr, строки с меткой виртуального времени
+ */
+class SimSerial : public Stream {
+public:
+    SimSerial() : lineStart(true), muted(false) {}
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+    void flush() override { fflush(stderr); }
+
+    // Вывод выключен (--quiet)
+    void mute(bool value) { muted = value; }
+
+private:
+    bool lineStart;
+    bool muted;
+};
+
+extern SimSerial Serial;
+
+#endif // SIM_ARDUINO_H
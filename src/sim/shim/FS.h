@@ -0,0 +1,227 @@
+/**
+ * Smart-Column S3 - FS Shim
+ *
+ * Файловая система в памяти с API arduino-esp32 (fs::FS, fs::File).
+ * До begin() файлы не открываются: симулятор ФС не монтирует, и код с
+ * проверкой "if (!file)" идёт по обычной ветке ошибки. Бенчмарк
+ * монтирует ФС и работает с историей и профилями как на устройстве.
+ */
+
+#ifndef SIM_FS_H
+#define SIM_FS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+#define FILE_READ       "r"
+#define FILE_WRITE      "w"
+#define FILE_APPEND     "a"
+
+namespace fs {
+
+typedef std::map<std::string, std::vector<uint8_t>> RamFiles;
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File : public Stream {
+public:
+    File() {}
+
+    // Открытый файл (data) или каталог (entries)
+    File(RamFiles* files, const std::string& path, bool directory, size_t pos)
+        : handle(new Handle) {
+        handle->files = files;
+        handle->path = path;
+        handle->directory = directory;
+        handle->pos = pos;
+        handle->next = 0;
+        if (directory) {
+            std::string prefix = path == "/" ? "/" : path + "/";
+            for (RamFiles::const_iterator it = files->begin(); it != files->end(); ++it) {
+                if (it->first.compare(0, prefix.size(), prefix) == 0 &&
+                    it->first.find('/', prefix.size()) == std::string::npos) {
+                    handle->entries.push_back(it->first);
+                }
+            }
+        }
+    }
+
+    explicit operator bool() const { return handle && (handle->directory || data()); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        std::vector<uint8_t>* d = data();
+        if (!d || handle->directory) return 0;
+        if (handle->pos + size > d->size()) d->resize(handle->pos + size);
+        memcpy(d->data() + handle->pos, buffer, size);
+        handle->pos += size;
+        return size;
+    }
+    using Print::write;
+
+    int available() override {
+        std::vector<uint8_t>* d = data();
+        return d ? (int)(d->size() - std::min(handle->pos, d->size())) : 0;
+    }
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    size_t read(uint8_t* buffer, size_t size) {
+        size_t n = std::min(size, (size_t)available());
+        if (n == 0) return 0;
+        memcpy(buffer, data()->data() + handle->pos, n);
+        handle->pos += n;
+        return n;
+    }
+    int peek() override {
+        std::vector<uint8_t>* d = data();
+        return available() > 0 ? (*d)[handle->pos] : -1;
+    }
+
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+        std::vector<uint8_t>* d = data();
+        if (!d) return false;
+        size_t base = mode == SeekSet ? 0 : (mode == SeekCur ? handle->pos : d->size());
+        if (base + pos > d->size()) return false;
+        handle->pos = base + pos;
+        return true;
+    }
+    size_t position() const { return handle ? handle->pos : 0; }
+    size_t size() const {
+        std::vector<uint8_t>* d = data();
+        return d ? d->size() : 0;
+    }
+
+    void close() { handle.reset(); }
+
+    const char* path() const { return handle ? handle->path.c_str() : ""; }
+    const char* name() const {
+        if (!handle) return "";
+        size_t slash = handle->path.rfind('/');
+        return handle->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+    bool isDirectory() const { return handle && handle->directory; }
+
+    File openNextFile() {
+        if (!isDirectory() || handle->next >= handle->entries.size()) return File();
+        const std::string& path = handle->entries[handle->next++];
+        return File(handle->files, path, false, 0);
+    }
+
+private:
+    struct Handle {
+        RamFiles* files;
+        std::string path;
+        bool directory;
+        size_t pos;
+        std::vector<std::string> entries;
+        size_t next;
+    };
+
+    std::vector<uint8_t>* data() const {
+        if (!handle || handle->directory) return nullptr;
+        RamFiles::iterator it = handle->files->find(handle->path);
+        return it != handle->files->end() ? &it->second : nullptr;
+    }
+
+    std::shared_ptr<Handle> handle;
+};
+
+class FS {
+public:
+    FS() : mounted(false) {}
+
+    bool begin(bool formatOnFail = false) {
+        (void)formatOnFail;
+        mounted = true;
+        return true;
+    }
+    void end() { mounted = false; }
+    bool format() {
+        files.clear();
+        dirs.clear();
+        return true;
+    }
+
+    File open(const char* path, const char* mode = FILE_READ) {
+        if (!mounted) return File();
+        std::string p(path);
+        if (isDir(p)) return File(&files, p, true, 0);
+
+        if (mode[0] == 'w') {
+            files[p].clear();
+        } else if (mode[0] == 'a') {
+            files[p];
+        } else if (files.find(p) == files.end()) {
+            return File();
+        }
+        return File(&files, p, false, mode[0] == 'a' ? files[p].size() : 0);
+    }
+    File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+
+    bool exists(const char* path) {
+        std::string p(path);
+        return mounted && (files.find(p) != files.end() || isDir(p));
+    }
+    bool exists(const String& path) { return exists(path.c_str()); }
+
+    bool remove(const char* path) { return mounted && files.erase(path) > 0; }
+    bool remove(const String& path) { return remove(path.c_str()); }
+
+    bool rename(const char* from, const char* to) {
+        RamFiles::iterator it = files.find(from);
+        if (!mounted || it == files.end()) return false;
+        std::vector<uint8_t> data;
+        data.swap(it->second);
+        files.erase(it);
+        files[to].swap(data);
+        return true;
+    }
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+
+    bool mkdir(const char* path) {
+        if (!mounted) return false;
+        dirs.push_back(path);
+        return true;
+    }
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+
+    size_t totalBytes() const { return 0x600000; }
+    size_t usedBytes() const {
+        size_t used = 0;
+        for (RamFiles::const_iterator it = files.begin(); it != files.end(); ++it) {
+            used += it->second.size();
+        }
+        return used;
+    }
+
+private:
+    bool isDir(const std::string& path) const {
+        if (path == "/") return true;
+        if (std::find(dirs.begin(), dirs.end(), path) != dirs.end()) return true;
+        std::string prefix = path + "/";
+        RamFiles::const_iterator it = files.lower_bound(prefix);
+        return it != files.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    bool mounted;
+    RamFiles files;
+    std::vector<std::string> dirs;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif // SIM_FS_H
@@ -0,0 +1,18 @@
+/**
+ * Smart-Column S3 - LittleFS Shim
+ *
+ * LittleFS - файловая система в памяти (FS.h). Симулятор её не
+ * монтирует, логи пишет сам (src/sim/sim_services.cpp).
+ */
+
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <FS.h>
+
+class LittleFSFS : public fs::FS {
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // SIM_LITTLEFS_H
@@ -0,0 +1,33 @@
+/**
+ * Smart-Column S3 - FreeRTOS Shim
+ *
+ * Симулятор однопоточный: критические секции пустые, задача одна
+ * (задача loop), уведомления никто не ждёт.
+ */
+
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    {0}
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+#define portMAX_DELAY                   0xFFFFFFFF
+
+#define pdTRUE                          1
+#define pdFALSE                         0
+#define pdPASS                          pdTRUE
+#define pdFAIL                          pdFALSE
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+
+#endif // SIM_FREERTOS_H
@@ -0,0 +1,42 @@
+/**
+ * Smart-Column S3 - FreeRTOS Semaphore Shim
+ *
+ * Одна задача - мьютексы всегда свободны.
+ */
+
+#ifndef SIM_FREERTOS_SEMPHR_H
+#define SIM_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t simSemaphore() {
+    static int semaphore;
+    return &semaphore;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return simSemaphore(); }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return simSemaphore(); }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    (void)sem; (void)wait;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    (void)sem;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait) {
+    (void)sem; (void)wait;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+    (void)sem;
+    return pdTRUE;
+}
+
+#endif // SIM_FREERTOS_SEMPHR_H
@@ -0,0 +1,55 @@
+/**
+ * Smart-Column S3 - FreeRTOS Task Shim
+ */
+
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+enum eNotifyAction {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+};
+
+// Задачи не создаются: вывод DeferredLog симулятор сбрасывает сам (flush)
+inline BaseType_t xTaskCreatePinnedToCore(void (*code)(void*), const char* name, uint32_t stack,
+                                          void* param, UBaseType_t priority,
+                                          TaskHandle_t* handle, BaseType_t core) {
+    (void)code; (void)name; (void)stack; (void)param; (void)priority; (void)core;
+    if (handle) *handle = nullptr;
+    return pdFAIL;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static int loopTask;
+    return &loopTask;
+}
+
+inline void vTaskDelay(TickType_t ticks) { (void)ticks; }
+inline void vTaskDelete(TaskHandle_t task) { (void)task; }
+inline void vTaskSuspend(TaskHandle_t task) { (void)task; }
+inline void vTaskResume(TaskHandle_t task) { (void)task; }
+
+inline void xTaskNotifyGive(TaskHandle_t task) { (void)task; }
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+    (void)clear; (void)wait;
+    return 0;
+}
+
+inline BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    (void)task; (void)value; (void)action;
+    return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value,
+                                  TickType_t wait) {
+    (void)clearOnEntry; (void)clearOnExit; (void)value; (void)wait;
+    return pdFALSE;
+}
+
+#endif // SIM_FREERTOS_TASK_H
@@ -0,0 +1,102 @@
+/**
+ * Smart-Column S3 - Simulator
+ *
+ * Связка прошивки с моделью колонны в сборке env:native: драйверы
+ * поверх Plant и лог в формате Logger. Виртуальные часы - HAL хоста
+ * (src/hal/hal_host.cpp).
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "plant.h"
+#include "../control/run_eta.h"
+
+namespace SimIO {
+    /**
+     * Шаг исполнительных устройств: объём насоса, входы модели, зеркало
+     * насоса и клапанов в SystemState
+     * @param state Состояние системы (фаза выбирает приёмник отбора)
+     * @param dtSec Шаг (с)
+     */
+    void update(SystemState& state, float dtSec);
+}
+
+namespace SimLog {
+    /**
+     * Файл лога: *.bin - сегмент как у Logger, иначе CSV экспорта
+     * (nullptr - не писать)
+     */
+    void setPath(const char* path);
+}
+
+struct ProcessHistory;
+
+namespace SimHistory {
+    /**
+     * Каталог ПК вместо /history: после прогона история сохраняется туда,
+     * getProcessList() и loadProcessHistory() читают его - в том числе
+     * файлы, скачанные с устройства (nullptr - история только в памяти)
+     */
+    void setDir(const char* dir);
+
+    /**
+     * Сохранение в каталог (process_<id>.json, формат устройства)
+     */
+    bool save(const ProcessHistory& history);
+}
+
+#define SIM_DEFAULT_HOURS       72      // Предел прогона (виртуальные часы)
+
+/**
+ * Параметры прогона (ключи командной строки)
+ */
+struct SimOptions {
+    PlantConfig config;
+    Mode mode;                      // IDLE - из лога повтора или RECTIFICATION
+    float value;                    // Уставка автонастройки и Hold, профиль затирки
+    float hours;                    // Предел прогона
+    float headsMl;                  // 0 - % голов от АС по оценке прошивки
+    const char* logPath;            // nullptr - без лога
+    const char* replay;             // nullptr - модель колонны
+    const char* diffPath;
+    const char* historyDir;         // nullptr - история только в памяти
+    bool quiet;
+};
+
+/**
+ * Итоги прогона для отчёта и тестов
+ */
+struct SimResult {
+    int exitCode;                   // 0 - процесс завершён, 1 - авария/предел, 2 - ошибка запуска
+    uint32_t wallMs;
+    uint32_t floodTrips;            // Переходы давления через критический порог
+    uint32_t bodySamples;           // Секунд отбора тела
+    float bodyPressureMean;         // мм рт.ст.
+    float bodyPressureSd;
+    float bodyPowerMean;            // % ТЭНа
+    bool etaValid;                  // Проверка прогноза (только ректификация)
+    EtaValidation eta;              // С концом тела RUN_ETA_TAILS_ABV
+    EtaValidation etaFit;           // С концом тела по факту погона (tailsCubeAbv)
+    uint16_t etaStoredRuns;         // Погонов в каталоге истории с телом и хвостами
+    EtaValidation etaStored;        // По ним, с концом тела RUN_ETA_TAILS_ABV
+};
+
+namespace Sim {
+    /**
+     * Параметры по умолчанию (модель - Plant::defaults)
+     */
+    void defaults(SimOptions& options);
+
+    /**
+     * Прогон: setup() и loop() прошивки до конца процесса или предела
+     * времени. Вызывается один раз за процесс (состояние модулей прошивки
+     * не сбрасывается). История - processRecorder.
+     */
+    void run(const SimOptions& options, SimResult& result);
+}
+
+#endif // SIM_H
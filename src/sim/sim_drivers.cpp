@@ -0,0 +1,283 @@
+/**
+ * Smart-Column S3 - Драйверы симулятора
+ *
+ * Heater, Pump, Valves и Sensors с теми же интерфейсами, что у драйверов
+ * прошивки, поверх модели колонны. Насос считает объём по заданной
+ * скорости (как по шагам), модель отдаёт в приёмник не больше конденсата.
+ * При повторе погона датчики читают запись вместо модели.
+ */
+
+#include "sim.h"
+#include "plant.h"
+#include "replay.h"
+#include "../drivers/heater.h"
+#include "../drivers/pump.h"
+#include "../drivers/valves.h"
+#include "../drivers/sensors.h"
+
+// Предел скорости насоса как у TMC2209 с AccelStepper
+#define SIM_PUMP_MAX_ML_H   (PUMP_MAX_SPEED * 3600.0f / (PUMP_STEPS_PER_REV * PUMP_MICROSTEPS) * \
+                             DEFAULT_PUMP_ML_PER_REV)
+
+static uint8_t heaterPower = 0;
+
+static bool pumpRunning = false;
+static float pumpSpeed = 0;
+static float pumpVolume = 0;
+
+static bool valveWater = false;
+static bool valveHeads = false;
+static bool valveUno = false;
+static uint8_t valveStartStop = 0;
+
+// ============================================================================
+// ТЭН
+// ============================================================================
+
+namespace Heater {
+
+void init() {
+    setPower(0);
+}
+
+void setPower(uint8_t percent) {
+    heaterPower = percent > 100 ? 100 : percent;
+    Plant::setHeater(heaterPower);
+}
+
+uint8_t getPower() {
+    return heaterPower;
+}
+
+void emergencyStop() {
+    LOG_I("Heater: EMERGENCY STOP!");
+    setPower(0);
+}
+
+void rampTo(uint8_t targetPercent, uint32_t rampTimeMs) {
+    (void)rampTimeMs;
+    setPower(targetPercent);
+}
+
+bool checkHealth(float actualPower) {
+    (void)actualPower;
+    return true;
+}
+
+} // namespace Heater
+
+// ============================================================================
+// Насос
+// ============================================================================
+
+namespace Pump {
+
+void init() {
+    pumpRunning = false;
+    pumpSpeed = 0;
+    pumpVolume = 0;
+}
+
+void start(float mlPerHour) {
+    if (mlPerHour <= 0) {
+        stop();
+        return;
+    }
+    pumpSpeed = mlPerHour < SIM_PUMP_MAX_ML_H ? mlPerHour : SIM_PUMP_MAX_ML_H;
+    if (!pumpRunning) {
+        LOG_I("Pump: Started at %.1f ml/h", pumpSpeed);
+    }
+    pumpRunning = true;
+}
+
+void stop() {
+    if (pumpRunning) {
+        LOG_I("Pump: Stopped");
+    }
+    pumpRunning = false;
+    pumpSpeed = 0;
+}
+
+void setSpeed(float mlPerHour) {
+    start(mlPerHour);
+}
+
+float getSpeed() {
+    return pumpSpeed;
+}
+
+bool isRunning() {
+    return pumpRunning;
+}
+
+float getTotalVolume() {
+    return pumpVolume;
+}
+
+void resetVolume() {
+    pumpVolume = 0;
+}
+
+void setCalibration(float mlPerRev) {
+    (void)mlPerRev;
+}
+
+void update() {
+}
+
+} // namespace Pump
+
+// ============================================================================
+// Клапаны
+// ============================================================================
+
+namespace Valves {
+
+void init() {
+    closeAll();
+}
+
+void setWater(bool open) {
+    valveWater = open;
+    Plant::setWater(open);
+}
+
+bool getWater() {
+    return valveWater;
+}
+
+void setHeads(bool open) {
+    valveHeads = open;
+}
+
+bool getHeads() {
+    return valveHeads;
+}
+
+void setUno(bool open) {
+    valveUno = open;
+}
+
+bool getUno() {
+    return valveUno;
+}
+
+void setStartStop(uint8_t duty) {
+    valveStartStop = duty;
+}
+
+uint8_t getStartStop() {
+    return valveStartStop;
+}
+
+void closeAll() {
+    setWater(false);
+    setHeads(false);
+    setUno(false);
+    setStartStop(0);
+}
+
+} // namespace Valves
+
+// ============================================================================
+// Датчики
+// ============================================================================
+
+namespace Sensors {
+
+void init() {
+}
+
+void readTemperatures(Temperatures& temps) {
+    float values[TEMP_COUNT];
+    for (uint8_t i = 0; i < TEMP_COUNT; i++) {
+        values[i] = Replay::active() ? Replay::current().temps[i] : Plant::readTemp(i);
+        temps.valid[i] = Replay::active() || Plant::sensorPresent(i);
+    }
+
+    temps.cube = values[TEMP_CUBE];
+    temps.columnBottom = values[TEMP_COLUMN_BOTTOM];
+    temps.columnTop = values[TEMP_COLUMN_TOP];
+    temps.reflux = values[TEMP_REFLUX];
+    temps.tsa = values[TEMP_TSA];
+    temps.waterIn = values[TEMP_WATER_IN];
+    temps.waterOut = values[TEMP_WATER_OUT];
+    temps.lastUpdate = millis();
+}
+
+void readPressure(Pressure& pressure) {
+    if (Replay::active()) {
+        pressure.cube = Replay::current().pressureCube;
+        pressure.atmosphere = Replay::current().pressureAtm;
+    } else {
+        pressure.cube = Plant::readPressure();
+        pressure.atmosphere = Plant::readAtmosphere();
+    }
+    pressure.lastUpdate = millis();
+}
+
+void readHydrometer(Hydrometer& hydro, float temperature) {
+    hydro.temperature = temperature;
+    hydro.abv = Replay::active() ? Replay::current().abv : 0;
+    hydro.valid = hydro.abv > 0;
+    hydro.lastUpdate = millis();
+}
+
+void readPower(Power& power) {
+    if (Replay::active()) {
+        // В логе только активная мощность - напряжение номинальное,
+        // энергия интегрируется по интервалу чтения
+        power.voltage = 230.0f;
+        power.power = Replay::current().power;
+        power.current = power.power / power.voltage;
+        power.energy += power.power * INTERVAL_POWER_READ / 3600000000.0f;
+    } else {
+        Plant::readPower(power.voltage, power.current, power.power, power.energy);
+    }
+    power.frequency = 50.0f;
+    power.powerFactor = power.power > 0 ? 1.0f : 0;
+    power.lastUpdate = millis();
+}
+
+void updateHealth(SystemHealth& health) {
+    health.tempSensorsOk = TEMP_COUNT;
+    health.tempSensorsTotal = TEMP_COUNT;
+    health.bmp280Ok = true;
+    health.ads1115Ok = true;
+    health.pzemOk = true;
+    health.uptime = millis() / 1000;
+    health.overallHealth = 100;
+    health.lastUpdate = millis();
+}
+
+} // namespace Sensors
+
+// ============================================================================
+// Связка с моделью
+// ============================================================================
+
+namespace SimIO {
+
+void update(SystemState& state, float dtSec) {
+    if (pumpRunning) {
+        pumpVolume += pumpSpeed * dtSec / 3600.0f;
+    }
+
+    uint8_t receiver = 2;
+    if (state.rectPhase == RectPhase::HEADS) receiver = 0;
+    else if (state.rectPhase == RectPhase::BODY) receiver = 1;
+    Plant::setDraw(pumpRunning ? pumpSpeed : 0, receiver);
+
+    // Драйверы прошивки состояние не публикуют - зеркало для CSV
+    state.pump.running = pumpRunning;
+    state.pump.speedMlPerHour = pumpSpeed;
+    state.pump.targetSpeed = pumpSpeed;
+    state.pump.totalVolumeMl = pumpVolume;
+    state.valves.water = valveWater;
+    state.valves.heads = valveHeads;
+    state.valves.uno = valveUno;
+    state.valves.startStop = valveStartStop > 0;
+    state.valves.startStopPwm = valveStartStop;
+}
+
+} // namespace SimIO
@@ -0,0 +1,528 @@
+/**
+ * Smart-Column S3 - Симулятор колонны
+ *
+ * Нативная сборка (pio run -e native): код src/control/ без изменений
+ * работает с моделью колонны по виртуальным часам. Цикл повторяет
+ * loop() прошивки с шагом SIM_TICK_MS, прогон с тем же seed повторяется
+ * бит в бит. Итоги: отчёт разгона, приёмники, энергия, изменения скорости.
+ * С --replay датчики читают лог записанного погона вместо модели, решения
+ * сравниваются с исходными.
+ *
+ * Пример: .pio/build/native/program --mode rect --seed 7 --log run.bin
+ *         .pio/build/native/program --replay run.bin --diff diff.csv
+ *
+ * Прогон - Sim::run(), тесты (pio test -e native) вызывают его без main().
+ */
+
+#include <time.h>
+#include "sim.h"
+#include "plant.h"
+#include "replay.h"
+#include "../hal/hal.h"
+#include "../control/safety.h"
+#include "../control/fsm.h"
+#include "../control/command_bus.h"
+#include "../control/run_plan.h"
+#include "../control/temp_filter.h"
+#include "../control/vle.h"
+#include "../control/mash_sequencer.h"
+#include "../control/run_eta.h"
+#include "../drivers/heater.h"
+#include "../drivers/pump.h"
+#include "../drivers/valves.h"
+#include "../drivers/sensors.h"
+#include "../storage/logger.h"
+#include "../history.h"
+
+#define SIM_TICK_MS             100     // Шаг модели и проход loop()
+
+SystemState g_state;
+Settings g_settings;
+
+/**
+ * Настройки по умолчанию (как loadSettings() в main.cpp без NVS)
+ */
+static void loadSettings() {
+    memset(&g_settings, 0, sizeof(g_settings));
+
+    g_settings.equipment.columnHeightMm = DEFAULT_COLUMN_HEIGHT_MM;
+    g_settings.equipment.packingType = PackingType::SPN_3_5;
+    g_settings.equipment.packingCoeff = DEFAULT_PACKING_COEFF;
+    g_settings.equipment.heaterPowerW = DEFAULT_HEATER_POWER_W;
+    g_settings.equipment.cubeVolumeL = DEFAULT_CUBE_VOLUME_L;
+
+    g_settings.pumpCal.mlPerRevolution = DEFAULT_PUMP_ML_PER_REV;
+    g_settings.pumpCal.stepsPerRevolution = PUMP_STEPS_PER_REV;
+    g_settings.pumpCal.microsteps = PUMP_MICROSTEPS;
+
+    g_settings.rectParams.headsPercent = RECT_HEADS_PERCENT_DEFAULT;
+    g_settings.rectParams.headsSpeedMlHKw = RECT_HEADS_SPEED_ML_H_KW;
+    g_settings.rectParams.bodySpeedMlHKw = RECT_HEADS_SPEED_ML_H_KW * 2;
+    g_settings.rectParams.stabilizationMin = RECT_STABILIZATION_TIME_MIN;
+    g_settings.rectParams.purgeMin = RECT_PURGE_TIME_MIN;
+
+    MashSequencer::defaultProfiles(g_settings.mashProfiles);
+}
+
+static uint32_t wallClockMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL);
+}
+
+namespace Sim {
+
+void defaults(SimOptions& options) {
+    memset(&options, 0, sizeof(options));
+    Plant::defaults(options.config);
+    options.mode = Mode::IDLE;
+    options.hours = SIM_DEFAULT_HOURS;
+}
+
+void run(const SimOptions& options, SimResult& result) {
+    PlantConfig config = options.config;
+    Mode mode = options.mode;
+    float value = options.value;
+
+    memset(&result, 0, sizeof(result));
+    Serial.mute(options.quiet);
+    SimLog::setPath(options.logPath);
+    SimHistory::setDir(options.historyDir);
+    if (options.replay &&
+        (!Replay::load(options.replay) || !Replay::setDiffPath(options.diffPath))) {
+        DeferredLog::flush();
+        result.exitCode = 2;
+        return;
+    }
+
+    // Режим повтора - из заголовка сессии, если не задан явно
+    if (mode == Mode::IDLE) {
+        mode = Replay::recordedMode() != Mode::IDLE ? Replay::recordedMode() : Mode::RECTIFICATION;
+    }
+
+    // =========================================================================
+    // setup()
+    // =========================================================================
+
+    memset(&g_state, 0, sizeof(g_state));
+    g_state.mode = Mode::IDLE;
+    g_state.rectPhase = RectPhase::IDLE;
+    g_state.safetyOk = true;
+
+    loadSettings();
+    config.heaterPowerW = g_settings.equipment.heaterPowerW;
+    config.columnHeightMm = g_settings.equipment.columnHeightMm;
+    g_settings.equipment.cubeVolumeL = (uint16_t)(config.chargeL + 0.5f);
+    Plant::init(config);
+
+    Heater::init();
+    Pump::init();
+    Valves::init();
+    Sensors::init();
+    CommandBus::init();
+
+    Sensors::readTemperatures(g_state.temps);
+    Sensors::readPressure(g_state.pressure);
+    Sensors::readPower(g_state.power);
+    Sensors::updateHealth(g_state.health);
+
+    // Крепость загрузки известна оператору (как в профиле); объём голов
+    // задан явно - вместо % голов от АС, оценённого прошивкой
+    if (mode == Mode::RECTIFICATION || mode == Mode::DISTILLATION) {
+        RunPlan plan;
+        RunPlanner::fromSettings(g_settings, mode, plan);
+        plan.chargeAbv = config.chargeAbv;
+        if (mode == Mode::RECTIFICATION && options.headsMl > 0) {
+            plan.headsVolumeMl = options.headsMl;
+        }
+        RunPlanner::seal(plan);
+        RunPlanError error = RunPlanner::stage(plan);
+        if (error != RunPlanError::OK) {
+            fprintf(stderr, "Plan rejected: %s\n", RunPlanner::errorString(error));
+            result.exitCode = 2;
+            return;
+        }
+    }
+    if ((mode == Mode::PID_AUTOTUNE || mode == Mode::HOLD) && value <= 0) {
+        value = 60.0f;
+    }
+
+    CommandBus::execute(CommandType::START, CommandSource::BUTTON, mode, value);
+
+    // =========================================================================
+    // loop()
+    // =========================================================================
+
+    uint32_t lastSafetyCheck = 0;
+    uint32_t lastTempRead = 0;
+    uint32_t lastPressureRead = 0;
+    uint32_t lastPowerRead = 0;
+    uint32_t lastLogWrite = 0;
+    uint32_t lastHealthUpdate = 0;
+    uint32_t lastCompare = 0;
+    uint32_t sessionStart = 0;
+    uint32_t lastStats = 0;
+    uint32_t limitMs = (uint32_t)(options.hours * 3600000.0f);
+    bool started = false;
+    bool flooded = false;
+    double pressureSum = 0, pressureSq = 0, powerSum = 0;
+    uint32_t wallStart = wallClockMs();
+
+    while (true) {
+        if (!Replay::active()) {
+            Plant::step(SIM_TICK_MS / 1000.0f);
+        }
+        Hal::Host::advance(SIM_TICK_MS);
+        SimIO::update(g_state, SIM_TICK_MS / 1000.0f);
+        uint32_t now = millis();
+
+        // Время записи идёт от старта сессии лога (прохода, в котором выполнен START).
+        // Конец записи - конец повтора, даже если новый прогон не завершён
+        if (Replay::active() && !Replay::advance(started ? now - sessionStart : 0)) {
+            break;
+        }
+
+        if (now - lastSafetyCheck >= INTERVAL_SAFETY_CHECK) {
+            lastSafetyCheck = now;
+            Safety::check(g_state, g_settings);
+        }
+        if (now - lastTempRead >= INTERVAL_TEMP_READ) {
+            lastTempRead = now;
+            Sensors::readTemperatures(g_state.temps);
+            TempFilter::update(g_state.temps);
+            Vle::update(g_state);
+        }
+        if (now - lastPressureRead >= INTERVAL_PRESSURE_READ) {
+            lastPressureRead = now;
+            Sensors::readPressure(g_state.pressure);
+            Sensors::readHydrometer(g_state.hydrometer, g_state.temps.columnTop);
+        }
+        if (now - lastPowerRead >= INTERVAL_POWER_READ) {
+            lastPowerRead = now;
+            Sensors::readPower(g_state.power);
+        }
+
+        CommandBus::process(g_state, g_settings);
+
+        if (g_state.safetyOk && !g_state.paused) {
+            FSM::update(g_state, g_settings);
+        }
+
+        if (g_state.mode != Mode::IDLE && now - lastLogWrite >= INTERVAL_LOG_WRITE) {
+            lastLogWrite = now;
+            Logger::writeData(g_state);
+
+            TimeseriesPoint point;
+            point.time = now / 1000;
+            point.cube = g_state.temps.cube;
+            point.columnTop = g_state.temps.columnTop;
+            point.columnBottom = g_state.temps.columnBottom;
+            point.deflegmator = g_state.temps.reflux;
+            point.power = g_state.power.power;
+            point.voltage = g_state.power.voltage;
+            point.current = g_state.power.current;
+            point.pumpSpeed = g_state.pump.speedMlPerHour;
+            point.cubeAbv = g_state.vle.cubeValid ? g_state.vle.cubeAbv : 0;
+            point.distillateAbv = g_state.vle.distillateValid ? g_state.vle.distillateAbv : 0;
+            point.phase = static_cast<uint8_t>(g_state.rectPhase);
+            point.volume = g_state.pump.totalVolumeMl;
+            processRecorder.addTimeseriesPoint(point);
+        }
+
+        g_state.uptime = now / 1000;
+        if (now - lastHealthUpdate >= 5000) {
+            lastHealthUpdate = now;
+            Sensors::updateHealth(g_state.health);
+        }
+
+        // Захлёбы за весь процесс (конец - спад ниже порога предупреждения,
+        // шум у порога не считается новым захлёбом), давление и мощность - в теле
+        if (g_state.mode != Mode::IDLE && g_state.health.ads1115Ok &&
+            g_state.pressure.critThreshold > 0) {
+            if (!flooded && g_state.pressure.cube >= g_state.pressure.critThreshold) {
+                result.floodTrips++;
+                flooded = true;
+            } else if (flooded && g_state.pressure.cube < g_state.pressure.warnThreshold) {
+                flooded = false;
+            }
+        }
+        if (g_state.mode == Mode::RECTIFICATION && g_state.rectPhase == RectPhase::BODY &&
+            now - lastStats >= 1000) {
+            lastStats = now;
+            pressureSum += g_state.pressure.cube;
+            pressureSq += (double)g_state.pressure.cube * g_state.pressure.cube;
+            powerSum += Heater::getPower();
+            result.bodySamples++;
+        }
+
+        if (Replay::active() && started && now - lastCompare >= INTERVAL_LOG_WRITE) {
+            lastCompare = now;
+            Replay::compare(g_state, now - sessionStart, Heater::getPower(),
+                            g_settings.equipment.heaterPowerW);
+        }
+
+        DeferredLog::flush();
+
+        // При повторе сравнение идёт до конца записи
+        if (g_state.mode != Mode::IDLE) {
+            if (!started) sessionStart = now;
+            started = true;
+        } else if (started && !Replay::active()) {
+            break;
+        }
+
+        if (!g_state.safetyOk && g_state.currentAlarm.level == AlarmLevel::CRITICAL) {
+            LOG_E("SIM: Emergency stop: %s", g_state.currentAlarm.message);
+            FSM::stopMode(g_state);
+            result.exitCode = 1;
+            break;
+        }
+        if (now >= limitMs) {
+            LOG_W("SIM: Time limit %.1f h reached", options.hours);
+            FSM::stopMode(g_state);
+            result.exitCode = 1;
+            break;
+        }
+        if (!started && now > 10 * SIM_TICK_MS) {
+            LOG_E("SIM: Start rejected");
+            result.exitCode = 1;
+            break;
+        }
+    }
+
+    DeferredLog::flush();
+    Logger::closeLog();
+    if (Replay::active()) {
+        Replay::close();
+    }
+
+    result.wallMs = wallClockMs() - wallStart;
+    if (result.bodySamples > 0) {
+        double mean = pressureSum / result.bodySamples;
+        double var = pressureSq / result.bodySamples - mean * mean;
+        result.bodyPressureMean = mean;
+        result.bodyPressureSd = var > 0 ? sqrt(var) : 0;
+        result.bodyPowerMean = powerSum / result.bodySamples;
+    }
+
+    // Прогноз хвостов есть только у ректификации
+    if (mode == Mode::RECTIFICATION) {
+        const ProcessHistory& history = processRecorder.getHistory();
+        const RunPlan& plan = RunPlanner::active();
+        result.etaValid = RunEta::validate(history, plan, result.eta) &&
+                          RunEta::validate(history, plan, result.etaFit, result.eta.tailsCubeAbv);
+    }
+
+    // Погон в каталог истории, затем проверка по всем сохранённым
+    if (options.historyDir) {
+        SimHistory::save(processRecorder.getHistory());
+        if (mode == Mode::RECTIFICATION) {
+            result.etaStoredRuns = RunEta::validateStored(RunPlanner::active(), result.etaStored);
+        }
+        DeferredLog::flush();
+    }
+}
+
+
+} // namespace Sim
+
+#ifndef PIO_UNIT_TESTING
+
+static void usage() {
+    fprintf(stderr,
+            "Usage: program [options]\n"
+            "  --mode rect|dist|mash|hold|flood|autotune  Режим (rect, при повторе - из лога)\n"
+            "  --seed N                     Seed шумов модели (1)\n"
+            "  --setpoint C                 Уставка автонастройки ПИД и Hold, °C (60)\n"
+            "  --mash-profile N             Профиль затирки из настроек, 0-2 (0)\n"
+            "  --hours H                    Предел прогона, ч (%d)\n"
+            "  --charge-l L                 Загрузка куба, л\n"
+            "  --abv P                      Крепость загрузки, %% об.\n"
+            "  --heads-ml ML                Объём голов (0 - %% голов от АС по оценке прошивки)\n"
+            "  --pot-still                  Без датчика низа царги (кипение по T куба)\n"
+            "  --log FILE                   Лог: *.bin как у Logger, иначе CSV экспорта\n"
+            "  --replay FILE                Повтор записанного погона (.bin или CSV)\n"
+            "  --diff FILE                  Построчное сравнение решений при повторе\n"
+            "  --history DIR                Каталог истории: сохранить погон, проверить прогноз по всем\n"
+            "  --quiet                      Без журнала, только итоги\n",
+            SIM_DEFAULT_HOURS);
+}
+
+static void printSummary(const PlantConfig& config, const SimResult& result) {
+    PlantStats stats;
+    Plant::getStats(stats);
+    ProcessHistory& history = processRecorder.getHistory();
+    const HeatupReport& heatup = history.heatup;
+
+    uint32_t sec = millis() / 1000;
+    printf("=== Smart-Column S3 simulator, seed %lu ===\n", (unsigned long)config.seed);
+    printf("Run:       %s, %s, %lu:%02lu:%02lu\n", history.process.type.c_str(),
+           history.results.status.c_str(), (unsigned long)(sec / 3600),
+           (unsigned long)(sec / 60 % 60), (unsigned long)(sec % 60));
+    if (heatup.durationSec > 0) {
+        printf("Heat-up:   %lu s (predicted %lu s), boil %.1f C, overshoot %.1f mmHg, "
+               "work %u%%\n", (unsigned long)heatup.durationSec,
+               (unsigned long)heatup.predictedSec, heatup.boilTemp, heatup.overshoot,
+               heatup.workPercent);
+    }
+
+    const char* names[PLANT_RECEIVERS] = { "Heads", "Body", "Tails" };
+    for (uint8_t i = 0; i < PLANT_RECEIVERS; i++) {
+        float abv = stats.volumeMl[i] > 0 ? stats.ethanolMl[i] / stats.volumeMl[i] * 100.0f : 0;
+        printf("%-10s %7.0f ml, %5.1f %%\n", names[i], stats.volumeMl[i], abv);
+    }
+    printf("Cube:      %.1f l, %.1f %%\n", stats.cubeVolumeL, stats.cubeAbv);
+    printf("Vapour:    %.0f ml lost past dephlegmator\n", stats.vapourLostMl);
+    printf("Energy:    %.2f kWh\n", stats.energyKwh);
+    printf("Flood:     %.1f mmHg threshold, %u ramp steps\n", g_state.pressure.floodThreshold,
+           (unsigned)history.ramp.size());
+    printf("Speed:     %u changes\n", (unsigned)history.speedChanges.size());
+    if (result.bodySamples > 0) {
+        printf("Pressure:  %.1f +/- %.2f mmHg in body, heater %.0f %%, %lu flood trips\n",
+               result.bodyPressureMean, result.bodyPressureSd, result.bodyPowerMean,
+               (unsigned long)result.floodTrips);
+    }
+    for (const auto& step : history.steps) {
+        printf("Step:      %-8s %5.1f C, ramp %4lu s, hold %5lu s, out %4lu s, %5.0f Wh, "
+               "loss %.1f W/K\n", step.name.c_str(), step.target, (unsigned long)step.rampSec,
+               (unsigned long)step.holdSec, (unsigned long)step.outOfBandSec, step.energyWh,
+               step.lossWK);
+    }
+    if (result.etaValid) {
+        const EtaValidation* runs[] = { &result.eta, &result.etaFit };
+        for (const EtaValidation* eta : runs) {
+            printf("ETA:       %u forecasts, tails at %.1f %%: error %.0f min (bias %+.0f), "
+                   "%.0f%% in interval, cube %.1f %% at tails\n", eta->samples, eta->tailsAbv,
+                   eta->tailsErrorMin, eta->tailsBiasMin, eta->coverage * 100.0f,
+                   eta->tailsCubeAbv);
+        }
+    }
+    if (result.etaStoredRuns > 0) {
+        const EtaValidation& eta = result.etaStored;
+        printf("History:   %u runs, %u forecasts, tails at %.1f %%: error %.0f min (bias %+.0f), "
+               "%.0f%% in interval, cube %.1f %% at tails\n", result.etaStoredRuns, eta.samples,
+               eta.tailsAbv, eta.tailsErrorMin, eta.tailsBiasMin, eta.coverage * 100.0f,
+               eta.tailsCubeAbv);
+    }
+    printf("Warnings:  %u, errors %u\n", (unsigned)history.results.warnings.size(),
+           (unsigned)history.results.errors.size());
+    if (!history.notes.isEmpty()) {
+        printf("Notes:     %s\n", history.notes.c_str());
+    }
+    if (result.wallMs > 0) {
+        printf("Speed-up:  x%.0f\n", (float)millis() / result.wallMs);
+    }
+}
+
+static void printReplaySummary(uint32_t wallMs) {
+    ReplayDiff diff;
+    Replay::getDiff(diff);
+
+    uint32_t sec = millis() / 1000;
+    printf("=== Smart-Column S3 replay, %lu:%02lu:%02lu ===\n", (unsigned long)(sec / 3600),
+           (unsigned long)(sec / 60 % 60), (unsigned long)(sec % 60));
+    printf("Heater:    mean |d| %.1f %%, max %.0f %%, energy %+.2f kWh\n",
+           diff.heaterMeanAbs, diff.heaterMaxAbs, diff.energyDeltaKwh);
+    printf("Pump:      mean |d| %.0f ml/h, volume %.0f -> %.0f ml\n",
+           diff.speedMeanAbs, diff.volumeOrig, diff.volumeNew);
+    printf("Mismatch:  phase %lu s, valves %lu s of %lu\n",
+           (unsigned long)diff.phaseMismatchSec, (unsigned long)diff.valveMismatchSec,
+           (unsigned long)diff.samples);
+
+    printf("Phase      orig(s)    new(s)     delta\n");
+    for (uint8_t i = 1; i < REPLAY_PHASES; i++) {
+        int32_t orig = diff.phaseStartOrig[i];
+        int32_t now = diff.phaseStartNew[i];
+        if (orig < 0 && now < 0) continue;
+
+        char origText[12] = "-", newText[12] = "-", deltaText[12] = "";
+        if (orig >= 0) snprintf(origText, sizeof(origText), "%ld", (long)orig);
+        if (now >= 0) snprintf(newText, sizeof(newText), "%ld", (long)now);
+        if (orig >= 0 && now >= 0) snprintf(deltaText, sizeof(deltaText), "%+ld", (long)(now - orig));
+        printf("%-10s %-10s %-10s %s\n", FSM::getPhaseName(static_cast<RectPhase>(i)),
+               origText, newText, deltaText);
+    }
+    if (wallMs > 0) {
+        printf("Speed-up:  x%.0f\n", (float)millis() / wallMs);
+    }
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    Sim::defaults(options);
+    PlantConfig& config = options.config;
+    Mode& mode = options.mode;
+    float value = 0;
+    float mashProfile = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* next = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+            continue;
+        }
+        if (strcmp(arg, "--pot-still") == 0) {
+            config.columnSensor = false;
+            continue;
+        }
+        if (!next) {
+            usage();
+            return 2;
+        }
+        i++;
+
+        if (strcmp(arg, "--mode") == 0) {
+            if (strcmp(next, "rect") == 0) mode = Mode::RECTIFICATION;
+            else if (strcmp(next, "dist") == 0) mode = Mode::DISTILLATION;
+            else if (strcmp(next, "mash") == 0) mode = Mode::MASHING;
+            else if (strcmp(next, "hold") == 0) mode = Mode::HOLD;
+            else if (strcmp(next, "flood") == 0) mode = Mode::FLOOD_CALIBRATION;
+            else if (strcmp(next, "autotune") == 0) mode = Mode::PID_AUTOTUNE;
+            else { usage(); return 2; }
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoul(next, nullptr, 10);
+        } else if (strcmp(arg, "--setpoint") == 0) {
+            value = atof(next);
+        } else if (strcmp(arg, "--mash-profile") == 0) {
+            mashProfile = atof(next);
+        } else if (strcmp(arg, "--hours") == 0) {
+            options.hours = atof(next);
+        } else if (strcmp(arg, "--charge-l") == 0) {
+            config.chargeL = atof(next);
+        } else if (strcmp(arg, "--abv") == 0) {
+            config.chargeAbv = atof(next);
+        } else if (strcmp(arg, "--heads-ml") == 0) {
+            options.headsMl = atof(next);
+        } else if (strcmp(arg, "--log") == 0) {
+            options.logPath = next;
+        } else if (strcmp(arg, "--replay") == 0) {
+            options.replay = next;
+        } else if (strcmp(arg, "--diff") == 0) {
+            options.diffPath = next;
+        } else if (strcmp(arg, "--history") == 0) {
+            options.historyDir = next;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    options.value = mode == Mode::MASHING ? mashProfile : value;
+
+    SimResult result;
+    Sim::run(options, result);
+    if (result.exitCode == 2) {
+        return 2;
+    }
+
+    if (Replay::active()) {
+        printReplaySummary(result.wallMs);
+    } else {
+        printSummary(config, result);
+    }
+    return result.exitCode;
+}
+
+#endif // PIO_UNIT_TESTING
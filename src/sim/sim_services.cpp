@@ -0,0 +1,368 @@
+/**
+ * Smart-Column S3 - Сервисы симулятора
+ *
+ * Logger пишет сегмент .bin как прошивка или CSV тем же форматом, что
+ * экспорт (packData + formatCsv). История процесса - в памяти, с
+ * каталогом ПК - ещё и файлы /history в формате устройства. Уведомления
+ * MQTT уходят в лог, профилей нет - автонастройка ПИД оставляет
+ * коэффициенты в результате.
+ */
+
+#include <dirent.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include "sim.h"
+#include "../history.h"
+#include "../profiles.h"
+#include "../drivers/heater.h"
+#include "../interface/mqtt.h"
+#include "../storage/logger.h"
+#include "../storage/nvs_manager.h"
+
+static const char* logPath = nullptr;
+static FILE* logFile = nullptr;
+static bool logBinary = false;
+static uint32_t sessionStart = 0;
+static const char* historyDir = nullptr;
+
+ProcessRecorder processRecorder;
+
+/**
+ * Запись в файл: .bin - как сегмент Logger, иначе строка CSV экспорта
+ */
+static void writeRecord(const LogRecord& record) {
+    if (!logFile) return;
+
+    if (logBinary) {
+        fwrite(&record, sizeof(record), 1, logFile);
+        return;
+    }
+
+    char line[256];
+    size_t len = Logger::formatCsv(record, line, sizeof(line));
+    if (len > 0) {
+        fwrite(line, 1, len, logFile);
+        fputc('\n', logFile);
+    }
+}
+
+// ============================================================================
+// Logger
+// ============================================================================
+
+namespace SimLog {
+
+void setPath(const char* path) {
+    logPath = path;
+    size_t len = path ? strlen(path) : 0;
+    logBinary = len > 4 && strcmp(path + len - 4, ".bin") == 0;
+}
+
+} // namespace SimLog
+
+namespace Logger {
+
+bool startNewLog(Mode mode) {
+    closeLog();
+    sessionStart = millis();
+    if (!logPath) return true;
+
+    logFile = fopen(logPath, logBinary ? "wb" : "w");
+    if (!logFile) {
+        LOG_E("Logger: Cannot create %s", logPath);
+        return false;
+    }
+
+    if (!logBinary) {
+        fprintf(logFile, "%s\n", LOG_CSV_HEADER);
+        return true;
+    }
+
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = LogRecordKind::HEADER;
+    record.mode = static_cast<uint8_t>(mode);
+    record.header.magic = LOG_RECORD_MAGIC;
+    record.header.version = LOG_RECORD_VERSION;
+    record.header.recordSize = sizeof(LogRecord);
+    writeRecord(record);
+    return true;
+}
+
+void writeData(const SystemState& state) {
+    LogRecord record;
+    packData(state, millis() - sessionStart, Heater::getPower(), record);
+    writeRecord(record);
+}
+
+void log(const LogEvent& event) {
+    LOG_I("Event: %s", event.message);
+
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timeMs = millis() - sessionStart;
+    record.kind = LogRecordKind::EVENT;
+    record.heaterPercent = Heater::getPower();
+    record.event.type = event.type;
+    memcpy(record.event.message, event.message, sizeof(record.event.message));
+    writeRecord(record);
+}
+
+void closeLog() {
+    if (!logFile) return;
+
+    if (logBinary) {
+        LogRecord record;
+        memset(&record, 0, sizeof(record));
+        record.timeMs = millis() - sessionStart;
+        record.kind = LogRecordKind::CLOSE;
+        writeRecord(record);
+    }
+    fclose(logFile);
+    logFile = nullptr;
+}
+
+} // namespace Logger
+
+// ============================================================================
+// Уведомления, настройки, профили
+// ============================================================================
+
+namespace MQTT {
+
+void publishNotification(const char* title, const char* message, const char* level) {
+    // Текст длиннее пула строк DeferredLog - в консоль напрямую, после очереди
+    DeferredLog::flush();
+    Serial.printf("[N] %s (%s): %s\n", title, level, message);
+}
+
+} // namespace MQTT
+
+namespace NVSManager {
+
+void markDirty() {
+    // Настройки живут до конца прогона (g_settings)
+}
+
+} // namespace NVSManager
+
+bool isBuiltinProfile(const String& id) {
+    return id.startsWith(BUILTIN_ID_PREFIX);
+}
+
+bool loadProfile(const String& id, Profile& profile) {
+    (void)id;
+    (void)profile;
+    return false;
+}
+
+bool saveProfile(const Profile& profile) {
+    (void)profile;
+    return false;
+}
+
+bool applyProfile(const String& id) {
+    (void)id;
+    return false;
+}
+
+// ============================================================================
+// История процесса (в памяти)
+// ============================================================================
+
+ProcessRecorder::ProcessRecorder() : recording(false), lastTimeseriesTime(0) {
+}
+
+void ProcessRecorder::startRecording(const String& type, const String& mode) {
+    currentHistory = ProcessHistory();
+    recording = true;
+
+    // Виртуальные часы каждого прогона идут с нуля - ID по часам ПК
+    currentHistory.id = String((unsigned long)time(nullptr));
+    currentHistory.version = FW_VERSION;
+    currentHistory.metadata.startTime = millis() / 1000;
+    currentHistory.process.type = type;
+    currentHistory.process.mode = mode;
+}
+
+void ProcessRecorder::stopRecording(bool success) {
+    if (!recording) return;
+
+    uint32_t now = millis() / 1000;
+    currentHistory.metadata.endTime = now;
+    currentHistory.metadata.duration = now - currentHistory.metadata.startTime;
+    currentHistory.metadata.completedSuccessfully = success;
+    currentHistory.results.status = success ? "completed" : "stopped";
+    recording = false;
+}
+
+void ProcessRecorder::recordPlan(uint32_t checksum, const String& profileId, const String& phase) {
+    if (!recording) return;
+
+    PlanSwap swap;
+    swap.time = millis() / 1000;
+    swap.checksum = checksum;
+    swap.profileId = profileId;
+    swap.phase = phase;
+    currentHistory.plans.push_back(swap);
+}
+
+void ProcessRecorder::recordSpeedChange(float fromSpeed, float toSpeed, float columnTop,
+                                        const String& reason) {
+    if (!recording) return;
+
+    SpeedChange change;
+    change.time = millis() / 1000;
+    change.fromSpeed = fromSpeed;
+    change.toSpeed = toSpeed;
+    change.columnTop = columnTop;
+    change.reason = reason;
+    currentHistory.speedChanges.push_back(change);
+}
+
+void ProcessRecorder::recordHeatup(const HeatupReport& report) {
+    if (!recording) return;
+    currentHistory.heatup = report;
+}
+
+void ProcessRecorder::recordRampStep(uint8_t power, float pressure, float pressureStd, bool flood) {
+    if (!recording) return;
+
+    RampStep step;
+    step.time = millis() / 1000;
+    step.power = power;
+    step.pressure = pressure;
+    step.pressureStd = pressureStd;
+    step.flood = flood;
+    currentHistory.ramp.push_back(step);
+}
+
+void ProcessRecorder::addTimeseriesPoint(const TimeseriesPoint& point) {
+    if (!recording) return;
+
+    uint32_t now = millis() / 1000;
+    if (now - lastTimeseriesTime >= TIMESERIES_INTERVAL) {
+        currentHistory.timeseries.push_back(point);
+        lastTimeseriesTime = now;
+    }
+}
+
+void ProcessRecorder::recordTempStep(const TempStepRecord& step) {
+    if (!recording) return;
+    currentHistory.steps.push_back(step);
+}
+
+void ProcessRecorder::addWarning(const String& message, const String& severity) {
+    ProcessWarning warning;
+    warning.time = millis() / 1000;
+    warning.message = message;
+    warning.severity = severity;
+
+    if (severity == "error") {
+        currentHistory.results.errors.push_back(warning);
+    } else {
+        currentHistory.results.warnings.push_back(warning);
+    }
+}
+
+void ProcessRecorder::setNotes(const String& notes) {
+    currentHistory.notes = notes;
+}
+
+ProcessHistory& ProcessRecorder::getHistory() {
+    return currentHistory;
+}
+
+// ============================================================================
+// История процессов (каталог ПК)
+// ============================================================================
+
+static std::string historyPath(const String& id) {
+    return std::string(historyDir) + "/process_" + id.c_str() + ".json";
+}
+
+static bool readJson(const std::string& path, JsonDocument& doc) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) {
+        text.append(buf, n);
+    }
+    fclose(file);
+
+    DeserializationError error = deserializeJson(doc, text.c_str(), text.size());
+    if (error) {
+        LOG_W("History: %s - %s", path.c_str(), error.c_str());
+        return false;
+    }
+    return true;
+}
+
+namespace SimHistory {
+
+void setDir(const char* dir) {
+    historyDir = dir;
+}
+
+bool save(const ProcessHistory& history) {
+    if (!historyDir) return true;
+
+    DynamicJsonDocument doc(32768);
+    historyToJson(history, doc);
+    std::string text;
+    serializeJson(doc, text);
+
+    std::string path = historyPath(history.id);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        LOG_E("History: Cannot create %s", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    fclose(file);
+    return ok;
+}
+
+} // namespace SimHistory
+
+std::vector<ProcessListItem> getProcessList() {
+    std::vector<ProcessListItem> list;
+    DIR* dir = historyDir ? opendir(historyDir) : nullptr;
+    if (!dir) return list;
+
+    while (struct dirent* entry = readdir(dir)) {
+        String name = entry->d_name;
+        if (!name.startsWith("process_") || !name.endsWith(".json")) continue;
+
+        DynamicJsonDocument doc(32768);
+        if (!readJson(std::string(historyDir) + "/" + entry->d_name, doc)) continue;
+
+        ProcessListItem item;
+        item.id = doc["id"].as<String>();
+        item.type = doc["process"]["type"].as<String>();
+        item.startTime = doc["metadata"]["startTime"];
+        item.duration = doc["metadata"]["duration"];
+        item.status = doc["results"]["status"].as<String>();
+        item.totalVolume = doc["results"]["totalCollected"];
+        list.push_back(item);
+    }
+    closedir(dir);
+
+    std::sort(list.begin(), list.end(), [](const ProcessListItem& a, const ProcessListItem& b) {
+        return a.startTime > b.startTime;
+    });
+    return list;
+}
+
+bool loadProcessHistory(const String& id, ProcessHistory& history) {
+    if (!historyDir) return false;
+
+    DynamicJsonDocument doc(32768);
+    if (!readJson(historyPath(id), doc)) return false;
+    historyFromJson(doc, history);
+    return true;
+}
@@ -0,0 +1,254 @@
+/**
+ * Smart-Column S3 - Бортовой самописец
+ *
+ * Кольца срезов и событий в RTC_NOINIT памяти. Содержимое не
+ * обнуляется при программном сбросе, панике и срабатывании WDT,
+ * поэтому после перезагрузки видно, что происходило перед сбоем.
+ */
+
+#include "flight_recorder.h"
+#include "../fs_compat.h"
+#include "../drivers/heater.h"
+#include <esp_system.h>
+#include <time.h>
+
+#define FLIGHT_MAGIC        0x464C5431  // "FLT1"
+#define FLIGHT_VERSION      1
+#define TEMP_NONE           INT16_MIN
+
+/**
+ * Заголовок колец (проверка целостности после сброса)
+ */
+struct FlightHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sampleSize;
+    uint16_t sampleHead;
+    uint16_t sampleCount;
+    uint16_t eventHead;
+    uint16_t eventCount;
+    uint32_t bootCount;
+    uint32_t lastEpoch;             // Время последнего среза (если NTP синхронизирован)
+};
+
+RTC_NOINIT_ATTR static FlightHeader header;
+RTC_NOINIT_ATTR static FlightSample samples[FLIGHT_SAMPLES];
+RTC_NOINIT_ATTR static LogEvent events[FLIGHT_EVENTS];
+
+static bool active = false;
+static bool crashSaved = false;
+static uint32_t lastSampleTime = 0;
+static esp_reset_reason_t resetReason = ESP_RST_UNKNOWN;
+static portMUX_TYPE eventMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ============================================================================
+// Вспомогательные функции
+// ============================================================================
+
+static bool headerValid() {
+    return header.magic == FLIGHT_MAGIC &&
+           header.version == FLIGHT_VERSION &&
+           header.sampleSize == sizeof(FlightSample) &&
+           header.sampleHead < FLIGHT_SAMPLES &&
+           header.sampleCount <= FLIGHT_SAMPLES &&
+           header.eventHead < FLIGHT_EVENTS &&
+           header.eventCount <= FLIGHT_EVENTS;
+}
+
+static bool isCrashReset(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static const char* reasonToString(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON:   return "poweron";
+        case ESP_RST_EXT:       return "external";
+        case ESP_RST_SW:        return "software";
+        case ESP_RST_PANIC:     return "panic";
+        case ESP_RST_INT_WDT:   return "int_wdt";
+        case ESP_RST_TASK_WDT:  return "task_wdt";
+        case ESP_RST_WDT:       return "wdt";
+        case ESP_RST_DEEPSLEEP: return "deepsleep";
+        case ESP_RST_BROWNOUT:  return "brownout";
+        case ESP_RST_SDIO:      return "sdio";
+        default:                return "unknown";
+    }
+}
+
+static int16_t packTemp(float value, bool valid) {
+    if (!valid || isnan(value)) return TEMP_NONE;
+    float scaled = value * 100.0f;
+    if (scaled > 32767.0f) return 32767;
+    if (scaled < -32767.0f) return -32767;
+    return static_cast<int16_t>(scaled);
+}
+
+static uint16_t packU16(float value, float scale) {
+    float scaled = value * scale;
+    if (scaled <= 0.0f) return 0;
+    if (scaled >= 65535.0f) return 65535;
+    return static_cast<uint16_t>(scaled);
+}
+
+static void resetRings() {
+    memset(&header, 0, sizeof(header));
+    header.magic = FLIGHT_MAGIC;
+    header.version = FLIGHT_VERSION;
+    header.sampleSize = sizeof(FlightSample);
+}
+
+/**
+ * Отчёт пишется построчно в файл - без JSON-документа на ~4 КБ данных
+ */
+static bool writeCrashReport() {
+    if (!SPIFFS.exists(CRASH_DIR)) {
+        SPIFFS.mkdir(CRASH_DIR);
+    }
+
+    // Предыдущий отчёт сохраняется
+    if (SPIFFS.exists(CRASH_REPORT_FILE)) {
+        SPIFFS.remove(CRASH_REPORT_PREV);
+        SPIFFS.rename(CRASH_REPORT_FILE, CRASH_REPORT_PREV);
+    }
+
+    File file = SPIFFS.open(CRASH_REPORT_FILE, FILE_WRITE);
+    if (!file) {
+        LOG_E("FlightRecorder: Failed to open %s", CRASH_REPORT_FILE);
+        return false;
+    }
+
+    file.printf("{\"resetReason\":\"%s\",\"bootCount\":%lu,\"lastEpoch\":%lu,\"firmware\":\"%s\",",
+                reasonToString(resetReason),
+                (unsigned long)header.bootCount,
+                (unsigned long)header.lastEpoch,
+                FW_VERSION);
+
+    // Срезы от старых к новым
+    file.print("\"fields\":[\"t\",\"cube\",\"colBot\",\"colTop\",\"reflux\",\"tsa\",\"waterIn\",\"waterOut\","
+               "\"pCube\",\"power\",\"pump\",\"heater\",\"mode\",\"phase\",\"flags\"],\"samples\":[");
+    uint16_t start = (header.sampleHead + FLIGHT_SAMPLES - header.sampleCount) % FLIGHT_SAMPLES;
+    for (uint16_t i = 0; i < header.sampleCount; i++) {
+        const FlightSample& s = samples[(start + i) % FLIGHT_SAMPLES];
+        file.printf("%s[%lu", i ? "," : "", (unsigned long)s.timeMs);
+        for (uint8_t t = 0; t < TEMP_COUNT; t++) {
+            if (s.temps[t] == TEMP_NONE) {
+                file.print(",null");
+            } else {
+                file.printf(",%.2f", s.temps[t] / 100.0f);
+            }
+        }
+        file.printf(",%.1f,%u,%u,%u,%u,%u,%u]",
+                    s.pressureCube / 10.0f, s.power, s.pumpSpeed,
+                    s.heaterPercent, s.mode, s.phase, s.flags);
+    }
+    file.print("],\"events\":[");
+
+    start = (header.eventHead + FLIGHT_EVENTS - header.eventCount) % FLIGHT_EVENTS;
+    for (uint16_t i = 0; i < header.eventCount; i++) {
+        const LogEvent& e = events[(start + i) % FLIGHT_EVENTS];
+        char message[sizeof(e.message) + 1];
+        memcpy(message, e.message, sizeof(e.message));
+        message[sizeof(e.message)] = '\0';
+        // Кавычки и управляющие символы не экранируются - заменяем
+        for (char* c = message; *c; c++) {
+            if (*c == '"' || *c == '\\' || static_cast<uint8_t>(*c) < 0x20) *c = ' ';
+        }
+        file.printf("%s{\"t\":%lu,\"type\":%u,\"message\":\"%s\"}",
+                    i ? "," : "", (unsigned long)e.timestamp, e.type, message);
+    }
+    file.print("]}");
+    file.close();
+
+    LOG_W("FlightRecorder: Crash report saved (%s, %u samples, %u events)",
+          reasonToString(resetReason), header.sampleCount, header.eventCount);
+    return true;
+}
+
+// ============================================================================
+// Публичный интерфейс
+// ============================================================================
+
+namespace FlightRecorder {
+
+void init() {
+    resetReason = esp_reset_reason();
+
+    if (headerValid()) {
+        if (isCrashReset(resetReason) && header.sampleCount > 0) {
+            crashSaved = writeCrashReport();
+        }
+        uint32_t bootCount = header.bootCount;
+        resetRings();
+        header.bootCount = bootCount + 1;
+    } else {
+        // Включение питания - в RTC-памяти мусор
+        resetRings();
+    }
+
+    active = true;
+    LOG_I("FlightRecorder: Ready (reset: %s, boot #%lu)",
+          reasonToString(resetReason), (unsigned long)header.bootCount);
+}
+
+void record(const SystemState& state) {
+    if (!active) return;
+
+    uint32_t now = millis();
+    if (now - lastSampleTime < FLIGHT_SAMPLE_INTERVAL_MS) return;
+    lastSampleTime = now;
+
+    FlightSample& s = samples[header.sampleHead];
+    s.timeMs = now;
+    s.temps[TEMP_CUBE] = packTemp(state.temps.cube, state.temps.valid[TEMP_CUBE]);
+    s.temps[TEMP_COLUMN_BOTTOM] = packTemp(state.temps.columnBottom, state.temps.valid[TEMP_COLUMN_BOTTOM]);
+    s.temps[TEMP_COLUMN_TOP] = packTemp(state.temps.columnTop, state.temps.valid[TEMP_COLUMN_TOP]);
+    s.temps[TEMP_REFLUX] = packTemp(state.temps.reflux, state.temps.valid[TEMP_REFLUX]);
+    s.temps[TEMP_TSA] = packTemp(state.temps.tsa, state.temps.valid[TEMP_TSA]);
+    s.temps[TEMP_WATER_IN] = packTemp(state.temps.waterIn, state.temps.valid[TEMP_WATER_IN]);
+    s.temps[TEMP_WATER_OUT] = packTemp(state.temps.waterOut, state.temps.valid[TEMP_WATER_OUT]);
+    s.pressureCube = packU16(state.pressure.cube, 10.0f);
+    s.power = packU16(state.power.power, 1.0f);
+    s.pumpSpeed = packU16(state.pump.speedMlPerHour, 1.0f);
+    s.heaterPercent = Heater::getPower();
+    s.mode = static_cast<uint8_t>(state.mode);
+    s.phase = (state.mode == Mode::MASHING) ? static_cast<uint8_t>(state.mashPhase)
+                                            : static_cast<uint8_t>(state.rectPhase);
+    s.flags = (state.safetyOk ? 0x01 : 0) | (state.paused ? 0x02 : 0);
+
+    header.sampleHead = (header.sampleHead + 1) % FLIGHT_SAMPLES;
+    if (header.sampleCount < FLIGHT_SAMPLES) header.sampleCount++;
+    header.lastEpoch = static_cast<uint32_t>(time(nullptr));
+}
+
+void recordEvent(const LogEvent& event) {
+    if (!active) return;
+
+    portENTER_CRITICAL(&eventMux);
+    events[header.eventHead] = event;
+    header.eventHead = (header.eventHead + 1) % FLIGHT_EVENTS;
+    if (header.eventCount < FLIGHT_EVENTS) header.eventCount++;
+    portEXIT_CRITICAL(&eventMux);
+}
+
+bool hasCrashReport() {
+    return crashSaved;
+}
+
+const char* getResetReason() {
+    return reasonToString(resetReason);
+}
+
+uint32_t getBootCount() {
+    return header.bootCount;
+}
+
+} // namespace FlightRecorder
@@ -0,0 +1,68 @@
+/**
+ * Smart-Column S3 - Flight Recorder
+ *
+ * Бортовой самописец: последние ~2 минуты состояния и последние
+ * события в RTC-памяти, переживающей программный сброс, WDT и панику.
+ * После аварийной перезагрузки сохраняется отчёт /crash/last.json.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+/**
+ * Компактный срез состояния (28 байт)
+ */
+struct FlightSample {
+    uint32_t timeMs;                // millis()
+    int16_t temps[TEMP_COUNT];      // 0.01 °C, INT16_MIN = нет данных
+    uint16_t pressureCube;          // 0.1 мм рт.ст.
+    uint16_t power;                 // Вт
+    uint16_t pumpSpeed;             // мл/час
+    uint8_t heaterPercent;          // %
+    uint8_t mode;                   // Mode
+    uint8_t phase;                  // RectPhase / MashPhase
+    uint8_t flags;                  // Бит 0 = safetyOk, 1 = paused
+};
+
+static_assert(sizeof(FlightSample) == 28, "FlightSample must stay compact");
+
+namespace FlightRecorder {
+    /**
+     * Инициализация: при аварийном сбросе сохранить отчёт, затем очистить кольцо.
+     * Вызывать после монтирования LittleFS.
+     */
+    void init();
+
+    /**
+     * Запись среза (вызывается на каждом такте, сохраняет раз в FLIGHT_SAMPLE_INTERVAL_MS)
+     * @param state Состояние системы
+     */
+    void record(const SystemState& state);
+
+    /**
+     * Запись события
+     * @param event Событие
+     */
+    void recordEvent(const LogEvent& event);
+
+    /**
+     * Был ли при загрузке сохранён отчёт об аварии
+     */
+    bool hasCrashReport();
+
+    /**
+     * Причина последнего сброса строкой
+     */
+    const char* getResetReason();
+
+    /**
+     * Номер загрузки (с включения питания, переживает программный сброс)
+     */
+    uint32_t getBootCount();
+}
+
+#endif // FLIGHT_RECORDER_H
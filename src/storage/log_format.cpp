@@ -0,0 +1,103 @@
+/**
+ * Smart-Column S3 - Формат записей лога
+ *
+ * Упаковка среза состояния в LogRecord и экспорт в CSV. Без файловой
+ * системы и задач - общий код для Logger и симулятора (env:native).
+ */
+
+#include "logger.h"
+
+namespace Logger {
+
+void packData(const SystemState& state, uint32_t timeMs, uint8_t heaterPercent, LogRecord& record) {
+    record.timeMs = timeMs;
+    record.kind = LogRecordKind::DATA;
+    record.mode = static_cast<uint8_t>(state.mode);
+    record.phase = static_cast<uint8_t>(state.rectPhase);
+    record.heaterPercent = heaterPercent;
+
+    record.data.temps[TEMP_CUBE] = state.temps.cube;
+    record.data.temps[TEMP_COLUMN_BOTTOM] = state.temps.columnBottom;
+    record.data.temps[TEMP_COLUMN_TOP] = state.temps.columnTop;
+    record.data.temps[TEMP_REFLUX] = state.temps.reflux;
+    record.data.temps[TEMP_TSA] = state.temps.tsa;
+    record.data.temps[TEMP_WATER_IN] = state.temps.waterIn;
+    record.data.temps[TEMP_WATER_OUT] = state.temps.waterOut;
+
+    record.data.validMask = 0;
+    for (uint8_t i = 0; i < TEMP_COUNT; i++) {
+        if (state.temps.valid[i]) record.data.validMask |= (1 << i);
+    }
+
+    record.data.pressureCube = state.pressure.cube;
+    record.data.pressureAtm = state.pressure.atmosphere;
+    record.data.abv = state.hydrometer.abv;
+    record.data.power = state.power.power;
+    record.data.pumpSpeed = state.pump.speedMlPerHour;
+    record.data.pumpVolume = state.pump.totalVolumeMl;
+
+    record.data.valves = (state.valves.water ? 0x01 : 0) |
+                         (state.valves.heads ? 0x02 : 0) |
+                         (state.valves.uno ? 0x04 : 0);
+    record.data.reserved[0] = 0;
+    record.data.reserved[1] = 0;
+}
+
+size_t formatCsv(const LogRecord& record, char* buffer, size_t size) {
+    int len = 0;
+
+    switch (record.kind) {
+        case LogRecordKind::DATA:
+            len = snprintf(buffer, size,
+                           "%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.0f,%.1f,%.1f,%u,%u,%u,,",
+                           (unsigned long)record.timeMs,
+                           record.data.temps[TEMP_CUBE],
+                           record.data.temps[TEMP_COLUMN_BOTTOM],
+                           record.data.temps[TEMP_COLUMN_TOP],
+                           record.data.temps[TEMP_REFLUX],
+                           record.data.temps[TEMP_TSA],
+                           record.data.temps[TEMP_WATER_IN],
+                           record.data.temps[TEMP_WATER_OUT],
+                           record.data.pressureCube,
+                           record.data.pressureAtm,
+                           record.data.abv,
+                           record.data.power,
+                           record.data.pumpSpeed,
+                           record.data.pumpVolume,
+                           record.phase,
+                           record.heaterPercent,
+                           record.data.valves);
+            break;
+
+        case LogRecordKind::EVENT: {
+            // Колонка state у события пустая, тип - в event_type.
+            // Сообщение в кавычках, кавычка внутри удваивается
+            len = snprintf(buffer, size, "%lu,,,,,,,,,,,,,,,%u,,%u,\"",
+                           (unsigned long)record.timeMs,
+                           record.heaterPercent,
+                           record.event.type);
+            if (len < 0 || static_cast<size_t>(len) + 2 > size) break;
+
+            size_t pos = len;
+            for (size_t i = 0; i < sizeof(record.event.message) && record.event.message[i]; i++) {
+                char c = record.event.message[i];
+                size_t need = c == '"' ? 2 : 1;
+                if (pos + need + 2 > size) break;   // Место под кавычку и '\0'
+                buffer[pos++] = c;
+                if (c == '"') buffer[pos++] = '"';
+            }
+            buffer[pos++] = '"';
+            buffer[pos] = '\0';
+            len = pos;
+            break;
+        }
+
+        default:
+            return 0;
+    }
+
+    if (len < 0) return 0;
+    return (static_cast<size_t>(len) < size) ? len : size - 1;
+}
+
+} // namespace Logger
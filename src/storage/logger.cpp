@@ -1,165 +1,554 @@
 /**
  * Smart-Column S3 - Логгер данных
  *
- * Запись данных на SPIFFS в формате CSV
+ * Запись данных на LittleFS в бинарном формате.
+ *
+ * Производители (loop, обработчики событий) кладут записи по 64 байта
+ * в кольцо в PSRAM. Задача-писатель собирает их в блок 4 КБ во
+ * внутренней RAM и пишет целым блоком, поэтому смещения в файле всегда
+ * выровнены по страницам флеш и LittleFS не переписывает хвост страницы
+ * на каждой строке. Сегменты ротируются по LOG_MAX_SIZE_BYTES, старые
+ * сессии удаляются по бюджету LOG_BUDGET_BYTES и свободному месту раздела.
  */
 
 #include "logger.h"
+#include "flight_recorder.h"
 #include "../fs_compat.h"
+#include "../drivers/heater.h"
 #include <time.h>
+#include <vector>
+#include <algorithm>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define RECORDS_PER_BLOCK   (LOG_BLOCK_SIZE / sizeof(LogRecord))
+#define PAD_KIND            0xFF        // Заполнитель неполного блока
+#define EPOCH_VALID         1577836800UL  // 2020-01-01: часы синхронизированы
+
+// Кольцо записей (один потребитель - задача-писатель)
+static LogRecord* ring = nullptr;
+static uint16_t ringCapacity = 0;       // Степень двойки
+static volatile uint32_t ringHead = 0;  // Пишут производители
+static volatile uint32_t ringTail = 0;  // Пишет только задача-писатель
+static bool ringInPsram = false;
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Последние события (для getLastEvents)
+static LogEvent lastEvents[LOG_EVENTS_KEEP];
+static uint8_t lastEventsHead = 0;
+static uint8_t lastEventsCount = 0;
+
+// Состояние сессии (поток производителя)
+static uint32_t sessionStart = 0;
+static bool sessionActive = false;
 
+// Состояние писателя (только задача-писатель)
+static TaskHandle_t writerTask = nullptr;
+static uint8_t* block = nullptr;        // Собираемый блок (внутренняя RAM)
+static uint16_t blockFill = 0;          // Записей в блоке
+static uint32_t blockStartMs = 0;
 static File currentLogFile;
+static char sessionBase[40];            // /logs/YYYYMMDD_HHMMSS или /logs/bNNNNN_UUUUUUU
 static char currentFilename[64];
-static uint32_t sessionStart = 0;
+static uint16_t segmentIndex = 0;
+static LogRecord sessionHeader;
 
-namespace Logger {
+// Статистика (пишет задача-писатель, читают все)
+static LoggerStats stats;
+static uint32_t statsHour = 0;
 
-bool init() {
-    LOG_I("Logger: Initializing...");
+// ============================================================================
+// Кольцо
+// ============================================================================
 
-    if (!SPIFFS.begin(true)) {
-        LOG_E("Logger: SPIFFS mount failed!");
-        return false;
+static bool ringPush(const LogRecord& record) {
+    if (!ring) return false;
+
+    bool ok = false;
+    portENTER_CRITICAL(&ringMux);
+    if (ringHead - ringTail < ringCapacity) {
+        ring[ringHead & (ringCapacity - 1)] = record;
+        ringHead = ringHead + 1;
+        ok = true;
+    } else {
+        stats.droppedRecords++;
     }
+    portEXIT_CRITICAL(&ringMux);
 
-    // Создать директорию для логов
-    if (!SPIFFS.exists(LOG_FILE_PREFIX)) {
-        SPIFFS.mkdir(LOG_FILE_PREFIX);
+    if (ok && writerTask) {
+        xTaskNotifyGive(writerTask);
     }
+    return ok;
+}
+
+static bool ringPop(LogRecord& record) {
+    uint32_t head;
+    portENTER_CRITICAL(&ringMux);
+    head = ringHead;
+    portEXIT_CRITICAL(&ringMux);
+
+    if (head == ringTail) return false;
 
-    LOG_I("Logger: Ready");
+    record = ring[ringTail & (ringCapacity - 1)];
+    portENTER_CRITICAL(&ringMux);
+    ringTail = ringTail + 1;
+    portEXIT_CRITICAL(&ringMux);
     return true;
 }
 
-void startSession() {
-    sessionStart = millis();
+// ============================================================================
+// Задача-писатель
+// ============================================================================
 
-    // Сформировать имя файла: /logs/YYYYMMDD_HHMMSS.csv
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
-
-    snprintf(currentFilename, sizeof(currentFilename),
-             "%s%04d%02d%02d_%02d%02d%02d%s",
-             LOG_FILE_PREFIX,
-             timeinfo.tm_year + 1900,
-             timeinfo.tm_mon + 1,
-             timeinfo.tm_mday,
-             timeinfo.tm_hour,
-             timeinfo.tm_min,
-             timeinfo.tm_sec,
-             LOG_FILE_EXT);
-
-    // Открыть файл для записи
-    currentLogFile = SPIFFS.open(currentFilename, FILE_WRITE);
+static void accountBytes(uint32_t bytes) {
+    uint32_t hour = millis() / 3600000UL;
+    if (hour != statsHour) {
+        // Прошлый час валиден только если он непосредственно предыдущий
+        stats.bytesLastHour = (hour == statsHour + 1) ? stats.bytesThisHour : 0;
+        stats.bytesThisHour = 0;
+        statsHour = hour;
+    }
+    stats.bytesWritten += bytes;
+    stats.bytesThisHour += bytes;
+}
+
+static void writeBlock(bool pad) {
+    if (blockFill == 0) return;
+
+    if (pad && blockFill < RECORDS_PER_BLOCK) {
+        // Заполнитель сохраняет выравнивание следующих блоков
+        memset(block + blockFill * sizeof(LogRecord), PAD_KIND,
+               (RECORDS_PER_BLOCK - blockFill) * sizeof(LogRecord));
+        blockFill = RECORDS_PER_BLOCK;
+    }
+
+    if (currentLogFile) {
+        size_t bytes = blockFill * sizeof(LogRecord);
+        size_t written = currentLogFile.write(block, bytes);
+        currentLogFile.flush();
+        if (written != bytes) {
+            LOG_E("Logger: Write failed (%u/%u)", (unsigned)written, (unsigned)bytes);
+        }
+        accountBytes(written);
+        stats.blocksWritten++;
+    }
+
+    blockFill = 0;
+}
+
+static void closeSegment() {
+    writeBlock(false);
+    if (currentLogFile) {
+        currentLogFile.close();
+        LOG_I("Logger: Segment closed %s", currentFilename);
+    }
+}
+
+static void openSegment() {
+    snprintf(currentFilename, sizeof(currentFilename), "%s_s%02u%s",
+             sessionBase, segmentIndex, LOG_FILE_EXT);
 
+    currentLogFile = SPIFFS.open(currentFilename, FILE_WRITE);
     if (!currentLogFile) {
         LOG_E("Logger: Failed to open %s", currentFilename);
         return;
     }
 
-    // Записать заголовок CSV
-    currentLogFile.println("timestamp,t_cube,t_col_bot,t_col_top,t_reflux,t_tsa,t_water_in,t_water_out,"
-                           "p_cube,p_atm,abv,power,speed,volume,state,event");
+    stats.segmentsOpened++;
+    LOG_I("Logger: Segment -> %s", currentFilename);
+
+    // Каждый сегмент начинается с заголовка и читается независимо
+    LogRecord header = sessionHeader;
+    header.header.segment = segmentIndex;
+    memcpy(block, &header, sizeof(LogRecord));
+    blockFill = 1;
+    blockStartMs = millis();
 
-    LOG_I("Logger: Session started -> %s", currentFilename);
+    Logger::cleanupOldLogs();
 }
 
-void stopSession() {
-    if (currentLogFile) {
-        currentLogFile.close();
-        LOG_I("Logger: Session stopped");
+static void startSegments(const LogRecord& header) {
+    closeSegment();
+
+    time_t epoch = header.header.epoch;
+    if (epoch >= EPOCH_VALID) {
+        struct tm timeinfo;
+        localtime_r(&epoch, &timeinfo);
+
+        // /logs/YYYYMMDD_HHMMSS
+        snprintf(sessionBase, sizeof(sessionBase),
+                 "%s%04d%02d%02d_%02d%02d%02d",
+                 LOG_FILE_PREFIX,
+                 timeinfo.tm_year + 1900,
+                 timeinfo.tm_mon + 1,
+                 timeinfo.tm_mday,
+                 timeinfo.tm_hour,
+                 timeinfo.tm_min,
+                 timeinfo.tm_sec);
+    } else {
+        // Часы не синхронизированы: /logs/bNNNNN_UUUUUUU (загрузка, секунды
+        // с загрузки). Счётчик загрузок сбрасывается при включении питания -
+        // занятое имя сдвигается на секунду
+        uint32_t uptime = millis() / 1000;
+        char first[64];
+        do {
+            snprintf(sessionBase, sizeof(sessionBase), "%sb%05lu_%07lu", LOG_FILE_PREFIX,
+                     (unsigned long)FlightRecorder::getBootCount(), (unsigned long)uptime++);
+            snprintf(first, sizeof(first), "%s_s00%s", sessionBase, LOG_FILE_EXT);
+        } while (SPIFFS.exists(first));
     }
+
+    sessionHeader = header;
+    segmentIndex = 0;
+    openSegment();
 }
 
-void writeData(const SystemState& state) {
+static void appendRecord(const LogRecord& record) {
     if (!currentLogFile) return;
 
-    // Формат: timestamp,temps...,pressure,abv,power,speed,volume,state,event
-    char line[256];
-    snprintf(line, sizeof(line),
-             "%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.0f,%.1f,%.1f,%d,",
-             millis() - sessionStart,
-             state.temps.cube,
-             state.temps.columnBottom,
-             state.temps.columnTop,
-             state.temps.reflux,
-             state.temps.tsa,
-             state.temps.waterIn,
-             state.temps.waterOut,
-             state.pressure.cube,
-             state.pressure.atmosphere,
-             state.hydrometer.abv,
-             state.power.power,
-             state.pump.speedMlPerHour,
-             state.pump.totalVolumeMl,
-             static_cast<int>(state.rectPhase));
-
-    currentLogFile.println(line);
-
-    // Периодически синхронизировать
-    static uint32_t lastFlush = 0;
-    if (millis() - lastFlush > 10000) {
-        currentLogFile.flush();
-        lastFlush = millis();
+    if (blockFill == 0) {
+        // Ротация на границе блока, чтобы сегмент не превысил лимит
+        if (currentLogFile.size() + LOG_BLOCK_SIZE > LOG_MAX_SIZE_BYTES) {
+            currentLogFile.close();
+            segmentIndex++;
+            openSegment();
+            if (!currentLogFile) return;
+        } else {
+            blockStartMs = millis();
+            // Раздел общий с историей и профилями - место могли занять они
+            if (Logger::getFreeSpace() < LOG_MIN_FREE_BYTES) {
+                Logger::cleanupOldLogs(0);
+            }
+        }
     }
-}
 
-void log(const LogEvent& event) {
-    // Записать событие
-    LOG_I("Event: %s", event.message);
+    memcpy(block + blockFill * sizeof(LogRecord), &record, sizeof(LogRecord));
+    blockFill++;
 
-    if (currentLogFile) {
-        char line[128];
-        snprintf(line, sizeof(line), "%lu,,,,,,,,,,,,,%d,%s",
-                 event.timestamp, event.type, event.message);
-        currentLogFile.println(line);
+    if (blockFill == RECORDS_PER_BLOCK) {
+        writeBlock(false);
     }
 }
 
-String getLogsList() {
-    String result = "[";
-    File root = SPIFFS.open(LOG_FILE_PREFIX);
+static void writerLoop(void* param) {
+    (void)param;
+    LogRecord record;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+        while (ringPop(record)) {
+            switch (record.kind) {
+                case LogRecordKind::HEADER:
+                    startSegments(record);
+                    break;
+
+                case LogRecordKind::CLOSE:
+                    appendRecord(record);
+                    closeSegment();
+                    break;
+
+                default:
+                    appendRecord(record);
+                    break;
+            }
+        }
 
-    if (!root || !root.isDirectory()) {
-        return "[]";
+        // Редкие данные (только события) не должны висеть в RAM бесконечно
+        if (blockFill > 0 && millis() - blockStartMs > LOG_FLUSH_TIMEOUT_MS) {
+            writeBlock(true);
+        }
     }
+}
 
-    File file = root.openNextFile();
-    bool first = true;
+// ============================================================================
+// Файлы
+// ============================================================================
+
+/**
+ * Сегмент на флеш
+ */
+struct LogFileInfo {
+    String name;
+    size_t size;
+
+    bool operator<(const LogFileInfo& other) const { return name < other.name; }
+};
 
+static void collectLogFiles(std::vector<LogFileInfo>& files) {
+    File root = SPIFFS.open(LOG_FILE_PREFIX);
+    if (!root || !root.isDirectory()) return;
+
+    File file = root.openNextFile();
     while (file) {
         if (!file.isDirectory()) {
-            if (!first) result += ",";
-            result += "\"" + String(file.name()) + "\"";
-            first = false;
+            String name = file.name();
+            if (name.endsWith(LOG_FILE_EXT)) {
+                LogFileInfo info = { name, file.size() };
+                files.push_back(info);
+            }
         }
         file = root.openNextFile();
     }
 
-    result += "]";
-    return result;
+    // Имена вида YYYYMMDD_HHMMSS_sNN - лексикографический порядок хронологичен.
+    // Сессии без синхронизации часов (bNNNNN_...) идут после датированных
+    // и удаляются последними
+    std::sort(files.begin(), files.end());
 }
 
-String readLog(const char* filename) {
-    File file = SPIFFS.open(filename, FILE_READ);
-    if (!file) {
-        return "";
+/**
+ * Сессия сегмента: имя без суффикса _sNN.bin
+ */
+static String sessionOf(const String& name) {
+    int pos = name.lastIndexOf("_s");
+    return pos > 0 ? name.substring(0, pos) : name;
+}
+
+static String fullPath(const char* filename) {
+    if (filename[0] == '/') return String(filename);
+    return String(LOG_FILE_PREFIX) + filename;
+}
+
+// ============================================================================
+// Публичный интерфейс
+// ============================================================================
+
+namespace Logger {
+
+bool init() {
+    LOG_I("Logger: Initializing...");
+
+    if (!SPIFFS.begin(true)) {
+        LOG_E("Logger: SPIFFS mount failed!");
+        return false;
     }
 
-    String content = file.readString();
-    file.close();
-    return content;
+    // Создать директорию для логов
+    if (!SPIFFS.exists(LOG_FILE_PREFIX)) {
+        SPIFFS.mkdir(LOG_FILE_PREFIX);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+
+    // Кольцо в PSRAM, при отсутствии - уменьшенное во внутренней RAM
+    ringCapacity = LOG_RING_RECORDS;
+    ring = static_cast<LogRecord*>(heap_caps_malloc(ringCapacity * sizeof(LogRecord),
+                                                    MALLOC_CAP_SPIRAM));
+    ringInPsram = (ring != nullptr);
+    if (!ring) {
+        ringCapacity = LOG_RING_RECORDS_FALLBACK;
+        ring = static_cast<LogRecord*>(malloc(ringCapacity * sizeof(LogRecord)));
+    }
+
+    // Блок собирается во внутренней RAM - запись во флеш из PSRAM медленнее
+    block = static_cast<uint8_t*>(heap_caps_malloc(LOG_BLOCK_SIZE,
+                                                   MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+
+    if (!ring || !block) {
+        LOG_E("Logger: Buffer allocation failed!");
+        return false;
+    }
+
+    stats.ringCapacity = ringCapacity;
+    stats.ringInPsram = ringInPsram;
+
+    xTaskCreatePinnedToCore(writerLoop, "logger", LOG_TASK_STACK, nullptr,
+                            LOG_TASK_PRIORITY, &writerTask, LOG_TASK_CORE);
+
+    LOG_I("Logger: Ready (ring %u records, %s)", ringCapacity, ringInPsram ? "PSRAM" : "internal");
+    return true;
+}
+
+bool startNewLog(Mode mode) {
+    if (!ring) return false;
+
+    sessionStart = millis();
+    sessionActive = true;
+
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = LogRecordKind::HEADER;
+    record.mode = static_cast<uint8_t>(mode);
+    record.header.magic = LOG_RECORD_MAGIC;
+    record.header.version = LOG_RECORD_VERSION;
+    record.header.recordSize = sizeof(LogRecord);
+    record.header.epoch = static_cast<uint32_t>(time(nullptr));
+
+    return ringPush(record);
+}
+
+void writeData(const SystemState& state) {
+    if (!sessionActive) return;
+
+    LogRecord record;
+    packData(state, millis() - sessionStart, Heater::getPower(), record);
+    ringPush(record);
+}
+
+void log(const LogEvent& event) {
+    LOG_I("Event: %s", event.message);
+    FlightRecorder::recordEvent(event);
+
+    portENTER_CRITICAL(&ringMux);
+    lastEvents[lastEventsHead] = event;
+    lastEventsHead = (lastEventsHead + 1) % LOG_EVENTS_KEEP;
+    if (lastEventsCount < LOG_EVENTS_KEEP) lastEventsCount++;
+    portEXIT_CRITICAL(&ringMux);
+
+    if (!sessionActive) return;
+
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timeMs = event.timestamp - sessionStart;
+    record.kind = LogRecordKind::EVENT;
+    record.heaterPercent = Heater::getPower();
+    record.event.type = event.type;
+    strncpy(record.event.message, event.message, sizeof(record.event.message) - 1);
+
+    ringPush(record);
+}
+
+void closeLog() {
+    if (!sessionActive) return;
+
+    LogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timeMs = millis() - sessionStart;
+    record.kind = LogRecordKind::CLOSE;
+
+    ringPush(record);
+    sessionActive = false;
+}
+
+uint8_t getLogFiles(char files[][32], uint8_t maxCount) {
+    std::vector<LogFileInfo> names;
+    collectLogFiles(names);
+
+    // Новые первыми
+    uint8_t count = 0;
+    for (auto it = names.rbegin(); it != names.rend() && count < maxCount; ++it) {
+        strncpy(files[count], it->name.c_str(), 31);
+        files[count][31] = '\0';
+        count++;
+    }
+    return count;
 }
 
 bool deleteLog(const char* filename) {
-    if (SPIFFS.remove(filename)) {
-        LOG_I("Logger: Deleted %s", filename);
+    String path = fullPath(filename);
+
+    if (strcmp(path.c_str(), currentFilename) == 0 && currentLogFile) {
+        LOG_W("Logger: %s is in use", filename);
+        return false;
+    }
+
+    if (SPIFFS.remove(path)) {
+        LOG_I("Logger: Deleted %s", path.c_str());
         return true;
     } else {
-        LOG_E("Logger: Failed to delete %s", filename);
+        LOG_E("Logger: Failed to delete %s", path.c_str());
         return false;
     }
 }
 
+void cleanupOldLogs(size_t reserve) {
+    std::vector<LogFileInfo> files;
+    collectLogFiles(files);
+
+    size_t logBytes = 0;
+    for (const LogFileInfo& file : files) {
+        logBytes += file.size;
+    }
+
+    // Сравнение по полному пути: currentFilename - путь, имя в списке - нет
+    String current = currentLogFile ? sessionOf(String(currentFilename)) : String();
+
+    // Сначала старые сессии целиком от старейшей, затем первые сегменты
+    // текущей. Открытый сегмент не трогаем
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        size_t i = 0;
+        while (i < files.size()) {
+            if (logBytes + reserve <= LOG_BUDGET_BYTES &&
+                getFreeSpace() >= reserve + LOG_MIN_FREE_BYTES) {
+                return;
+            }
+
+            String session = sessionOf(fullPath(files[i].name.c_str()));
+            bool ownSession = currentLogFile && session == current;
+            do {
+                bool open = fullPath(files[i].name.c_str()) == currentFilename;
+                if (ownSession == (pass == 1) && !open && deleteLog(files[i].name.c_str())) {
+                    logBytes -= files[i].size;
+                }
+                i++;
+            } while (!ownSession && i < files.size() &&
+                     sessionOf(fullPath(files[i].name.c_str())) == session);
+        }
+    }
+
+    if (logBytes + reserve > LOG_BUDGET_BYTES || getFreeSpace() < reserve + LOG_MIN_FREE_BYTES) {
+        LOG_W("Logger: No logs left to prune (%u bytes free)", (unsigned)getFreeSpace());
+    }
+}
+
+size_t exportLog(const char* filename, uint8_t* buffer, size_t maxSize) {
+    File file = SPIFFS.open(fullPath(filename), FILE_READ);
+    if (!file || maxSize == 0) return 0;
+
+    char* out = reinterpret_cast<char*>(buffer);
+    size_t used = snprintf(out, maxSize, "%s\n", LOG_CSV_HEADER);
+    if (used >= maxSize) {
+        file.close();
+        return 0;
+    }
+
+    LogRecord record;
+    char line[200];
+    while (file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record)) {
+        size_t len = formatCsv(record, line, sizeof(line));
+        if (len == 0) continue;
+        if (used + len + 1 >= maxSize) break;
+        memcpy(out + used, line, len);
+        used += len;
+        out[used++] = '\n';
+    }
+
+    out[used] = '\0';
+    file.close();
+    return used;
+}
+
+uint8_t getLastEvents(LogEvent* events, uint8_t count) {
+    portENTER_CRITICAL(&ringMux);
+    if (count > lastEventsCount) count = lastEventsCount;
+    // Новые первыми
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t idx = (lastEventsHead + LOG_EVENTS_KEEP - 1 - i) % LOG_EVENTS_KEEP;
+        events[i] = lastEvents[idx];
+    }
+    portEXIT_CRITICAL(&ringMux);
+    return count;
+}
+
+size_t getUsedSpace() {
+    return SPIFFS.usedBytes();
+}
+
+size_t getFreeSpace() {
+    return SPIFFS.totalBytes() - SPIFFS.usedBytes();
+}
+
+const char* getCurrentLogFile() {
+    return currentLogFile ? currentFilename : nullptr;
+}
+
+void getStats(LoggerStats& out) {
+    portENTER_CRITICAL(&ringMux);
+    out = stats;
+    out.ringPending = ringHead - ringTail;
+    portEXIT_CRITICAL(&ringMux);
+}
+
 } // namespace Logger
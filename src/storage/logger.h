@@ -1,7 +1,11 @@
 /**
  * Smart-Column S3 - Logger
- * 
- * Логирование данных на SPIFFS в формате CSV
+ *
+ * Логирование данных на LittleFS в бинарном формате
+ *
+ * Записи фиксированного размера копятся в кольце PSRAM и
+ * сбрасываются низкоприоритетной задачей блоками по 4 КБ
+ * (размер страницы флеш), файлы ротируются по размеру.
  */
 
 #ifndef LOGGER_H
@@ -11,37 +15,110 @@
 #include "config.h"
 #include "types.h"
 
+/**
+ * Тип бинарной записи
+ */
+enum class LogRecordKind : uint8_t {
+    DATA = 0,           // Срез состояния
+    EVENT,              // Событие (LogEvent)
+    HEADER,             // Заголовок сегмента / начало сессии
+    CLOSE               // Завершение сессии
+};
+
+/**
+ * Бинарная запись лога (64 байта, 64 записи = 1 блок флеш)
+ */
+struct LogRecord {
+    uint32_t timeMs;                    // Время от начала сессии (мс)
+    LogRecordKind kind;
+    uint8_t mode;                       // Mode
+    uint8_t phase;                      // RectPhase
+    uint8_t heaterPercent;              // Заданная мощность ТЭНа (%)
+    union {
+        struct {
+            float temps[TEMP_COUNT];    // Температуры по индексам TEMP_*
+            float pressureCube;         // мм рт.ст.
+            float pressureAtm;          // гПа
+            float abv;                  // %
+            float power;                // Вт
+            float pumpSpeed;            // мл/час
+            float pumpVolume;           // мл
+            uint8_t validMask;          // Бит i = temps[i] валидна
+            uint8_t valves;             // Бит 0=вода, 1=головы, 2=УНО
+            uint8_t reserved[2];
+        } data;
+        struct {
+            uint8_t type;               // LogEvent::type
+            char message[sizeof(LogEvent::message)];
+        } event;
+        struct {
+            uint32_t magic;             // LOG_RECORD_MAGIC
+            uint16_t version;           // LOG_RECORD_VERSION
+            uint16_t recordSize;        // sizeof(LogRecord)
+            uint32_t epoch;             // Время старта сессии (epoch)
+            uint16_t segment;           // Номер сегмента в сессии
+        } header;
+    };
+};
+
+static_assert(sizeof(LogRecord) == 64, "LogRecord must be 64 bytes");
+static_assert(LOG_BLOCK_SIZE % sizeof(LogRecord) == 0, "Block must hold whole records");
+
+#define LOG_RECORD_MAGIC        0x4C434D53  // "SMCL"
+#define LOG_RECORD_VERSION      1
+
+/**
+ * Заголовок CSV (формат экспорта)
+ */
+#define LOG_CSV_HEADER  "timestamp,t_cube,t_col_bot,t_col_top,t_reflux,t_tsa,t_water_in,t_water_out," \
+                        "p_cube,p_atm,abv,power,speed,volume,state,heater,valves,event_type,event"
+
+/**
+ * Статистика записи на флеш (для прогноза ресурса)
+ */
+struct LoggerStats {
+    uint32_t bytesWritten;              // Всего записано с момента загрузки
+    uint32_t blocksWritten;             // Блоков записано
+    uint32_t bytesThisHour;             // Записано за текущий час
+    uint32_t bytesLastHour;             // Записано за прошлый полный час
+    uint32_t droppedRecords;            // Потеряно записей (кольцо заполнено)
+    uint16_t segmentsOpened;            // Открыто сегментов
+    uint16_t ringCapacity;              // Ёмкость кольца (записей)
+    uint16_t ringPending;               // Ожидают записи
+    bool ringInPsram;                   // Кольцо размещено в PSRAM
+};
+
 namespace Logger {
     /**
      * Инициализация логгера
      * @return true если успешно
      */
     bool init();
-    
+
     /**
      * Начало нового лога (при старте режима)
      * @param mode Режим работы
      * @return true если успешно
      */
     bool startNewLog(Mode mode);
-    
+
     /**
      * Запись данных
      * @param state Состояние системы
      */
     void writeData(const SystemState& state);
-    
+
     /**
      * Запись события
      * @param event Событие
      */
     void log(const LogEvent& event);
-    
+
     /**
      * Завершение текущего лога
      */
     void closeLog();
-    
+
     /**
      * Получение списка файлов логов
      * @param files Массив имён файлов
@@ -49,29 +126,50 @@ namespace Logger {
      * @return Количество найденных
      */
     uint8_t getLogFiles(char files[][32], uint8_t maxCount);
-    
+
     /**
      * Удаление лог-файла
      * @param filename Имя файла
      * @return true если успешно
      */
     bool deleteLog(const char* filename);
-    
+
     /**
-     * Удаление старых логов (оставить последние N)
-     * @param keepCount Сколько оставить
+     * Удаление старых логов: пока /logs с запасом на сегмент больше
+     * LOG_BUDGET_BYTES или в разделе свободно меньше LOG_MIN_FREE_BYTES.
+     * Старые сессии удаляются целиком; текущая, если одна не помещается, -
+     * с первых сегментов (каждый сегмент читается независимо)
+     * @param reserve Байт, которые ещё будут записаны (новый сегмент)
      */
-    void cleanupOldLogs(uint8_t keepCount);
-    
+    void cleanupOldLogs(size_t reserve = LOG_MAX_SIZE_BYTES);
+
     /**
-     * Экспорт лога в буфер
+     * Экспорт лога в буфер (CSV)
      * @param filename Имя файла
      * @param buffer Буфер для данных
      * @param maxSize Максимальный размер
      * @return Размер данных
      */
     size_t exportLog(const char* filename, uint8_t* buffer, size_t maxSize);
-    
+
+    /**
+     * Упаковка среза состояния в запись DATA
+     * @param state Состояние системы
+     * @param timeMs Время от начала сессии (мс)
+     * @param heaterPercent Заданная мощность ТЭНа (%)
+     * @param record Запись (выход)
+     */
+    void packData(const SystemState& state, uint32_t timeMs, uint8_t heaterPercent, LogRecord& record);
+
+    /**
+     * Форматирование записи в строку CSV (без перевода строки)
+     * @param record Запись
+     * @param buffer Буфер
+     * @param size Размер буфера
+     * @return Длина строки, 0 для служебных записей
+     */
+    size_t formatCsv(const LogRecord& record, char* buffer, size_t size);
+
     /**
      * Получение последних N записей
      * @param events Массив событий
@@ -79,24 +177,30 @@ namespace Logger {
      * @return Реальное количество
      */
     uint8_t getLastEvents(LogEvent* events, uint8_t count);
-    
+
     /**
      * Получение использованного места
      * @return Байт использовано
      */
     size_t getUsedSpace();
-    
+
     /**
      * Получение свободного места
      * @return Байт свободно
      */
     size_t getFreeSpace();
-    
+
     /**
      * Получение имени текущего лог-файла
      * @return Имя файла или nullptr
      */
     const char* getCurrentLogFile();
+
+    /**
+     * Получение статистики записи на флеш
+     * @param stats Структура для записи
+     */
+    void getStats(LoggerStats& stats);
 }
 
 #endif // LOGGER_H
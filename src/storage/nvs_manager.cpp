@@ -1,27 +1,64 @@
 /**
  * Smart-Column S3 - Менеджер NVS (Non-Volatile Storage)
  *
- * Сохранение и загрузка настроек во флеш-память
+ * Сохранение и загрузка настроек во флеш-память.
+ * Settings хранится одним блобом (заголовок + структура + CRC).
+ * Изменения из веб-обработчиков только помечают настройки грязными,
+ * запись выполняет отдельная задача после паузы в изменениях. Снимок
+ * пишет только она: flush() просит задачу записать сразу и ждёт.
  */
 
 #include "nvs_manager.h"
+#include "crc32.h"
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <type_traits>
+#include <atomic>
+
+#define SETTINGS_MAGIC  0x53544753  // "SGTS"
+
+static_assert(std::is_trivially_copyable<Settings>::value, "Settings must be POD for blob storage");
+
+/**
+ * Заголовок блоба
+ */
+struct SettingsBlobHeader {
+    uint32_t magic;
+    uint16_t version;               // SETTINGS_SCHEMA_VERSION на момент записи
+    uint16_t size;                  // sizeof(Settings) на момент записи
+    uint32_t crc;                   // CRC32 данных после заголовка
+};
 
 static Preferences prefs;
+static SemaphoreHandle_t nvsMutex = nullptr;
+static TaskHandle_t writerTask = nullptr;
+static const Settings* source = nullptr;
 
-namespace NVSManager {
+static volatile bool dirty = false;
+static volatile uint32_t lastChange = 0;
+static std::atomic<bool> flushRequested(false);  // flush() ждёт записи задачей
+static volatile bool flushOk = true;
+static bool legacyKeys = false;     // Старые отдельные ключи ещё не удалены
+static uint32_t lastCrc = 0;        // CRC последнего записанного блоба
+static uint32_t commitCount = 0;
 
-bool init() {
-    LOG_I("NVS: Initializing...");
-    // Preferences автоматически инициализируется
-    LOG_I("NVS: Ready");
-    return true;
-}
+static Settings snapshot;           // Копия для записи (не на стеке задачи)
 
-bool loadSettings(Settings& settings) {
-    LOG_I("NVS: Loading settings...");
+// ============================================================================
+// Схема и миграции
+// ============================================================================
 
-    prefs.begin(NVS_NAMESPACE, true); // Read-only
+/**
+ * Настройки до версии 1 - отдельные ключи
+ * @return true если хотя бы один ключ найден
+ */
+static bool loadLegacyKeys(Settings& settings) {
+    if (!prefs.isKey(NVS_KEY_WIFI_SSID) && !prefs.isKey(NVS_KEY_HEATER_POWER) &&
+        !prefs.isKey(NVS_KEY_PUMP_ML_REV)) {
+        return false;
+    }
 
     // WiFi
     prefs.getString(NVS_KEY_WIFI_SSID, settings.wifi.ssid, sizeof(settings.wifi.ssid));
@@ -40,55 +77,260 @@ bool loadSettings(Settings& settings) {
     // Калибровка насоса
     settings.pumpCal.mlPerRevolution = prefs.getFloat(NVS_KEY_PUMP_ML_REV, DEFAULT_PUMP_ML_PER_REV);
 
+    // Порог захлёба (ручная калибровка старых версий)
+    settings.floodCal.pressure = prefs.getFloat(NVS_KEY_PRESSURE_FLOOD, 0);
+
     // Прочее
     settings.language = prefs.getUChar(NVS_KEY_LANGUAGE, 0);
     settings.theme = prefs.getUChar(NVS_KEY_THEME, 0);
     settings.soundEnabled = prefs.getBool(NVS_KEY_SOUND, true);
 
-    prefs.end();
-
-    LOG_I("NVS: Settings loaded");
     return true;
 }
 
-bool saveSettings(const Settings& settings) {
-    LOG_I("NVS: Saving settings...");
+static void removeLegacyKeys() {
+    static const char* const keys[] = {
+        NVS_KEY_WIFI_SSID, NVS_KEY_WIFI_PASS, NVS_KEY_TG_TOKEN, NVS_KEY_TG_CHAT,
+        NVS_KEY_LANGUAGE, NVS_KEY_THEME, NVS_KEY_SOUND, NVS_KEY_COLUMN_HEIGHT,
+        NVS_KEY_PACKING_TYPE, NVS_KEY_PACKING_COEFF, NVS_KEY_HEATER_POWER,
+        NVS_KEY_CUBE_VOLUME, NVS_KEY_TEMP_OFFSETS, NVS_KEY_PUMP_ML_REV,
+        NVS_KEY_PRESSURE_FLOOD, NVS_KEY_HYDRO_POINTS, NVS_KEY_FRACTION_ANGLES,
+        NVS_KEY_FRACTION_ENABLED
+    };
+    for (const char* key : keys) {
+        prefs.remove(key);
+    }
+}
 
-    prefs.begin(NVS_NAMESPACE, false); // Read-write
+/**
+ * Миграция блоба старой версии схемы.
+ * Данные старой версии уже скопированы поверх значений по умолчанию
+ * (поля добавляются только в конец структур верхнего уровня).
+ * Шаги выполняются последовательно начиная с fromVersion.
+ */
+static void migrate(uint16_t fromVersion, Settings& settings) {
+    switch (fromVersion) {
+        case 1:
+            // v2: калибровка захлёба - до первого прогона порог по высоте и насадке
+            memset(&settings.floodCal, 0, sizeof(settings.floodCal));
+            // fallthrough
+        default:
+            break;
+    }
+}
 
-    // WiFi
-    prefs.putString(NVS_KEY_WIFI_SSID, settings.wifi.ssid);
-    prefs.putString(NVS_KEY_WIFI_PASS, settings.wifi.password);
+// ============================================================================
+// Запись блоба
+// ============================================================================
 
-    // Telegram
-    prefs.putString(NVS_KEY_TG_TOKEN, settings.telegram.token);
-    prefs.putString(NVS_KEY_TG_CHAT, settings.telegram.chatId);
+static bool writeBlob(const Settings& settings) {
+    SettingsBlobHeader header;
+    header.magic = SETTINGS_MAGIC;
+    header.version = SETTINGS_SCHEMA_VERSION;
+    header.size = sizeof(Settings);
+    header.crc = crc32(&settings, sizeof(Settings));
 
-    // Оборудование
-    prefs.putUShort(NVS_KEY_COLUMN_HEIGHT, settings.equipment.columnHeightMm);
-    prefs.putUShort(NVS_KEY_HEATER_POWER, settings.equipment.heaterPowerW);
-    prefs.putUShort(NVS_KEY_CUBE_VOLUME, settings.equipment.cubeVolumeL);
-    prefs.putFloat(NVS_KEY_PACKING_COEFF, settings.equipment.packingCoeff);
+    xSemaphoreTake(nvsMutex, portMAX_DELAY);
 
-    // Калибровка насоса
-    prefs.putFloat(NVS_KEY_PUMP_ML_REV, settings.pumpCal.mlPerRevolution);
+    // Без изменений - флеш не трогаем
+    if (header.crc == lastCrc && !legacyKeys) {
+        xSemaphoreGive(nvsMutex);
+        return true;
+    }
 
-    // Прочее
-    prefs.putUChar(NVS_KEY_LANGUAGE, settings.language);
-    prefs.putUChar(NVS_KEY_THEME, settings.theme);
-    prefs.putBool(NVS_KEY_SOUND, settings.soundEnabled);
+    bool ok = prefs.begin(NVS_NAMESPACE, false);
+    if (ok) {
+        // Один ключ - одна запись в NVS
+        static uint8_t blob[sizeof(SettingsBlobHeader) + sizeof(Settings)];
+        memcpy(blob, &header, sizeof(header));
+        memcpy(blob + sizeof(header), &settings, sizeof(Settings));
+        ok = prefs.putBytes(NVS_KEY_SETTINGS, blob, sizeof(blob)) == sizeof(blob);
 
-    prefs.end();
+        if (ok && legacyKeys) {
+            removeLegacyKeys();
+            legacyKeys = false;
+        }
+        prefs.end();
+    }
+
+    if (ok) {
+        lastCrc = header.crc;
+        commitCount++;
+    }
+
+    xSemaphoreGive(nvsMutex);
+
+    if (ok) {
+        LOG_I("NVS: Settings saved (%u bytes, commit #%lu)",
+              (unsigned)sizeof(Settings), (unsigned long)commitCount);
+    } else {
+        LOG_E("NVS: Failed to save settings");
+    }
+    return ok;
+}
+
+static bool commit() {
+    xSemaphoreTake(nvsMutex, portMAX_DELAY);
+    if (!dirty || !source) {
+        xSemaphoreGive(nvsMutex);
+        return true;
+    }
+
+    // Сброс до копирования: изменение во время копирования снова
+    // пометит настройки, и следующая запись его подхватит
+    dirty = false;
+    memcpy(&snapshot, source, sizeof(Settings));
+    xSemaphoreGive(nvsMutex);
+
+    return writeBlob(snapshot);
+}
+
+static void writerLoop(void* param) {
+    (void)param;
 
-    LOG_I("NVS: Settings saved");
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Серия изменений объединяется в одну запись (flush() - без паузы)
+        while (millis() - lastChange < NVS_WRITE_DELAY_MS &&
+               !flushRequested.load(std::memory_order_acquire)) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+
+        bool ok = commit();
+        if (flushRequested.load(std::memory_order_acquire)) {
+            // Изменения, помеченные во время записи выше, - тоже до ответа
+            flushOk = commit() && ok;
+            flushRequested.store(false, std::memory_order_release);
+        }
+    }
+}
+
+// ============================================================================
+// Публичный интерфейс
+// ============================================================================
+
+namespace NVSManager {
+
+bool init() {
+    LOG_I("NVS: Initializing...");
+    if (!nvsMutex) {
+        nvsMutex = xSemaphoreCreateMutex();
+    }
+    LOG_I("NVS: Ready");
     return true;
 }
 
+bool loadSettings(Settings& settings) {
+    LOG_I("NVS: Loading settings...");
+
+    xSemaphoreTake(nvsMutex, portMAX_DELAY);
+    prefs.begin(NVS_NAMESPACE, true); // Read-only
+
+    bool loaded = false;
+    bool needsWrite = false;
+    size_t length = prefs.getBytesLength(NVS_KEY_SETTINGS);
+
+    if (length >= sizeof(SettingsBlobHeader)) {
+        uint8_t* blob = static_cast<uint8_t*>(malloc(length));
+        if (blob && prefs.getBytes(NVS_KEY_SETTINGS, blob, length) == length) {
+            SettingsBlobHeader header;
+            memcpy(&header, blob, sizeof(header));
+            const uint8_t* data = blob + sizeof(header);
+            size_t dataSize = length - sizeof(header);
+
+            if (header.magic != SETTINGS_MAGIC || header.size != dataSize ||
+                header.crc != crc32(data, dataSize)) {
+                LOG_E("NVS: Settings blob corrupted, using defaults");
+            } else if (header.version > SETTINGS_SCHEMA_VERSION) {
+                LOG_W("NVS: Settings schema v%u is newer than firmware, using defaults",
+                      header.version);
+            } else {
+                memcpy(&settings, data, dataSize < sizeof(Settings) ? dataSize : sizeof(Settings));
+                if (header.version < SETTINGS_SCHEMA_VERSION || header.size != sizeof(Settings)) {
+                    LOG_I("NVS: Migrating settings v%u -> v%u",
+                          header.version, SETTINGS_SCHEMA_VERSION);
+                    migrate(header.version, settings);
+                    needsWrite = true;
+                }
+                loaded = true;
+            }
+        }
+        free(blob);
+    }
+
+    if (!loaded && loadLegacyKeys(settings)) {
+        LOG_I("NVS: Migrating legacy keys to settings blob");
+        legacyKeys = true;
+        needsWrite = true;
+        loaded = true;
+    }
+
+    prefs.end();
+    xSemaphoreGive(nvsMutex);
+
+    // CRC актуального блоба - чтобы не переписывать его без изменений
+    if (loaded && !needsWrite) {
+        lastCrc = crc32(&settings, sizeof(Settings));
+    }
+    if (needsWrite) {
+        writeBlob(settings);
+    }
+
+    LOG_I("NVS: Settings loaded%s", loaded ? "" : " (defaults)");
+    return loaded;
+}
+
+bool saveSettings(const Settings& settings) {
+    return writeBlob(settings);
+}
+
+void startWriteBehind(const Settings& settings) {
+    source = &settings;
+    if (writerTask) return;
+
+    xTaskCreatePinnedToCore(writerLoop, "nvs", NVS_TASK_STACK, nullptr,
+                            NVS_TASK_PRIORITY, &writerTask, NVS_TASK_CORE);
+}
+
+void markDirty() {
+    lastChange = millis();
+    dirty = true;
+    if (writerTask) {
+        xTaskNotifyGive(writerTask);
+    }
+}
+
+bool flush(uint32_t timeoutMs) {
+    // Задачи нет - снимок больше никто не пишет
+    if (!writerTask) return commit();
+
+    flushRequested.store(true, std::memory_order_release);
+    xTaskNotifyGive(writerTask);
+
+    uint32_t start = millis();
+    while (flushRequested.load(std::memory_order_acquire)) {
+        if (millis() - start >= timeoutMs) {
+            LOG_W("NVS: Flush timed out");
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return flushOk;
+}
+
+uint32_t getCommitCount() {
+    return commitCount;
+}
+
 void reset() {
     LOG_I("NVS: Resetting to defaults...");
+    xSemaphoreTake(nvsMutex, portMAX_DELAY);
     prefs.begin(NVS_NAMESPACE, false);
     prefs.clear();
     prefs.end();
+    xSemaphoreGive(nvsMutex);
+    lastCrc = 0;
     LOG_I("NVS: Reset complete");
 }
 
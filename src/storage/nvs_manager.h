@@ -26,11 +26,37 @@ namespace NVSManager {
     bool loadSettings(Settings& settings);
     
     /**
-     * Сохранение всех настроек
+     * Немедленное сохранение всех настроек (одним блобом)
      * @param settings Настройки для сохранения
-     * @return true если успешно
+     * @return true если успешно (или блоб не изменился)
      */
     bool saveSettings(const Settings& settings);
+
+    /**
+     * Запуск отложенной записи
+     * @param settings Настройки, которые сохраняются по markDirty()
+     */
+    void startWriteBehind(const Settings& settings);
+
+    /**
+     * Пометить настройки изменёнными. Запись выполняется задачей
+     * через NVS_WRITE_DELAY_MS после последнего изменения.
+     */
+    void markDirty();
+
+    /**
+     * Запись отложенных изменений без паузы (перед перезагрузкой).
+     * Пишет задача записи, вызывающая ждёт её; до startWriteBehind() -
+     * на вызывающей задаче
+     * @param timeoutMs Предел ожидания
+     * @return true если успешно, false - ошибка записи или задача не успела
+     */
+    bool flush(uint32_t timeoutMs = NVS_FLUSH_TIMEOUT_MS);
+
+    /**
+     * Количество записей блоба с момента загрузки
+     */
+    uint32_t getCommitCount();
     
     /**
      * Сброс к заводским настройкам
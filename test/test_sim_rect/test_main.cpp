@@ -0,0 +1,64 @@
+/**
+ * Smart-Column S3 - Тест симулятора: ректификация
+ *
+ * Полный погон Sim::run() на модели колонны (seed 1): процесс завершается,
+ * захлёбы после снижения уставки WattControl не повторяются по кругу,
+ * прогноз хвостов RunEta по временному ряду погона без систематической
+ * ошибки и факт попадает в интервал. Конец тела в прогнозе - крепость
+ * в кубе на входе в хвосты этого же погона: высокая царга модели ведёт
+ * тело дальше RUN_ETA_TAILS_ABV, с ним ошибка только выводится.
+ * Статика модулей не сбрасывается - один прогон на программу.
+ *
+ * pio test -e native -f test_sim_rect
+ */
+
+#include <unity.h>
+#include "sim/sim.h"
+
+#define TEST_MAX_FLOOD_TRIPS    6       // Захлёбов за погон (без снижения уставки 16-56)
+#define TEST_MAX_ETA_BIAS_MIN   30.0f   // Средняя ошибка прогноза хвостов со знаком
+#define TEST_MAX_ETA_ERROR_MIN  60.0f   // Средняя |ошибка| (погон ~38 ч тела)
+#define TEST_MIN_ETA_COVERAGE   0.8f    // Доля прогнозов с фактом внутри интервала
+
+static SimResult result;
+
+void setUp() {}
+void tearDown() {}
+
+void test_rect_completes() {
+    TEST_ASSERT_EQUAL_INT(0, result.exitCode);
+    TEST_ASSERT_GREATER_THAN(0, result.bodySamples);
+}
+
+void test_rect_floods_bounded() {
+    TEST_ASSERT_LESS_OR_EQUAL(TEST_MAX_FLOOD_TRIPS, result.floodTrips);
+}
+
+void test_rect_eta_unbiased() {
+    TEST_ASSERT_TRUE(result.etaValid);
+
+    char line[128];
+    snprintf(line, sizeof(line), "tails at %.1f %%: bias %+.0f min, at %.1f %%: bias %+.0f min",
+             result.eta.tailsAbv, result.eta.tailsBiasMin, result.etaFit.tailsAbv,
+             result.etaFit.tailsBiasMin);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_FLOAT_WITHIN(TEST_MAX_ETA_BIAS_MIN, 0.0f, result.etaFit.tailsBiasMin);
+    TEST_ASSERT_LESS_THAN_FLOAT(TEST_MAX_ETA_ERROR_MIN, result.etaFit.tailsErrorMin);
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_MIN_ETA_COVERAGE, result.etaFit.coverage);
+}
+
+int main() {
+    SimOptions options;
+    Sim::defaults(options);
+    options.mode = Mode::RECTIFICATION;
+    options.config.seed = 1;
+    options.quiet = true;
+    Sim::run(options, result);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_rect_completes);
+    RUN_TEST(test_rect_floods_bounded);
+    RUN_TEST(test_rect_eta_unbiased);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+/**
+ * Smart-Column S3 - Тест WattControl на модели колонны
+ *
+ * Замкнутый контур ТЭН → давление куба на модели src/sim/plant:
+ * регулятор по прогнозу против прежней линейной зависимости
+ * getRecommendedPower() со снижением после захлёбов. Один seed шумов,
+ * одинаковый разгон, статистика по установившемуся участку. Разброс
+ * давления - СКО от уставки: прежний закон с положительной обратной
+ * связью гасит колонну до нуля, и разброс от среднего там почти нулевой.
+ *
+ * pio test -e native -f test_watt_control
+ */
+
+#include <unity.h>
+#include "sim/plant.h"
+#include "hal/hal.h"
+#include "control/watt_control.h"
+#include "drivers/heater.h"
+
+#define TEST_TICK_MS            100     // Шаг модели, как SIM_TICK_MS
+#define TEST_WARMUP_MAX_MS      (6UL * 3600 * 1000)
+#define TEST_SETTLE_MS          (30UL * 60 * 1000)
+#define TEST_RUN_MS             (3UL * 3600 * 1000)
+#define TEST_SAMPLE_MS          1000
+
+/**
+ * Статистика установившегося участка
+ */
+struct LoopStats {
+    float pressureMean;
+    float pressureRms;              // СКО от уставки
+    float powerMean;
+    uint32_t floodTrips;
+};
+
+static SystemState state;
+
+static void tick() {
+    Plant::step(TEST_TICK_MS / 1000.0f);
+    Hal::Host::advance(TEST_TICK_MS);
+    state.pressure.cube = Plant::readPressure();
+}
+
+/**
+ * Прежний закон: мощность линейно по давлению до рабочего порога,
+ * после захлёба -15%, восстановление 5% в минуту
+ */
+static uint8_t legacyPower(float pressure, uint8_t& reduction, uint32_t& reductionTime) {
+    float work, warn, crit;
+    WattControl::getThresholds(work, warn, crit);
+    uint32_t now = Hal::millis();
+
+    if (pressure >= crit && now - reductionTime > 5000) {
+        reduction = reduction + 15 > 50 ? 50 : reduction + 15;
+        reductionTime = now;
+    }
+    if (reduction > 0 && now - reductionTime > 60000) {
+        reduction = reduction >= 5 ? reduction - 5 : 0;
+        reductionTime = now;
+    }
+
+    uint8_t power = WattControl::getRecommendedPower(pressure);
+    return power > reduction ? power - reduction : 0;
+}
+
+/**
+ * Разгон на полной мощности до кипения, затем регулирование
+ * @param mpc true - WattControl::update, false - прежний закон
+ */
+static void runLoop(bool mpc, LoopStats& out) {
+    PlantConfig config;
+    Plant::defaults(config);
+    config.seed = 1;
+    Plant::init(config);
+    Plant::setWater(true);
+
+    EquipmentSettings equipment;
+    memset(&equipment, 0, sizeof(equipment));
+    equipment.columnHeightMm = DEFAULT_COLUMN_HEIGHT_MM;
+    equipment.packingCoeff = DEFAULT_PACKING_COEFF;
+    equipment.heaterPowerW = DEFAULT_HEATER_POWER_W;
+    WattControl::init(equipment);
+
+    float work, warn, crit;
+    WattControl::getThresholds(work, warn, crit);
+    float target = WattControl::getModel().target;
+
+    memset(&state, 0, sizeof(state));
+    state.health.ads1115Ok = true;
+
+    Heater::setPower(100);
+    for (uint32_t t = 0; t < TEST_WARMUP_MAX_MS && state.pressure.cube < work * 0.5f;
+         t += TEST_TICK_MS) {
+        tick();
+    }
+    WattControl::resetModel(Heater::getPower());
+
+    uint8_t reduction = 0;
+    uint32_t reductionTime = 0;
+    bool tripped = false;
+    double sumP = 0, sumErr2 = 0, sumU = 0;
+    uint32_t samples = 0;
+    memset(&out, 0, sizeof(out));
+
+    for (uint32_t t = 0; t < TEST_RUN_MS; t += TEST_TICK_MS) {
+        tick();
+        float pressure = state.pressure.cube;
+
+        uint8_t power = mpc ? WattControl::update(state, 100)
+                            : legacyPower(pressure, reduction, reductionTime);
+        if (Heater::getPower() != power) {
+            Heater::setPower(power);
+        }
+
+        if (!tripped && pressure >= crit) {
+            out.floodTrips++;
+            tripped = true;
+        } else if (tripped && pressure < warn) {
+            tripped = false;
+        }
+
+        if (t >= TEST_SETTLE_MS && t % TEST_SAMPLE_MS == 0) {
+            sumP += pressure;
+            sumErr2 += (pressure - target) * (pressure - target);
+            sumU += Heater::getPower();
+            samples++;
+        }
+    }
+
+    out.pressureMean = sumP / samples;
+    out.pressureRms = sqrt(sumErr2 / samples);
+    out.powerMean = sumU / samples;
+
+    char line[128];
+    snprintf(line, sizeof(line),
+             "%s: %.1f mmHg, RMS %.2f from target, heater %.0f %%, %u flood trips",
+             mpc ? "MPC" : "linear", out.pressureMean, out.pressureRms, out.powerMean,
+             (unsigned)out.floodTrips);
+    TEST_MESSAGE(line);
+}
+
+// ============================================================================
+// ТЕСТЫ
+// ============================================================================
+
+void setUp() {}
+void tearDown() {}
+
+void test_mpc_beats_linear_mapping() {
+    LoopStats linear, mpc;
+    runLoop(false, linear);
+    runLoop(true, mpc);
+
+    TEST_ASSERT_LESS_THAN_FLOAT(linear.pressureRms, mpc.pressureRms);
+    TEST_ASSERT_GREATER_THAN_FLOAT(linear.powerMean, mpc.powerMean);
+    TEST_ASSERT_LESS_OR_EQUAL(1, mpc.floodTrips);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_mpc_beats_linear_mapping);
+    return UNITY_END();
+}